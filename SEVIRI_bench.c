@@ -0,0 +1,1383 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ *******************************************************************************
+ *
+ *    This program benchmarks seviri_util on synthetic data so that no real
+ *    SEVIRI files are required.  For each image size it writes Native, BSQ and
+ *    HRIT files to the given work directory and times, separately, the Native
+ *    and BSQ writers, the Native header parse, reading and unpacking of the
+ *    Native, BSQ and HRIT files, navigation, solar angles, viewing angles and
+ *    pre-processing to each unit.  The read_mem stage reads the same file from
+ *    a memory buffer, through the open member of struct seviri_options, rather
+ *    than from disk.  The read_thread stage reads the Native file on a reader
+ *    thread READ_DEPTH chunks deep, through the read_depth, thread_start and
+ *    thread_join members, so that the reads overlap the unpacking.  The
+ *    read_band stage reads the first band only, which shows the benefit of
+ *    the band sequential layout.  The HRV band, which the full disk and RSS
+ *    data include, is read and pre-processed on its own in the read_hrv and
+ *    hrv stages, for which the pixels are those at HRV resolution.  The
+ *    ingest stages feed the HRIT segments one at a time to the incremental
+ *    ingest, ingest_last being the time from the last segment to the
+ *    completed image.  The read_preproc stage reads and pre-processes the VIR
+ *    bands with
+ *    seviri_read_and_preproc_nat() or seviri_read_and_preproc_hrit() and the
+ *    threads stage runs the same on several threads at once, as a check that
+ *    the library may be called concurrently.  The output of each thread must
+ *    be identical to that of the serial run.
+ *    The pixels read back are checked against the synthetic counts.
+ *
+ *    Usage: SEVIRI_bench [-r n_repeats] [-s size] [-t n_threads] [-k] work_dir
+ *
+ *    -r n_repeats	Number of times each stage is run (default 3), the
+ *			fastest is reported.
+ *    -s size		Image size to run: full_disk, rss or subset.  May be
+ *			given more than once.  The default is all sizes.
+ *    -t n_threads	Number of concurrent runs of the threads stage
+ *			(default 4).
+ *    -k		Keep the synthetic files rather than deleting them.
+ *
+ *    Each result is printed as one line with the columns: size, format, stage,
+ *    number of pixels processed, best time in seconds and throughput in
+ *    Mpixel/s.  The calib_* stages are the calibration alone, from the
+ *    SEVIRI_PERF_CALIB statistics of the pre-processing, and are only
+ *    reported when the library is compiled with -DSEVIRI_PERF.
+ *
+ *    Files are read back immediately after being written so the reads are
+ *    normally from the page cache.
+ *
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <time.h>
+
+#include "SEVIRI_bench.h"
+#include "hrit_anc_funcs.h"
+#include "internal.h"
+
+
+#define N_BANDS		(SEVIRI_N_BANDS - 1)
+
+/* Chunks held by the reader thread of the read_thread stage. */
+#define READ_DEPTH	3
+
+
+/* The units pre-processed to with the bands they apply to, given as the first
+   band index and the number of bands. */
+static const struct {
+     const char *name;
+     enum seviri_units unit;
+     uint i_band;
+     uint n_bands;
+} bench_units[] = {
+     {"cnt", SEVIRI_UNIT_CNT, 0, 11},
+     {"rad", SEVIRI_UNIT_RAD, 0, 11},
+     {"ref", SEVIRI_UNIT_REF, 0,  3},
+     {"brf", SEVIRI_UNIT_BRF, 0,  3},
+     {"bt",  SEVIRI_UNIT_BT,  3,  8},
+     {"hrv", SEVIRI_UNIT_BRF, 11, 1}
+};
+
+#define N_BENCH_UNITS (sizeof(bench_units) / sizeof(bench_units[0]))
+
+
+
+/*******************************************************************************
+ * Monotonic wall clock time in seconds.
+ ******************************************************************************/
+static double get_time(void)
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+
+     return ts.tv_sec + ts.tv_nsec / 1.e9;
+}
+
+
+
+/*******************************************************************************
+ * Print one result line.
+ ******************************************************************************/
+static void print_result(enum seviri_bench_sizes size, const char *format,
+                         const char *stage, double n_pixels, double t)
+{
+     printf("%-10s %-5s %-12s %12.0f %10.4f %10.2f\n", seviri_bench_size_names[size],
+            format, stage, n_pixels, t, t > 0. ? n_pixels / 1.e6 / t : 0.);
+     fflush(stdout);
+}
+
+
+
+/*******************************************************************************
+ * Check the image read back against the synthetic image, which may be larger.
+ ******************************************************************************/
+static int check_counts(const struct seviri_image_data *a,
+                        const struct seviri_image_data *b)
+{
+     uint i;
+     uint j;
+     uint k;
+
+     uint i_line;
+     uint i_column;
+
+     i_line   = a->i_line   - b->i_line;
+     i_column = a->i_column - b->i_column;
+
+     for (i = 0; i < a->n_bands; ++i) {
+          for (j = 0; j < a->n_lines; ++j) {
+               for (k = 0; k < a->n_columns; ++k) {
+                    if (a->data_vir[i][ j           * a->n_columns + k] !=
+                        b->data_vir[i][(j + i_line) * b->n_columns + k + i_column]) {
+                         fprintf(stderr, "ERROR: Count read back does not match "
+                                 "the synthetic count: band = %u, line = %u, "
+                                 "column = %u\n", i + 1, j, k);
+                         return -1;
+                    }
+               }
+          }
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Check the HRV image read back against the synthetic HRV image.
+ ******************************************************************************/
+static int check_counts_hrv(const struct seviri_image_data *a,
+                            const struct seviri_image_data *b)
+{
+     uint i;
+
+     if (! a->data_hrv || a->n_lines_hrv   != b->n_lines_hrv ||
+                          a->n_columns_hrv != b->n_columns_hrv) {
+          fprintf(stderr, "ERROR: HRV image read back does not match the "
+                  "synthetic HRV image dimensions\n");
+          return -1;
+     }
+
+     for (i = 0; i < a->n_lines_hrv * a->n_columns_hrv; ++i) {
+          if (a->data_hrv[i] != b->data_hrv[i]) {
+               fprintf(stderr, "ERROR: HRV count read back does not match the "
+                       "synthetic count: line = %u, column = %u\n",
+                       i / a->n_columns_hrv, i % a->n_columns_hrv);
+               return -1;
+          }
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * A file loaded into memory for the read_mem stage and the opener that gives
+ * the readers a memory stream of it in place of the file.
+ ******************************************************************************/
+struct mem_file {
+     const char *name;
+     uchar *buf;
+     size_t size;
+};
+
+
+static int load_file(const char *filename, struct mem_file *m)
+{
+     FILE *fp;
+
+     if ((fp = fopen(filename, "rb")) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
+                  filename, strerror(errno));
+          return -1;
+     }
+
+     fseek(fp, 0, SEEK_END);
+     m->name = filename;
+     m->size = ftell(fp);
+     m->buf  = malloc(m->size);
+     fseek(fp, 0, SEEK_SET);
+
+     if (fread(m->buf, sizeof(uchar), m->size, fp) < m->size) {
+          fprintf(stderr, "ERROR: Problem reading file: %s\n", filename);
+          free(m->buf);
+          fclose(fp);
+          return -1;
+     }
+
+     fclose(fp);
+
+     return 0;
+}
+
+
+static struct seviri_io *open_mem(const char *name, void *data)
+{
+     const struct mem_file *m = (const struct mem_file *) data;
+
+     if (strcmp(name, m->name) != 0)
+          return NULL;
+
+     return seviri_io_open_mem(m->buf, m->size);
+}
+
+
+
+/*******************************************************************************
+ * The functions that start and join the reader thread of the read_thread stage
+ * for the library, see struct seviri_options.
+ ******************************************************************************/
+struct reader_thread {
+     pthread_t thread;
+     seviri_thread_func func;
+     void *arg;
+};
+
+
+static void *run_reader_thread(void *arg)
+{
+     struct reader_thread *r = (struct reader_thread *) arg;
+
+     r->func(r->arg);
+
+     return NULL;
+}
+
+
+static int start_reader_thread(void **thread, seviri_thread_func func, void *arg,
+                               void *data)
+{
+     struct reader_thread *r;
+
+     r = malloc(sizeof(struct reader_thread));
+     r->func = func;
+     r->arg  = arg;
+
+     if (pthread_create(&r->thread, NULL, run_reader_thread, r)) {
+          free(r);
+          return -1;
+     }
+
+     *thread = r;
+
+     return 0;
+}
+
+
+static int join_reader_thread(void *thread, void *data)
+{
+     int status;
+
+     struct reader_thread *r = (struct reader_thread *) thread;
+
+     status = pthread_join(r->thread, NULL);
+
+     free(r);
+
+     return status;
+}
+
+
+
+/*******************************************************************************
+ * One run of seviri_read_and_preproc_nat() or seviri_read_and_preproc_hrit()
+ * of the threads stage, all the VIR bands to BRF or BT, and its thread.
+ ******************************************************************************/
+struct bench_run {
+     const char *path;
+     int hrit;
+     int rss;
+     enum seviri_bounds bounds;
+     const struct seviri_bench_area *area;
+     struct seviri_preproc_data preproc;
+     int status;
+};
+
+
+static void *bench_run_read_and_preproc(void *arg)
+{
+     char satposstr[128];
+
+     uint i;
+
+     uint band_ids[N_BANDS];
+
+     enum seviri_units band_units[N_BANDS];
+
+     struct bench_run *r = (struct bench_run *) arg;
+
+     for (i = 0; i < N_BANDS; ++i) {
+          band_ids[i]   = i + 1;
+          band_units[i] = i < 3 ? SEVIRI_UNIT_BRF : SEVIRI_UNIT_BT;
+     }
+
+     if (r->hrit)
+          r->status = seviri_read_and_preproc_hrit(r->path, SEVIRI_BENCH_TIMESLOT,
+                          SEVIRI_BENCH_SATNUM, &r->preproc, N_BANDS, band_ids,
+                          band_units, r->bounds, r->area->line0 - 1,
+                          r->area->line1 - 1, r->area->column0 - 1,
+                          r->area->column1 - 1, 0., 0., 0., 0., r->rss, 0, 0, 0,
+                          satposstr, 0, NULL);
+     else
+          r->status = seviri_read_and_preproc_nat(r->path, &r->preproc, N_BANDS,
+                          band_ids, band_units, r->bounds, r->area->line0 - 1,
+                          r->area->line1 - 1, r->area->column0 - 1,
+                          r->area->column1 - 1, 0., 0., 0., 0., 0, 0,
+                          satposstr, 0, NULL);
+
+     return NULL;
+}
+
+
+
+/*******************************************************************************
+ * Check the output of a run of the threads stage against that of the serial
+ * run, which must be identical to the bit.
+ ******************************************************************************/
+static int check_preproc(const struct seviri_preproc_data *a,
+                         const struct seviri_preproc_data *b)
+{
+     uint i;
+
+     size_t n;
+
+     if (a->n_bands != b->n_bands || a->n_lines != b->n_lines ||
+         a->n_columns != b->n_columns) {
+          fprintf(stderr, "ERROR: Dimensions of a threaded run do not match "
+                  "those of the serial run\n");
+          return -1;
+     }
+
+     n = (size_t) a->n_lines * a->n_columns * sizeof(float);
+
+     if (memcmp(a->time_line, b->time_line, a->n_lines * sizeof(double)) ||
+         memcmp(a->lat, b->lat, n) || memcmp(a->lon, b->lon, n) ||
+         memcmp(a->sza, b->sza, n) || memcmp(a->saa, b->saa, n) ||
+         memcmp(a->vza, b->vza, n) || memcmp(a->vaa, b->vaa, n)) {
+          fprintf(stderr, "ERROR: Time or geometry of a threaded run does not "
+                  "match that of the serial run\n");
+          return -1;
+     }
+
+     for (i = 0; i < a->n_bands; ++i) {
+          if (memcmp(a->data[i], b->data[i], n)) {
+               fprintf(stderr, "ERROR: Band %u of a threaded run does not "
+                       "match that of the serial run\n", i + 1);
+               return -1;
+          }
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time n_threads runs of seviri_read_and_preproc_*() on the same file at once,
+ * each on its own thread, and check that each output is that of a serial run.
+ * The read_preproc stage is the serial run and the threads stage the wall time
+ * of the concurrent runs, with the pixels of all of them.
+ ******************************************************************************/
+static int bench_threads(const char *path, enum seviri_bench_sizes size,
+                         const struct seviri_data *d, int n_repeats,
+                         int n_threads, int hrit, enum seviri_bounds bounds)
+{
+     int i;
+     int j;
+     int status;
+
+     double t;
+     double t0;
+     double n_pixels;
+
+     pthread_t *threads;
+
+     struct bench_run serial;
+
+     struct bench_run *runs;
+
+     serial.path   = path;
+     serial.hrit   = hrit;
+     serial.rss    = size == SEVIRI_BENCH_RSS;
+     serial.bounds = bounds;
+     serial.area   = &seviri_bench_areas[size];
+
+     n_pixels = (double) N_BANDS * d->image.n_lines * d->image.n_columns;
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          bench_run_read_and_preproc(&serial);
+          if (serial.status) {
+               fprintf(stderr, "ERROR: Problem reading and pre-processing: %s\n",
+                       path);
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          if (i < n_repeats - 1)
+               seviri_preproc_free(&serial.preproc);
+     }
+     print_result(size, hrit ? "hrit" : "nat", "read_preproc", n_pixels, t);
+
+     threads = malloc(n_threads * sizeof(pthread_t));
+     runs    = malloc(n_threads * sizeof(struct bench_run));
+
+     status = 0;
+
+     for (i = 0, t = 1.e99; status == 0 && i < n_repeats; ++i) {
+          t0 = get_time();
+          for (j = 0; j < n_threads; ++j) {
+               runs[j] = serial;
+               runs[j].status = -1;
+               if (pthread_create(&threads[j], NULL, bench_run_read_and_preproc,
+                                  &runs[j])) {
+                    fprintf(stderr, "ERROR: pthread_create()\n");
+                    status = -1;
+                    break;
+               }
+          }
+          n_threads = j;
+          for (j = 0; j < n_threads; ++j)
+               pthread_join(threads[j], NULL);
+          t = MIN(t, get_time() - t0);
+
+          for (j = 0; j < n_threads; ++j) {
+               if (runs[j].status) {
+                    fprintf(stderr, "ERROR: Problem reading and pre-processing "
+                            "on thread %d: %s\n", j, path);
+                    status = -1;
+                    continue;
+               }
+
+               if (status == 0 &&
+                   check_preproc(&runs[j].preproc, &serial.preproc)) {
+                    fprintf(stderr, "ERROR: check_preproc()\n");
+                    status = -1;
+               }
+
+               seviri_preproc_free(&runs[j].preproc);
+          }
+     }
+
+     if (status == 0)
+          print_result(size, hrit ? "hrit" : "nat", "threads",
+                       n_threads * n_pixels, t);
+
+     seviri_preproc_free(&serial.preproc);
+
+     free(threads);
+     free(runs);
+
+     return status;
+}
+
+
+
+/*******************************************************************************
+ * Time reading the HRV band alone with the given reader, 0 for Native and 1 for
+ * HRIT.
+ ******************************************************************************/
+static int bench_read_hrv(const char *path, enum seviri_bench_sizes size,
+                          const struct seviri_data *d, int n_repeats, int hrit)
+{
+     int i;
+
+     uint band_id = 12;
+
+     double t;
+     double t0;
+
+     struct seviri_data *d2;
+
+     d2 = malloc(sizeof(struct seviri_data));
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (hrit ? seviri_read_hrit(path, SEVIRI_BENCH_TIMESLOT, SEVIRI_BENCH_SATNUM,
+                                      d2, 1, &band_id, SEVIRI_BOUNDS_ACTUAL_IMAGE,
+                                      0, 0, 0, 0, 0., 0., 0., 0.,
+                                      size == SEVIRI_BENCH_RSS, 0, NULL) :
+                     seviri_read_nat(path, d2, 1, &band_id,
+                                     SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                                     0., 0., 0., 0., NULL)) {
+               fprintf(stderr, "ERROR: Problem reading the HRV band: %s\n", path);
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          if (i == n_repeats - 1 && check_counts_hrv(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts_hrv()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, hrit ? "hrit" : "nat", "read_hrv",
+                  (double) d->image.n_lines_hrv * d->image.n_columns_hrv, t);
+
+     free(d2);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time the Native writer, header parse and reader.
+ ******************************************************************************/
+static int bench_nat(const char *dir, enum seviri_bench_sizes size,
+                     const struct seviri_data *d, int n_repeats, int n_threads,
+                     int keep)
+{
+     char filename[1024 + 64];
+
+     int i;
+
+     uint band_ids[N_BANDS];
+
+     double t;
+     double t0;
+     double n_pixels;
+
+     struct seviri_io *fp;
+
+     struct seviri_auxillary_io_data aux;
+
+     struct seviri_data *d2;
+
+     struct mem_file m;
+
+     struct seviri_options opts;
+
+     snprintf(filename, 1024 + 64, "%sseviri_bench_%s.nat", dir,
+              seviri_bench_size_names[size]);
+
+     for (i = 0; i < N_BANDS; ++i)
+          band_ids[i] = i + 1;
+
+     n_pixels = (double) N_BANDS * d->image.n_lines * d->image.n_columns;
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_write_nat(filename, d)) {
+               fprintf(stderr, "ERROR: seviri_write_nat()\n");
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+     }
+     print_result(size, "nat", "write", n_pixels, t);
+
+     d2 = malloc(sizeof(struct seviri_data));
+
+     aux.operation  = 0;
+     aux.swap_bytes = su_is_little_endian();
+     seviri_auxillary_alloc(&aux);
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if ((fp = seviri_io_open_file(filename, "rb")) == NULL) {
+               fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
+                       filename, strerror(errno));
+               return -1;
+          }
+          if (seviri_marf_header_read  (fp, &d2->marf_header,    &aux) ||
+              seviri_packet_header_read(fp, &d2->packet_header1, &aux) ||
+              seviri_15HEADER_read     (fp, &d2->header,         &aux)) {
+               fprintf(stderr, "ERROR: Problem reading the headers: %s\n", filename);
+               seviri_io_close(fp);
+               return -1;
+          }
+          seviri_io_close(fp);
+          t = MIN(t, get_time() - t0);
+     }
+     print_result(size, "nat", "header", n_pixels, t);
+
+     seviri_auxillary_free(&aux);
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_read_nat(filename, d2, N_BANDS, band_ids,
+                              SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                              0., 0., 0., 0., NULL)) {
+               fprintf(stderr, "ERROR: seviri_read_nat()\n");
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, "nat", "read", n_pixels, t);
+
+     memset(&opts, 0, sizeof(struct seviri_options));
+     opts.read_depth   = READ_DEPTH;
+     opts.thread_start = start_reader_thread;
+     opts.thread_join  = join_reader_thread;
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_read_nat(filename, d2, N_BANDS, band_ids,
+                              SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                              0., 0., 0., 0., &opts)) {
+               fprintf(stderr, "ERROR: seviri_read_nat()\n");
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, "nat", "read_thread", n_pixels, t);
+
+     if (load_file(filename, &m)) {
+          fprintf(stderr, "ERROR: load_file()\n");
+          return -1;
+     }
+
+     memset(&opts, 0, sizeof(struct seviri_options));
+     opts.open      = open_mem;
+     opts.open_data = &m;
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_read_nat(filename, d2, N_BANDS, band_ids,
+                              SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                              0., 0., 0., 0., &opts)) {
+               fprintf(stderr, "ERROR: Problem reading from memory: %s\n", filename);
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, "nat", "read_mem", n_pixels, t);
+
+     free(m.buf);
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_read_nat(filename, d2, 1, band_ids,
+                              SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                              0., 0., 0., 0., NULL)) {
+               fprintf(stderr, "ERROR: seviri_read_nat()\n");
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, "nat", "read_band", n_pixels / N_BANDS, t);
+
+     free(d2);
+
+     if (d->image.data_hrv && bench_read_hrv(filename, size, d, n_repeats, 0)) {
+          fprintf(stderr, "ERROR: bench_read_hrv()\n");
+          return -1;
+     }
+
+     if (bench_threads(filename, size, d, n_repeats, n_threads, 0,
+                       SEVIRI_BOUNDS_ACTUAL_IMAGE)) {
+          fprintf(stderr, "ERROR: bench_threads()\n");
+          return -1;
+     }
+
+     if (! keep)
+          remove(filename);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time the BSQ writer and reader, the latter for all the VIS/IR bands and for a
+ * single band, which shows the benefit of the band sequential layout over the
+ * read_band stage of the Native format.
+ ******************************************************************************/
+static int bench_bsq(const char *dir, enum seviri_bench_sizes size,
+                     const struct seviri_data *d, int n_repeats, int keep)
+{
+     char filename[1024 + 64];
+
+     int i;
+     int j;
+
+     uint band_ids[N_BANDS];
+
+     double t;
+     double t0;
+     double n_pixels;
+
+     struct seviri_data *d2;
+
+     snprintf(filename, 1024 + 64, "%sseviri_bench_%s.bsq", dir,
+              seviri_bench_size_names[size]);
+
+     for (i = 0; i < N_BANDS; ++i)
+          band_ids[i] = i + 1;
+
+     n_pixels = (double) N_BANDS * d->image.n_lines * d->image.n_columns;
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_write_bsq(filename, d)) {
+               fprintf(stderr, "ERROR: seviri_write_bsq()\n");
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+     }
+     print_result(size, "bsq", "write", n_pixels, t);
+
+     d2 = malloc(sizeof(struct seviri_data));
+
+     for (j = 0; j < 2; ++j) {
+          for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+               t0 = get_time();
+               if (seviri_read_bsq(filename, d2, j == 0 ? N_BANDS : 1, band_ids,
+                                   SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                                   0., 0., 0., 0., NULL)) {
+                    fprintf(stderr, "ERROR: seviri_read_bsq()\n");
+                    return -1;
+               }
+               t = MIN(t, get_time() - t0);
+
+               if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+                    fprintf(stderr, "ERROR: check_counts()\n");
+                    return -1;
+               }
+
+               seviri_free(d2);
+          }
+          print_result(size, "bsq", j == 0 ? "read" : "read_band",
+                       j == 0 ? n_pixels : n_pixels / N_BANDS, t);
+     }
+
+     free(d2);
+
+     if (! keep)
+          remove(filename);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Remove the files of a synthetic HRIT timeslot.
+ ******************************************************************************/
+static void remove_hrit(const char *dir, int rss)
+{
+     char *proname;
+     char *epiname;
+     char ***bnames;
+
+     uint i;
+     uint j;
+
+     uint band_ids[SEVIRI_N_BANDS];
+
+     for (i = 0; i < SEVIRI_N_BANDS; ++i)
+          band_ids[i] = i + 1;
+
+     assemble_proname(&proname, dir, SEVIRI_BENCH_TIMESLOT, SEVIRI_BENCH_SATNUM, rss, 0);
+     assemble_epiname(&epiname, dir, SEVIRI_BENCH_TIMESLOT, SEVIRI_BENCH_SATNUM, rss, 0);
+     assemble_fnames (&bnames,  dir, SEVIRI_BENCH_TIMESLOT, SEVIRI_N_BANDS, band_ids,
+                      SEVIRI_BENCH_SATNUM, rss, 0);
+
+     remove(proname);
+     remove(epiname);
+     free(proname);
+     free(epiname);
+     for (i = 0; i < SEVIRI_N_BANDS; ++i) {
+          for (j = 0; j < (uint) is_hrv(band_ids[i]); ++j) {
+               remove(bnames[i][j]);
+               free(bnames[i][j]);
+          }
+          free(bnames[i]);
+     }
+     free(bnames);
+}
+
+
+
+/*******************************************************************************
+ * Time an incremental HRIT ingest of all the bands of the synthetic image.  The
+ * segments are given to it in the order they are disseminated, segment by
+ * segment across the bands, as if each had just arrived.  The ingest_last stage
+ * is the time from the arrival of the last segment to the completed image, the
+ * latency that remains once the slot has been received.
+ ******************************************************************************/
+static int bench_ingest(const char *dir, enum seviri_bench_sizes size,
+                        const struct seviri_data *d, int n_repeats,
+                        enum seviri_bounds bounds,
+                        const struct seviri_bench_area *area)
+{
+     int i;
+
+     uint j;
+     uint k;
+     uint l;
+     uint band_id;
+
+     uint i_line;
+     uint n_lines;
+     uint n_lines_done;
+
+     int rss;
+
+     double t;
+     double t0;
+     double t1;
+     double t_last;
+     double n_pixels;
+
+     struct seviri_hrit_ingest_data s;
+
+     struct seviri_data *d2;
+
+     rss = size == SEVIRI_BENCH_RSS;
+
+     n_pixels = (double) d->image.n_bands * d->image.n_lines * d->image.n_columns;
+
+     d2 = malloc(sizeof(struct seviri_data));
+
+     for (i = 0, t = t_last = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_hrit_ingest_init(&s, dir, SEVIRI_BENCH_TIMESLOT,
+                                      SEVIRI_BENCH_SATNUM, d2, d->image.n_bands,
+                                      d->image.band_ids, bounds,
+                                      area->line0 - 1, area->line1 - 1,
+                                      area->column0 - 1, area->column1 - 1,
+                                      0., 0., 0., 0., rss, 0, NULL)) {
+               fprintf(stderr, "ERROR: seviri_hrit_ingest_init()\n");
+               return -1;
+          }
+
+          n_lines_done = 0;
+
+          /* Each VIR segment with the three HRV segments of the same lines. */
+          for (k = 0, t1 = t0; k < 8; ++k) {
+               t1 = get_time();
+               for (j = 0; j < d->image.n_bands; ++j) {
+                    band_id = d->image.band_ids[j];
+                    for (l = 0; l < (band_id == 12 ? 3 : 1); ++l) {
+                         if (seviri_hrit_ingest_segment(&s, band_id,
+                              (band_id == 12 ? 3 * k + l : k) + 1, &i_line, &n_lines)) {
+                              fprintf(stderr, "ERROR: seviri_hrit_ingest_segment()\n");
+                              seviri_hrit_ingest_free(&s);
+                              return -1;
+                         }
+                         n_lines_done += n_lines;
+                    }
+               }
+          }
+
+          if (seviri_hrit_ingest_finish(&s)) {
+               fprintf(stderr, "ERROR: seviri_hrit_ingest_finish()\n");
+               return -1;
+          }
+          t      = MIN(t,      get_time() - t0);
+          t_last = MIN(t_last, get_time() - t1);
+
+          if (n_lines_done != d2->image.n_lines) {
+               fprintf(stderr, "ERROR: Number of lines completed by the ingest, "
+                       "%u, is not that of the image, %u\n", n_lines_done,
+                       d2->image.n_lines);
+               return -1;
+          }
+
+          /* The HRIT reader does not offset RSS images within the full disk. */
+          if (rss)
+               d2->image.i_line = d->image.i_line;
+
+          if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts()\n");
+               return -1;
+          }
+
+          if (i == n_repeats - 1 && d->image.data_hrv &&
+              check_counts_hrv(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts_hrv()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, "hrit", "ingest", n_pixels, t);
+     print_result(size, "hrit", "ingest_last", n_pixels, t_last);
+
+     free(d2);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time the HRIT reader.  The subset is read from the full disk files.
+ ******************************************************************************/
+static int bench_hrit(const char *dir, enum seviri_bench_sizes size,
+                      const struct seviri_data *d, int n_repeats, int n_threads,
+                      int *have_hrit)
+{
+     int i;
+
+     int rss;
+
+     uint band_ids[N_BANDS];
+
+     double t;
+     double t0;
+     double n_pixels;
+
+     enum seviri_bounds bounds;
+
+     const struct seviri_bench_area *area;
+
+     struct seviri_data *d2;
+
+     rss = size == SEVIRI_BENCH_RSS;
+
+     if (! have_hrit[rss]) {
+          if (seviri_bench_gen_hrit(dir, SEVIRI_BENCH_TIMESLOT, SEVIRI_BENCH_SATNUM,
+                                    rss)) {
+               fprintf(stderr, "ERROR: seviri_bench_gen_hrit()\n");
+               return -1;
+          }
+          have_hrit[rss] = 1;
+     }
+
+     for (i = 0; i < N_BANDS; ++i)
+          band_ids[i] = i + 1;
+
+     area = &seviri_bench_areas[size];
+
+     bounds = size == SEVIRI_BENCH_SUBSET ? SEVIRI_BOUNDS_LINE_COLUMN :
+                                            SEVIRI_BOUNDS_ACTUAL_IMAGE;
+
+     n_pixels = (double) N_BANDS * d->image.n_lines * d->image.n_columns;
+
+     d2 = malloc(sizeof(struct seviri_data));
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_read_hrit(dir, SEVIRI_BENCH_TIMESLOT, SEVIRI_BENCH_SATNUM,
+                               d2, N_BANDS, band_ids, bounds,
+                               area->line0 - 1, area->line1 - 1,
+                               area->column0 - 1, area->column1 - 1,
+                               0., 0., 0., 0., rss, 0, NULL)) {
+               fprintf(stderr, "ERROR: seviri_read_hrit()\n");
+               return -1;
+          }
+          t = MIN(t, get_time() - t0);
+
+          /* The HRIT reader does not offset RSS images within the full disk. */
+          if (rss)
+               d2->image.i_line = d->image.i_line;
+
+          if (i == n_repeats - 1 && check_counts(&d2->image, &d->image)) {
+               fprintf(stderr, "ERROR: check_counts()\n");
+               return -1;
+          }
+
+          seviri_free(d2);
+     }
+     print_result(size, "hrit", "read", n_pixels, t);
+
+     free(d2);
+
+     if (d->image.data_hrv && bench_read_hrv(dir, size, d, n_repeats, 1)) {
+          fprintf(stderr, "ERROR: bench_read_hrv()\n");
+          return -1;
+     }
+
+     if (bench_ingest(dir, size, d, n_repeats, bounds, area)) {
+          fprintf(stderr, "ERROR: bench_ingest()\n");
+          return -1;
+     }
+
+     if (bench_threads(dir, size, d, n_repeats, n_threads, 1, bounds)) {
+          fprintf(stderr, "ERROR: bench_threads()\n");
+          return -1;
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time navigation, solar angles and viewing angles on their own.
+ ******************************************************************************/
+static int bench_geometry(enum seviri_bench_sizes size, const struct seviri_data *d,
+                          int n_repeats)
+{
+     int i;
+
+     uint j;
+     uint k;
+
+     uint i_image;
+
+     uint length;
+
+     double t;
+     double t0;
+     double n_pixels;
+
+     double jtime;
+     double mu0;
+     double theta0;
+     double phi0;
+
+     float *lat;
+     float *lon;
+     float *sza;
+     float *saa;
+     float *vza;
+     float *vaa;
+
+     length = d->image.n_lines * d->image.n_columns;
+
+     n_pixels = length;
+
+     lat = malloc(length * sizeof(float));
+     lon = malloc(length * sizeof(float));
+     sza = malloc(length * sizeof(float));
+     saa = malloc(length * sizeof(float));
+     vza = malloc(length * sizeof(float));
+     vaa = malloc(length * sizeof(float));
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          for (j = 0; j < d->image.n_lines; ++j) {
+               for (k = 0; k < d->image.n_columns; ++k) {
+                    i_image = j * d->image.n_columns + k;
+                    su_line_column_to_lat_lon(d->image.i_line + j + 1,
+                                              d->image.i_column + k + 1,
+                                              &lat[i_image], &lon[i_image],
+                                              d->header.ImageDescription.LongitudeOfSSP,
+                                              &nav_scaling_factors_vir,
+                                              d->header.GeometricProcessing.TypeOfEarthModel);
+               }
+          }
+          t = MIN(t, get_time() - t0);
+     }
+     print_result(size, "-", "navigation", n_pixels, t);
+
+     jtime = su_cal_to_jul_day(2018, 6, 21);
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          for (j = 0; j < length; ++j) {
+               if (lat[j] != FILL_VALUE_F && lon[j] != FILL_VALUE_F) {
+                    su_solar_params2(jtime, lat[j] * D2R, lon[j] * D2R,
+                                     &mu0, &theta0, &phi0, NULL);
+                    sza[j] = theta0 * R2D;
+                    saa[j] = phi0   * R2D;
+               }
+          }
+          t = MIN(t, get_time() - t0);
+     }
+     print_result(size, "-", "solar", n_pixels, t);
+
+     for (i = 0, t = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          for (j = 0; j < length; ++j) {
+               if (lat[j] != FILL_VALUE_F && lon[j] != FILL_VALUE_F)
+                    su_vza_and_vaa(lat[j], lon[j], 0.,
+                                   d->header.SatelliteStatus.OrbitPolynomial[0].X[0] / 2.,
+                                   0., 0., &vza[j], &vaa[j]);
+          }
+          t = MIN(t, get_time() - t0);
+     }
+     print_result(size, "-", "viewing", n_pixels, t);
+
+     free(lat);
+     free(lon);
+     free(sza);
+     free(saa);
+     free(vza);
+     free(vaa);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time seviri_preproc() to one unit for a range of bands, and the calibration
+ * within it from its SEVIRI_PERF_CALIB statistics, -1 if they are not kept.
+ ******************************************************************************/
+static int time_preproc(const struct seviri_data *d, enum seviri_units unit,
+                        uint i_band, uint n_bands, int n_repeats, double *t,
+                        double *t_calib)
+{
+     char satposstr[128];
+
+     int i;
+
+     uint j;
+
+     double t0;
+
+     enum seviri_units band_units[N_BANDS];
+
+     struct seviri_data *d2;
+
+     struct seviri_preproc_data preproc;
+
+     struct seviri_perf_stage_data *calib;
+
+     /* A shallow copy with only the requested bands. */
+     d2 = malloc(sizeof(struct seviri_data));
+     *d2 = *d;
+
+     d2->image.n_bands  = n_bands;
+     d2->image.data_vir = d->image.data_vir + i_band;
+     for (j = 0; j < n_bands; ++j) {
+          d2->image.band_ids[j] = d->image.band_ids[i_band + j];
+          band_units[j] = unit;
+     }
+
+     for (i = 0, *t = 1.e99, *t_calib = 1.e99; i < n_repeats; ++i) {
+          t0 = get_time();
+          if (seviri_preproc(d2, &preproc, band_units, 0, 0, 0, satposstr, 0, NULL)) {
+               fprintf(stderr, "ERROR: seviri_preproc()\n");
+               free(d2);
+               return -1;
+          }
+          *t = MIN(*t, get_time() - t0);
+
+          /* The statistics of the pre-processing start from those of d. */
+          calib = &preproc.perf.stage[SEVIRI_PERF_CALIB];
+          if (calib->calls == d->perf.stage[SEVIRI_PERF_CALIB].calls)
+               *t_calib = -1.;
+          else
+               *t_calib = MIN(*t_calib, calib->wall -
+                              d->perf.stage[SEVIRI_PERF_CALIB].wall);
+
+          seviri_preproc_free(&preproc);
+     }
+
+     free(d2);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Time pre-processing to each unit and the calibration within it.
+ ******************************************************************************/
+static int bench_preproc(enum seviri_bench_sizes size, const struct seviri_data *d,
+                         int n_repeats)
+{
+     char stage[32];
+
+     uint i;
+
+     double t;
+     double t_calib;
+     double n_pixels;
+
+     for (i = 0; i < N_BENCH_UNITS; ++i) {
+          if (bench_units[i].i_band + bench_units[i].n_bands > d->image.n_bands)
+               continue;
+
+          n_pixels = (double) bench_units[i].n_bands *
+                     d->image.n_lines * d->image.n_columns;
+
+          /* For the HRV band the cost is dominated by the HRV resolution. */
+          if (d->image.band_ids[bench_units[i].i_band] == 12)
+               n_pixels = (double) d->image.n_lines_hrv * d->image.n_columns_hrv;
+
+          if (time_preproc(d, bench_units[i].unit, bench_units[i].i_band,
+                           bench_units[i].n_bands, n_repeats, &t, &t_calib)) {
+               fprintf(stderr, "ERROR: time_preproc()\n");
+               return -1;
+          }
+
+          snprintf(stage, 32, "preproc_%s", bench_units[i].name);
+          print_result(size, "-", stage, n_pixels, t);
+
+          if (t_calib < 0.)
+               continue;
+
+          snprintf(stage, 32, "calib_%s", bench_units[i].name);
+          print_result(size, "-", stage, n_pixels, t_calib);
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+static void usage(const char *name)
+{
+     printf("usage: %s [-r n_repeats] [-s full_disk|rss|subset] [-t n_threads] "
+            "[-k] work_dir\n", name);
+}
+
+
+
+int main(int argc, char *argv[])
+{
+     char dir[1024];
+
+     int i;
+     int j;
+
+     int n_repeats = 3;
+
+     int n_threads = 4;
+
+     int keep = 0;
+
+     int n_sizes = 0;
+
+     int have_hrit[2] = {0, 0};
+
+     enum seviri_bench_sizes sizes[N_SEVIRI_BENCH_SIZES];
+
+     struct seviri_data *d;
+
+     const char *work_dir = NULL;
+
+
+     /*-------------------------------------------------------------------------
+      * Parse the arguments.
+      *-----------------------------------------------------------------------*/
+     for (i = 1; i < argc; ++i) {
+          if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+               n_repeats = atoi(argv[++i]);
+               if (n_repeats < 1) {
+                    fprintf(stderr, "ERROR: Invalid number of repeats: %s\n", argv[i]);
+                    return -1;
+               }
+          }
+          else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+               ++i;
+               for (j = 0; j < N_SEVIRI_BENCH_SIZES; ++j) {
+                    if (strcmp(argv[i], seviri_bench_size_names[j]) == 0)
+                         break;
+               }
+               if (j == N_SEVIRI_BENCH_SIZES) {
+                    fprintf(stderr, "ERROR: Invalid size: %s\n", argv[i]);
+                    return -1;
+               }
+               if (n_sizes < N_SEVIRI_BENCH_SIZES)
+                    sizes[n_sizes++] = j;
+          }
+          else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+               n_threads = atoi(argv[++i]);
+               if (n_threads < 1) {
+                    fprintf(stderr, "ERROR: Invalid number of threads: %s\n", argv[i]);
+                    return -1;
+               }
+          }
+          else if (strcmp(argv[i], "-k") == 0)
+               keep = 1;
+          else if (argv[i][0] != '-' && ! work_dir)
+               work_dir = argv[i];
+          else {
+               usage(argv[0]);
+               return -1;
+          }
+     }
+
+     if (! work_dir) {
+          usage(argv[0]);
+          return -1;
+     }
+
+     if (n_sizes == 0) {
+          for (j = 0; j < N_SEVIRI_BENCH_SIZES; ++j)
+               sizes[n_sizes++] = j;
+     }
+
+     snprintf(dir, 1024, "%s%s", work_dir,
+              work_dir[strlen(work_dir) - 1] == '/' ? "" : "/");
+
+
+     /*-------------------------------------------------------------------------
+      * Run the stages for each size.
+      *-----------------------------------------------------------------------*/
+     printf("# seviri_util %s, best of %d\n", SEVIRI_UTIL_VERSION, n_repeats);
+     printf("# %-8s %-5s %-12s %12s %10s %10s\n", "size", "fmt", "stage",
+            "pixels", "seconds", "Mpixel/s");
+
+     d = malloc(sizeof(struct seviri_data));
+
+     for (i = 0; i < n_sizes; ++i) {
+          if (seviri_bench_gen_data(d, sizes[i])) {
+               fprintf(stderr, "ERROR: seviri_bench_gen_data()\n");
+               return -1;
+          }
+
+          if (bench_nat(dir, sizes[i], d, n_repeats, n_threads, keep)) {
+               fprintf(stderr, "ERROR: bench_nat()\n");
+               return -1;
+          }
+
+          if (bench_bsq(dir, sizes[i], d, n_repeats, keep)) {
+               fprintf(stderr, "ERROR: bench_bsq()\n");
+               return -1;
+          }
+
+          if (bench_hrit(dir, sizes[i], d, n_repeats, n_threads, have_hrit)) {
+               fprintf(stderr, "ERROR: bench_hrit()\n");
+               return -1;
+          }
+
+          if (bench_geometry(sizes[i], d, n_repeats)) {
+               fprintf(stderr, "ERROR: bench_geometry()\n");
+               return -1;
+          }
+
+          if (bench_preproc(sizes[i], d, n_repeats)) {
+               fprintf(stderr, "ERROR: bench_preproc()\n");
+               return -1;
+          }
+
+          seviri_free(d);
+     }
+
+     free(d);
+
+     if (! keep) {
+          for (j = 0; j < 2; ++j) {
+               if (have_hrit[j])
+                    remove_hrit(dir, j);
+          }
+     }
+
+     return 0;
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#ifndef SEVIRI_BENCH_H
+#define SEVIRI_BENCH_H
+
+#include "seviri_util.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Image sizes covered by the synthetic data: the full disk, the northern third
+   of the disk scanned in rapid scan mode (RSS) and a small sub-image. */
+enum seviri_bench_sizes {
+     SEVIRI_BENCH_FULL_DISK,
+     SEVIRI_BENCH_RSS,
+     SEVIRI_BENCH_SUBSET,
+
+     N_SEVIRI_BENCH_SIZES
+};
+
+
+extern const char *seviri_bench_size_names[];
+
+
+/* Timeslot and satellite number (MSG2) of the synthetic data. */
+#define SEVIRI_BENCH_TIMESLOT	"201806211200"
+#define SEVIRI_BENCH_SATNUM	2
+
+
+/* Full disk coordinates (1 based) of the lines and columns covered by each of
+   the sizes. */
+struct seviri_bench_area {
+     uint line0;
+     uint line1;
+     uint column0;
+     uint column1;
+};
+
+
+extern const struct seviri_bench_area seviri_bench_areas[];
+
+
+/* In SEVIRI_bench_gen.c */
+int seviri_bench_gen_data(struct seviri_data *d, enum seviri_bench_sizes size);
+int seviri_bench_gen_nat(const char *filename, enum seviri_bench_sizes size);
+int seviri_bench_gen_hrit(const char *indir, const char *timeslot, int sat,
+                          int rss);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEVIRI_BENCH_H */
@@ -0,0 +1,765 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ *******************************************************************************
+ *
+ *    Generates synthetic SEVIRI level 1.5 data, in memory, as a Native file
+ *    written with seviri_write_nat() or as a set of HRIT segment, prologue and
+ *    epilogue files, that can be read back by seviri_util.  Only the header
+ *    fields used by seviri_util are given meaningful values.  The counts are a
+ *    deterministic pattern over the Earth disk and zero off the disk.  The full
+ *    disk and RSS data include the HRV band, acquired in a lower window over
+ *    the southern half of the image and an upper window over the northern
+ *    half.
+ *
+ ******************************************************************************/
+
+#include "SEVIRI_bench.h"
+#include "hrit_anc_funcs.h"
+#include "internal.h"
+
+
+const char *seviri_bench_size_names[] = {"full_disk", "rss", "subset"};
+
+const struct seviri_bench_area seviri_bench_areas[] = {
+     {1,    IMAGE_SIZE_VIR_LINES, 1,    IMAGE_SIZE_VIR_COLUMNS},
+     {IMAGE_SIZE_VIR_LINES - IMAGE_SIZE_VIR_RSS_LINES + 1,
+            IMAGE_SIZE_VIR_LINES, 1,    IMAGE_SIZE_VIR_RSS_COLUMNS},
+     {1625, 2088,                 1393, 2320}
+};
+
+
+/* Nominal IMPF calibration slope and offset for each band (MSG2). */
+static const double cal_slope[]  = {0.020824, 0.026989, 0.022414, 0.003678,
+                                    0.008346, 0.038624, 0.126118, 0.104170,
+                                    0.205503, 0.223316, 0.157626, 0.026989};
+static const double cal_offset[] = {-1.062024, -1.376444, -1.143114, -0.187578,
+                                    -0.425646, -1.969824, -6.432018, -5.312670,
+                                    -10.480653, -11.389116, -8.038926, -1.376444};
+
+/* Range of the synthetic counts for the solar and thermal bands. */
+#define COUNT_MIN_VIS	 40
+#define COUNT_MAX_VIS	700
+#define COUNT_MIN_IR	300
+#define COUNT_MAX_IR	900
+
+/* Radius of the Earth disk in pixels for deciding which pixels are space. */
+#define DISK_RADIUS	1800.
+
+/* HRIT header record sizes, the size of the segment file headers and the lines
+   per segment. */
+#define HRIT_PRIMARY_HEADER_SIZE	16
+#define HRIT_IMAGE_STRUCTURE_SIZE	9
+#define HRIT_SEGMENT_ID_SIZE		13
+#define HRIT_SEGMENT_HEADER_SIZE	6198
+#define HRIT_SEGMENT_LINES		464
+
+
+
+/* First (1 based) HRV reference grid column of the lower and upper HRV
+   windows, which are IMAGE_SIZE_HRV_COLUMNS wide. */
+#define HRV_LOWER_EAST_COLUMN	(IMAGE_SIZE_HRV_COLUMNS / 2 + 1)
+#define HRV_UPPER_EAST_COLUMN	(IMAGE_SIZE_HRV_COLUMNS + 1)
+
+
+
+/*******************************************************************************
+ * Fill the U-MARF header fields that describe the selected rectangle.
+ ******************************************************************************/
+static void gen_marf_header(struct seviri_marf_header_data *d,
+                            const struct seviri_bench_area *area, int hrv)
+{
+     snprintf(d->secondary.SelectedBandIDs.Value, 50, "%s",
+              hrv ? "XXXXXXXXXXXX" : "XXXXXXXXXXX-");
+
+     snprintf(d->secondary.NumberLinesVISIR.Value,   50, "%u",
+              area->line1   - area->line0   + 1);
+     snprintf(d->secondary.NumberColumnsVISIR.Value, 50, "%u",
+              area->column1 - area->column0 + 1);
+     snprintf(d->secondary.NumberLinesHRV.Value,     50, "%u",
+              hrv ? 3 * (area->line1 - area->line0 + 1) : 0);
+     snprintf(d->secondary.NumberColumnsHRV.Value,   50, "%u",
+              hrv ? 2 * IMAGE_SIZE_HRV_COLUMNS : 0);
+
+     snprintf(d->secondary.SouthLineSelectedRectangle.Value,  50, "%u", area->line0);
+     snprintf(d->secondary.NorthLineSelectedRectangle.Value,  50, "%u", area->line1);
+     snprintf(d->secondary.EastColumnSelectedRectangle.Value, 50, "%u", area->column0);
+     snprintf(d->secondary.WestColumnSelectedRectangle.Value, 50, "%u", area->column1);
+}
+
+
+
+/*******************************************************************************
+ * Fill the level 1.5 header and trailer fields used by seviri_preproc(): a
+ * satellite at 0 degrees longitude scanning from 12:00 to 12:12 UTC on the day
+ * of SEVIRI_BENCH_TIMESLOT.
+ ******************************************************************************/
+static void gen_header_and_trailer(struct seviri_data *d,
+                                   const struct seviri_bench_area *area)
+{
+     int i;
+     int line_mid;
+     short day;
+
+     day = su_cal_to_jul_day(2018, 6, 21) - su_cal_to_jul_day(1958, 1, 1);
+
+     d->header.SatelliteStatus.SatelliteId      = satellite_ids[1];
+     d->header.SatelliteStatus.NominalLongitude = 0.;
+
+     d->header.SatelliteStatus.OrbitPolynomial[0].StartTime.day  = day;
+     d->header.SatelliteStatus.OrbitPolynomial[0].StartTime.msec = 0;
+     d->header.SatelliteStatus.OrbitPolynomial[0].EndTime.day    = day + 1;
+     d->header.SatelliteStatus.OrbitPolynomial[0].EndTime.msec   = 0;
+
+     /* Only the constant term of the Chebyshev polynomial, which is halved. */
+     d->header.SatelliteStatus.OrbitPolynomial[0].X[0] = 2. * 42164.;
+
+     d->header.ImageDescription.TypeOfProjection = 1;
+     d->header.ImageDescription.LongitudeOfSSP   = 0.;
+
+     d->header.ImageDescription.ReferenceGridVIS_IR.NumberOfLines     = IMAGE_SIZE_VIR_LINES;
+     d->header.ImageDescription.ReferenceGridVIS_IR.NumberOfColumns   = IMAGE_SIZE_VIR_COLUMNS;
+     d->header.ImageDescription.ReferenceGridVIS_IR.LineDirGridStep   = 3.0004032;
+     d->header.ImageDescription.ReferenceGridVIS_IR.ColumnDirGridStep = 3.0004032;
+
+     d->header.ImageDescription.ReferenceGridHRV.NumberOfLines        = IMAGE_SIZE_HRV_LINES;
+     d->header.ImageDescription.ReferenceGridHRV.NumberOfColumns      = IMAGE_SIZE_HRV_COLUMNS;
+     d->header.ImageDescription.ReferenceGridHRV.LineDirGridStep      = 1.0001343;
+     d->header.ImageDescription.ReferenceGridHRV.ColumnDirGridStep    = 1.0001343;
+
+     d->header.ImageDescription.PlannedCoverageVIS_IR.SouthernLinePlanned  = area->line0;
+     d->header.ImageDescription.PlannedCoverageVIS_IR.NorthernLinePlanned  = area->line1;
+     d->header.ImageDescription.PlannedCoverageVIS_IR.EasternColumnPlanned = area->column0;
+     d->header.ImageDescription.PlannedCoverageVIS_IR.WesternColumnPlanned = area->column1;
+
+     line_mid = 3 * (area->line0 - 1) + 3 * (area->line1 - area->line0 + 1) / 2;
+
+     d->header.ImageDescription.PlannedCoverageHRV.LowerSouthLinePlanned  = 3 * (area->line0 - 1) + 1;
+     d->header.ImageDescription.PlannedCoverageHRV.LowerNorthLinePlanned  = line_mid;
+     d->header.ImageDescription.PlannedCoverageHRV.LowerEastColumnPlanned = HRV_LOWER_EAST_COLUMN;
+     d->header.ImageDescription.PlannedCoverageHRV.LowerWestColumnPlanned = HRV_LOWER_EAST_COLUMN +
+                                                                            IMAGE_SIZE_HRV_COLUMNS - 1;
+     d->header.ImageDescription.PlannedCoverageHRV.UpperSouthLinePlanned  = line_mid + 1;
+     d->header.ImageDescription.PlannedCoverageHRV.UpperNorthLinePlanned  = 3 * area->line1;
+     d->header.ImageDescription.PlannedCoverageHRV.UpperEastColumnPlanned = HRV_UPPER_EAST_COLUMN;
+     d->header.ImageDescription.PlannedCoverageHRV.UpperWestColumnPlanned = HRV_UPPER_EAST_COLUMN +
+                                                                            IMAGE_SIZE_HRV_COLUMNS - 1;
+
+     for (i = 0; i < SEVIRI_N_BANDS; ++i) {
+          d->header.RadiometricProcessing.Level1_5ImageCalibration[i].Cal_Slope  =
+               cal_slope[i];
+          d->header.RadiometricProcessing.Level1_5ImageCalibration[i].Cal_Offset =
+               cal_offset[i];
+     }
+
+     d->header.GeometricProcessing.TypeOfEarthModel = 2;
+     d->header.GeometricProcessing.EquatorialRadius = 6378.169;
+     d->header.GeometricProcessing.NorthPolarRadius = 6356.5838;
+     d->header.GeometricProcessing.SouthPolarRadius = 6356.5838;
+
+     d->trailer.ImageProductionStats.SatelliteID = satellite_ids[1];
+     d->trailer.ImageProductionStats.NominalImageScanning = 1;
+
+     d->trailer.ImageProductionStats.ActScanForwardStart.day  = day;
+     d->trailer.ImageProductionStats.ActScanForwardStart.msec = 12 * 3600 * 1000;
+     d->trailer.ImageProductionStats.ActScanForwardEnd.day    = day;
+     d->trailer.ImageProductionStats.ActScanForwardEnd.msec   = 12 * 3600 * 1000 +
+                                                                12 * 60 * 1000;
+
+     /* The planned times, a few seconds from the actual ones. */
+     d->header.ImageAcquisition.TrueRepeatCycleStart.day   = day;
+     d->header.ImageAcquisition.TrueRepeatCycleStart.msec  = 12 * 3600 * 1000 - 2000;
+     d->header.ImageAcquisition.PlannedForwardScanEnd.day  = day;
+     d->header.ImageAcquisition.PlannedForwardScanEnd.msec = 12 * 3600 * 1000 +
+                                                             12 * 60 * 1000 + 2000;
+}
+
+
+
+/*******************************************************************************
+ * Synthetic count for the given band at the given full disk line and column (0
+ * based), which are on the HRV reference grid for the HRV band.
+ ******************************************************************************/
+static ushort gen_count(uint band_id, uint line, uint column)
+{
+     uint min;
+     uint max;
+
+     double n;
+
+     double x;
+     double y;
+
+     n = band_id == 12 ? 3. : 1.;
+
+     x = (column + .5 - n * IMAGE_SIZE_VIR_COLUMNS / 2.) / (n * DISK_RADIUS);
+     y = (line   + .5 - n * IMAGE_SIZE_VIR_LINES   / 2.) / (n * DISK_RADIUS);
+
+     if (x * x + y * y >= 1.)
+          return 0;
+
+     if (band_id <= 3 || band_id == 12) {
+          min = COUNT_MIN_VIS;
+          max = COUNT_MAX_VIS;
+     }
+     else {
+          min = COUNT_MIN_IR;
+          max = COUNT_MAX_IR;
+     }
+
+     return min + (line * 37 + column * 91 + band_id * 17) % (max - min);
+}
+
+
+
+/*******************************************************************************
+ * Copy the pixels of one line of an HRV window from the HRV image, with zero
+ * for pixels that are not in the image.
+ ******************************************************************************/
+static void gen_hrv_record(const struct seviri_data *d, uint i_line, ushort *line)
+{
+     uint j;
+
+     uint i_column;
+
+     long column;
+
+     su_init_array_us(line, IMAGE_SIZE_HRV_COLUMNS, 0);
+
+     if (seviri_hrv_window(&d->header.ImageDescription.PlannedCoverageHRV,
+                           3 * d->image.i_line + i_line, &i_column))
+          return;
+
+     for (j = 0; j < IMAGE_SIZE_HRV_COLUMNS; ++j) {
+          column = (long) i_column + j - 3 * d->image.i_column;
+          if (column >= 0 && column < d->image.n_columns_hrv &&
+              d->image.data_hrv[i_line * d->image.n_columns_hrv + column] !=
+              d->image.fill_value)
+               line[j] = d->image.data_hrv[i_line * d->image.n_columns_hrv + column];
+     }
+}
+
+
+
+/*******************************************************************************
+ * Fill a seviri_data struct with synthetic data as would be returned by
+ * seviri_read_nat() with SEVIRI_BOUNDS_ACTUAL_IMAGE for all 11 VIS/IR bands
+ * and, except for the subset, the HRV band.  The struct is freed with
+ * seviri_free().
+ *
+ * d		: The output seviri_data struct
+ * size		: The size of the image, one of the seviri_bench_sizes
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_bench_gen_data(struct seviri_data *d, enum seviri_bench_sizes size)
+{
+     uint i;
+     uint j;
+     uint k;
+
+     uint length;
+
+     uint i_column;
+
+     int hrv;
+
+     uint n_bands;
+
+     const struct seviri_bench_area *area;
+
+     struct seviri_dimension_data *dimens;
+
+     area = &seviri_bench_areas[size];
+
+     hrv = size != SEVIRI_BENCH_SUBSET;
+
+     n_bands = hrv ? SEVIRI_N_BANDS : SEVIRI_N_BANDS - 1;
+
+     memset(d, 0, sizeof(struct seviri_data));
+
+     gen_marf_header(&d->marf_header, area, hrv);
+
+     gen_header_and_trailer(d, area);
+
+     dimens = &d->image.dimens;
+
+     if (seviri_get_dimension_data(dimens, &d->marf_header,
+                                   SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                                   0., 0., 0., 0., 0)) {
+          fprintf(stderr, "ERROR: seviri_get_dimension_data()\n");
+          return -1;
+     }
+
+     d->image.i_line     = dimens->i_line_requested_VIR;
+     d->image.i_column   = dimens->i_column_requested_VIR;
+     d->image.n_lines    = dimens->n_lines_requested_VIR;
+     d->image.n_columns  = dimens->n_columns_requested_VIR;
+     d->image.n_bands    = n_bands;
+     d->image.fill_value = FILL_VALUE_US;
+
+     length = d->image.n_lines * d->image.n_columns;
+
+     d->image.packet_header = malloc(n_bands * sizeof(struct seviri_packet_header_data *));
+     d->image.LineSideInfo  = malloc(n_bands * sizeof(struct seviri_LineSideInfo_data *));
+     d->image.data_vir      = malloc(n_bands * sizeof(ushort *));
+
+     for (i = 0; i < n_bands; ++i) {
+          d->image.band_ids[i] = i + 1;
+
+          d->image.packet_header[i] = calloc(d->image.n_lines,
+                                             sizeof(struct seviri_packet_header_data));
+          d->image.LineSideInfo[i]  = calloc(d->image.n_lines,
+                                             sizeof(struct seviri_LineSideInfo_data));
+          d->image.data_vir[i]      = malloc(length * sizeof(ushort));
+
+          for (j = 0; j < d->image.n_lines; ++j) {
+               d->image.LineSideInfo[i][j].SatelliteId      =
+                    d->header.SatelliteStatus.SatelliteId;
+               d->image.LineSideInfo[i][j].LineNumberInGrid = d->image.i_line + j + 1;
+               d->image.LineSideInfo[i][j].ChannelId        = i + 1;
+
+               for (k = 0; k < d->image.n_columns; ++k)
+                    d->image.data_vir[i][j * d->image.n_columns + k] =
+                         gen_count(i + 1, d->image.i_line + j,
+                                   d->image.i_column + k);
+          }
+     }
+
+     if (! hrv)
+          return 0;
+
+     /* The HRV image within the two windows and its VIR resolution image. */
+     if (seviri_hrv_alloc(&d->image)) {
+          fprintf(stderr, "ERROR: seviri_hrv_alloc()\n");
+          return -1;
+     }
+
+     for (j = 0; j < d->image.n_lines_hrv; ++j) {
+          if (seviri_hrv_window(&d->header.ImageDescription.PlannedCoverageHRV,
+                                dimens->i_line_requested_HRV + j, &i_column))
+               continue;
+
+          for (k = 0; k < d->image.n_columns_hrv; ++k) {
+               if (dimens->i_column_requested_HRV + k >= i_column &&
+                   dimens->i_column_requested_HRV + k <  i_column + IMAGE_SIZE_HRV_COLUMNS)
+                    d->image.data_hrv[j * d->image.n_columns_hrv + k] =
+                         gen_count(12, dimens->i_line_requested_HRV + j,
+                                   dimens->i_column_requested_HRV + k);
+          }
+     }
+
+     seviri_hrv_bin(&d->image, n_bands - 1, 0, d->image.n_lines);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write a synthetic Native SEVIRI level 1.5 file.
+ *
+ * filename	: Output Native SEVIRI level 1.5 filename
+ * size		: The size of the image, one of the seviri_bench_sizes
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_bench_gen_nat(const char *filename, enum seviri_bench_sizes size)
+{
+     struct seviri_data *d;
+
+     d = malloc(sizeof(struct seviri_data));
+
+     if (seviri_bench_gen_data(d, size)) {
+          fprintf(stderr, "ERROR: seviri_bench_gen_data()\n");
+          free(d);
+          return -1;
+     }
+
+     if (seviri_write_nat(filename, d)) {
+          fprintf(stderr, "ERROR: seviri_write_nat(), filename = %s\n", filename);
+          seviri_free(d);
+          free(d);
+          return -1;
+     }
+
+     seviri_free(d);
+     free(d);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write an HRIT primary header (Ref: PDF_CGMS_LRIT_HRIT_2_6).
+ ******************************************************************************/
+static int write_hrit_primary_header(struct seviri_io *fp, uchar file_type,
+                                     uint header_length, ulong data_length,
+                                     struct seviri_auxillary_io_data *aux)
+{
+     uchar  header_type   = 0;
+     ushort record_length = HRIT_PRIMARY_HEADER_SIZE;
+
+     if (fxxxx_swap(&header_type,   sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&record_length, sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&file_type,     sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&header_length, sizeof(uint),   1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&data_length,   sizeof(ulong),  1, fp, aux) < 0) E_L_R();
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write the HRIT image structure header record for an uncompressed segment of
+ * 10 bit pixels, followed by the segment identification record.
+ ******************************************************************************/
+static int write_hrit_image_structure(struct seviri_io *fp, ushort n_columns,
+                                      uchar band_id, ushort segment,
+                                      short satellite_id,
+                                      struct seviri_auxillary_io_data *aux)
+{
+     uchar  header_type   = 1;
+     ushort record_length = HRIT_IMAGE_STRUCTURE_SIZE;
+     uchar  n_bits        = 10;
+     ushort n_lines       = HRIT_SEGMENT_LINES;
+     uchar  compression   = 0;
+     ushort segment_start = 1;
+     ushort segment_end   = band_id == 12 ? 24 : 8;
+     uchar  planned       = 0;
+
+     if (fxxxx_swap(&header_type,   sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&record_length, sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&n_bits,        sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&n_columns,     sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&n_lines,       sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&compression,   sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+
+     header_type   = 128;
+     record_length = HRIT_SEGMENT_ID_SIZE;
+
+     if (fxxxx_swap(&header_type,   sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&record_length, sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&satellite_id,  sizeof(short),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&band_id,       sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&segment,       sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&segment_start, sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&segment_end,   sizeof(ushort), 1, fp, aux) < 0) E_L_R();
+     if (fxxxx_swap(&planned,       sizeof(uchar),  1, fp, aux) < 0) E_L_R();
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write one HRIT image segment of HRIT_SEGMENT_LINES lines for one band.
+ * segment is the 1 based segment sequence number.
+ ******************************************************************************/
+static int write_hrit_segment(const char *filename, const ushort *counts,
+                              uint n_columns, uint band_id, uint segment,
+                              short satellite_id, uchar *data10,
+                              struct seviri_auxillary_io_data *aux)
+{
+     uint i;
+
+     uint n_bytes_line;
+
+     struct seviri_io *fp;
+
+     n_bytes_line = n_columns / 4 * 5;
+
+     if ((fp = seviri_io_open_file(filename, "wb")) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for writing: %s ... %s\n",
+                  filename, strerror(errno));
+          return -1;
+     }
+
+     if (write_hrit_primary_header(fp, HRIT_FILE_TYPE_IMAGE, HRIT_SEGMENT_HEADER_SIZE,
+                                   (ulong) HRIT_SEGMENT_LINES * n_columns * 10, aux)) {
+          fprintf(stderr, "ERROR: write_hrit_primary_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (write_hrit_image_structure(fp, n_columns, band_id, segment,
+                                    satellite_id, aux)) {
+          fprintf(stderr, "ERROR: write_hrit_image_structure()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     seviri_io_seek(fp, HRIT_SEGMENT_HEADER_SIZE, SEEK_SET);
+
+     for (i = 0; i < HRIT_SEGMENT_LINES; ++i) {
+          su_pack_10bit(counts + i * n_columns, n_columns, data10);
+
+          if (seviri_io_write(data10, sizeof(uchar), n_bytes_line, fp) <
+              n_bytes_line) {
+               fprintf(stderr, "ERROR: Error writing file: %s ... %s\n",
+                       filename, strerror(errno));
+               seviri_io_close(fp);
+               return -1;
+          }
+     }
+
+     seviri_io_close(fp);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write the HRIT prologue with the fields read by seviri_read_hrit().
+ ******************************************************************************/
+static int write_hrit_prologue(const char *filename, const struct seviri_data *d,
+                               struct seviri_auxillary_io_data *aux)
+{
+     struct seviri_io *fp;
+
+     if ((fp = seviri_io_open_file(filename, "wb")) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for writing: %s ... %s\n",
+                  filename, strerror(errno));
+          return -1;
+     }
+
+     if (write_hrit_primary_header(fp, HRIT_FILE_TYPE_PROLOGUE,
+                                   HRIT_PRIMARY_HEADER_SIZE, 0, aux)) {
+          fprintf(stderr, "ERROR: write_hrit_primary_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_15HEADER_SatelliteStatus_read(fp,
+          (struct seviri_15HEADER_SatelliteStatus_data *)
+          &d->header.SatelliteStatus, aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_SatelliteStatus_read()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_15HEADER_ImageAcquisition_read(fp,
+          (struct seviri_15HEADER_ImageAcquisition_data *)
+          &d->header.ImageAcquisition, aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_ImageAcquisition_read()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_io_tell(fp) >
+         HRIT_PRIMARY_HEADER_SIZE + HRIT_PROLOGUE_IMAGE_DESCRIPTION) {
+          fprintf(stderr, "ERROR: Satellite status overlaps the image description\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     seviri_io_seek(fp, HRIT_PRIMARY_HEADER_SIZE + HRIT_PROLOGUE_IMAGE_DESCRIPTION,
+                    SEEK_SET);
+
+     if (seviri_15HEADER_ImageDescription_read(fp,
+          (struct seviri_15HEADER_ImageDescription_data *)
+          &d->header.ImageDescription, aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_ImageDescription_read()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_15HEADER_RadiometricProcessing_read(fp,
+          (struct seviri_15HEADER_RadiometricProcessing_data *)
+          &d->header.RadiometricProcessing, aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_RadiometricProcessing_read()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_15HEADER_GeometricProcessing_read(fp,
+          (struct seviri_15HEADER_GeometricProcessing_data *)
+          &d->header.GeometricProcessing, aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_GeometricProcessing_read()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     seviri_io_close(fp);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write the HRIT epilogue with the fields read by seviri_read_hrit().
+ ******************************************************************************/
+static int write_hrit_epilogue(const char *filename, const struct seviri_data *d,
+                               struct seviri_auxillary_io_data *aux)
+{
+     struct seviri_io *fp;
+
+     struct seviri_15TRAILER_ImageProductionStats_data stats;
+
+     stats = d->trailer.ImageProductionStats;
+
+     if ((fp = seviri_io_open_file(filename, "wb")) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for writing: %s ... %s\n",
+                  filename, strerror(errno));
+          return -1;
+     }
+
+     if (write_hrit_primary_header(fp, HRIT_FILE_TYPE_EPILOGUE,
+                                   HRIT_PRIMARY_HEADER_SIZE, 0, aux)) {
+          fprintf(stderr, "ERROR: write_hrit_primary_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (fxxxx_swap((uchar *) &d->trailer.L15TrailerVersion,
+                                                     sizeof(uchar), 1, fp, aux) < 0 ||
+         fxxxx_swap(&stats.SatelliteID,          sizeof(short), 1, fp, aux) < 0 ||
+         fxxxx_swap(&stats.NominalImageScanning, sizeof(uchar), 1, fp, aux) < 0 ||
+         fxxxx_swap(&stats.ReducedScan,          sizeof(uchar), 1, fp, aux) < 0 ||
+         seviri_TIME_CDS_SHORT_read(fp, &stats.ActScanForwardStart, aux) ||
+         seviri_TIME_CDS_SHORT_read(fp, &stats.ActScanForwardEnd,   aux)) {
+          fprintf(stderr, "ERROR: Error writing file: %s\n", filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     seviri_io_close(fp);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Write a synthetic HRIT timeslot: the prologue, the epilogue and the image
+ * segments of the 11 VIS/IR bands and the HRV band.  For the full disk all 8 (24
+ * for HRV) segments are written and for RSS the northern 3 (9) segments.
+ *
+ * indir	: Output directory including the trailing '/'
+ * timeslot	: Timeslot of the data. Format: YYYYMMDDHHMM
+ * sat		: Satellite number, can be 1, 2, 3 or 4
+ * rss		: Flag to write RSS rather than full disk data
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_bench_gen_hrit(const char *indir, const char *timeslot, int sat,
+                          int rss)
+{
+     char *proname;
+     char *epiname;
+     char ***bnames;
+
+     uchar *data10;
+
+     ushort *counts;
+
+     uint i;
+     uint j;
+     uint j0;
+     uint k;
+
+     uint n_bands = SEVIRI_N_BANDS;
+
+     uint band_ids[SEVIRI_N_BANDS];
+
+     int status = 0;
+
+     struct seviri_auxillary_io_data aux;
+
+     struct seviri_data *d;
+
+     for (i = 0; i < n_bands; ++i)
+          band_ids[i] = i + 1;
+
+     d = malloc(sizeof(struct seviri_data));
+
+     if (seviri_bench_gen_data(d, rss ? SEVIRI_BENCH_RSS : SEVIRI_BENCH_FULL_DISK)) {
+          fprintf(stderr, "ERROR: seviri_bench_gen_data()\n");
+          free(d);
+          return -1;
+     }
+
+     assemble_proname(&proname, indir, timeslot, sat, rss, 0);
+     assemble_epiname(&epiname, indir, timeslot, sat, rss, 0);
+     assemble_fnames (&bnames,  indir, timeslot, n_bands, band_ids, sat, rss, 0);
+
+     seviri_auxillary_alloc(&aux);
+     aux.operation  = 1;
+     aux.swap_bytes = su_is_little_endian();
+
+     if (write_hrit_prologue(proname, d, &aux)) {
+          fprintf(stderr, "ERROR: write_hrit_prologue()\n");
+          status = -1;
+     }
+
+     if (! status && write_hrit_epilogue(epiname, d, &aux)) {
+          fprintf(stderr, "ERROR: write_hrit_epilogue()\n");
+          status = -1;
+     }
+
+     data10 = malloc(MAX(d->image.n_columns, IMAGE_SIZE_HRV_COLUMNS) / 4 * 5 *
+                     sizeof(uchar));
+
+     /* RSS images only cover the last (northern) 3 of the 8 segments. */
+     j0 = rss ? 8 - d->image.n_lines / HRIT_SEGMENT_LINES : 0;
+
+     for (i = 0; i < n_bands - 1 && ! status; ++i) {
+          for (j = j0; j < 8 && ! status; ++j) {
+               if (write_hrit_segment(bnames[i][j], d->image.data_vir[i] +
+                                      (j - j0) * HRIT_SEGMENT_LINES * d->image.n_columns,
+                                      d->image.n_columns, band_ids[i], j + 1,
+                                      d->header.SatelliteStatus.SatelliteId, data10,
+                                      &aux)) {
+                    fprintf(stderr, "ERROR: write_hrit_segment()\n");
+                    status = -1;
+               }
+          }
+     }
+
+     /* Each HRV segment line is one line of the lower or upper window. */
+     counts = malloc(HRIT_SEGMENT_LINES * IMAGE_SIZE_HRV_COLUMNS * sizeof(ushort));
+
+     j0 = rss ? 24 - d->image.n_lines_hrv / HRIT_SEGMENT_LINES : 0;
+
+     for (j = j0; j < 24 && ! status; ++j) {
+          for (k = 0; k < HRIT_SEGMENT_LINES; ++k)
+               gen_hrv_record(d, (j - j0) * HRIT_SEGMENT_LINES + k,
+                              counts + k * IMAGE_SIZE_HRV_COLUMNS);
+
+          if (write_hrit_segment(bnames[n_bands - 1][j], counts,
+                                 IMAGE_SIZE_HRV_COLUMNS, 12, j + 1,
+                                 d->header.SatelliteStatus.SatelliteId, data10,
+                                 &aux)) {
+               fprintf(stderr, "ERROR: write_hrit_segment()\n");
+               status = -1;
+          }
+     }
+
+     free(counts);
+
+     free(data10);
+
+     seviri_auxillary_free(&aux);
+
+     free(proname);
+     free(epiname);
+     for (i = 0; i < n_bands; ++i) {
+          for (j = 0; j < (uint) is_hrv(band_ids[i]); ++j)
+               free(bnames[i][j]);
+          free(bnames[i]);
+     }
+     free(bnames);
+
+     seviri_free(d);
+     free(d);
+
+     return status;
+}
@@ -8,10 +8,35 @@
  *******************************************************************************
  *
  *    This program will read a NAT or HRIT file and save the data into
- *    a specific output format, one of HDF5, NetCDF or TIFF.
+ *    a specific output format, one of HDF5, NetCDF, TIFF or Zarr.
  *    A text file is used as a driver to describe the read/write.
  *    The name of the driver file should be given as the argument when
  *    running this program. e.g: ./SEVIRI_tool driver_file_name
+ *    Several driver files, one per time slot, may be given to process
+ *    them all in one process, e.g: ./SEVIRI_tool -j 4 driver_1 driver_2 ...
+ *    where -j sets the number of slots processed at a time (1 by
+ *    default). The latitude and longitude are then computed once for all
+ *    the slots with the same bounds, and the threads compressing the
+ *    output are shared out between the slots. Slots appending to a
+ *    cube are processed one at a time. If a slot fails the others are
+ *    still processed and the program returns an error at the end.
+ *    With -s <socket> the program runs as a daemon, accepting drivers as
+ *    jobs over a Unix domain socket until it receives SIGINT or SIGTERM,
+ *    e.g: ./SEVIRI_tool -j 2 -s /tmp/seviri.sock
+ *    A job is the text of a driver file sent over a connection to the
+ *    socket, ended by shutting down the sending side of the connection,
+ *    e.g: socat -t 600 - UNIX-CONNECT:/tmp/seviri.sock < driver_file_name
+ *    The reply is a JSON object with the status (0 if successful,
+ *    otherwise -1), the wall time in seconds and, if the driver contains
+ *    a perf line, the timing statistics of the job. The latitude and
+ *    longitude are kept for the life of the daemon.
+ *    With -m the arguments are NAT files rather than drivers and for each
+ *    a line of JSON is printed with the number of pixels, fill fraction,
+ *    minimum, maximum, mean, standard deviation and 1024 bin histogram of
+ *    the raw counts of every band, e.g: ./SEVIRI_tool -j 4 -m *.nat
+ *    The line records are unpacked straight into the statistics, without
+ *    calibration or holding the image, by -j threads sharing out blocks of
+ *    lines, for radiometric monitoring at close to the speed of the disk.
  *
  *    Text file format:
  *    Line 1,  Input data format: HRIT or NAT
@@ -22,8 +47,9 @@
  *    Line 6,  Indian Ocean coverage, 1 for yes 0 for no.
  *    Line 7,  Bands to read (HRIT and NAT) in format: 11010100100
  *             1 = read this band, 0 = do not read this band
- *             max length: 11 chars. If shorter, defaults to 0 for missing bands
- *    Line 8,  Output data format: HDF, CDF or TIF
+ *             max length: 12 chars, the 12th is HRV. If shorter, defaults
+ *             to 0 for missing bands. HRV is saved at VIS/IR resolution.
+ *    Line 8,  Output data format: HDF, CDF, TIF or ZARR
  *    Line 9,  Output data type: CNT, RAD or RBT (for count, radiance, refl/bt)
  *    Line 10, Output directory
  *    Line 11, Initial line
@@ -43,6 +69,62 @@
  *             Adding a line with 'compress' to the driver will compress
  *             the output data, saves disk space at expense of read/write time
  *             calib will apply GSICS calibration coefficients.
+ *             A product may be followed by :f32, :i16 or :f16 to set its
+ *             output precision, e.g. lat:i16. i16 saves 16 bit integers
+ *             with scale_factor/add_offset attributes, f16 saves half
+ *             floats (HDF and ZARR only). bands:<prec> sets the
+ *             precision of the bands and all:<prec> that of the bands and
+ *             all the geometry. time:line saves one time per line instead
+ *             of one per pixel. The precision only sets the size of the
+ *             file: the library still computes and holds every product as
+ *             32 bit floats, so the memory used is bounded with block
+ *             (below) rather than with the precision.
+ *             perf will print per-stage timing and I/O statistics as
+ *             JSON to stdout. These are only collected if the library
+ *             is compiled with -DSEVIRI_PERF.
+ *             chunk:<lines>x<columns> sets the chunk shape of the HDF,
+ *             NetCDF and ZARR output and the tile shape of the TIFF
+ *             output (rounded up to a multiple of 16), by default 512x512
+ *             or the image if smaller. Compressed HDF, TIFF and ZARR
+ *             output is compressed chunk by chunk by a pool of threads,
+ *             threads:<n> sets their number, by default one per processor.
+ *             ZARR output is a Zarr (version 2) directory store with an
+ *             array per product, chunked as the HDF output. Compressed
+ *             chunks are shuffled and deflated (zlib) and written to
+ *             their files by the same pool of threads.
+ *             TIFF output is tiled, with the bands and then the
+ *             ancilliary products as separate planes, compressed with
+ *             deflate and the floating point predictor, and followed by
+ *             overviews reduced by 2, 4, ... until one fits in a tile.
+ *             block:<lines> reads, processes and writes the image that
+ *             many lines at a time, each block being written while the
+ *             next is processed, so that only two blocks are held in
+ *             memory. Full disk bounds are only streamed when the file
+ *             covers the full disk. For compressed HDF and for ZARR
+ *             output blocks are rounded up to whole rows of chunks.
+ *             append makes the HDF or CDF output file a cube of time
+ *             slots and appends this run's slot to it if it exists. The
+ *             bands, time and solar angles get a leading unlimited time
+ *             dimension, chunked one slot at a time, while lat, lon, vza
+ *             and vaa are saved only once, by the run creating the cube.
+ *             The products, image size and packing must match the cube.
+ *             stats saves the minimum, maximum, mean and standard
+ *             deviation of each band, the fraction of its pixels that
+ *             are fill and a histogram of its counts as attributes of
+ *             the band (statistics_minimum, statistics_maximum,
+ *             statistics_mean, statistics_stddev, fill_fraction and
+ *             count_histogram). They are collected as each line is
+ *             calibrated, and merged across streamed blocks, so that
+ *             the output need not be read again. HDF, CDF and ZARR only,
+ *             and not when appending to a cube.
+ *             rgb:<name> saves an RGB composite of the bands, one of
+ *             natural_colour (bands 1-3), airmass (bands 5, 6, 8 and 9)
+ *             or dust (bands 7, 9 and 10), which must be read as RBT. It
+ *             is saved as an 8 bit PNG image next to the output file, e.g.
+ *             <output>_airmass.png, or as TIFF with rgb:<name>:tif. The
+ *             composites are produced from each block of lines as it is
+ *             written, with the enhancement and gamma of each channel
+ *             applied by an 8 bit lookup table, and not when appending.
  *
  *******************************************************************************
  *   Example file:
@@ -66,6 +148,7 @@
  *   vaa
  *   compress
  *   calib
+ *   bands:i16
  *
  *   This example will read HRIT data from 12:00 UTC on 3rd March 2017
  *   will search for IODC data but not RSS data
@@ -75,6 +158,7 @@
  *   As well as saving channels the viewing angles (vza + vaa) and
  *   the geoinfo (lat + lon) will be saved.
  *   The output file will be compressed to save disk space.
+ *   The bands will be saved as scaled 16 bit integers.
  *
  ******************************************************************************/
 
@@ -82,34 +166,62 @@
 
 int main(int argc, char *argv[])
 {
-     struct driver_data driver;
+     struct driver_data *drivers;
 
-     /* This struct will contain the image data and some metadata. */
-     struct seviri_preproc_data preproc;
+     int i, i_arg = 1, n_drivers, n_slots = 1;
 
-     /* Char array to store information required for parallax correction */
-     char satposstr[128];
+     /* Path of the socket of the daemon, if run as one */
+     char *sockpath = NULL;
 
-     /* Parse the input driver file into the driver structure */
-     if (argc!=2){show_usage();exit(-1);}
-     if (parse_driver(argv[1],&driver)!=0) {E_L_R();}
-     if (VERBOSE) if (print_driver(driver)!=0) {E_L_R();}
+     /* Monitor the counts of Native files instead of processing drivers */
+     int monitor = 0;
 
-     /* Run the appropriate processing chain, HRIT or NAT */
-     if (driver.infrmt==SEVIRI_INFILE_HRIT) if (run_sev_hrit(driver,&preproc, satposstr)!=0) {E_L_R();}
-     if (driver.infrmt==SEVIRI_INFILE_NAT) if (run_sev_native(driver,&preproc, satposstr)!=0) {E_L_R();}
+     /* Number of slots processed at a time, socket path and monitoring */
+     while (i_arg<argc && argv[i_arg][0]=='-') {
+          if (strcmp(argv[i_arg],"-m")==0) {monitor = 1;i_arg++;continue;}
+          if (i_arg+1>=argc) break;
+          if (strcmp(argv[i_arg],"-j")==0) n_slots = atoi(argv[i_arg+1]);
+          else if (strcmp(argv[i_arg],"-s")==0) sockpath = argv[i_arg+1];
+          else break;
+          i_arg += 2;
+     }
+     if (n_slots<1){show_usage();exit(-1);}
 
-     /* If we're in verbose mode then print info about a sample pixel in the preprocessed data
-        By default we'll examine the central pixel in the image */
-     if (VERBOSE) if (print_preproc_out(driver, preproc, preproc.n_lines/2-1, preproc.n_columns/2-1)!=0) {E_L_R();}
+     /* Print the count statistics of each Native file */
+     if (monitor) {
+          if (sockpath || argc<=i_arg){show_usage();exit(-1);}
+          if (run_sev_monitor(&argv[i_arg],argc-i_arg,n_slots)!=0) {E_L_R();}
+          return 0;
+     }
 
-     if (driver.outfrmt==SEVIRI_OUTFILE_HDF)if (save_sev_hdf(driver,preproc)!=0) {E_L_R();}
-     if (driver.outfrmt==SEVIRI_OUTFILE_CDF)if (save_sev_cdf(driver,preproc)!=0) {E_L_R();}
-     if (driver.outfrmt==SEVIRI_OUTFILE_TIF)if (save_sev_tiff(driver,preproc)!=0) {E_L_R();}
+     /* Run as a daemon accepting drivers over the socket */
+     if (sockpath) {
+          if (argc!=i_arg){show_usage();exit(-1);}
+          if (run_sev_daemon(sockpath,n_slots)!=0) {E_L_R();}
+          return 0;
+     }
+     if (argc<=i_arg){show_usage();exit(-1);}
 
-     if (free_driver(&driver)!=0) {E_L_R();}
-     /* Free memory allocated by seviri_read_and_preproc(). */
-     if (seviri_preproc_free(&preproc)!=0) {E_L_R();}
+     /* Parse the input driver files into driver structures */
+     n_drivers = argc - i_arg;
+     drivers   = (struct driver_data*) malloc(sizeof(struct driver_data)*n_drivers);
+     for (i=0;i<n_drivers;i++) {
+          if (parse_driver(argv[i_arg+i],&drivers[i])!=0) {
+               while (i-- > 0) free_driver(&drivers[i]);
+               free(drivers);
+               E_L_R();
+          }
+     }
+
+     /* Process the time slots, at most n_slots at a time */
+     if (run_sev_batch(drivers,n_drivers,n_slots)!=0) {
+          for (i=0;i<n_drivers;i++) free_driver(&drivers[i]);
+          free(drivers);
+          E_L_R();
+     }
+
+     for (i=0;i<n_drivers;i++) if (free_driver(&drivers[i])!=0) {E_L_R();}
+     free(drivers);
 
      return 0;
 }
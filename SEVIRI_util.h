@@ -19,11 +19,19 @@
 
 /* Define some useful types that are using during processing. */
 enum seviri_intypes {SEVIRI_INFILE_HRIT, SEVIRI_INFILE_NAT, N_SEVIRI_INTYPES};
-enum seviri_outtypes{SEVIRI_OUTFILE_HDF, SEVIRI_OUTFILE_CDF, SEVIRI_OUTFILE_TIF, N_SEVIRI_OUTTYPES};
+enum seviri_outtypes{SEVIRI_OUTFILE_HDF, SEVIRI_OUTFILE_CDF, SEVIRI_OUTFILE_TIF, SEVIRI_OUTFILE_ZARR, N_SEVIRI_OUTTYPES};
 enum sat_nums       {SAT_MSG1, SAT_MSG2, SAT_MSG3, SAT_MSG4, N_SEVIRI_SATNUMS};
 
+/* Storage type of a product in the output file: 32 bit float, 16 bit integer
+   with CF scale_factor/add_offset attributes or 16 bit (half) float. */
+enum seviri_outprecs{SEVIRI_OUTPREC_F32, SEVIRI_OUTPREC_I16, SEVIRI_OUTPREC_F16, N_SEVIRI_OUTPRECS};
+
+/* Format of an RGB composite output file, if the composite is saved. */
+enum seviri_rgbtypes{SEVIRI_RGB_NONE, SEVIRI_RGB_PNG, SEVIRI_RGB_TIF, N_SEVIRI_RGBTYPES};
+
 
 extern const char *bnames[];
+extern const char *ancnames[];
 
 
 /* Struct that contains the band information, both number of bands and which to process */
@@ -52,9 +60,36 @@ struct driver_data {
      int               fcol;
      /* ancsave contains: time,lat,lon,sza,saa,vza,vaa */
      int               ancsave[7];
+     /* Output precision of the bands and of each ancsave product */
+     int               bandprec;
+     int               ancprec[7];
+     /* Save one time per line rather than one time per pixel */
+     int               linetime;
      int               compression;
+     /* Chunk shape (lines, columns) of the output, 0 for the default, and
+        number of threads compressing the chunks, 0 for one per processor */
+     int               chunk[2];
+     int               threads;
+     /* Number of lines read, processed and written at a time, 0 for all */
+     int               block;
+     /* Append a time slot to the output file, a cube of time slots */
+     int               append;
+     /* Save the band statistics collected during calibration as attributes */
+     int               stats;
+     /* Format of each RGB composite (see composite.h) saved, if any */
+     int               rgb[N_SEVIRI_COMPOSITES];
      int               do_calib;
      int               do_nasa;
+     /* Print the per-stage timing statistics as JSON */
+     int               perf;
+     /* Cache of the latitude and longitude images shared with the other slots
+        of a batch or jobs of a daemon, or NULL. Not set by the driver file */
+     struct            seviri_nav_cache *nav_cache;
+     /* Turns in which the slots of a batch or jobs of a daemon appending to a
+        cube write it, and the turn of this one, or NULL. Not set by the
+        driver file */
+     struct            sev_out_turn *out_turn;
+     int               i_turn;
 };
 
 
@@ -63,12 +98,28 @@ void show_usage();
 int print_driver(struct driver_data driver);
 int free_driver(struct driver_data *driver);
 int parse_driver(char *fname,struct driver_data *driver);
+int parse_driver_fp(FILE *fp,char *fname,struct driver_data *driver);
 int print_preproc_out(struct driver_data, struct seviri_preproc_data preproc, unsigned int i_line, unsigned int i_column);
 
 /* In SEVIRI_tool_prog.c */
 int run_sev_native(struct driver_data driver, struct seviri_preproc_data *preproc, char satposstr[128]);
 int run_sev_hrit(struct driver_data driver, struct seviri_preproc_data *preproc, char satposstr[128]);
 
+int run_sev_stream(struct driver_data driver, struct seviri_perf_data *perf, char satposstr[128]);
+
+int run_sev_slot(struct driver_data driver, struct seviri_perf_data *perf);
+int run_sev_batch(struct driver_data *drivers, int n_drivers, int n_slots);
+int run_sev_daemon(const char *path, int n_slots);
+int run_sev_monitor(char **fnames, int n_files, int n_slots);
+
+struct sev_outfile;
+struct sev_outfile *open_sev_out(struct driver_data driver, unsigned int n_lines,
+                                 unsigned int n_columns, unsigned int n_bands, float fill_value);
+int put_sev_out(struct sev_outfile *out, struct driver_data driver,
+                struct seviri_preproc_data preproc, unsigned int i_line);
+int close_sev_out(struct sev_outfile *out);
+
 int save_sev_tiff(struct driver_data driver, struct seviri_preproc_data preproc);
 int save_sev_cdf(struct driver_data driver, struct seviri_preproc_data preproc);
 int save_sev_hdf(struct driver_data driver, struct seviri_preproc_data preproc);
+int save_sev_zarr(struct driver_data driver, struct seviri_preproc_data preproc);
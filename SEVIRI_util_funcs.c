@@ -18,21 +18,30 @@
 
 const char *bnames[] = {"VIS006", "VIS008", "IR_016", "IR_039", "WV_062",
                         "WV_073", "IR_087", "IR_097", "IR_108", "IR_120",
-                        "IR_134"};
+                        "IR_134", "HRV"};
+
+/* Driver keywords of the optional ancillary outputs, in ancsave order. */
+
+const char *ancnames[] = {"time", "lat", "lon", "sza", "saa", "vza", "vaa"};
+
+/* Driver keywords of the output precisions, in seviri_outprecs order. */
+
+static const char *precnames[] = {"f32", "i16", "f16"};
 
 /* Prints a message that shows how to use the utility. */
 void show_usage()
 {
-     printf("To run this program please use:\n\t./SEVIRI_tool <filename>\n");
-     printf("Where <filename> points to a driver file containing the following lines:\n");
+     printf("To run this program please use:\n\t./SEVIRI_tool [-j <n>] <filename> [<filename> ...]\n");
+     printf("Where each <filename> points to a driver file, one per time slot, processed\n");
+     printf("in one process at most <n> (1 by default) at a time, containing the following lines:\n");
      printf("\tLine 1,  Input data format: HRIT or NAT\n");
      printf("\tLine 2,  Input directory (if HRIT) or input file (if NAT)\n");
      printf("\tLine 3,  Timeslot (if HRIT, YYYYMMDDHHMM) or blank (if NAT)\n");
      printf("\tLine 4,  Satellite number (if HRIT, 1/2/3/4) or blank (if nat)\n");
      printf("\tLine 5,  Bands to read (HRIT and NAT) in format: 11010100100\n");
      printf("\t\t 1 = read this band, 0 = do not read this band\n");
-     printf("\t\t max length: 11 chars. If shorter, defaults to 0 for missing bands\n");
-     printf("\tLine 6,  Output data format: HDF, CDF or TIF\n");
+     printf("\t\t max length: 12 chars, the 12th is HRV. If shorter, defaults to 0 for missing bands\n");
+     printf("\tLine 6,  Output data format: HDF, CDF, TIF or ZARR\n");
      printf("\tLine 7,  Output data type: CNT, RAD or RBT (for count, radiance, refl/bt)\n");
      printf("\tLine 8,  Output directory\n");
      printf("\tLine 9,  Initial line\n");
@@ -42,6 +51,21 @@ void show_usage()
      printf("\t\t If final vals < initial vals: Program will quit\n");
      printf("\t\t If initial vals are < 0:      Program assumes inital vals = 0\n");
      printf("\t\t If final vals are > 3711:     Program assumes final vals = 3711\n");
+     printf("\tRemaining lines, optional outputs: time, lat, lon, sza, saa, vza, vaa\n");
+     printf("\t\t Append :f32, :i16 or :f16 to set the output precision, e.g. lat:i16\n");
+     printf("\t\t (of the file only, the products are held as floats in memory)\n");
+     printf("\t\t Use bands:<prec> for the bands and all:<prec> for every product\n");
+     printf("\t\t Use time:line to save one time per line instead of per pixel\n");
+     printf("\t\t Use perf to print timing statistics as JSON (build with -DSEVIRI_PERF)\n");
+     printf("\t\t Use chunk:<lines>x<columns> to set the HDF/CDF chunk or TIFF tile shape, e.g. chunk:512x512\n");
+     printf("\t\t Use threads:<n> to set the number of threads compressing HDF chunks or TIFF tiles\n");
+     printf("\t\t Use block:<lines> to read, process and write that many lines at a time\n");
+     printf("\t\t Use append to append a time slot to an existing HDF/CDF cube\n");
+     printf("\t\t Use stats to save band statistics and count histograms as HDF/CDF/ZARR attributes\n");
+     printf("\t\t Use rgb:<name>[:png|:tif] to save a natural_colour, airmass or dust RGB composite\n");
+     printf("Or, to accept the text of driver files as jobs over a Unix domain socket:\n\t./SEVIRI_tool [-j <n>] -s <socket>\n");
+     printf("\t\t Each job replies with its status and timings as JSON\n");
+     printf("Or, to print the statistics and histogram of the counts of Native files as JSON:\n\t./SEVIRI_tool [-j <n>] -m <file.nat> [<file.nat> ...]\n");
      printf("Will now exit!\n");
 }
 
@@ -50,10 +74,10 @@ void show_usage()
 static void parsebands(char *bands, struct bands_st *inbands)
 {
      int len       = strlen(bands);
-     int recval    = 11;
+     int recval    = 12;
      int i         = 0;
      int act_bands = 0;
-     if (len<11) recval=len;
+     if (len<12) recval=len;
      recval = recval;
 
      inbands->band_ids = malloc(sizeof(unsigned int));
@@ -116,20 +140,91 @@ int print_driver(struct driver_data driver)
      if (driver.ancsave[5]==1)strcat(outstr,"vza ");
      if (driver.ancsave[6]==1)strcat(outstr,"vaa ");
      printf("Will save this ancilliary data:\t%s\n",outstr);
+     printf("Band output precision:\t\t%s\n",precnames[driver.bandprec]);
+     for (i=1;i<7;i++)
+          if (driver.ancsave[i]==1 && driver.ancprec[i]!=SEVIRI_OUTPREC_F32)
+               printf("%s output precision:\t\t%s\n",ancnames[i],precnames[driver.ancprec[i]]);
+     if (driver.ancsave[0]==1 && driver.linetime==1)printf("Time will be saved once per line\n");
 
-     if (driver.compression==1 && driver.outfrmt==SEVIRI_OUTFILE_TIF)printf("The output file will be compressed with LZW\n");
+     if (driver.compression==1 && driver.outfrmt==SEVIRI_OUTFILE_TIF)printf("The output file will be compressed with deflate level 2 and the floating point predictor\n");
      if (driver.compression!=1 && driver.outfrmt==SEVIRI_OUTFILE_TIF)printf("The output file will not be compressed\n");
      if (driver.compression==1 && driver.outfrmt==SEVIRI_OUTFILE_CDF)printf("The output file will be compressed with shuffle and deflate level 2\n");
      if (driver.compression!=1 && driver.outfrmt==SEVIRI_OUTFILE_CDF)printf("The output file will not be compressed\n");
      if (driver.compression==1 && driver.outfrmt==SEVIRI_OUTFILE_HDF)printf("The output file will be compressed with shuffle and deflate level 2\n");
      if (driver.compression!=1 && driver.outfrmt==SEVIRI_OUTFILE_HDF)printf("The output file will not be compressed\n");
+     if (driver.compression==1 && driver.outfrmt==SEVIRI_OUTFILE_ZARR)printf("The output chunks will be compressed with shuffle and zlib level 2\n");
+     if (driver.compression!=1 && driver.outfrmt==SEVIRI_OUTFILE_ZARR)printf("The output chunks will not be compressed\n");
+     if (driver.chunk[0]>0)printf("Output chunk shape:\t\t%ix%i\n",driver.chunk[0],driver.chunk[1]);
+     if (driver.compression==1 && driver.outfrmt!=SEVIRI_OUTFILE_CDF && driver.threads>0)printf("Compression threads:\t\t%i\n",driver.threads);
+     if (driver.block>0)printf("Will stream blocks of lines:\t%i\n",driver.block);
+     if (driver.append==1)printf("Will append a time slot to the output file if it exists\n");
+     if (driver.stats==1)printf("Will save the band statistics as attributes of the bands\n");
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++)
+          if (driver.rgb[i]!=SEVIRI_RGB_NONE)printf("Will save the %s composite as %s\n",seviri_composite_name(i),driver.rgb[i]==SEVIRI_RGB_PNG ? "PNG" : "TIFF");
      if (driver.do_calib==1)printf("The GSICS calibration coefficients will be applied.\n");
      if (driver.do_calib!=1)printf("The GSICS calibration coefficients will NOT be applied.\n");
+     if (driver.perf==1)printf("Timing statistics will be printed as JSON\n");
 
      printf("**************************************************************************\n\n");
      return 0;
 }
 
+/* Parses an output precision keyword (f32, i16 or f16) and checks that the
+   output format can store it. Returns -1 if the keyword is not valid. */
+static int parseprec(const char *str, int outfrmt, int *prec)
+{
+     int i;
+
+     for (i=0;i<N_SEVIRI_OUTPRECS;i++)
+          if (!strcmp(str,precnames[i])) break;
+     if (i==N_SEVIRI_OUTPRECS) {
+          printf("Unknown output precision in driver file: %s\n",str);
+          return -1;
+     }
+     if (i!=SEVIRI_OUTPREC_F32 && outfrmt==SEVIRI_OUTFILE_TIF) {
+          printf("Reduced output precision is only supported for HDF and CDF output\n");
+          return -1;
+     }
+     if (i==SEVIRI_OUTPREC_F16 && outfrmt!=SEVIRI_OUTFILE_HDF && outfrmt!=SEVIRI_OUTFILE_ZARR) {
+          printf("Half precision output is only supported for HDF and ZARR output\n");
+          return -1;
+     }
+     *prec=i;
+
+     return 0;
+}
+
+/* Parses an RGB composite keyword (<name>[:png|:tif], e.g. airmass:tif) and
+   checks that the driver reads the bands the composite needs in the right
+   units. Returns -1 if the keyword is not valid. */
+static int parsergb(char *str, struct driver_data *driver)
+{
+     int i, frmt=SEVIRI_RGB_PNG;
+     char *ext;
+     struct seviri_composite_data comp;
+
+     if (str==NULL) {printf("The composite must be given as rgb:<name>, e.g. rgb:airmass\n");return -1;}
+
+     ext=strchr(str,':');
+     if (ext!=NULL) {
+          *ext++='\0';
+          if (!strcmp(ext,"png")) frmt=SEVIRI_RGB_PNG;
+          else if (!strcmp(ext,"tif")) frmt=SEVIRI_RGB_TIF;
+          else {printf("Unknown composite output format in driver file: %s\n",ext);return -1;}
+     }
+
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++)
+          if (!strcmp(str,seviri_composite_name(i))) break;
+     if (i==N_SEVIRI_COMPOSITES) {printf("Unknown composite in driver file: %s\n",str);return -1;}
+
+     if (seviri_composite_init(&comp,i,driver->sev_bands.nbands,driver->sev_bands.band_ids,
+                               driver->outtype)!=0) {printf("The driver does not read the bands the %s composite needs\n",str);return -1;}
+
+     driver->rgb[i]=frmt;
+
+     return 0;
+}
+
 /* Sets lines and cols to zero in case of FULL/ACTUAL image reading */
 static void setline(struct driver_data *driver)
 {
@@ -165,7 +260,8 @@ int print_preproc_out(struct driver_data driver, struct seviri_preproc_data prep
      printf("i_line:                %d\n", i_line);
      printf("i_column:              %d\n", i_column);
      printf("i_pixel:               %d\n", i_pixel);
-     printf("Julian Day Number:     %f\n", preproc.time[i_pixel]);
+     printf("Julian Day Number:     %f\n", preproc.lat[i_pixel] != preproc.fill_value ?
+                                         preproc.time_line[i_line] : preproc.fill_value);
      printf("latitude:              %f\n", preproc.lat [i_pixel]);
      printf("longitude:             %f\n", preproc.lon [i_pixel]);
      printf("solar zenith angle:    %f\n", preproc.sza [i_pixel]);
@@ -204,108 +300,111 @@ int free_driver(struct driver_data *driver)
 }
 
 /*******************************************************************************
- *    Parser for the driver file.
+ *    Parser for a driver read from a stream, such as a driver file or a job
+ *    sent to run_sev_daemon().
  *    Inputs:
- *         fname:     Driver filename
+ *         fp:        The stream, read to the end of the driver
+ *         fname:     Name of the driver used in error messages
  *         driver:      Structure that will contain the parsed data
  *    Outputs:
  *         integer:     Zero if success, otherwise -1
  ******************************************************************************/
-int parse_driver(char *fname,struct driver_data *driver)
+int parse_driver_fp(FILE *fp,char *fname,struct driver_data *driver)
 {
      int i;
      int iline;
      size_t len=0;
      char *line = NULL;
 
-     FILE *fp = fopen(fname,"r");
-     if (fp == NULL) {printf("Unable to open the driver file: %s\n",fname);E_L_R();}
-
      /* Read the type of input file from line 1 of the driver */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading HRIT line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading HRIT line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      if (!strcmp(line,"HRIT")) driver->infrmt = SEVIRI_INFILE_HRIT;
      else if (!strcmp(line,"NAT")) driver->infrmt = SEVIRI_INFILE_NAT;
-     else {printf("Incorrect input type in driver file. Must be HRIT or NAT.\n");free(line);fclose(fp);E_L_R();}
+     else {printf("Incorrect input type in driver file. Must be HRIT or NAT.\n");free(line);E_L_R();}
 
      /* Read the filename / input file directory. */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading input file/dir line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-     if (strlen(line)<4) {printf("Failure reading input file/dir line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading input file/dir line of driver file %s\n",fname);free(line);E_L_R();}
+     if (strlen(line)<4) {printf("Failure reading input file/dir line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      driver->infdir = (char*) malloc(sizeof(char)*(strlen(line)+1));
      strcpy(driver->infdir,line);
      if (driver->infrmt==SEVIRI_INFILE_HRIT) {
           /* Read the timeslot (HRIT only) */
-          if (getline(&line,&len,fp)==-1) {printf("Failure reading input timeslot line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-          if (strlen(line)<12 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading input timeslot line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-          line[strlen(line)-1]='\0';
+          if (getline(&line,&len,fp)==-1) {printf("Failure reading input timeslot line of driver file %s\n",fname);free(line);E_L_R();}
+          /* The timeslot must be exactly YYYYMMDDhhmm, as the driver may come
+             from a client of run_sev_daemon() */
+          line[strcspn(line,"\r\n")]='\0';
+          if (strlen(line)!=12 || strspn(line,"0123456789")!=12) {printf("Failure reading input timeslot line of driver file %s\n",fname);free(line);E_L_R();}
           driver->timeslot = (char*) malloc(sizeof(char)*13);
           strcpy(driver->timeslot,line);
 
           /* Read the satellite number (HRIT only) */
-          if (getline(&line,&len,fp)==-1) {printf("Failure reading input satellite number line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-          if (strlen(line)<1 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading input satellite number line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+          if (getline(&line,&len,fp)==-1) {printf("Failure reading input satellite number line of driver file %s\n",fname);free(line);E_L_R();}
+          if (strlen(line)<1 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading input satellite number line of driver file %s\n",fname);free(line);E_L_R();}
           line[strlen(line)-1]='\0';
           if (atoi(line)==1) driver->satnum  = SAT_MSG1+1;
           else if (atoi(line)==2) driver->satnum = SAT_MSG2+1;
           else if (atoi(line)==3) driver->satnum = SAT_MSG3+1;
           else if (atoi(line)==4) driver->satnum = SAT_MSG4+1;
-          else {printf("Failure reading input satellite number line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+          else {printf("Failure reading input satellite number line of driver file %s\n",fname);free(line);E_L_R();}
      }
 
      /* Read the rss mode */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading RSS flag line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-     if (strlen(line)<1 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading RSS flag line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading RSS flag line of driver file %s\n",fname);free(line);E_L_R();}
+     if (strlen(line)<1 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading RSS flag line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      if (atoi(line)==0) driver->rss = 0;
      else if (atoi(line)==1) driver->rss = 1;
-     else {printf("Failure reading RSS flag line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     else {printf("Failure reading RSS flag line of driver file %s\n",fname);free(line);E_L_R();}
 
      /* Read the iodc mode */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading IODC flag line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-     if (strlen(line)<1 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading IODC flag line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading IODC flag line of driver file %s\n",fname);free(line);E_L_R();}
+     if (strlen(line)<1 && driver->infrmt==SEVIRI_INFILE_HRIT) {printf("Failure reading IODC flag line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      if (atoi(line)==0) driver->iodc = 0;
      else if (atoi(line)==1) driver->iodc = 1;
-     else {printf("Failure reading IODC flag line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     else {printf("Failure reading IODC flag line of driver file %s\n",fname);free(line);E_L_R();}
 
      /* Read the bands to process */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading bands to process line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading bands to process line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      parsebands(line,&driver->sev_bands);
      driver->outtype = (enum seviri_units*) malloc(sizeof(enum seviri_units)*driver->sev_bands.nbands);
-     if (driver->outtype == NULL) {printf("Failure reading bands to process line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
-     if (driver->sev_bands.nbands<=0 || driver->sev_bands.nbands>11) {printf("Failure reading bands to process line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (driver->outtype == NULL) {printf("Failure reading bands to process line of driver file %s\n",fname);free(line);E_L_R();}
+     if (driver->sev_bands.nbands<=0 || driver->sev_bands.nbands>12) {printf("Failure reading bands to process line of driver file %s\n",fname);free(line);E_L_R();}
 
      /* Read the output file type */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading output file type line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading output file type line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      if (!strcmp(line,"HDF")) driver->outfrmt = SEVIRI_OUTFILE_HDF;
      else if (!strcmp(line,"CDF")) driver->outfrmt = SEVIRI_OUTFILE_CDF;
      else if (!strcmp(line,"TIF")) driver->outfrmt = SEVIRI_OUTFILE_TIF;
-     else {printf("Failure reading output file type line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     else if (!strcmp(line,"ZARR")) driver->outfrmt = SEVIRI_OUTFILE_ZARR;
+     else {printf("Failure reading output file type line of driver file %s\n",fname);free(line);E_L_R();}
 
      /* Read the output units type */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading output units type line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading output units type line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      if (!strcmp(line,"CNT")) for (i=0;i<driver->sev_bands.nbands;i++) driver->outtype[i] = SEVIRI_UNIT_CNT;
      else if (!strcmp(line,"RAD")) for (i=0;i<driver->sev_bands.nbands;i++) driver->outtype[i] = SEVIRI_UNIT_RAD;
-     else if (!strcmp(line,"RBT")) for (i=0;i<driver->sev_bands.nbands;i++) if (driver->sev_bands.band_ids[i]<=3) driver->outtype[i] = SEVIRI_UNIT_BRF; else driver->outtype[i] = SEVIRI_UNIT_BT;
-     else {printf("Failure reading output units type line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     else if (!strcmp(line,"RBT")) for (i=0;i<driver->sev_bands.nbands;i++) if (driver->sev_bands.band_ids[i]<=3 || driver->sev_bands.band_ids[i]==12) driver->outtype[i] = SEVIRI_UNIT_BRF; else driver->outtype[i] = SEVIRI_UNIT_BT;
+     else {printf("Failure reading output units type line of driver file %s\n",fname);free(line);E_L_R();}
 
      /* Read the output filename. */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading output filename line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading output filename line of driver file %s\n",fname);free(line);E_L_R();}
      len = strlen(line);
-     if (len<4) {printf("Failure reading utput filename line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (len<4) {printf("Failure reading utput filename line of driver file %s\n",fname);free(line);E_L_R();}
      if (len > 0 && line[len-1] == '\n') line[len-1] = '\0';
      driver->outf = (char*) malloc(sizeof(char)*(len+5));
      strcpy(driver->outf,line);
      if (driver->outfrmt == SEVIRI_OUTFILE_HDF)strcat(driver->outf,".h5");
      if (driver->outfrmt == SEVIRI_OUTFILE_CDF)strcat(driver->outf,".nc");
      if (driver->outfrmt == SEVIRI_OUTFILE_TIF)strcat(driver->outf,".tiff");
+     if (driver->outfrmt == SEVIRI_OUTFILE_ZARR)strcat(driver->outf,".zarr");
 
      /* Read the initial line */
-     if (getline(&line,&len,fp)==-1) {printf("Failure reading input initial line line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+     if (getline(&line,&len,fp)==-1) {printf("Failure reading input initial line line of driver file %s\n",fname);free(line);E_L_R();}
      line[strlen(line)-1]='\0';
      iline = atoi(line);
      driver->bounds = SEVIRI_BOUNDS_LINE_COLUMN;
@@ -314,15 +413,15 @@ int parse_driver(char *fname,struct driver_data *driver)
      if (iline!=-100 && iline!=-200) {
           driver->iline = iline;
           /* Read the final line */
-          if (getline(&line,&len,fp)==-1) {printf("Failure reading input final line line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+          if (getline(&line,&len,fp)==-1) {printf("Failure reading input final line line of driver file %s\n",fname);free(line);E_L_R();}
           line[strlen(line)-1]='\0';
           driver->fline = atoi(line);
           /* Read the initial column */
-          if (getline(&line,&len,fp)==-1) {printf("Failure reading input initial column line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+          if (getline(&line,&len,fp)==-1) {printf("Failure reading input initial column line of driver file %s\n",fname);free(line);E_L_R();}
           line[strlen(line)-1]='\0';
           driver->icol = atoi(line);
           /* Read the final column */
-          if (getline(&line,&len,fp)==-1) {printf("Failure reading input final column line of driver file %s\n",fname);free(line);fclose(fp);E_L_R();}
+          if (getline(&line,&len,fp)==-1) {printf("Failure reading input final column line of driver file %s\n",fname);free(line);E_L_R();}
           line[strlen(line)-1]='\0';
           driver->fcol = atoi(line);
 
@@ -333,37 +432,141 @@ int parse_driver(char *fname,struct driver_data *driver)
           if (driver->fline>3711) driver->fline=3711;
           if (driver->fcol>3711) driver->fcol=3711;
 
-          if (driver->iline>3711) {printf("The initial processing line cannot be greater than 3711. You used: %i\n",driver->iline);free(line);fclose(fp);E_L_R();}
-          if (driver->icol>3711) {printf("The initial processing column cannot be greater than 3711. You used: %i\n",driver->icol);free(line);fclose(fp);E_L_R();}
-          if (driver->fline<0) {printf("The final processing line cannot be less than 0. You used: %i\n",driver->fline);free(line);fclose(fp);E_L_R();}
-          if (driver->fcol<0) {printf("The final processing column cannot be less than 0. You used: %i\n",driver->fcol);free(line);fclose(fp);E_L_R();}
+          if (driver->iline>3711) {printf("The initial processing line cannot be greater than 3711. You used: %i\n",driver->iline);free(line);E_L_R();}
+          if (driver->icol>3711) {printf("The initial processing column cannot be greater than 3711. You used: %i\n",driver->icol);free(line);E_L_R();}
+          if (driver->fline<0) {printf("The final processing line cannot be less than 0. You used: %i\n",driver->fline);free(line);E_L_R();}
+          if (driver->fcol<0) {printf("The final processing column cannot be less than 0. You used: %i\n",driver->fcol);free(line);E_L_R();}
 
-          if (driver->icol>=driver->fcol) {printf("The initial processing column cannot be greater than the final processing column. You used: %i and %i\n",driver->icol,driver->fcol);free(line);fclose(fp);E_L_R();}
-          if (driver->iline>=driver->fline) {printf("The initial processing line cannot be greater than the final processing line. You used: %i and %i\n",driver->iline,driver->fline);free(line);fclose(fp);E_L_R();}
+          if (driver->icol>=driver->fcol) {printf("The initial processing column cannot be greater than the final processing column. You used: %i and %i\n",driver->icol,driver->fcol);free(line);E_L_R();}
+          if (driver->iline>=driver->fline) {printf("The initial processing line cannot be greater than the final processing line. You used: %i and %i\n",driver->iline,driver->fline);free(line);E_L_R();}
           if (driver->fline>3711) driver->fline=3711;
           if (driver->fcol>3711) driver->fcol=3711;
      }
 
      /* Read the anciliary data line.*/
      /* ancsave contains: 0-time, 1-lat, 2-lon, 3-sza, 4-saa, 5-vza, 6-vaa */
+     /* Each product may be followed by :<precision>, e.g. lat:i16 */
      driver->compression=0;
+     driver->do_calib=0;
+     driver->do_nasa=0;
+     driver->perf=0;
+     driver->bandprec=SEVIRI_OUTPREC_F32;
+     driver->linetime=0;
+     driver->chunk[0]=0;
+     driver->chunk[1]=0;
+     driver->threads=0;
+     driver->block=0;
+     driver->append=0;
+     driver->stats=0;
+     driver->nav_cache=NULL;
+     driver->out_turn=NULL;
+     driver->i_turn=0;
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++) driver->rgb[i]=SEVIRI_RGB_NONE;
      for (i=0;i<7;i++) driver->ancsave[i]=0;
-     while (fgets(line, 10, fp)) {
-          line[strlen(line)-1]='\0';
-          if (strcmp(line,"time")==0)    driver->ancsave[0]=1;
+     for (i=0;i<7;i++) driver->ancprec[i]=SEVIRI_OUTPREC_F32;
+     while (getline(&line,&len,fp)!=-1) {
+          char *prec;
+          int iprec=SEVIRI_OUTPREC_F32;
+
+          line[strcspn(line," \t\r\n")]='\0';
+          if (line[0]=='\0') continue;
+
+          prec=strchr(line,':');
+          if (prec!=NULL) *prec++='\0';
+
           if (strcmp(line,"compress")==0)driver->compression=1;
-          if (strcmp(line,"lat")==0)     driver->ancsave[1]=1;
-          if (strcmp(line,"lon")==0)     driver->ancsave[2]=1;
-          if (strcmp(line,"sza")==0)     driver->ancsave[3]=1;
-          if (strcmp(line,"saa")==0)     driver->ancsave[4]=1;
-          if (strcmp(line,"vza")==0)     driver->ancsave[5]=1;
-          if (strcmp(line,"vaa")==0)     driver->ancsave[6]=1;
-          if (strcmp(line,"calib")==0)
-               driver->do_calib=1;
-          else
-               driver->do_calib=0;
+          if (strcmp(line,"calib")==0)   driver->do_calib=1;
+          if (strcmp(line,"perf")==0)    driver->perf=1;
+
+          /* Append a time slot to a cube file */
+          if (strcmp(line,"append")==0) {
+               if (driver->outfrmt!=SEVIRI_OUTFILE_HDF && driver->outfrmt!=SEVIRI_OUTFILE_CDF) {printf("Append mode is only supported for HDF and CDF output\n");free(line);E_L_R();}
+               driver->append=1;
+               continue;
+          }
+
+          /* Save the band statistics as attributes of the bands */
+          if (strcmp(line,"stats")==0) {
+               if (driver->outfrmt==SEVIRI_OUTFILE_TIF) {printf("Band statistics are only saved for HDF, CDF and ZARR output\n");free(line);E_L_R();}
+               driver->stats=1;
+               continue;
+          }
+
+          /* Save an RGB composite of the bands, as PNG unless followed by :tif */
+          if (strcmp(line,"rgb")==0) {
+               if (parsergb(prec,driver)!=0) {free(line);E_L_R();}
+               continue;
+          }
+
+          /* The chunk shape and number of compression threads */
+          if (strcmp(line,"chunk")==0) {
+               if (prec==NULL || sscanf(prec,"%ix%i",&driver->chunk[0],&driver->chunk[1])!=2 ||
+                   driver->chunk[0]<1 || driver->chunk[1]<1) {printf("The chunk shape must be given as chunk:<lines>x<columns>\n");free(line);E_L_R();}
+               continue;
+          }
+          if (strcmp(line,"threads")==0) {
+               if (prec==NULL || sscanf(prec,"%i",&driver->threads)!=1 || driver->threads<1) {printf("The number of threads must be given as threads:<n>\n");free(line);E_L_R();}
+               continue;
+          }
+          if (strcmp(line,"block")==0) {
+               if (prec==NULL || sscanf(prec,"%i",&driver->block)!=1 || driver->block<1) {printf("The block size must be given as block:<lines>\n");free(line);E_L_R();}
+               continue;
+          }
+
+          for (i=0;i<7;i++) if (strcmp(line,ancnames[i])==0) break;
+
+          /* Time is kept in double precision, only its layout can be changed */
+          if (i==0 && prec!=NULL) {
+               if (strcmp(prec,"line")!=0) {printf("Time can only be saved per pixel or with time:line\n");free(line);E_L_R();}
+               driver->linetime=1;
+               prec=NULL;
+          }
+
+          if (prec!=NULL && parseprec(prec,driver->outfrmt,&iprec)!=0) {free(line);E_L_R();}
+
+          if (i<7) {
+               driver->ancsave[i]=1;
+               if (prec!=NULL) driver->ancprec[i]=iprec;
+          }
+          else if (strcmp(line,"bands")==0 && prec!=NULL)
+               driver->bandprec=iprec;
+          else if (strcmp(line,"all")==0 && prec!=NULL) {
+               driver->bandprec=iprec;
+               for (i=1;i<7;i++) driver->ancprec[i]=iprec;
+          }
+          else if (prec!=NULL) {printf("Output precision given for unknown product: %s\n",line);free(line);E_L_R();}
      }
+     free(line);
+
+     /* The statistics attributes would only describe one slot of a cube */
+     if (driver->stats==1 && driver->append==1) {printf("Band statistics cannot be saved when appending to a cube\n");E_L_R();}
+
+     /* The composites are of a single slot, and would be overwritten */
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++)
+          if (driver->rgb[i]!=SEVIRI_RGB_NONE && driver->append==1) {printf("RGB composites cannot be saved when appending to a cube\n");E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Parser for the driver file.
+ *    Inputs:
+ *         fname:     Driver filename
+ *         driver:      Structure that will contain the parsed data
+ *    Outputs:
+ *         integer:     Zero if success, otherwise -1
+ ******************************************************************************/
+int parse_driver(char *fname,struct driver_data *driver)
+{
+     int status;
+
+     FILE *fp = fopen(fname,"r");
+     if (fp == NULL) {printf("Unable to open the driver file: %s\n",fname);E_L_R();}
+
+     status = parse_driver_fp(fp,fname,driver);
      fclose(fp);
 
+     if (status!=0) {E_L_R();}
+
      return 0;
 }
@@ -11,13 +11,309 @@
  ******************************************************************************/
 
 #include "SEVIRI_util.h"
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
 #include <tiffio.h>
 #include <netcdf.h>
 #include <hdf5.h>
+#include <zlib.h>
+
+/* Default chunk shape of the HDF5 and NetCDF output, or the image if smaller */
+#define OUT_CHUNK_SIZE 512
+
+/* Deflate level of compressed output */
+#define OUT_DEFLATE_LEVEL 2
+
+/* Maximum size of the latitude and longitude images shared by the slots of a
+   batch, enough for two full disks */
+#define BATCH_NAV_CACHE_SIZE (256 * 1024 * 1024)
+
+/* Size of the IDAT chunks of PNG composites and lines per strip of TIFF
+   composites */
+#define RGB_PNG_IDAT_SIZE 65536
+#define RGB_TIFF_STRIP 16
+
+/* Number of line groups in each block of a file monitored by run_sev_monitor() */
+#define MONITOR_BLOCK_LINES 256
+
+/* Chunks of Native image data held by the reader thread of run_sev_native() */
+#define NAT_READ_DEPTH 3
+
+/* Seconds a client of run_sev_daemon() may send nothing before its job fails */
+#define DAEMON_RECV_TIMEOUT 60
+
+/* The HDF5 and NetCDF libraries are not thread safe, so calls to them are
+   serialised when several slots are processed at once by run_sev_batch().
+   HDF5 output is compressed outside the lock (see put_hdf_data()) */
+static pthread_mutex_t out_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The slots appending to a cube take turns to write it, in the order in which
+   take_out_turn() handed out their turns, so that they are appended in order
+   while their reading and processing overlap */
+struct sev_out_turn {
+     int             next;              /* the turn writing the cube */
+     int             n;                 /* the number of turns handed out */
+     pthread_mutex_t mutex;
+     pthread_cond_t  cond;
+};
+
+/*******************************************************************************
+ *    An image being compressed chunk by chunk (HDF5 chunks or TIFF tiles) by
+ *    a pool of threads, each taking the next chunk until none are left. The
+ *    chunks are padded to the full chunk shape, filtered and deflated.
+ ******************************************************************************/
+enum chunk_filters {CHUNK_SHUFFLE, CHUNK_FP_PREDICTOR};
+
+struct chunk_job {
+     const unsigned char *data;         /* the image in the file type */
+     size_t              size;          /* bytes per element */
+     size_t              dims[2];
+     size_t              chunk[2];
+     size_t              n_chunks[2];
+     int                 filter;        /* chunk_filters */
+     int                 level;         /* deflate level, 0 to store the
+                                           padded chunks unfiltered */
+     unsigned char       **out;         /* compressed chunks */
+     size_t              *n_out;        /* sizes of the compressed chunks */
+     /* If not NULL, called from the threads to write each compressed chunk
+        instead of it being kept in out */
+     int                 (*put)(void *put_data,size_t i_chunk,
+                                const unsigned char *buf,size_t n);
+     void                *put_data;
+     size_t              next;          /* next chunk to compress */
+     int                 status;
+     pthread_mutex_t     mutex;
+};
+
+/*******************************************************************************
+ *    Thread function compressing chunks of a chunk_job. CHUNK_SHUFFLE is the
+ *    HDF5 shuffle filter, the bytes of the elements split into planes.
+ *    CHUNK_FP_PREDICTOR is the TIFF floating point predictor, the same done a
+ *    row at a time with the bytes most significant first and then
+ *    differenced.
+ ******************************************************************************/
+static void *compress_chunks(void *arg)
+{
+     struct chunk_job *job = (struct chunk_job *) arg;
+     const unsigned short one = 1;
+     size_t i, j, k, n, len, i_chunk, i0, j0, n0, n1, w, msb;
+     unsigned char *buf, *filt, *row, *out;
+     uLongf n_out;
+
+     /* Byte of the elements that is most significant */
+     msb = *(const unsigned char *) &one ? job->size - 1 : 0;
+
+     n   = job->chunk[0]*job->chunk[1];
+     len = n*job->size;
+     w   = job->chunk[1];
+     buf  = (unsigned char *) malloc(len);
+     filt = (unsigned char *) malloc(len);
+
+     while (1) {
+          pthread_mutex_lock(&job->mutex);
+          i_chunk = job->next++;
+          pthread_mutex_unlock(&job->mutex);
+          if (i_chunk >= job->n_chunks[0]*job->n_chunks[1]) break;
+
+          /* Gather the chunk, edge chunks are padded to the full chunk shape */
+          i0 = i_chunk / job->n_chunks[1] * job->chunk[0];
+          j0 = i_chunk % job->n_chunks[1] * job->chunk[1];
+          n0 = job->dims[0] - i0 < job->chunk[0] ? job->dims[0] - i0 : job->chunk[0];
+          n1 = job->dims[1] - j0 < job->chunk[1] ? job->dims[1] - j0 : job->chunk[1];
+          memset(buf, 0, len);
+          for (i=0;i<n0;i++)
+               memcpy(buf + i*job->chunk[1]*job->size,
+                      job->data + ((i0+i)*job->dims[1] + j0)*job->size, n1*job->size);
+
+          if (job->level==0) {
+               out   = buf;
+               n_out = len;
+               if (job->put == NULL) buf = (unsigned char *) malloc(len);
+          }
+          else {
+               if (job->filter==CHUNK_SHUFFLE) {
+                    /* Shuffle the bytes of the elements into planes */
+                    for (k=0;k<job->size;k++)
+                         for (j=0;j<n;j++)
+                              filt[k*n+j] = buf[j*job->size+k];
+               }
+               else {
+                    /* Byte planes of each row, most significant first, differenced */
+                    for (i=0;i<job->chunk[0];i++) {
+                         row = filt + i*w*job->size;
+                         for (k=0;k<job->size;k++)
+                              for (j=0;j<w;j++)
+                                   row[(msb>k ? msb-k : k-msb)*w+j] = buf[(i*w+j)*job->size+k];
+                         for (j=w*job->size-1;j>0;j--)
+                              row[j] -= row[j-1];
+                    }
+               }
+
+               n_out = compressBound(len);
+               out   = (unsigned char *) malloc(n_out);
+               if (compress2(out, &n_out, filt, len, job->level) != Z_OK) {
+                    free(out);
+                    job->status = -1;
+                    break;
+               }
+          }
+
+          if (job->put == NULL) {
+               job->out[i_chunk]   = out;
+               job->n_out[i_chunk] = n_out;
+               continue;
+          }
+          if (job->put(job->put_data, i_chunk, out, n_out)) job->status = -1;
+          if (out != buf) free(out);
+          if (job->status) break;
+     }
+
+     free(buf);
+     free(filt);
+
+     return NULL;
+}
+
+/*******************************************************************************
+ *    Compresses an image chunk by chunk with a pool of threads.
+ *    Inputs:
+ *        data:       The image in the file type
+ *        size:       Bytes per element
+ *        dims:       The two dimensions of the image
+ *        chunk:      The chunk shape
+ *        filter:     The filter applied before deflating (chunk_filters)
+ *        level:      Deflate level, 0 to store the padded chunks unfiltered
+ *        n_threads:  Number of threads
+ *        put:        If not NULL, called from the threads with the index (in
+ *                    row major order) and contents of each compressed chunk
+ *                    to write it, returning non-zero on failure
+ *        put_data:   Passed to put
+ *    Outputs:
+ *        job:        Unless put is given, the compressed chunks in job->out
+ *                    and their sizes in job->n_out, in row major order, to be
+ *                    freed with free_chunk_job()
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int run_chunk_job(struct chunk_job *job,const void *data,size_t size,
+                         const size_t *dims,const size_t *chunk,int filter,
+                         int level,int n_threads,
+                         int (*put)(void *,size_t,const unsigned char *,size_t),
+                         void *put_data)
+{
+     pthread_t *threads;
+     size_t i, n_chunks;
+
+     job->data        = (const unsigned char *) data;
+     job->size        = size;
+     job->dims[0]     = dims[0];
+     job->dims[1]     = dims[1];
+     job->chunk[0]    = chunk[0];
+     job->chunk[1]    = chunk[1];
+     job->n_chunks[0] = (dims[0] + chunk[0] - 1) / chunk[0];
+     job->n_chunks[1] = (dims[1] + chunk[1] - 1) / chunk[1];
+     job->filter      = filter;
+     job->level       = level;
+     job->put         = put;
+     job->put_data    = put_data;
+     job->next        = 0;
+     job->status      = 0;
+
+     n_chunks   = job->n_chunks[0]*job->n_chunks[1];
+     job->out   = (unsigned char **) calloc(n_chunks, sizeof(unsigned char *));
+     job->n_out = (size_t *) calloc(n_chunks, sizeof(size_t));
+     pthread_mutex_init(&job->mutex, NULL);
+
+     if ((size_t) n_threads > n_chunks) n_threads = n_chunks;
+     threads = (pthread_t *) malloc(n_threads*sizeof(pthread_t));
+     for (i=0;i<(size_t) n_threads;i++)
+          if (pthread_create(&threads[i], NULL, compress_chunks, job) != 0) break;
+     n_threads = i;
+     /* Compress on this thread as well if no thread could be started */
+     if (n_threads==0) compress_chunks(job);
+     for (i=0;i<(size_t) n_threads;i++)
+          pthread_join(threads[i], NULL);
+     free(threads);
+     pthread_mutex_destroy(&job->mutex);
+
+     return job->status;
+}
+
+static void free_chunk_job(struct chunk_job *job)
+{
+     size_t i;
+
+     for (i=0;i<job->n_chunks[0]*job->n_chunks[1];i++)
+          free(job->out[i]);
+     free(job->out);
+     free(job->n_out);
+}
+
+/*******************************************************************************
+ *    Returns the number of threads compressing the output.
+ ******************************************************************************/
+static int get_n_threads(struct driver_data driver)
+{
+     int n;
+
+     n = driver.threads>0 ? driver.threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+     return n>0 ? n : 1;
+}
+
+/*******************************************************************************
+ *    A thread started for the library, see the thread_start and thread_join
+ *    members of struct seviri_options.
+ ******************************************************************************/
+struct lib_thread {
+     pthread_t          thread;
+     seviri_thread_func func;
+     void               *arg;
+};
+
+static void *run_lib_thread(void *arg)
+{
+     struct lib_thread *t = (struct lib_thread *) arg;
+
+     t->func(t->arg);
+
+     return NULL;
+}
+
+static int start_lib_thread(void **thread,seviri_thread_func func,void *arg,void *data)
+{
+     struct lib_thread *t;
+
+     t = (struct lib_thread*) malloc(sizeof(struct lib_thread));
+     t->func = func;
+     t->arg  = arg;
+     if (pthread_create(&t->thread,NULL,run_lib_thread,t)!=0) {free(t);return -1;}
+     *thread = t;
+
+     return 0;
+}
+
+static int join_lib_thread(void *thread,void *data)
+{
+     int status;
+     struct lib_thread *t = (struct lib_thread *) thread;
+
+     status = pthread_join(t->thread,NULL);
+     free(t);
+
+     return status;
+}
 
 /*******************************************************************************
  *    Wrapper for the native reader. Converts the driver info into something
- *    that the reader can understand.
+ *    that the reader can understand. The image data are read on a reader
+ *    thread, NAT_READ_DEPTH chunks ahead of the unpacking.
  *    Inputs:
  *        driver:     Structure containing the driver info
  *        preproc:    Main structure that will contain the SEVIRI data
@@ -26,9 +322,18 @@
  ******************************************************************************/
 int run_sev_native(struct driver_data driver,struct seviri_preproc_data *preproc, char satposstr[128])
 {
+     struct seviri_options opts;
+
+     memset(&opts,0,sizeof(struct seviri_options));
+     opts.nav_cache    = driver.nav_cache;
+     opts.stats        = driver.stats;
+     opts.read_depth   = NAT_READ_DEPTH;
+     opts.thread_start = start_lib_thread;
+     opts.thread_join  = join_lib_thread;
+
      if (seviri_read_and_preproc(driver.infdir,preproc, driver.sev_bands.nbands, driver.sev_bands.band_ids,
      driver.outtype, driver.bounds,driver.iline, driver.fline, driver.icol, driver.fcol,0., 0., 0., 0., driver.do_calib,
-     driver.do_nasa, satposstr, 0))
+     driver.do_nasa, satposstr, 0, &opts))
      {E_L_R();}
      return 0;
 }
@@ -44,328 +349,3193 @@ int run_sev_native(struct driver_data driver,struct seviri_preproc_data *preproc
  ******************************************************************************/
 int run_sev_hrit(struct driver_data driver,struct seviri_preproc_data *preproc, char satposstr[128])
 {
+     struct seviri_options opts;
+
+     memset(&opts,0,sizeof(struct seviri_options));
+     opts.nav_cache = driver.nav_cache;
+     opts.stats     = driver.stats;
+
      if (seviri_read_and_preproc_hrit(driver.infdir,driver.timeslot,driver.satnum, preproc, driver.sev_bands.nbands, driver.sev_bands.band_ids,
      driver.outtype, driver.bounds,driver.iline, driver.fline, driver.icol, driver.fcol,0., 0., 0., 0., driver.rss, driver.iodc, 
-     driver.do_calib, driver.do_nasa, satposstr, 0))
+     driver.do_calib, driver.do_nasa, satposstr, 0, &opts))
      {E_L_R();}
      return 0;
 }
 
+/* Valid ranges of the output products. These also set the scale factor and
+   offset of products that are saved as 16 bit integers. */
+static float cnt_range[]    = {0.0, 1024.0};
+static float rad_range[]    = {0.0, 2000.0};
+static float brf_range[]    = {-0.5, 5.0};
+static float bt_range[]     = {150.0, 400.0};
+
+static float lat_range[]    = {-90.0, 90.0};
+static float lon_range[]    = {-180.0, 180.0};
+static float zen_range[]    = {-180.0, 180.0};
+static float azi_range[]    = {0.0, 360.0};
+
+static char title_cnt[]     = "SEVIRI data in raw count format.";
+static char title_rad[]     = "SEVIRI data in radiance format";
+static char title_brf[]     = "SEVIRI data in solar reflectance format";
+static char title_bt[]      = "SEVIRI data in brightness temperature format";
+
+/* Output names and valid ranges of the ancilliary data, in ancsave order. */
+static const char *anc_outnames[] = {"Time", "Latitude", "Longitude",
+                                     "Solar Zenith Angle", "Solar Azimuth Angle",
+                                     "View Zenith Angle", "View Azimuth Angle"};
+static float *anc_ranges[] = {NULL, lat_range, lon_range, zen_range,
+                              azi_range, zen_range, azi_range};
+
+/* Ancilliary products that do not change from one time slot to the next,
+   saved only once in a cube of time slots. */
+static int anc_static[] = {0, 1, 1, 0, 0, 1, 1};
+
+/* Fill value of products saved as 16 bit integers, outside the packed range. */
+#define FILL_VALUE_I16 -32768
+
+/*******************************************************************************
+ *    Returns the valid range and the title for a given band unit
+ ******************************************************************************/
+static float *get_band_range(enum seviri_units unit)
+{
+     if (unit==SEVIRI_UNIT_CNT) return cnt_range;
+     if (unit==SEVIRI_UNIT_RAD) return rad_range;
+     if (unit==SEVIRI_UNIT_BT)  return bt_range;
+     return brf_range;
+}
+
+static char *get_band_title(enum seviri_units unit)
+{
+     if (unit==SEVIRI_UNIT_CNT) return title_cnt;
+     if (unit==SEVIRI_UNIT_RAD) return title_rad;
+     if (unit==SEVIRI_UNIT_BT)  return title_bt;
+     return title_brf;
+}
+
+/*******************************************************************************
+ *    Returns the preproc array of a float ancilliary product (ancsave 1 to 6)
+ ******************************************************************************/
+static float *get_anc_data(struct seviri_preproc_data preproc, int i)
+{
+     switch (i) {
+          case 1:  return preproc.lat;
+          case 2:  return preproc.lon;
+          case 3:  return preproc.sza;
+          case 4:  return preproc.saa;
+          case 5:  return preproc.vza;
+          case 6:  return preproc.vaa;
+          default: return NULL;
+     }
+}
+
+/*******************************************************************************
+ *    Computes the CF scale_factor and add_offset that map a valid range onto
+ *    the 16 bit integers -32767 -> 32767, leaving -32768 for the fill value.
+ *    Inputs:
+ *        range:      Valid range of the product
+ *    Outputs:
+ *        scale:      Scale factor, unpacked = packed * scale + offset
+ *        offset:     Offset
+ ******************************************************************************/
+static void get_i16_scaling(const float *range,float *scale,float *offset)
+{
+     *scale  = (range[1] - range[0]) / 65534.;
+     *offset = (range[1] + range[0]) / 2.;
+}
+
+/*******************************************************************************
+ *    Packs a float image into 16 bit integers. Values outside the valid range
+ *    are clipped to it and fill values are set to FILL_VALUE_I16.
+ *    Inputs:
+ *        data:       The float image
+ *        n:          Number of pixels in the image
+ *        fill_value: Fill value of the float image
+ *        range:      Valid range of the product
+ *    Outputs:
+ *        short*:     Newly allocated packed image, NULL on failure
+ ******************************************************************************/
+static short *pack_i16(const float *data,size_t n,float fill_value,const float *range)
+{
+     size_t i;
+     float scale, offset, x;
+     short *out;
+
+     if ((out = (short*) malloc(sizeof(short)*n)) == NULL) return NULL;
+
+     get_i16_scaling(range,&scale,&offset);
+
+     for (i=0;i<n;i++) {
+          if (data[i]==fill_value) {out[i]=FILL_VALUE_I16;continue;}
+          x = (data[i] - offset) / scale;
+          if (x < -32767.) x = -32767.;
+          if (x >  32767.) x =  32767.;
+          out[i] = (short) (x < 0. ? x - .5 : x + .5);
+     }
+
+     return out;
+}
+
+/*******************************************************************************
+ *    Expands the per line time of the preproc data into a newly allocated
+ *    image of time, NULL on failure. The preproc data is passed by value
+ *    so seviri_preproc_time() cannot be used to cache the image.
+ ******************************************************************************/
+static double *get_time_image(struct seviri_preproc_data preproc)
+{
+     double *time;
+
+     if ((time = (double*) malloc(sizeof(double)*preproc.n_lines*preproc.n_columns)) == NULL) return NULL;
+
+     seviri_preproc_expand_time(&preproc,time);
+
+     return time;
+}
+
+/*******************************************************************************
+ *    Returns the chunk size along a dimension of the output.
+ *    Inputs:
+ *        size:       The chunk size from the driver or 0 for the default
+ *        dim:        The size of the dimension
+ *    Outputs:
+ *        size_t:     The chunk size, no larger than the dimension
+ ******************************************************************************/
+static size_t get_chunk_size(int size,size_t dim)
+{
+     if (size<=0) size=OUT_CHUNK_SIZE;
+     if ((size_t) size>dim) return dim>0 ? dim : 1;
+
+     return size;
+}
+
+/*******************************************************************************
+ *    Defines a 2D float product in a NetCDF file at the requested precision,
+ *    or a series of them along a leading time dimension. Products saved as 16
+ *    bit integers get CF packing attributes.
+ *    Inputs:
+ *        ncid:       The NetCDF file id
+ *        name:       Name of the variable
+ *        ndims:      2, or 3 with the time dimension
+ *        dimids:     The dimension ids
+ *        prec:       Output precision (seviri_outprecs)
+ *        range:      Valid range of the product
+ *        fill_value: Fill value of the float data
+ *        compression:Non-zero to compress the variable
+ *        chunk:      The chunk shape
+ *    Outputs:
+ *        varid:      The new variable id
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int def_cdf_var(int ncid,const char *name,int ndims,const int *dimids,int prec,
+                       const float *range,float fill_value,int compression,
+                       const size_t *chunk,int *varid)
+{
+     float scale, offset;
+     short fill_i16 = FILL_VALUE_I16;
+     short range_i16[] = {-32767, 32767};
+
+     if (prec==SEVIRI_OUTPREC_I16) {
+          get_i16_scaling(range,&scale,&offset);
+          if(nc_def_var(ncid, name, NC_SHORT, ndims, dimids, varid)) {E_L_R();};
+          if(nc_def_var_chunking(ncid, *varid, NC_CHUNKED, chunk)) {E_L_R();};
+          if (compression==1) if(nc_def_var_deflate(ncid, *varid, 1,1,OUT_DEFLATE_LEVEL)) {E_L_R();};
+          if(nc_put_att_short(ncid, *varid, "_FillValue",NC_SHORT, 1, &fill_i16)) {E_L_R();};
+          if(nc_put_att_short(ncid, *varid, "valid_range",NC_SHORT, 2, range_i16)) {E_L_R();};
+          if(nc_put_att_float(ncid, *varid, "scale_factor",NC_FLOAT, 1, &scale)) {E_L_R();};
+          if(nc_put_att_float(ncid, *varid, "add_offset",NC_FLOAT, 1, &offset)) {E_L_R();};
+     }
+     else {
+          if(nc_def_var(ncid, name, NC_FLOAT, ndims, dimids, varid)) {E_L_R();};
+          if(nc_def_var_chunking(ncid, *varid, NC_CHUNKED, chunk)) {E_L_R();};
+          if (compression==1) if(nc_def_var_deflate(ncid, *varid, 1,1,OUT_DEFLATE_LEVEL)) {E_L_R();};
+          if(nc_put_att_float(ncid, *varid, "_FillValue",NC_FLOAT, 1, &fill_value)) {E_L_R();};
+          if(nc_put_att_float(ncid, *varid, "valid_range",NC_FLOAT, 2, range)) {E_L_R();};
+     }
+
+     return 0;
+}
+
 /*******************************************************************************
- *    Initialises the array that will contain output data for the TIFF writer
- *    All elements of the output array will contain the fill value.
+ *    Writes a block of lines of a 2D float product defined with def_cdf_var()
+ *    into a NetCDF file.
  *    Inputs:
- *        outline:    The float array that will contain the data
- *        sizer:      Size of the output array
- *        filler:     The fill value to be placed into each array element
+ *        ncid:       The NetCDF file id
+ *        varid:      The variable id
+ *        data:       The float block
+ *        start:      Line and column of the image at which the block starts,
+ *                    preceded by the time slot if the variable has a time
+ *                    dimension
+ *        count:      Number of lines and columns of the block, preceded by 1
+ *                    if the variable has a time dimension
+ *        ndims:      Number of dimensions of the variable
+ *        prec:       Output precision (seviri_outprecs)
+ *        range:      Valid range of the product
+ *        fill_value: Fill value of the float data
  *    Outputs:
- *        integer:    Returns 0 if successful
+ *        integer:    Returns 0 if successful, otherwise -1
  ******************************************************************************/
-static int init_outline(float* outline,unsigned int sizer,float filler)
+static int put_cdf_var(int ncid,int varid,const float *data,const size_t *start,
+                       const size_t *count,int ndims,int prec,const float *range,
+                       float fill_value)
 {
-     int i=0;
-     for (i=0;i<sizer;i++)outline[i]=filler;
+     short *data_i16;
+
+     if (prec==SEVIRI_OUTPREC_I16) {
+          if ((data_i16 = pack_i16(data,count[ndims-2]*count[ndims-1],fill_value,range)) == NULL) {E_L_R();}
+          if(nc_put_vara_short(ncid, varid, start, count, data_i16)) {free(data_i16);E_L_R();};
+          free(data_i16);
+     }
+     else
+          if(nc_put_vara_float(ncid, varid, start, count, data)) {E_L_R();};
+
      return 0;
 }
 
 /*******************************************************************************
- *    Writes the processed SEVIRI data (and any ancilliary data) into a TIFF
- *    file. All data is saved as floating point type.
+ *    Opens an existing cube file, see open_sev_cdf(), to append a time slot
+ *    to it. The products must be those of the cube, with the same image
+ *    dimensions and packing.
  *    Inputs:
- *        driver:  The float array that will contain the data
- *        preproc: Main structure that will contain the SEVIRI data
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
  *    Outputs:
- *        integer: Returns 0 if successful, otherwise -1
+ *        ncid:       The NetCDF file id
+ *        varid:      The variable ids, bands first then one per ancsave product
+ *        slot:       The time slot to be written
+ *        integer:    Returns 0 if successful, otherwise -1
  ******************************************************************************/
-int save_sev_tiff(struct driver_data driver,struct seviri_preproc_data preproc)
+static int reopen_sev_cdf(struct driver_data driver,unsigned int n_lines,unsigned int n_columns,
+                          unsigned int n_bands,int *ncid,int *varid,long *slot)
 {
-     char outstr[2048];
-     int i=0, j=0, nbands=preproc.n_bands, k=0,band=0;
-     long int col=0;
-
-     for (i=0;i<7;i++)if (driver.ancsave[i]==1)nbands+=1;
-
-     TIFF *tif=TIFFOpen(driver.outf, "w");
-     /* Set up the tags for the TIFF file, ensures correct size and number of
-        bands. */
-     TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, preproc.n_columns);
-     TIFFSetField(tif, TIFFTAG_IMAGELENGTH, preproc.n_lines);
-     TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, nbands);
-     TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 32);
-     TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT,SAMPLEFORMAT_IEEEFP);
-     TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-     TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-     TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-     if (driver.compression==1) TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
-     if (driver.infrmt==SEVIRI_INFILE_HRIT) sprintf(outstr,"Image created with the SEVIRI reader utility. This file was produced from MSG%i data in timeslot %s.",driver.satnum,driver.timeslot);
-     else if (driver.infrmt==SEVIRI_INFILE_NAT) sprintf(outstr,"Image created with the SEVIRI reader utility. This file was produced from %s.",driver.infdir);
-     else  sprintf(outstr,"Image created with the SEVIRI reader utility.");
-     TIFFSetField(tif, TIFFTAG_IMAGEDESCRIPTION, outstr);
-     /* Begin saving the actual image data */
-     float oneline[nbands*preproc.n_columns];
-     for (i=0;i<preproc.n_lines;i++) {
-          if (init_outline(oneline,nbands*preproc.n_columns,preproc.fill_value)!=0) {E_L_R();}
+     int i, t_dimid, x_dimid, y_dimid, ndims, prec;
+     size_t n_slots, n_x, n_y;
+     nc_type type;
+     const char *name;
+
+     if(nc_open(driver.outf, NC_WRITE, ncid)) {E_L_R();};
+     if(nc_inq_dimid(*ncid, "time", &t_dimid)) {E_L_R();};
+     if(nc_inq_dimlen(*ncid, t_dimid, &n_slots)) {E_L_R();};
+     if(nc_inq_dimid(*ncid, "x", &x_dimid)) {E_L_R();};
+     if(nc_inq_dimlen(*ncid, x_dimid, &n_x)) {E_L_R();};
+     if(nc_inq_dimid(*ncid, "y", &y_dimid)) {E_L_R();};
+     if(nc_inq_dimlen(*ncid, y_dimid, &n_y)) {E_L_R();};
+     if (n_x != n_lines || n_y != n_columns) {
+          fprintf(stderr, "ERROR: The image of the cube is %zux%zu, not %ux%u\n",
+                  n_x, n_y, n_lines, n_columns);
+          E_L_R();
+     }
 
-          k=0;
-          for (j=0;j<nbands*preproc.n_columns;j=j+nbands) {
-               band=0;
-               col = (i*preproc.n_columns)+k;
-/*               for (band=0;band<preproc.n_bands;band++) oneline[j+band]=(float)preproc.data[band][col];*/
-               if(driver.ancsave[0]==1){oneline[j+band]=(float)preproc.time[col];band++;}
-               if(driver.ancsave[1]==1){oneline[j+band]=(float)preproc.lat[col];band++;}
-               if(driver.ancsave[2]==1){oneline[j+band]=(float)preproc.lon[col];band++;}
-               if(driver.ancsave[3]==1){oneline[j+band]=(float)preproc.sza[col];band++;}
-               if(driver.ancsave[4]==1){oneline[j+band]=(float)preproc.saa[col];band++;}
-               if(driver.ancsave[5]==1){oneline[j+band]=(float)preproc.vza[col];band++;}
-               if(driver.ancsave[6]==1){oneline[j+band]=(float)preproc.vaa[col];band++;}
-               k=k+1;
+     for (i=0;i<n_bands+7;i++) {
+          if (i>=n_bands && driver.ancsave[i-n_bands]!=1) continue;
+          name = i<n_bands ? bnames[driver.sev_bands.band_ids[i]-1] : anc_outnames[i-n_bands];
+          if(nc_inq_varid(*ncid, name, &varid[i])) {
+               fprintf(stderr, "ERROR: %s is not in the cube\n", name);
+               E_L_R();
+          }
+          if(nc_inq_varndims(*ncid, varid[i], &ndims)) {E_L_R();};
+          if(nc_inq_vartype(*ncid, varid[i], &type)) {E_L_R();};
+          prec = i<n_bands ? driver.bandprec : driver.ancprec[i-n_bands];
+          if (ndims != (i==n_bands && driver.linetime==1 ? 2 :
+                        i>n_bands && anc_static[i-n_bands] ? 2 : 3) ||
+              type != (i==n_bands ? NC_DOUBLE : prec==SEVIRI_OUTPREC_I16 ? NC_SHORT : NC_FLOAT)) {
+               fprintf(stderr, "ERROR: %s of the cube does not match the output\n", name);
+               E_L_R();
           }
-          if (TIFFWriteScanline(tif, oneline, i, 0) !=1) {E_L_R();}
      }
-     TIFFClose(tif);
+
+     *slot = n_slots;
+
      return 0;
 }
 
 /*******************************************************************************
- *    Writes the processed SEVIRI data (and any ancilliary data) into a NetCDF
- *    file. All data is saved as floating point type, aside from "Time" (double)
+ *    Creates a NetCDF file for the processed SEVIRI data (and any ancilliary
+ *    data), to be written a block of lines at a time with put_sev_cdf(). Data
+ *    is saved as floating point or as scaled 16 bit integers depending on the
+ *    driver precisions, aside from "Time" (double)
+ *
+ *    With driver.append the file is a cube of time slots as for HDF5 output
+ *    (see open_sev_hdf()), with an unlimited "time" dimension, and is opened
+ *    to append a time slot to it if it exists.
  *    Inputs:
- *        driver:     The float array that will contain the data
- *        preproc:    Main structure that will contain the SEVIRI data
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
+ *        fill_value: Fill value of the float data
  *    Outputs:
+ *        ncid:       The NetCDF file id
+ *        varid:      The variable ids, bands first then one per ancsave product
+ *        slot:       The time slot to be written, -1 if not a cube
+ *        put_static: Whether the static products are to be written
  *        integer:    Returns 0 if successful, otherwise -1
  ******************************************************************************/
-int save_sev_cdf(struct driver_data driver,struct seviri_preproc_data preproc)
+static int open_sev_cdf(struct driver_data driver,unsigned int n_lines,unsigned int n_columns,
+                        unsigned int n_bands,float fill_value,int *ncid,int *varid,
+                        long *slot,int *put_static)
 {
-     static float cnt_range[]    = {0.0, 1024.0};
-     static float rad_range[]    = {0.0, 2000.0};
-     static float brf_range[]    = {-0.5, 5.0};
-     static float bt_range[]     = {150.0, 400.0};
+     int i, cube, x_dimid, y_dimid, t_dimid = -1;
+     int dimids[3];
+     size_t chunk[3];
+     const int *dimids2=dimids+1;
+     const size_t *chunk2=chunk+1;
 
-     static float latlon_range[] = {-90.0, 90.0};
-     static float zen_range[]    = {-180.0, 180.0};
-     static float azi_range[]    = {0.0, 360.0};
+     cube = driver.append==1;
+     *slot       = cube ? 0 : -1;
+     *put_static = 1;
 
-     static char title_cnt[]     = "SEVIRI data in raw count format.";
-     static char title_rad[]     = "SEVIRI data in radiance format";
-     static char title_brf[]     = "SEVIRI data in solar reflectance format";
-     static char title_bt[]      = "SEVIRI data in brightness temperature format";
-
-     int nbands=preproc.n_bands,i=0;
-     for (i=0;i<7;i++)if (driver.ancsave[i]==1)nbands+=1;
-     int ncid, x_dimid, y_dimid;
-     int dimids[2];
-     int *varid;
-     varid = (int*) malloc(sizeof(int)*nbands);
+     if (cube && access(driver.outf,F_OK)==0) {
+          *put_static = 0;
+          if (reopen_sev_cdf(driver,n_lines,n_columns,n_bands,ncid,varid,slot)) {E_L_R();}
+          return 0;
+     }
 
      /* Create the NetCDF file and initialise the data*/
-     if(nc_create(driver.outf, NC_CLOBBER|NC_NETCDF4 , &ncid)) {E_L_R();};
-     if(nc_def_dim(ncid, "x", preproc.n_lines, &x_dimid)) {E_L_R();};
-     if(nc_def_dim(ncid, "y", preproc.n_columns, &y_dimid)) {E_L_R();};
-     dimids[0] = x_dimid;
-     dimids[1] = y_dimid;
+     if(nc_create(driver.outf, NC_CLOBBER|NC_NETCDF4 , ncid)) {E_L_R();};
+     if (cube) if(nc_def_dim(*ncid, "time", NC_UNLIMITED, &t_dimid)) {E_L_R();};
+     if(nc_def_dim(*ncid, "x", n_lines, &x_dimid)) {E_L_R();};
+     if(nc_def_dim(*ncid, "y", n_columns, &y_dimid)) {E_L_R();};
+     dimids[0] = t_dimid;
+     dimids[1] = x_dimid;
+     dimids[2] = y_dimid;
 
+     /* Products of the time slots of a cube are chunked by time slot */
+     chunk[0] = 1;
+     chunk[1] = get_chunk_size(driver.chunk[0],n_lines);
+     chunk[2] = get_chunk_size(driver.chunk[1],n_columns);
 
      /* Initialise each variable, loop first over all bands included in the preproc data*/
-     for (i=0;i<preproc.n_bands;i++) {
-          if(nc_def_var(ncid, bnames[driver.sev_bands.band_ids[i]], NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          if(nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value)) {E_L_R();};
-          if (driver.outtype[i] == SEVIRI_UNIT_CNT){if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, cnt_range)) {E_L_R();};if(nc_put_att_text (ncid, NC_GLOBAL, "title",strlen(title_cnt), title_cnt)) {E_L_R();};}
-          if (driver.outtype[i] == SEVIRI_UNIT_RAD){if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, rad_range)) {E_L_R();};if(nc_put_att_text (ncid, NC_GLOBAL, "title",strlen(title_rad), title_rad)) {E_L_R();};}
-          if (driver.outtype[i] == SEVIRI_UNIT_BRF){if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, brf_range)) {E_L_R();};if(nc_put_att_text (ncid, NC_GLOBAL, "title",strlen(title_brf), title_brf)) {E_L_R();};}
-          if (driver.outtype[i] == SEVIRI_UNIT_BT){if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, bt_range)) {E_L_R();};if(nc_put_att_text (ncid, NC_GLOBAL, "title",strlen(title_bt), title_bt)) {E_L_R();};}
+     for (i=0;i<n_bands;i++) {
+          if (def_cdf_var(*ncid,bnames[driver.sev_bands.band_ids[i]-1],cube ? 3 : 2,
+                          cube ? dimids : dimids2,driver.bandprec,
+                          get_band_range(driver.outtype[i]),fill_value,
+                          driver.compression,cube ? chunk : chunk2,&varid[i])) {E_L_R();}
+          if(nc_put_att_text (*ncid, NC_GLOBAL, "title",strlen(get_band_title(driver.outtype[i])),
+                              get_band_title(driver.outtype[i]))) {E_L_R();};
      }
 
-     /* Now initialise the ancilliary data*/
+     /* Now initialise the ancilliary data, time is either per pixel or per line*/
      if(driver.ancsave[0]==1) {
-          if(nc_def_var(ncid, "Time", NC_DOUBLE, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          i++;
-     }
-     if(driver.ancsave[1]==1) {
-          if(nc_def_var(ncid, "Latitude", NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value);
-          if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, latlon_range)) {E_L_R();};
-          i++;
-     }
-     if(driver.ancsave[2]==1) {
-          if(nc_def_var(ncid, "Longitude", NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value);
-          if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, latlon_range)) {E_L_R();};
-          i++;
-     }
-     if(driver.ancsave[3]==1) {
-          if(nc_def_var(ncid, "Solar Zenith Angle", NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value);
-          if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, zen_range)) {E_L_R();};
-          i++;
-     }
-     if(driver.ancsave[4]==1) {
-          if(nc_def_var(ncid, "Solar Azimuth Angle", NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value);
-          if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, azi_range)) {E_L_R();};
-          i++;
-     }
-     if(driver.ancsave[5]==1) {
-          if(nc_def_var(ncid, "View Zenith Angle", NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value);
-          if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, zen_range)) {E_L_R();};
-          i++;
-     }
-     if(driver.ancsave[6]==1) {
-          if(nc_def_var(ncid, "View Azimuth Angle", NC_FLOAT, 2,dimids, &varid[i])) {E_L_R();};
-          if (driver.compression==1) if(nc_def_var_deflate(ncid, varid[i], 1,1,2)) {E_L_R();};
-          i++;
-          nc_put_att_float(ncid, varid[i], "_FillValue",NC_FLOAT, 1, &preproc.fill_value);
-          if(nc_put_att_float(ncid, varid[i], "valid_range",NC_FLOAT, 2, azi_range)) {E_L_R();};
+          if(nc_def_var(*ncid, anc_outnames[0], NC_DOUBLE, (driver.linetime==1 ? 1 : 2) + cube,
+                        cube ? dimids : dimids2, &varid[n_bands])) {E_L_R();};
+          if(nc_def_var_chunking(*ncid, varid[n_bands], NC_CHUNKED, cube ? chunk : chunk2)) {E_L_R();};
+          if (driver.compression==1) if(nc_def_var_deflate(*ncid, varid[n_bands], 1,1,OUT_DEFLATE_LEVEL)) {E_L_R();};
+     }
+     for (i=1;i<7;i++) {
+          if(driver.ancsave[i]==1)
+               if (def_cdf_var(*ncid,anc_outnames[i],cube && !anc_static[i] ? 3 : 2,
+                               cube && !anc_static[i] ? dimids : dimids2,driver.ancprec[i],
+                               anc_ranges[i],fill_value,driver.compression,
+                               cube && !anc_static[i] ? chunk : chunk2,
+                               &varid[n_bands+i])) {E_L_R();}
      }
 
-     if(nc_enddef(ncid)) {E_L_R();};
+     if(nc_enddef(*ncid)) {E_L_R();};
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of the processed SEVIRI data into a NetCDF file
+ *    created with open_sev_cdf().
+ *    Inputs:
+ *        ncid:       The NetCDF file id
+ *        varid:      The variable ids
+ *        driver:     The driver info
+ *        preproc:    The block of SEVIRI data
+ *        i_line:     Line of the image at which the block starts
+ *        slot:       The time slot of a cube, -1 if not a cube
+ *        put_static: Whether the static products of a cube are to be written
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_sev_cdf(int ncid,const int *varid,struct driver_data driver,
+                       struct seviri_preproc_data preproc,unsigned int i_line,
+                       long slot,int put_static)
+{
+     int i, cube;
+     size_t start[3] = {slot>=0 ? slot : 0, i_line, 0};
+     size_t count[3] = {1, preproc.n_lines, preproc.n_columns};
+     const size_t *start2=start+1, *count2=count+1;
+     double *time;
+
+     /* Products of a time slot of a cube start with the time dimension */
+     cube = slot>=0;
 
      /* This will actually put the data into the file*/
      for (i=0;i<preproc.n_bands;i++)
-          if(nc_put_var_float(ncid, varid[i], &preproc.data[i][0])) {E_L_R();};
+          if (put_cdf_var(ncid,varid[i],preproc.data[i],cube ? start : start2,cube ? count : count2,
+                          cube ? 3 : 2,driver.bandprec,get_band_range(driver.outtype[i]),
+                          preproc.fill_value)) {E_L_R();}
+
+     if(driver.ancsave[0]==1) {
+          if (driver.linetime==1) {
+               if(nc_put_vara_double(ncid, varid[preproc.n_bands], cube ? start : start2, cube ? count : count2, preproc.time_line)) {E_L_R();};
+          }
+          else {
+               if ((time = get_time_image(preproc)) == NULL) {E_L_R();}
+               if(nc_put_vara_double(ncid, varid[preproc.n_bands], cube ? start : start2, cube ? count : count2, time)) {free(time);E_L_R();};
+               free(time);
+          }
+     }
+     for (i=1;i<7;i++) {
+          /* The static products of a cube are only saved when it is created */
+          if(driver.ancsave[i]!=1 || (anc_static[i] && !put_static)) continue;
+          if (put_cdf_var(ncid,varid[preproc.n_bands+i],get_anc_data(preproc,i),
+                          cube && !anc_static[i] ? start : start2,
+                          cube && !anc_static[i] ? count : count2,
+                          cube && !anc_static[i] ? 3 : 2,
+                          driver.ancprec[i],anc_ranges[i],preproc.fill_value)) {E_L_R();}
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Names of the statistics attributes of the bands, see get_stats_values().
+ ******************************************************************************/
+#define N_STATS_ATTS 5
+
+static const char *stats_att_names[] = {"statistics_minimum","statistics_maximum",
+                                        "statistics_mean","statistics_stddev",
+                                        "fill_fraction"};
 
-     if(driver.ancsave[0]==1){if(nc_put_var_double(ncid, varid[i], &preproc.time[0])) {E_L_R();};i++;}
-     if(driver.ancsave[1]==1){if(nc_put_var_float(ncid, varid[i], &preproc.lat[0])) {E_L_R();};i++;}
-     if(driver.ancsave[2]==1){if(nc_put_var_float(ncid, varid[i], &preproc.lon[0])) {E_L_R();};i++;}
-     if(driver.ancsave[3]==1){if(nc_put_var_float(ncid, varid[i], &preproc.sza[0])) {E_L_R();};i++;}
-     if(driver.ancsave[4]==1){if(nc_put_var_float(ncid, varid[i], &preproc.saa[0])) {E_L_R();};i++;}
-     if(driver.ancsave[5]==1){if(nc_put_var_float(ncid, varid[i], &preproc.vza[0])) {E_L_R();};i++;}
-     if(driver.ancsave[6]==1){if(nc_put_var_float(ncid, varid[i], &preproc.vaa[0])) {E_L_R();};i++;}
+/*******************************************************************************
+ *    The values of the statistics attributes of a band, in the order of
+ *    stats_att_names. The histogram of the counts is the attribute
+ *    count_histogram.
+ ******************************************************************************/
+static void get_stats_values(const struct seviri_band_stats *s,double *values)
+{
+     values[0] = s->min;
+     values[1] = s->max;
+     values[2] = s->mean;
+     values[3] = seviri_stats_std(s);
+     values[4] = seviri_stats_fill_fraction(s);
+}
+
+/*******************************************************************************
+ *    Attaches the statistics of each band to its NetCDF variable.
+ *    Inputs:
+ *        ncid:       The NetCDF file
+ *        varid:      The variables of the file, bands first
+ *        stats:      The statistics of the bands
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_cdf_stats(int ncid,const int *varid,const struct seviri_stats_data *stats)
+{
+     unsigned int i, j;
+     double values[N_STATS_ATTS];
+     unsigned long long hist[SEVIRI_STATS_N_COUNTS];
+
+     if(nc_redef(ncid)) {E_L_R();};
+     for (i=0;i<stats->n_bands;i++) {
+          get_stats_values(&stats->band[i],values);
+          for (j=0;j<N_STATS_ATTS;j++)
+               if(nc_put_att_double(ncid, varid[i], stats_att_names[j],NC_DOUBLE, 1, &values[j])) {E_L_R();};
+          for (j=0;j<SEVIRI_STATS_N_COUNTS;j++) hist[j] = stats->band[i].hist[j];
+          if(nc_put_att_ulonglong(ncid, varid[i], "count_histogram",NC_UINT64,
+                                  SEVIRI_STATS_N_COUNTS, hist)) {E_L_R();};
+     }
+     if(nc_enddef(ncid)) {E_L_R();};
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Returns a new HDF5 datatype for IEEE 754 half precision floats. HDF5
+ *    converts to and from it in H5Dwrite()/H5Dread().
+ ******************************************************************************/
+static hid_t get_hdf_half_type()
+{
+     hid_t type;
+
+     if ((type = H5Tcopy(H5T_NATIVE_FLOAT)) < 0) return -1;
+     if (H5Tset_fields(type, 15, 10, 5, 0, 10) < 0 ||
+         H5Tset_precision(type, 16) < 0 ||
+         H5Tset_size(type, 2) < 0 ||
+         H5Tset_ebias(type, 15) < 0) {
+          H5Tclose(type);
+          return -1;
+     }
+
+     return type;
+}
 
-     /* Now we are done, so close the file*/
-     if(nc_close(ncid)) {E_L_R();};
+/*******************************************************************************
+ *    Attaches an attribute of n values to an HDF5 dataset, a scalar if n is 0.
+ ******************************************************************************/
+static int put_hdf_att_n(hid_t dataset,const char *name,hid_t type,hsize_t n,
+                         const void *value)
+{
+     hid_t space, attr;
 
-     free(varid);
+     if ((space = n>0 ? H5Screate_simple(1,&n,NULL) : H5Screate(H5S_SCALAR)) < 0) {E_L_R();}
+     if ((attr = H5Acreate2(dataset, name, type, space, H5P_DEFAULT, H5P_DEFAULT)) < 0) {H5Sclose(space);E_L_R();}
+     if (H5Awrite(attr, type, value) < 0) {H5Aclose(attr);H5Sclose(space);E_L_R();}
+     H5Aclose(attr);
+     H5Sclose(space);
 
      return 0;
 }
 
 /*******************************************************************************
- *    Writes the processed SEVIRI data (and any ancilliary data) into an HDF5
- *    file. All data is saved as floating point type, aside from "Time" (double)
+ *    Attaches a scalar attribute to an HDF5 dataset.
+ ******************************************************************************/
+static int put_hdf_att(hid_t dataset,const char *name,hid_t type,const void *value)
+{
+     return put_hdf_att_n(dataset,name,type,0,value);
+}
+
+/*******************************************************************************
+ *    Chunking, compression and threading of the HDF5 output.
+ ******************************************************************************/
+struct hdf_opts {
+     hsize_t chunk[2];
+     int     compression;
+     int     n_threads;
+     /* The time slot written in a cube file (see open_sev_hdf()), -1 if the
+        file is not a cube, and whether the static products are written */
+     long    slot;
+     int     put_static;
+};
+
+/*******************************************************************************
+ *    Writes a block of lines into a 1D or 2D HDF5 dataset, or into a time
+ *    slot of a dataset with a leading time dimension, with H5Dwrite().
  *    Inputs:
- *        driver:     The float array that will contain the data
- *        preproc:    Main structure that will contain the SEVIRI data
+ *        dataset:    The dataset
+ *        mem_type:   The type of the data in memory
+ *        rank:       The rank of the block, 1 or 2
+ *        slot:       The time slot if the dataset has a time dimension
+ *        i_line:     Line of the dataset at which the block starts
+ *        dims:       The dimensions of the block
+ *        data:       The block
  *    Outputs:
  *        integer:    Returns 0 if successful, otherwise -1
  ******************************************************************************/
-int save_sev_hdf(struct driver_data driver,struct seviri_preproc_data preproc)
+static int put_hdf_slab(hid_t dataset,hid_t mem_type,int rank,long slot,hsize_t i_line,
+                        const hsize_t *dims,const void *data)
 {
-/*
-     static float cnt_range[]    = {0.0, 1024.0};
-     static float rad_range[]    = {0.0, 2000.0};
-     static float brf_range[]    = {-0.5, 5.0};
-     static float bt_range[]     = {150.0, 400.0};
-
-     static float latlon_range[] = {-90.0, 90.0};
-     static float zen_range[]    = {-180.0, 180.0};
-     static float azi_range[]    = {0.0, 360.0};
-
-     static char title_cnt[]     = "SEVIRI data in raw count format.";
-     static char title_rad[]     = "SEVIRI data in radiance format";
-     static char title_brf[]     = "SEVIRI data in solar reflectance format";
-     static char title_bt[]      = "SEVIRI data in brightness temperature format";
-*/
-     int nbands=preproc.n_bands,i=0;
-     for (i=0;i<7;i++)if (driver.ancsave[i]==1)nbands+=1;
-     int *varid;
-     varid = (int*) malloc(sizeof(int)*nbands);
-     varid = varid;
-
-     /* Create the HDF5 file and initialise the data*/
-     hid_t   outfile;
-     outfile = H5Fcreate(driver.outf,H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+     int     i, n;
      herr_t  status;
-     hid_t   dataspace,dataset,dcpl;
-     hsize_t dims[2]={preproc.n_lines,preproc.n_columns};
+     hid_t   memspace,filespace;
+     hsize_t start[3] = {i_line, 0, 0};
+     hsize_t count[3] = {dims[0], rank > 1 ? dims[1] : 0, 0};
+
+     pthread_mutex_lock(&out_mutex);
+     if ((filespace=H5Dget_space(dataset)) < 0) {pthread_mutex_unlock(&out_mutex);E_L_R();}
+     if ((n = H5Sget_simple_extent_ndims(filespace)) > rank) {
+          for (i=rank;i>0;i--) {start[i]=start[i-1];count[i]=count[i-1];}
+          start[0] = slot;
+          count[0] = 1;
+     }
+     if ((memspace=H5Screate_simple(rank,dims,dims)) < 0) {
+          H5Sclose(filespace);
+          pthread_mutex_unlock(&out_mutex);
+          E_L_R();
+     }
+     status=H5Sselect_hyperslab(filespace,H5S_SELECT_SET,start,NULL,count,NULL);
+     if (status >= 0)
+          status=H5Dwrite(dataset,mem_type,memspace,filespace,H5P_DEFAULT,data);
+     H5Sclose(memspace);
+     H5Sclose(filespace);
+     pthread_mutex_unlock(&out_mutex);
+     if (status < 0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines into a 2D HDF5 dataset, or into the time slot
+ *    opts->slot of a dataset with a leading time dimension, chunked by slot
+ *    (see open_sev_hdf()). Compressed blocks are
+ *    shuffled and deflated a chunk at a time by a pool of threads and the
+ *    compressed chunks are then written directly with H5Dwrite_chunk(),
+ *    bypassing the single threaded filter pipeline of H5Dwrite(). This needs
+ *    the block to cover whole rows of chunks, or to end at the last line, and
+ *    otherwise the block is written with H5Dwrite(). Only the calls to HDF5
+ *    are made holding out_mutex, so that the blocks of several slots are
+ *    compressed at once.
+ *    Inputs:
+ *        dataset:    The dataset, created with the shuffle and deflate
+ *                    filters if compressed
+ *        mem_type:   The type of the data in memory
+ *        file_type:  The type of the dataset
+ *        i_line:     Line of the dataset at which the block starts
+ *        dims:       The two dimensions of the block
+ *        data:       The block
+ *        opts:       Chunking, compression and threading of the output
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_hdf_data(hid_t dataset,hid_t mem_type,hid_t file_type,hsize_t i_line,
+                        const hsize_t *dims,const void *data,const struct hdf_opts *opts)
+{
+     struct chunk_job job;
+     size_t i, n, n_chunks, n_mem, n_file, dims_job[2], chunk[2];
+     int status, rank;
+     hid_t space;
+     hsize_t offset[3], dims_file[3];
+     unsigned char *conv = NULL;
 
-     hsize_t chunk[2] = {(dims[0]/100), (dims[1]/100)};
+     pthread_mutex_lock(&out_mutex);
+     space = H5Dget_space(dataset);
+     if (space >= 0) {
+          rank = H5Sget_simple_extent_ndims(space);
+          H5Sget_simple_extent_dims(space,dims_file,NULL);
+          H5Sclose(space);
+     }
+     pthread_mutex_unlock(&out_mutex);
+     if (space < 0) {E_L_R();}
 
-     status = status;
+     /* The offsets of the chunks start with the time slot in a cube */
+     offset[0] = opts->slot;
 
-     /* Set up some basic properties common to all the datasets*/
-     dcpl = H5Pcreate (H5P_DATASET_CREATE);
-     if (driver.compression==1) status = H5Pset_shuffle(dcpl);
-     if (driver.compression==1) status = H5Pset_deflate(dcpl, 2);
-     status = H5Pset_chunk (dcpl, 2, chunk);
-     H5Pset_fill_value(dcpl, H5T_NATIVE_FLOAT, &preproc.fill_value);
+#if H5_VERSION_GE(1,10,3)
+     if (opts->compression!=1 || i_line % opts->chunk[0] != 0 ||
+         ((i_line + dims[0]) % opts->chunk[0] != 0 && i_line + dims[0] != dims_file[rank-2]))
+#endif
+          return put_hdf_slab(dataset,mem_type,2,opts->slot,i_line,dims,data);
 
-     /* Set up dataspaces for the SEVIRI band data and write to the file.*/
-     for (i=0;i<preproc.n_bands;i++) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,bnames[driver.sev_bands.band_ids[i-1]],H5T_NATIVE_FLOAT,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.data[i][0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
+     /* Convert to the file type first if it differs, e.g. half floats */
+     n      = dims[0]*dims[1];
+     status = 0;
+     pthread_mutex_lock(&out_mutex);
+     n_mem  = H5Tget_size(mem_type);
+     n_file = H5Tget_size(file_type);
+     if (H5Tequal(mem_type,file_type) <= 0) {
+          conv = (unsigned char *) malloc(n*(n_mem > n_file ? n_mem : n_file));
+          memcpy(conv, data, n*n_mem);
+          if (H5Tconvert(mem_type,file_type,n,conv,NULL,H5P_DEFAULT) < 0) status = -1;
+          data = conv;
+     }
+     pthread_mutex_unlock(&out_mutex);
+     if (status!=0) {free(conv);E_L_R();}
+
+     dims_job[0] = dims[0];
+     dims_job[1] = dims[1];
+     chunk[0]    = opts->chunk[0];
+     chunk[1]    = opts->chunk[1];
+     if (run_chunk_job(&job,data,n_file,dims_job,chunk,CHUNK_SHUFFLE,OUT_DEFLATE_LEVEL,
+                       opts->n_threads,NULL,NULL)) {free_chunk_job(&job);if (conv) free(conv);E_L_R();}
+     n_chunks = job.n_chunks[0]*job.n_chunks[1];
+
+     /* HDF5 is not thread safe, so the chunks are written from this thread */
+     pthread_mutex_lock(&out_mutex);
+     for (i=0;i<n_chunks && status==0;i++) {
+          offset[rank-2] = i_line + i / job.n_chunks[1] * job.chunk[0];
+          offset[rank-1] = i % job.n_chunks[1] * job.chunk[1];
+#if H5_VERSION_GE(1,10,3)
+          if (H5Dwrite_chunk(dataset,H5P_DEFAULT,0,offset,job.n_out[i],job.out[i]) < 0)
+               status = -1;
+#endif
+     }
+     pthread_mutex_unlock(&out_mutex);
+
+     free_chunk_job(&job);
+     if (conv) free(conv);
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Creates a dataset for a 2D float product in an HDF5 file at the
+ *    requested precision, or for a series of them along a leading time
+ *    dimension that is unlimited. Products saved as 16 bit integers get CF
+ *    packing attributes.
+ *    Inputs:
+ *        outfile:    The HDF5 file id
+ *        dcpl:       Dataset creation properties (chunking, compression)
+ *        name:       Name of the dataset
+ *        rank:       2, or 3 with the time dimension
+ *        dims:       The dimensions of the dataset
+ *        prec:       Output precision (seviri_outprecs)
+ *        range:      Valid range of the product
+ *    Outputs:
+ *        hid_t:      The dataset, negative on failure
+ ******************************************************************************/
+static hid_t def_hdf_var(hid_t outfile,hid_t dcpl,const char *name,int rank,
+                         const hsize_t *dims,int prec,const float *range)
+{
+     float   scale, offset;
+     short   fill_i16 = FILL_VALUE_I16;
+     hid_t   dataspace,dataset,dcpl2,type;
+     hsize_t maxdims[3];
+
+     memcpy(maxdims,dims,rank*sizeof(hsize_t));
+     if (rank==3) maxdims[0]=H5S_UNLIMITED;
+
+     if ((dataspace=H5Screate_simple(rank,dims,maxdims)) < 0) {E_L_R();}
+
+     if (prec==SEVIRI_OUTPREC_I16) {
+          get_i16_scaling(range,&scale,&offset);
+          dcpl2=H5Pcopy(dcpl);
+          H5Pset_fill_value(dcpl2, H5T_NATIVE_SHORT, &fill_i16);
+          dataset=H5Dcreate2(outfile,name,H5T_NATIVE_SHORT,dataspace,H5P_DEFAULT,dcpl2,H5P_DEFAULT);
+          H5Pclose(dcpl2);
+          H5Sclose(dataspace);
+          if (dataset < 0) {E_L_R();}
+          if (put_hdf_att(dataset,"scale_factor",H5T_NATIVE_FLOAT,&scale) ||
+              put_hdf_att(dataset,"add_offset",H5T_NATIVE_FLOAT,&offset) ||
+              put_hdf_att(dataset,"_FillValue",H5T_NATIVE_SHORT,&fill_i16)) {H5Dclose(dataset);E_L_R();}
+     }
+     else {
+          if (prec==SEVIRI_OUTPREC_F16)
+               type=get_hdf_half_type();
+          else
+               type=H5Tcopy(H5T_NATIVE_FLOAT);
+          if (type < 0) {H5Sclose(dataspace);E_L_R();}
+          dataset=H5Dcreate2(outfile,name,type,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
+          H5Tclose(type);
+          H5Sclose(dataspace);
+          if (dataset < 0) {E_L_R();}
+     }
+
+     return dataset;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of a 2D float product into a dataset created
+ *    with def_hdf_var().
+ *    Inputs:
+ *        dataset:    The dataset
+ *        opts:       Chunking, compression and threading of the output
+ *        i_line:     Line of the image at which the block starts
+ *        dims:       The two dimensions of the block
+ *        data:       The float block
+ *        prec:       Output precision (seviri_outprecs)
+ *        range:      Valid range of the product
+ *        fill_value: Fill value of the float data
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_hdf_var(hid_t dataset,const struct hdf_opts *opts,hsize_t i_line,
+                       const hsize_t *dims,const float *data,int prec,
+                       const float *range,float fill_value)
+{
+     short   *data_i16;
+     herr_t  status;
+     hid_t   type;
+
+     if (prec==SEVIRI_OUTPREC_I16) {
+          if ((data_i16 = pack_i16(data,dims[0]*dims[1],fill_value,range)) == NULL) {E_L_R();}
+          status=put_hdf_data(dataset,H5T_NATIVE_SHORT,H5T_NATIVE_SHORT,i_line,dims,data_i16,opts);
+          free(data_i16);
+     }
+     else {
+          pthread_mutex_lock(&out_mutex);
+          type=H5Dget_type(dataset);
+          pthread_mutex_unlock(&out_mutex);
+          if (type < 0) {E_L_R();}
+          status=put_hdf_data(dataset,H5T_NATIVE_FLOAT,type,i_line,dims,data,opts);
+          pthread_mutex_lock(&out_mutex);
+          H5Tclose(type);
+          pthread_mutex_unlock(&out_mutex);
+     }
+     if (status < 0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Opens a dataset of an existing cube file and checks that it has the
+ *    expected rank and image dimensions and is packed as 16 bit integers if
+ *    and only if that is requested.
+ *    Inputs:
+ *        outfile:    The HDF5 file id
+ *        name:       Name of the dataset
+ *        rank:       The expected rank, one more if per time slot
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image, if the rank includes
+ *                    them
+ *        prec:       Output precision (seviri_outprecs) or -1 if double
+ *    Outputs:
+ *        n_slots:    The length of the time dimension, if any
+ *        hid_t:      The dataset, negative on failure
+ ******************************************************************************/
+static hid_t open_hdf_cube_var(hid_t outfile,const char *name,int rank,hsize_t n_lines,
+                               hsize_t n_columns,int prec,hsize_t *n_slots)
+{
+     hid_t dataset, space, type;
+     hsize_t dims[3];
+     int ok;
+
+     if ((dataset = H5Dopen2(outfile,name,H5P_DEFAULT)) < 0) {
+          fprintf(stderr, "ERROR: %s is not in the cube\n", name);
+          E_L_R();
+     }
+     space = H5Dget_space(dataset);
+     type  = H5Dget_type(dataset);
+     ok = H5Sget_simple_extent_ndims(space)==rank;
+     if (ok) {
+          H5Sget_simple_extent_dims(space,dims,NULL);
+          ok = dims[rank-(n_columns ? 2 : 1)]==n_lines && (!n_columns || dims[rank-1]==n_columns);
+          if (ok && n_slots) *n_slots = dims[0];
+     }
+     if (ok && prec>=0)
+          ok = (H5Tget_class(type)==H5T_INTEGER) == (prec==SEVIRI_OUTPREC_I16);
+     H5Tclose(type);
+     H5Sclose(space);
+     if (!ok) {
+          fprintf(stderr, "ERROR: %s of the cube does not match the output\n", name);
+          H5Dclose(dataset);
+          E_L_R();
+     }
+
+     return dataset;
+}
+
+/*******************************************************************************
+ *    Opens an existing cube file, see open_sev_hdf(), to append a time slot
+ *    to it. The products must be those of the cube, with the same image
+ *    dimensions and packing.
+ *    Inputs:
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
+ *    Outputs:
+ *        opts:       The time slot to be written
+ *        outfile:    The HDF5 file id
+ *        datasets:   The datasets, bands first then one per ancsave product
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int reopen_sev_hdf(struct driver_data driver,unsigned int n_lines,unsigned int n_columns,
+                          unsigned int n_bands,struct hdf_opts *opts,hid_t *outfile,
+                          hid_t *datasets)
+{
+     int i, first = 1;
+     hsize_t n_slots, slot = 0;
+
+     if ((*outfile = H5Fopen(driver.outf,H5F_ACC_RDWR,H5P_DEFAULT)) < 0) {E_L_R();}
+
+     for (i=0;i<n_bands+7;i++) {
+          if (i>=n_bands && driver.ancsave[i-n_bands]!=1) continue;
+          if (i<n_bands)
+               datasets[i]=open_hdf_cube_var(*outfile,bnames[driver.sev_bands.band_ids[i]-1],3,
+                                             n_lines,n_columns,driver.bandprec,&n_slots);
+          else if (i==n_bands)
+               datasets[i]=open_hdf_cube_var(*outfile,anc_outnames[0],driver.linetime==1 ? 2 : 3,
+                                             n_lines,driver.linetime==1 ? 0 : n_columns,-1,&n_slots);
+          else if (anc_static[i-n_bands])
+               datasets[i]=open_hdf_cube_var(*outfile,anc_outnames[i-n_bands],2,n_lines,n_columns,
+                                             driver.ancprec[i-n_bands],NULL);
+          else
+               datasets[i]=open_hdf_cube_var(*outfile,anc_outnames[i-n_bands],3,n_lines,n_columns,
+                                             driver.ancprec[i-n_bands],&n_slots);
+          if (datasets[i] < 0) {E_L_R();}
+
+          /* All the products of a time slot must have been written */
+          if (i>=n_bands && anc_static[i-n_bands]) continue;
+          if (!first && n_slots != slot) {
+               fprintf(stderr, "ERROR: The time dimensions of the cube %s differ\n", driver.outf);
+               E_L_R();
+          }
+          slot  = n_slots;
+          first = 0;
+     }
+
+     opts->slot       = slot;
+     opts->put_static = 0;
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Creates an HDF5 file for the processed SEVIRI data (and any ancilliary
+ *    data), to be written a block of lines at a time with put_sev_hdf(). Data
+ *    is saved as single or half precision floating point or as scaled 16 bit
+ *    integers depending on the driver precisions, aside from "Time" (double)
+ *
+ *    With driver.append the file is a cube of time slots, each run appending
+ *    one. The bands, time and solar angles then have a leading unlimited time
+ *    dimension, chunked one time slot by the image chunk, while the static
+ *    products (latitude, longitude and the viewing angles) are saved only by
+ *    the run creating the cube. If the file exists it is opened to append to
+ *    it instead of being overwritten.
+ *    Inputs:
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
+ *        fill_value: Fill value of the float data
+ *        opts:       Chunking, compression and threading of the output
+ *    Outputs:
+ *        opts:       The time slot to be written, if a cube
+ *        outfile:    The HDF5 file id
+ *        datasets:   The datasets, bands first then one per ancsave product
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int open_sev_hdf(struct driver_data driver,unsigned int n_lines,unsigned int n_columns,
+                        unsigned int n_bands,float fill_value,struct hdf_opts *opts,
+                        hid_t *outfile,hid_t *datasets)
+{
+     int i, cube, rank;
+     hid_t   dataspace,dcpl,dcpl_cube,dcpl_time;
+     hsize_t dims[3]={0,n_lines,n_columns}, maxdims[3]={H5S_UNLIMITED,n_lines,n_columns};
+     hsize_t chunk[3]={1,opts->chunk[0],opts->chunk[1]}, chunk_line[2]={1,n_lines};
+     const hsize_t *dims2=dims+1;
+
+     cube = driver.append==1;
+     opts->slot       = cube ? 0 : -1;
+     opts->put_static = 1;
+
+     if (cube && access(driver.outf,F_OK)==0) {
+          if (reopen_sev_hdf(driver,n_lines,n_columns,n_bands,opts,outfile,datasets)) {E_L_R();}
+     }
+     else {
+          /* Create the HDF5 file and initialise the data*/
+          *outfile = H5Fcreate(driver.outf,H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+          if (*outfile < 0) {E_L_R();}
+
+          /* Set up some basic properties common to all the datasets, those
+             of the time slots of a cube being chunked by time slot */
+          dcpl = H5Pcreate (H5P_DATASET_CREATE);
+          if (driver.compression==1) H5Pset_shuffle(dcpl);
+          if (driver.compression==1) H5Pset_deflate(dcpl, OUT_DEFLATE_LEVEL);
+          H5Pset_fill_value(dcpl, H5T_NATIVE_FLOAT, &fill_value);
+          dcpl_cube = H5Pcopy(dcpl);
+          H5Pset_chunk (dcpl, 2, opts->chunk);
+          H5Pset_chunk (dcpl_cube, 3, chunk);
+          rank = cube ? 3 : 2;
+
+          /* Create the datasets of the SEVIRI band data.*/
+          for (i=0;i<n_bands;i++)
+               if ((datasets[i]=def_hdf_var(*outfile,cube ? dcpl_cube : dcpl,
+                                            bnames[driver.sev_bands.band_ids[i]-1],rank,
+                                            cube ? dims : dims2,driver.bandprec,
+                                            get_band_range(driver.outtype[i]))) < 0) {H5Pclose(dcpl);H5Pclose(dcpl_cube);E_L_R();}
+
+          /* Create the datasets of the ancilliary data. Time is either a per
+             pixel image or one value per line.*/
+          if(driver.ancsave[0]==1) {
+               if (driver.linetime==1 && cube) {
+                    dataspace=H5Screate_simple(2,dims,maxdims);
+                    dcpl_time=H5Pcreate(H5P_DATASET_CREATE);
+                    H5Pset_chunk(dcpl_time, 2, chunk_line);
+               }
+               else if (driver.linetime==1) {
+                    dataspace=H5Screate_simple(1,dims2,dims2);
+                    dcpl_time=H5Pcreate(H5P_DATASET_CREATE);
+               }
+               else {
+                    dataspace=H5Screate_simple(rank,cube ? dims : dims2,cube ? maxdims : dims2);
+                    dcpl_time=H5Pcopy(cube ? dcpl_cube : dcpl);
+               }
+               datasets[n_bands]=H5Dcreate2(*outfile,anc_outnames[0],H5T_NATIVE_DOUBLE,dataspace,H5P_DEFAULT,dcpl_time,H5P_DEFAULT);
+               H5Pclose(dcpl_time);
+               H5Sclose(dataspace);
+               if (datasets[n_bands] < 0) {H5Pclose(dcpl);H5Pclose(dcpl_cube);E_L_R();}
+          }
+          for (i=1;i<7;i++) {
+               if(driver.ancsave[i]==1)
+                    if ((datasets[n_bands+i]=def_hdf_var(*outfile,cube && !anc_static[i] ? dcpl_cube : dcpl,
+                                                         anc_outnames[i],cube && !anc_static[i] ? 3 : 2,
+                                                         cube && !anc_static[i] ? dims : dims2,
+                                                         driver.ancprec[i],anc_ranges[i])) < 0) {H5Pclose(dcpl);H5Pclose(dcpl_cube);E_L_R();}
+          }
+
+          H5Pclose(dcpl);
+          H5Pclose(dcpl_cube);
+     }
+
+     /* Add the time slot to the datasets of a cube */
+     if (cube) {
+          for (i=0;i<n_bands+7;i++) {
+               if (datasets[i] < 0 || (i>=n_bands && anc_static[i-n_bands])) continue;
+               dataspace = H5Dget_space(datasets[i]);
+               H5Sget_simple_extent_dims(dataspace,dims,NULL);
+               H5Sclose(dataspace);
+               dims[0] = opts->slot + 1;
+               if (H5Dset_extent(datasets[i],dims) < 0) {E_L_R();}
+          }
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of the processed SEVIRI data into an HDF5 file
+ *    created with open_sev_hdf().
+ *    Inputs:
+ *        datasets:   The datasets
+ *        opts:       Chunking, compression and threading of the output
+ *        driver:     The driver info
+ *        preproc:    The block of SEVIRI data
+ *        i_line:     Line of the image at which the block starts
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_sev_hdf(const hid_t *datasets,const struct hdf_opts *opts,
+                       struct driver_data driver,struct seviri_preproc_data preproc,
+                       unsigned int i_line)
+{
+     int i, status;
+     double *time;
+     hsize_t dims[2]={preproc.n_lines,preproc.n_columns};
+
+     for (i=0;i<preproc.n_bands;i++)
+          if (put_hdf_var(datasets[i],opts,i_line,dims,preproc.data[i],driver.bandprec,
+                          get_band_range(driver.outtype[i]),preproc.fill_value)) {E_L_R();}
+
+     if(driver.ancsave[0]==1) {
+          if (driver.linetime==1)
+               status=put_hdf_slab(datasets[preproc.n_bands],H5T_NATIVE_DOUBLE,1,opts->slot,i_line,dims,
+                                   preproc.time_line);
+          else {
+               if ((time = get_time_image(preproc)) == NULL) {E_L_R();}
+               status=put_hdf_data(datasets[preproc.n_bands],H5T_NATIVE_DOUBLE,H5T_NATIVE_DOUBLE,
+                                   i_line,dims,time,opts);
+               free(time);
+          }
+          if (status < 0) {E_L_R();}
+     }
+     for (i=1;i<7;i++) {
+          /* The static products of a cube are only saved when it is created */
+          if(driver.ancsave[i]==1 && (opts->put_static || !anc_static[i]))
+               if (put_hdf_var(datasets[preproc.n_bands+i],opts,i_line,dims,get_anc_data(preproc,i),
+                               driver.ancprec[i],anc_ranges[i],preproc.fill_value)) {E_L_R();}
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Attaches the statistics of each band to its HDF5 dataset.
+ *    Inputs:
+ *        datasets:   The datasets of the file, bands first
+ *        stats:      The statistics of the bands
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_hdf_stats(const hid_t *datasets,const struct seviri_stats_data *stats)
+{
+     unsigned int i, j;
+     double values[N_STATS_ATTS];
+
+     for (i=0;i<stats->n_bands;i++) {
+          get_stats_values(&stats->band[i],values);
+          for (j=0;j<N_STATS_ATTS;j++)
+               if (put_hdf_att(datasets[i],stats_att_names[j],H5T_NATIVE_DOUBLE,&values[j])) {E_L_R();}
+          if (put_hdf_att_n(datasets[i],"count_histogram",H5T_NATIVE_ULONG,SEVIRI_STATS_N_COUNTS,
+                            stats->band[i].hist)) {E_L_R();}
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    A tiled TIFF file being written a tile row at a time. The bands and the
+ *    ancilliary products are separate planes of one image, written tile by
+ *    tile with the tiles of each tile row compressed by a pool of threads.
+ *    The first overview is accumulated as the tile rows are written and the
+ *    coarser overviews are computed from it when the file is closed.
+ ******************************************************************************/
+struct tiff_out {
+     TIFF            *tif;
+     struct driver_data driver;
+     unsigned int    n_lines;
+     unsigned int    n_columns;
+     unsigned int    n_planes;
+     size_t          tile[2];
+     int             n_threads;
+     float           fill_value;
+     /* The tile row being filled, tile[0] lines of each plane */
+     float           *row;
+     unsigned int    i_row;             /* first line of the tile row */
+     unsigned int    n_row;             /* lines of the tile row filled */
+     /* The first overview, all planes */
+     float           *ovr;
+     unsigned int    ovr_lines;
+     unsigned int    ovr_columns;
+};
+
+/*******************************************************************************
+ *    Returns the tile size along a dimension of the TIFF output, a multiple of
+ *    16 as TIFF requires.
+ *    Inputs:
+ *        size:       The chunk size from the driver or 0 for the default
+ *        dim:        The size of the dimension
+ *    Outputs:
+ *        size_t:     The tile size
+ ******************************************************************************/
+static size_t get_tile_size(int size,size_t dim)
+{
+     size_t n;
+
+     n = get_chunk_size(size,dim);
+
+     return (n + 15) / 16 * 16;
+}
+
+/*******************************************************************************
+ *    Sets the tags of an image of the TIFF file, the full resolution image or
+ *    an overview.
+ ******************************************************************************/
+static void set_tiff_tags(const struct tiff_out *t,unsigned int n_lines,
+                          unsigned int n_columns,int overview)
+{
+     char outstr[2048];
+     unsigned int i;
+     unsigned short *extra;
+
+     TIFFSetField(t->tif, TIFFTAG_SUBFILETYPE, overview ? FILETYPE_REDUCEDIMAGE : 0);
+     TIFFSetField(t->tif, TIFFTAG_IMAGEWIDTH, n_columns);
+     TIFFSetField(t->tif, TIFFTAG_IMAGELENGTH, n_lines);
+     TIFFSetField(t->tif, TIFFTAG_TILEWIDTH, (unsigned int) t->tile[1]);
+     TIFFSetField(t->tif, TIFFTAG_TILELENGTH, (unsigned int) t->tile[0]);
+     TIFFSetField(t->tif, TIFFTAG_SAMPLESPERPIXEL, t->n_planes);
+     TIFFSetField(t->tif, TIFFTAG_BITSPERSAMPLE, 32);
+     TIFFSetField(t->tif, TIFFTAG_SAMPLEFORMAT,SAMPLEFORMAT_IEEEFP);
+     TIFFSetField(t->tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+     TIFFSetField(t->tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_SEPARATE);
+     TIFFSetField(t->tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+     if (t->n_planes > 1) {
+          extra = (unsigned short*) calloc(t->n_planes-1,sizeof(unsigned short));
+          for (i=0;i<t->n_planes-1;i++) extra[i]=EXTRASAMPLE_UNSPECIFIED;
+          TIFFSetField(t->tif, TIFFTAG_EXTRASAMPLES, t->n_planes-1, extra);
+          free(extra);
+     }
+     if (t->driver.compression==1) {
+          TIFFSetField(t->tif, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+          TIFFSetField(t->tif, TIFFTAG_PREDICTOR, PREDICTOR_FLOATINGPOINT);
+     }
+     else
+          TIFFSetField(t->tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+     if (overview) return;
+
+     if (t->driver.infrmt==SEVIRI_INFILE_HRIT) sprintf(outstr,"Image created with the SEVIRI reader utility. This file was produced from MSG%i data in timeslot %s.",t->driver.satnum,t->driver.timeslot);
+     else if (t->driver.infrmt==SEVIRI_INFILE_NAT) sprintf(outstr,"Image created with the SEVIRI reader utility. This file was produced from %s.",t->driver.infdir);
+     else  sprintf(outstr,"Image created with the SEVIRI reader utility.");
+     TIFFSetField(t->tif, TIFFTAG_IMAGEDESCRIPTION, outstr);
+}
+
+/*******************************************************************************
+ *    Compresses and writes the tiles of a block of planes of the current image
+ *    of the TIFF file.
+ *    Inputs:
+ *        t:          The TIFF file
+ *        data:       The planes, one after the other, n_lines lines each
+ *        n_planes:   Number of planes in data
+ *        i_plane:    The plane of the image of the first plane in data
+ *        n_lines:    Number of lines of each plane in data, a multiple of the
+ *                    tile length unless data is the last tile row
+ *        n_columns:  Number of columns of the image
+ *        i_line:     Line of the image at which data starts, at a tile row
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_tiff_tiles(struct tiff_out *t,const float *data,unsigned int n_planes,
+                          unsigned int i_plane,unsigned int n_lines,
+                          unsigned int n_columns,unsigned int i_line)
+{
+     struct chunk_job job;
+     size_t i, i_chunk, dims[2];
+     unsigned int p, y, x;
+     int status;
+
+     /* Each plane is compressed separately so that the tiles of a plane are
+        padded at its own edge */
+     for (p=0;p<n_planes;p++) {
+          dims[0] = n_lines;
+          dims[1] = n_columns;
+          status  = run_chunk_job(&job,data + (size_t) p*n_lines*n_columns,sizeof(float),
+                                  dims,t->tile,CHUNK_FP_PREDICTOR,
+                                  t->driver.compression==1 ? OUT_DEFLATE_LEVEL : 0,
+                                  t->n_threads,NULL,NULL);
+          for (i=0;i<job.n_chunks[0] && status==0;i++) {
+               for (i_chunk=i*job.n_chunks[1];i_chunk<(i+1)*job.n_chunks[1];i_chunk++) {
+                    y = i_line + i*t->tile[0];
+                    x = i_chunk % job.n_chunks[1] * t->tile[1];
+                    if (TIFFWriteRawTile(t->tif,TIFFComputeTile(t->tif,x,y,0,i_plane+p),
+                                         job.out[i_chunk],job.n_out[i_chunk]) < 0) {
+                         status = -1;
+                         break;
+                    }
+               }
+          }
+          free_chunk_job(&job);
+          if (status) {E_L_R();}
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Averages a plane over blocks of 2x2 pixels, ignoring fill values.
+ *    Inputs:
+ *        in:         The plane
+ *        n_lines:    Number of lines of the plane
+ *        n_columns:  Number of columns of the plane
+ *        fill_value: The fill value
+ *    Outputs:
+ *        out:        The averaged plane, (n_lines+1)/2 by (n_columns+1)/2
+ ******************************************************************************/
+static void reduce_plane(const float *in,unsigned int n_lines,unsigned int n_columns,
+                         float fill_value,float *out)
+{
+     unsigned int i, j, ii, jj, n, n_out_columns;
+     double sum;
+
+     n_out_columns = (n_columns + 1) / 2;
+
+     for (i=0;i<(n_lines+1)/2;i++) {
+          for (j=0;j<n_out_columns;j++) {
+               n   = 0;
+               sum = 0.;
+               for (ii=2*i;ii<2*i+2 && ii<n_lines;ii++) {
+                    for (jj=2*j;jj<2*j+2 && jj<n_columns;jj++) {
+                         if (in[ii*n_columns+jj]==fill_value) continue;
+                         sum += in[ii*n_columns+jj];
+                         n++;
+                    }
+               }
+               out[i*n_out_columns+j] = n>0 ? sum / n : fill_value;
+          }
+     }
+}
+
+/*******************************************************************************
+ *    Writes the tile row buffered in a tiff_out and accumulates it into the
+ *    first overview.
+ ******************************************************************************/
+static int flush_tiff_row(struct tiff_out *t)
+{
+     unsigned int p;
+     size_t n_plane;
+
+     if (t->n_row==0) return 0;
+
+     if (put_tiff_tiles(t,t->row,t->n_planes,0,t->tile[0],t->n_columns,t->i_row)) {E_L_R();}
+
+     if (t->ovr) {
+          n_plane = (size_t) t->ovr_lines*t->ovr_columns;
+          for (p=0;p<t->n_planes;p++)
+               reduce_plane(t->row + (size_t) p*t->tile[0]*t->n_columns,t->n_row,t->n_columns,
+                            t->fill_value,t->ovr + p*n_plane + (size_t) t->i_row/2*t->ovr_columns);
+     }
+
+     t->i_row += t->n_row;
+     t->n_row  = 0;
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Creates a tiled TIFF file for the processed SEVIRI data (and any
+ *    ancilliary data), to be written a block of lines at a time with
+ *    put_sev_tiff() and closed with close_sev_tiff(). All data is saved as
+ *    floating point type with the bands and then the ancilliary products as
+ *    separate planes. If the image is larger than a tile, overviews reduced by
+ *    2, 4, ... follow it until one fits in a tile.
+ *    Inputs:
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
+ *        fill_value: Fill value of the float data
+ *    Outputs:
+ *        tiff_out*:  The TIFF file, NULL on failure
+ ******************************************************************************/
+static struct tiff_out *open_sev_tiff(struct driver_data driver,unsigned int n_lines,
+                                      unsigned int n_columns,unsigned int n_bands,
+                                      float fill_value)
+{
+     int i;
+     struct tiff_out *t;
+
+     t = (struct tiff_out*) calloc(1,sizeof(struct tiff_out));
+     t->driver     = driver;
+     t->n_lines    = n_lines;
+     t->n_columns  = n_columns;
+     t->n_planes   = n_bands;
+     for (i=0;i<7;i++)if (driver.ancsave[i]==1)t->n_planes+=1;
+     t->tile[0]    = get_tile_size(driver.chunk[0],n_lines);
+     t->tile[1]    = get_tile_size(driver.chunk[1],n_columns);
+     t->n_threads  = get_n_threads(driver);
+     t->fill_value = fill_value;
+
+     t->row = (float*) malloc(sizeof(float)*t->n_planes*t->tile[0]*n_columns);
+     if (n_lines > t->tile[0] || n_columns > t->tile[1]) {
+          t->ovr_lines   = (n_lines + 1) / 2;
+          t->ovr_columns = (n_columns + 1) / 2;
+          t->ovr = (float*) malloc(sizeof(float)*t->n_planes*t->ovr_lines*t->ovr_columns);
+          if (t->ovr==NULL) {free(t->row);free(t);return NULL;}
+     }
+     if (t->row==NULL) {free(t->ovr);free(t);return NULL;}
+
+     if ((t->tif = TIFFOpen(driver.outf, "w")) == NULL) {
+          free(t->row);
+          free(t->ovr);
+          free(t);
+          return NULL;
+     }
+     set_tiff_tags(t,n_lines,n_columns,0);
+
+     return t;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of the processed SEVIRI data into a TIFF file
+ *    created with open_sev_tiff(). Blocks must be written in order.
+ *    Inputs:
+ *        t:          The TIFF file
+ *        preproc:    The block of SEVIRI data
+ *        i_line:     Line of the image at which the block starts
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_sev_tiff(struct tiff_out *t,struct seviri_preproc_data preproc,
+                        unsigned int i_line)
+{
+     unsigned int i, j, n, l, p;
+     size_t n_plane;
+     float *row;
+
+     if (i_line != t->i_row + t->n_row) {
+          fprintf(stderr, "ERROR: TIFF output must be written in order\n");
+          E_L_R();
+     }
+
+     n_plane = (size_t) t->tile[0]*t->n_columns;
+     for (l=0;l<preproc.n_lines;l+=n) {
+          n = t->tile[0] - t->n_row;
+          if (n > preproc.n_lines - l) n = preproc.n_lines - l;
+
+          /* The bands, the time and then the float ancilliary products */
+          row = t->row + (size_t) t->n_row*t->n_columns;
+          for (p=0;p<preproc.n_bands;p++,row+=n_plane)
+               memcpy(row,preproc.data[p]+(size_t) l*t->n_columns,sizeof(float)*n*t->n_columns);
+          if (t->driver.ancsave[0]==1) {
+               /* Time is given per line, only where the pixel is on the disk */
+               for (i=0;i<n;i++)
+                    for (j=0;j<t->n_columns;j++)
+                         row[i*t->n_columns+j] =
+                              preproc.lat[(size_t) (l+i)*t->n_columns+j]!=preproc.fill_value ?
+                              (float) preproc.time_line[l+i] : preproc.fill_value;
+               row+=n_plane;
+          }
+          for (p=1;p<7;p++) {
+               if (t->driver.ancsave[p]!=1) continue;
+               memcpy(row,get_anc_data(preproc,p)+(size_t) l*t->n_columns,sizeof(float)*n*t->n_columns);
+               row+=n_plane;
+          }
+
+          t->n_row += n;
+          if (t->n_row==t->tile[0] || t->i_row+t->n_row==t->n_lines) {
+               /* Pad the last tile row with fill values */
+               for (p=0;p<t->n_planes;p++)
+                    for (i=t->n_row*t->n_columns;i<n_plane;i++) t->row[p*n_plane+i]=t->fill_value;
+               if (flush_tiff_row(t)) {E_L_R();}
+          }
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Finishes the full resolution image of a TIFF file created with
+ *    open_sev_tiff(), writes the overviews and closes it.
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int close_sev_tiff(struct tiff_out *t)
+{
+     unsigned int p, n_lines, n_columns;
+     int status = 0;
+     size_t n_plane;
+     float *ovr, *next;
+
+     if (t->i_row + t->n_row != t->n_lines) status = -1;
+
+     if (status==0 && t->ovr && !TIFFWriteDirectory(t->tif)) status = -1;
+
+     ovr       = t->ovr;
+     n_lines   = t->ovr_lines;
+     n_columns = t->ovr_columns;
+     while (status==0 && ovr) {
+          set_tiff_tags(t,n_lines,n_columns,1);
+          if (put_tiff_tiles(t,ovr,t->n_planes,0,n_lines,n_columns,0)) status = -1;
+          if (status==0 && !TIFFWriteDirectory(t->tif)) status = -1;
+
+          next = NULL;
+          if (status==0 && (n_lines > t->tile[0] || n_columns > t->tile[1])) {
+               n_plane = (size_t) ((n_lines + 1) / 2)*((n_columns + 1) / 2);
+               if ((next = (float*) malloc(sizeof(float)*t->n_planes*n_plane)) == NULL)
+                    status = -1;
+               else
+                    for (p=0;p<t->n_planes;p++)
+                         reduce_plane(ovr + (size_t) p*n_lines*n_columns,n_lines,n_columns,
+                                      t->fill_value,next + p*n_plane);
+               n_lines   = (n_lines + 1) / 2;
+               n_columns = (n_columns + 1) / 2;
+          }
+          if (ovr!=t->ovr) free(ovr);
+          ovr = next;
+     }
+
+     TIFFClose(t->tif);
+     free(t->ovr);
+     free(t->row);
+     free(t);
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Converts a float to an IEEE half precision float, rounding to nearest
+ *    even. Values too large become infinity.
+ ******************************************************************************/
+static unsigned short float_to_half(float x)
+{
+     union {float f; unsigned int u;} v;
+     unsigned int sign, mant, shift;
+     int exp;
+
+     v.f  = x;
+     sign = (v.u >> 16) & 0x8000;
+     exp  = (int) ((v.u >> 23) & 0xff) - 127 + 15;
+     mant = v.u & 0x7fffff;
+
+     if (((v.u >> 23) & 0xff) == 0xff)
+          return sign | 0x7c00 | (mant ? 0x200 : 0);
+     if (exp >= 31)
+          return sign | 0x7c00;
+     if (exp <= 0) {
+          /* Subnormal or zero */
+          if (exp < -10) return sign;
+          mant |= 0x800000;
+          shift = 14 - exp;
+          v.u   = mant >> shift;
+          if ((mant >> (shift - 1) & 1) && ((mant & ((1u << (shift - 1)) - 1)) || (v.u & 1)))
+               v.u++;
+          return sign | v.u;
+     }
+
+     v.u = (unsigned int) exp << 10 | mant >> 13;
+     if ((mant & 0x1000) && ((mant & 0xfff) || (v.u & 1)))
+          v.u++;                        /* may carry into the exponent */
+
+     return sign | v.u;
+}
+
+/*******************************************************************************
+ *    A Zarr (version 2) directory store being written a block of lines at a
+ *    time. Each product is an array of the store with its chunks compressed
+ *    and written to their own files by a pool of threads.
+ ******************************************************************************/
+struct zarr_out {
+     char            *dir;
+     unsigned int    n_lines;
+     unsigned int    n_columns;
+     size_t          chunk[2];
+     int             compression;
+     int             n_threads;
+     const char      **names;           /* bands first then one per ancsave
+                                           product, NULL if not saved */
+};
+
+/*******************************************************************************
+ *    The chunks of a block of lines of an array of a Zarr store, see
+ *    put_zarr_chunk().
+ ******************************************************************************/
+struct zarr_chunks {
+     const char      *dir;              /* the array */
+     int             rank;
+     size_t          i_row;             /* chunk row at which the block starts */
+     size_t          n_chunks;          /* chunks along a row */
+};
+
+/*******************************************************************************
+ *    Returns a newly allocated path dir/name, or dir if name is NULL.
+ ******************************************************************************/
+static char *get_zarr_path(const char *dir,const char *name)
+{
+     char *path;
+
+     path = (char*) malloc(strlen(dir)+(name ? strlen(name) : 0)+2);
+     strcpy(path,dir);
+     if (name) {strcat(path,"/");strcat(path,name);}
+
+     return path;
+}
+
+/*******************************************************************************
+ *    Writes a text file into a Zarr store.
+ ******************************************************************************/
+static int put_zarr_text(const char *dir,const char *name,const char *text)
+{
+     char *path;
+     FILE *fp;
+     int status = 0;
+
+     path = get_zarr_path(dir,name);
+     if ((fp = fopen(path,"w")) == NULL) {
+          fprintf(stderr, "ERROR: fopen(%s, w), %s\n", path, strerror(errno));
+          free(path);
+          E_L_R();
+     }
+     if (fputs(text,fp) == EOF) status = -1;
+     if (fclose(fp)) status = -1;
+     free(path);
+     if (status) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Thread callback of run_chunk_job() writing a compressed chunk of a block
+ *    of lines of a Zarr array to the file named by its chunk indices.
+ ******************************************************************************/
+static int put_zarr_chunk(void *put_data,size_t i_chunk,const unsigned char *buf,size_t n)
+{
+     char key[64], *path;
+     FILE *fp;
+     int status = 0;
+     struct zarr_chunks *c = (struct zarr_chunks *) put_data;
+
+     if (c->rank==1)
+          sprintf(key,"%lu",(unsigned long) (c->i_row + i_chunk));
+     else
+          sprintf(key,"%lu.%lu",(unsigned long) (c->i_row + i_chunk / c->n_chunks),
+                  (unsigned long) (i_chunk % c->n_chunks));
+
+     path = get_zarr_path(c->dir,key);
+     if ((fp = fopen(path,"wb")) == NULL) {
+          fprintf(stderr, "ERROR: fopen(%s, wb), %s\n", path, strerror(errno));
+          free(path);
+          return -1;
+     }
+     if (fwrite(buf,1,n,fp) != n) status = -1;
+     if (fclose(fp)) status = -1;
+     free(path);
+
+     return status;
+}
+
+/*******************************************************************************
+ *    Creates an array of a Zarr store, a directory with the array metadata
+ *    (.zarray) and attributes (.zattrs), the latter naming the dimensions as
+ *    xarray expects and giving the CF packing of 16 bit integers.
+ *    Inputs:
+ *        z:          The Zarr store
+ *        name:       Name of the array
+ *        rank:       1 for an array of lines, 2 for an image
+ *        type:       Zarr type of the elements without the byte order, "f4",
+ *                    "f2", "i2" or "f8"
+ *        size:       Bytes per element
+ *        fill:       The fill value as JSON
+ *        range:      Valid range for 16 bit integers, otherwise NULL
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int def_zarr_var(const struct zarr_out *z,const char *name,int rank,
+                        const char *type,size_t size,const char *fill,
+                        const float *range)
+{
+     char text[1024], order, *dir;
+     float scale, offset;
+     const unsigned short one = 1;
+
+     dir = get_zarr_path(z->dir,name);
+     if (mkdir(dir,0777) && errno != EEXIST) {
+          fprintf(stderr, "ERROR: mkdir(%s), %s\n", dir, strerror(errno));
+          free(dir);
+          E_L_R();
+     }
+
+     /* The chunks are written in the byte order of this machine */
+     order = *(const unsigned char *) &one ? '<' : '>';
+
+     if (rank==1)
+          sprintf(text,"{\n    \"zarr_format\": 2,\n    \"shape\": [%u],\n    \"chunks\": [%lu],\n",
+                  z->n_lines,(unsigned long) z->chunk[0]);
+     else
+          sprintf(text,"{\n    \"zarr_format\": 2,\n    \"shape\": [%u, %u],\n    \"chunks\": [%lu, %lu],\n",
+                  z->n_lines,z->n_columns,(unsigned long) z->chunk[0],(unsigned long) z->chunk[1]);
+     sprintf(text+strlen(text),"    \"dtype\": \"%c%s\",\n    \"fill_value\": %s,\n    \"order\": \"C\",\n",
+             order,type,fill);
+     if (z->compression==1)
+          sprintf(text+strlen(text),"    \"filters\": [{\"id\": \"shuffle\", \"elementsize\": %lu}],\n"
+                  "    \"compressor\": {\"id\": \"zlib\", \"level\": %d},\n",
+                  (unsigned long) size,OUT_DEFLATE_LEVEL);
+     else
+          strcat(text,"    \"filters\": null,\n    \"compressor\": null,\n");
+     strcat(text,"    \"dimension_separator\": \".\"\n}\n");
+     if (put_zarr_text(dir,".zarray",text)) {free(dir);E_L_R();}
+
+     sprintf(text,"{\n    \"_ARRAY_DIMENSIONS\": %s",rank==1 ? "[\"y\"]" : "[\"y\", \"x\"]");
+     if (range) {
+          get_i16_scaling(range,&scale,&offset);
+          sprintf(text+strlen(text),",\n    \"scale_factor\": %.9g,\n    \"add_offset\": %.9g",
+                  scale,offset);
+     }
+     strcat(text,"\n}\n");
+     if (put_zarr_text(dir,".zattrs",text)) {free(dir);E_L_R();}
+
+     free(dir);
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Adds the statistics of each band to the attributes (.zattrs) of its
+ *    array, written by def_zarr_var().
+ *    Inputs:
+ *        z:          The Zarr store
+ *        stats:      The statistics of the bands
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_zarr_stats(const struct zarr_out *z,const struct seviri_stats_data *stats)
+{
+     unsigned int i, j;
+     long n;
+     char *dir, *path, *text;
+     double values[N_STATS_ATTS];
+     FILE *fp;
+
+     for (i=0;i<stats->n_bands;i++) {
+          dir  = get_zarr_path(z->dir,z->names[i]);
+          path = get_zarr_path(dir,".zattrs");
+          if ((fp = fopen(path,"r")) == NULL) {
+               fprintf(stderr, "ERROR: fopen(%s, r), %s\n", path, strerror(errno));
+               free(path);free(dir);
+               E_L_R();
+          }
+          free(path);
+
+          /* The attributes without the closing brace, followed by the
+             statistics, the histogram taking at most 21 characters a bin */
+          text = (char*) malloc(1024+22*SEVIRI_STATS_N_COUNTS);
+          n = fread(text,1,1023,fp);
+          fclose(fp);
+          while (n>0 && text[n-1]!='}') n--;
+          if (n==0) {free(text);free(dir);E_L_R();}
+          for (n--;n>0 && (text[n-1]=='\n' || text[n-1]==' ');n--);
+          text[n] = '\0';
+
+          get_stats_values(&stats->band[i],values);
+          for (j=0;j<N_STATS_ATTS;j++)
+               sprintf(text+strlen(text),",\n    \"%s\": %.17g",stats_att_names[j],values[j]);
+          strcat(text,",\n    \"count_histogram\": [");
+          for (j=0;j<SEVIRI_STATS_N_COUNTS;j++)
+               sprintf(text+strlen(text),"%s%lu",j>0 ? ", " : "",stats->band[i].hist[j]);
+          strcat(text,"]\n}\n");
+
+          if (put_zarr_text(dir,".zattrs",text)) {free(text);free(dir);E_L_R();}
+          free(text);
+          free(dir);
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines into an array of a Zarr store. The block must
+ *    start at a row of chunks and cover whole rows of chunks unless it ends
+ *    at the last line.
+ *    Inputs:
+ *        z:          The Zarr store
+ *        name:       Name of the array
+ *        rank:       1 for an array of lines, 2 for an image
+ *        i_line:     Line of the image at which the block starts
+ *        n_lines:    Number of lines of the block
+ *        data:       The block in the type of the array
+ *        size:       Bytes per element
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_zarr_data(const struct zarr_out *z,const char *name,int rank,
+                         unsigned int i_line,unsigned int n_lines,const void *data,
+                         size_t size)
+{
+     struct chunk_job job;
+     struct zarr_chunks c;
+     size_t dims[2], chunk[2];
+     int status;
+
+     if (i_line % z->chunk[0] != 0 || (n_lines % z->chunk[0] != 0 && i_line+n_lines != z->n_lines)) {
+          fprintf(stderr, "ERROR: Zarr output must be written in whole rows of chunks\n");
+          E_L_R();
+     }
+
+     dims[0]  = n_lines;
+     dims[1]  = rank==1 ? 1 : z->n_columns;
+     chunk[0] = z->chunk[0];
+     chunk[1] = rank==1 ? 1 : z->chunk[1];
+
+     c.dir      = get_zarr_path(z->dir,name);
+     c.rank     = rank;
+     c.i_row    = i_line / z->chunk[0];
+     c.n_chunks = (dims[1] + chunk[1] - 1) / chunk[1];
+
+     status = run_chunk_job(&job,data,size,dims,chunk,CHUNK_SHUFFLE,
+                            z->compression==1 ? OUT_DEFLATE_LEVEL : 0,z->n_threads,
+                            put_zarr_chunk,&c);
+     free_chunk_job(&job);
+     free((char *) c.dir);
+     if (status) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of a 2D float product into an array created with
+ *    def_zarr_var(), converted to the output precision.
+ ******************************************************************************/
+static int put_zarr_var(const struct zarr_out *z,const char *name,unsigned int i_line,
+                        unsigned int n_lines,const float *data,int prec,
+                        const float *range,float fill_value)
+{
+     size_t i, n;
+     short *data_i16;
+     unsigned short *data_f16;
+     int status;
+
+     n = (size_t) n_lines*z->n_columns;
+
+     if (prec==SEVIRI_OUTPREC_I16) {
+          if ((data_i16 = pack_i16(data,n,fill_value,range)) == NULL) {E_L_R();}
+          status = put_zarr_data(z,name,2,i_line,n_lines,data_i16,sizeof(short));
+          free(data_i16);
+     }
+     else if (prec==SEVIRI_OUTPREC_F16) {
+          if ((data_f16 = (unsigned short*) malloc(sizeof(unsigned short)*n)) == NULL) {E_L_R();}
+          for (i=0;i<n;i++) data_f16[i] = float_to_half(data[i]);
+          status = put_zarr_data(z,name,2,i_line,n_lines,data_f16,sizeof(unsigned short));
+          free(data_f16);
+     }
+     else
+          status = put_zarr_data(z,name,2,i_line,n_lines,data,sizeof(float));
+     if (status) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Defines a 2D float product in a Zarr store at the requested precision.
+ ******************************************************************************/
+static int def_zarr_prod(const struct zarr_out *z,const char *name,int prec,
+                         const float *range,float fill_value)
+{
+     char fill[64];
+
+     if (prec==SEVIRI_OUTPREC_I16) {
+          sprintf(fill,"%d",FILL_VALUE_I16);
+          return def_zarr_var(z,name,2,"i2",sizeof(short),fill,range);
+     }
+
+     sprintf(fill,"%.9g",fill_value);
+     if (prec==SEVIRI_OUTPREC_F16)
+          return def_zarr_var(z,name,2,"f2",sizeof(unsigned short),fill,NULL);
+
+     return def_zarr_var(z,name,2,"f4",sizeof(float),fill,NULL);
+}
+
+/*******************************************************************************
+ *    Creates a Zarr (version 2) directory store for the processed SEVIRI data
+ *    (and any ancilliary data), to be written a block of lines at a time with
+ *    put_sev_zarr(). Each band and ancilliary product is an array of the
+ *    store, saved as single or half precision floating point or as scaled 16
+ *    bit integers depending on the driver precisions, aside from "Time"
+ *    (double). The arrays are chunked as the HDF5 output and compressed chunks
+ *    are shuffled and deflated (zlib).
+ *    Inputs:
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
+ *        fill_value: Fill value of the float data
+ *    Outputs:
+ *        zarr_out*:  The Zarr store, NULL on failure
+ ******************************************************************************/
+static struct zarr_out *open_sev_zarr(struct driver_data driver,unsigned int n_lines,
+                                      unsigned int n_columns,unsigned int n_bands,
+                                      float fill_value)
+{
+     char fill[64];
+     int i, status = 0;
+     struct zarr_out *z;
+
+     if (mkdir(driver.outf,0777) && errno != EEXIST) {
+          fprintf(stderr, "ERROR: mkdir(%s), %s\n", driver.outf, strerror(errno));
+          return NULL;
+     }
+
+     z = (struct zarr_out*) calloc(1,sizeof(struct zarr_out));
+     z->dir         = get_zarr_path(driver.outf,NULL);
+     z->n_lines     = n_lines;
+     z->n_columns   = n_columns;
+     z->chunk[0]    = get_chunk_size(driver.chunk[0],n_lines);
+     z->chunk[1]    = get_chunk_size(driver.chunk[1],n_columns);
+     z->compression = driver.compression;
+     z->n_threads   = get_n_threads(driver);
+     z->names       = (const char**) calloc(n_bands+7,sizeof(const char*));
+
+     status = put_zarr_text(z->dir,".zgroup","{\n    \"zarr_format\": 2\n}\n");
+
+     for (i=0;i<n_bands && status==0;i++) {
+          z->names[i] = bnames[driver.sev_bands.band_ids[i]-1];
+          status = def_zarr_prod(z,z->names[i],driver.bandprec,
+                                 get_band_range(driver.outtype[i]),fill_value);
+     }
+     if (status==0 && driver.ancsave[0]==1) {
+          z->names[n_bands] = anc_outnames[0];
+          sprintf(fill,"%.9g",fill_value);
+          status = def_zarr_var(z,anc_outnames[0],driver.linetime==1 ? 1 : 2,"f8",
+                                sizeof(double),fill,NULL);
+     }
+     for (i=1;i<7 && status==0;i++) {
+          if (driver.ancsave[i]!=1) continue;
+          z->names[n_bands+i] = anc_outnames[i];
+          status = def_zarr_prod(z,anc_outnames[i],driver.ancprec[i],anc_ranges[i],fill_value);
+     }
+
+     if (status) {
+          free(z->names);
+          free(z->dir);
+          free(z);
+          return NULL;
+     }
+
+     return z;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of the processed SEVIRI data into a Zarr store
+ *    created with open_sev_zarr(). Blocks must cover whole rows of chunks.
+ *    Inputs:
+ *        z:          The Zarr store
+ *        driver:     The driver info
+ *        preproc:    The block of SEVIRI data
+ *        i_line:     Line of the image at which the block starts
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_sev_zarr(const struct zarr_out *z,struct driver_data driver,
+                        struct seviri_preproc_data preproc,unsigned int i_line)
+{
+     int i, status;
+     double *time;
+
+     for (i=0;i<preproc.n_bands;i++)
+          if (put_zarr_var(z,z->names[i],i_line,preproc.n_lines,preproc.data[i],driver.bandprec,
+                           get_band_range(driver.outtype[i]),preproc.fill_value)) {E_L_R();}
+
+     if(driver.ancsave[0]==1) {
+          if (driver.linetime==1)
+               status=put_zarr_data(z,anc_outnames[0],1,i_line,preproc.n_lines,
+                                    preproc.time_line,sizeof(double));
+          else {
+               if ((time = get_time_image(preproc)) == NULL) {E_L_R();}
+               status=put_zarr_data(z,anc_outnames[0],2,i_line,preproc.n_lines,
+                                    time,sizeof(double));
+               free(time);
+          }
+          if (status) {E_L_R();}
+     }
+     for (i=1;i<7;i++) {
+          if(driver.ancsave[i]==1)
+               if (put_zarr_var(z,anc_outnames[i],i_line,preproc.n_lines,get_anc_data(preproc,i),
+                                driver.ancprec[i],anc_ranges[i],preproc.fill_value)) {E_L_R();}
+     }
+
+     return 0;
+}
+
+static void close_sev_zarr(struct zarr_out *z)
+{
+     free(z->names);
+     free(z->dir);
+     free(z);
+}
+
+/*******************************************************************************
+ *    An RGB composite output file, PNG or TIFF, written a block of lines at a
+ *    time as the blocks are processed.
+ ******************************************************************************/
+struct rgb_out {
+     int             outfrmt;
+     struct seviri_composite_data comp;
+     unsigned int    n_lines;
+     unsigned int    n_columns;
+     unsigned int    i_line;            /* lines written */
+     /* The composite of a block of lines */
+     unsigned char   *rgb;
+     unsigned int    rgb_lines;
+     /* PNG: the file and the deflate stream, written as IDAT chunks */
+     FILE            *fp;
+     z_stream        strm;
+     int             strm_init;
+     unsigned char   *idat;
+     /* TIFF */
+     TIFF            *tif;
+};
+
+/*******************************************************************************
+ *    Writes a chunk of a PNG file: its length, type, data and CRC.
+ ******************************************************************************/
+static int put_png_chunk(FILE *fp,const char *type,const unsigned char *data,size_t n)
+{
+     unsigned char len[4];
+     uLong crc;
+
+     len[0] = n >> 24 & 0xFF;
+     len[1] = n >> 16 & 0xFF;
+     len[2] = n >>  8 & 0xFF;
+     len[3] = n       & 0xFF;
+
+     crc = crc32(0L,(const Bytef*) type,4);
+     if (n>0) crc = crc32(crc,data,n);
+
+     if (fwrite(len,1,4,fp)!=4 || fwrite(type,1,4,fp)!=4 ||
+         (n>0 && fwrite(data,1,n,fp)!=n)) {E_L_R();}
+
+     len[0] = crc >> 24 & 0xFF;
+     len[1] = crc >> 16 & 0xFF;
+     len[2] = crc >>  8 & 0xFF;
+     len[3] = crc       & 0xFF;
+     if (fwrite(len,1,4,fp)!=4) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Deflates data into the image data of a PNG file, writing an IDAT chunk
+ *    each time the output buffer is full and the rest of the stream when
+ *    finished.
+ *    Inputs:
+ *        r:          The composite file
+ *        data:       The data, the filter type byte and pixels of a line
+ *        n:          Number of bytes of data
+ *        flush:      Z_NO_FLUSH, or Z_FINISH at the end of the image
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_png_data(struct rgb_out *r,const unsigned char *data,size_t n,int flush)
+{
+     int status;
+
+     r->strm.next_in  = (Bytef*) data;
+     r->strm.avail_in = n;
+
+     for (;;) {
+          status = deflate(&r->strm,flush);
+          if (status==Z_STREAM_ERROR) {E_L_R();}
+
+          if (r->strm.avail_out==0) {
+               if (put_png_chunk(r->fp,"IDAT",r->idat,RGB_PNG_IDAT_SIZE)) {E_L_R();}
+               r->strm.next_out  = r->idat;
+               r->strm.avail_out = RGB_PNG_IDAT_SIZE;
+               continue;
+          }
+
+          if (flush==Z_FINISH ? status==Z_STREAM_END : r->strm.avail_in==0) break;
+     }
+
+     if (flush==Z_FINISH && r->strm.avail_out<RGB_PNG_IDAT_SIZE)
+          if (put_png_chunk(r->fp,"IDAT",r->idat,RGB_PNG_IDAT_SIZE-r->strm.avail_out)) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Closes a composite file created with open_sev_rgb(), finishing it if all
+ *    its lines were written.
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int close_sev_rgb(struct rgb_out *r)
+{
+     int status = 0;
+
+     if (r->i_line!=r->n_lines) status = -1;
+
+     if (r->fp) {
+          if (status==0 && put_png_data(r,NULL,0,Z_FINISH)) status = -1;
+          if (status==0 && put_png_chunk(r->fp,"IEND",NULL,0)) status = -1;
+          if (fclose(r->fp)!=0) status = -1;
+     }
+     if (r->strm_init) deflateEnd(&r->strm);
+     if (r->tif) TIFFClose(r->tif);
+
+     free(r->idat);
+     free(r->rgb);
+     free(r);
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Creates an RGB composite file, named after the output file of the driver
+ *    with the name of the composite in place of its extension, to be written
+ *    a block of lines at a time with put_sev_rgb() and closed with
+ *    close_sev_rgb(). PNG files are 8 bit RGB images deflated as a single
+ *    stream and TIFF files are deflated with the horizontal predictor in
+ *    strips of RGB_TIFF_STRIP lines.
+ *    Inputs:
+ *        driver:     The driver info
+ *        type:       The composite
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *    Outputs:
+ *        rgb_out*:   The composite file, NULL on failure
+ ******************************************************************************/
+static struct rgb_out *open_sev_rgb(struct driver_data driver,enum seviri_composite type,
+                                    unsigned int n_lines,unsigned int n_columns)
+{
+     char *fname, *ext;
+     unsigned char ihdr[13];
+     struct rgb_out *r;
+
+     r = (struct rgb_out*) calloc(1,sizeof(struct rgb_out));
+     r->outfrmt   = driver.rgb[type];
+     r->n_lines   = n_lines;
+     r->n_columns = n_columns;
+
+     if (seviri_composite_init(&r->comp,type,driver.sev_bands.nbands,driver.sev_bands.band_ids,
+                               driver.outtype)) {free(r);return NULL;}
+
+     /* The file name, the extension of the output file replaced */
+     fname = (char*) malloc(strlen(driver.outf)+strlen(seviri_composite_name(type))+6);
+     strcpy(fname,driver.outf);
+     if ((ext = strrchr(fname,'.')) != NULL) *ext = '\0';
+     strcat(fname,"_");
+     strcat(fname,seviri_composite_name(type));
+     strcat(fname,r->outfrmt==SEVIRI_RGB_PNG ? ".png" : ".tif");
+
+     if (r->outfrmt==SEVIRI_RGB_PNG) {
+          r->idat = (unsigned char*) malloc(RGB_PNG_IDAT_SIZE);
+          if (r->idat==NULL || deflateInit(&r->strm,OUT_DEFLATE_LEVEL)!=Z_OK) {
+               fprintf(stderr,"ERROR: Unable to set up the deflate stream of %s\n",fname);
+               free(fname);
+               close_sev_rgb(r);
+               return NULL;
+          }
+          r->strm_init      = 1;
+          r->strm.next_out  = r->idat;
+          r->strm.avail_out = RGB_PNG_IDAT_SIZE;
+
+          if ((r->fp = fopen(fname,"wb")) == NULL) {
+               fprintf(stderr,"ERROR: Unable to create %s: %s\n",fname,strerror(errno));
+               free(fname);
+               close_sev_rgb(r);
+               return NULL;
+          }
+
+          /* Width, height, 8 bits per sample, RGB, deflate, no interlace */
+          memset(ihdr,0,13);
+          ihdr[0]  = n_columns >> 24 & 0xFF;
+          ihdr[1]  = n_columns >> 16 & 0xFF;
+          ihdr[2]  = n_columns >>  8 & 0xFF;
+          ihdr[3]  = n_columns       & 0xFF;
+          ihdr[4]  = n_lines   >> 24 & 0xFF;
+          ihdr[5]  = n_lines   >> 16 & 0xFF;
+          ihdr[6]  = n_lines   >>  8 & 0xFF;
+          ihdr[7]  = n_lines         & 0xFF;
+          ihdr[8]  = 8;
+          ihdr[9]  = 2;
+          if (fwrite("\211PNG\r\n\032\n",1,8,r->fp)!=8 || put_png_chunk(r->fp,"IHDR",ihdr,13)) {
+               free(fname);
+               close_sev_rgb(r);
+               return NULL;
+          }
+     }
+     else {
+          if ((r->tif = TIFFOpen(fname,"w")) == NULL) {
+               free(fname);
+               close_sev_rgb(r);
+               return NULL;
+          }
+          TIFFSetField(r->tif, TIFFTAG_IMAGEWIDTH, n_columns);
+          TIFFSetField(r->tif, TIFFTAG_IMAGELENGTH, n_lines);
+          TIFFSetField(r->tif, TIFFTAG_BITSPERSAMPLE, 8);
+          TIFFSetField(r->tif, TIFFTAG_SAMPLESPERPIXEL, 3);
+          TIFFSetField(r->tif, TIFFTAG_ROWSPERSTRIP, RGB_TIFF_STRIP);
+          TIFFSetField(r->tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+          TIFFSetField(r->tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+          TIFFSetField(r->tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+          TIFFSetField(r->tif, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+          TIFFSetField(r->tif, TIFFTAG_PREDICTOR, PREDICTOR_HORIZONTAL);
+     }
+
+     free(fname);
+
+     return r;
+}
+
+/*******************************************************************************
+ *    Produces the composite of a block of lines of the processed SEVIRI data
+ *    and writes it into a composite file created with open_sev_rgb(). Blocks
+ *    must be written in order.
+ *    Inputs:
+ *        r:          The composite file
+ *        preproc:    The block of SEVIRI data
+ *        i_line:     Line of the image at which the block starts
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_sev_rgb(struct rgb_out *r,struct seviri_preproc_data preproc,unsigned int i_line)
+{
+     unsigned int i;
+     size_t n_line;
+     unsigned char filter = 0;
+
+     if (i_line!=r->i_line) {
+          fprintf(stderr, "ERROR: Composite output must be written in order\n");
+          E_L_R();
+     }
+
+     n_line = (size_t) 3*r->n_columns;
+
+     if (preproc.n_lines>r->rgb_lines) {
+          free(r->rgb);
+          if ((r->rgb = (unsigned char*) malloc(n_line*preproc.n_lines)) == NULL) {E_L_R();}
+          r->rgb_lines = preproc.n_lines;
+     }
+
+     seviri_composite_lines(&r->comp,&preproc,0,preproc.n_lines,r->rgb);
+
+     for (i=0;i<preproc.n_lines;i++) {
+          if (r->fp) {
+               /* Each line is preceded by its filter type, none */
+               if (put_png_data(r,&filter,1,Z_NO_FLUSH)) {E_L_R();}
+               if (put_png_data(r,r->rgb+i*n_line,n_line,Z_NO_FLUSH)) {E_L_R();}
+          }
+          else if (TIFFWriteScanline(r->tif,r->rgb+i*n_line,r->i_line+i,0) < 0) {E_L_R();}
+     }
+
+     r->i_line += preproc.n_lines;
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    An output file of any format, written a block of lines at a time.
+ ******************************************************************************/
+struct sev_outfile {
+     int             outfrmt;
+     unsigned int    n_bands;
+     /* HDF5: the file, the datasets (bands, then one per ancsave product) */
+     hid_t           outfile;
+     hid_t           *datasets;
+     struct hdf_opts opts;
+     /* NetCDF: the file and the variables, as for the HDF5 datasets, and the
+        time slot written if a cube */
+     int             ncid;
+     int             *varid;
+     long            slot;
+     int             put_static;
+     /* TIFF */
+     struct tiff_out *tif;
+     /* Zarr */
+     struct zarr_out *zarr;
+     /* The RGB composites saved, if any */
+     struct rgb_out  *rgb[N_SEVIRI_COMPOSITES];
+};
+
+/*******************************************************************************
+ *    Creates the output file given by the driver, and a file for each RGB
+ *    composite it saves, to be written a block of lines at a time with
+ *    put_sev_out() and closed with close_sev_out().
+ *    Inputs:
+ *        driver:     The driver info
+ *        n_lines:    Number of lines of the image
+ *        n_columns:  Number of columns of the image
+ *        n_bands:    Number of bands of the image
+ *        fill_value: Fill value of the float data
+ *    Outputs:
+ *        sev_outfile*: The output file, NULL on failure
+ ******************************************************************************/
+struct sev_outfile *open_sev_out(struct driver_data driver,unsigned int n_lines,
+                                 unsigned int n_columns,unsigned int n_bands,float fill_value)
+{
+     int i, status;
+     struct sev_outfile *out;
+
+     out = (struct sev_outfile*) calloc(1,sizeof(struct sev_outfile));
+     out->outfrmt = driver.outfrmt;
+     out->n_bands = n_bands;
+
+     if (driver.outfrmt==SEVIRI_OUTFILE_HDF) {
+          out->opts.chunk[0]    = get_chunk_size(driver.chunk[0],n_lines);
+          out->opts.chunk[1]    = get_chunk_size(driver.chunk[1],n_columns);
+          out->opts.compression = driver.compression;
+          out->opts.n_threads   = get_n_threads(driver);
+
+          out->outfile  = -1;
+          out->datasets = (hid_t*) malloc(sizeof(hid_t)*(n_bands+7));
+          for (i=0;i<n_bands+7;i++) out->datasets[i]=-1;
+          pthread_mutex_lock(&out_mutex);
+          status = open_sev_hdf(driver,n_lines,n_columns,n_bands,fill_value,&out->opts,
+                                &out->outfile,out->datasets);
+          pthread_mutex_unlock(&out_mutex);
+          if (status) {close_sev_out(out);return NULL;}
+     }
+     if (driver.outfrmt==SEVIRI_OUTFILE_CDF) {
+          out->ncid  = -1;
+          out->varid = (int*) malloc(sizeof(int)*(n_bands+7));
+          pthread_mutex_lock(&out_mutex);
+          status = open_sev_cdf(driver,n_lines,n_columns,n_bands,fill_value,&out->ncid,out->varid,
+                                &out->slot,&out->put_static);
+          pthread_mutex_unlock(&out_mutex);
+          if (status) {close_sev_out(out);return NULL;}
+     }
+     if (driver.outfrmt==SEVIRI_OUTFILE_TIF) {
+          if ((out->tif = open_sev_tiff(driver,n_lines,n_columns,n_bands,fill_value)) == NULL) {
+               close_sev_out(out);
+               return NULL;
+          }
+     }
+     if (driver.outfrmt==SEVIRI_OUTFILE_ZARR) {
+          if ((out->zarr = open_sev_zarr(driver,n_lines,n_columns,n_bands,fill_value)) == NULL) {
+               close_sev_out(out);
+               return NULL;
+          }
+     }
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++) {
+          if (driver.rgb[i]==SEVIRI_RGB_NONE) continue;
+          if ((out->rgb[i] = open_sev_rgb(driver,i,n_lines,n_columns)) == NULL) {
+               close_sev_out(out);
+               return NULL;
+          }
+     }
+
+     return out;
+}
+
+/*******************************************************************************
+ *    Writes a block of lines of the processed SEVIRI data into an output file
+ *    created with open_sev_out(), and the RGB composites of the block into
+ *    their files. Blocks must be written in order for TIFF and composites
+ *    and cover whole rows of chunks for Zarr.
+ *    Inputs:
+ *        out:        The output file
+ *        driver:     The driver info
+ *        preproc:    The block of SEVIRI data
+ *        i_line:     Line of the image at which the block starts
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+int put_sev_out(struct sev_outfile *out,struct driver_data driver,
+                struct seviri_preproc_data preproc,unsigned int i_line)
+{
+     int i, status = 0;
+
+     /* put_sev_hdf() takes out_mutex itself, only around the calls to HDF5 */
+     if (out->outfrmt==SEVIRI_OUTFILE_HDF)
+          if (put_sev_hdf(out->datasets,&out->opts,driver,preproc,i_line)) {E_L_R();}
+     if (out->outfrmt==SEVIRI_OUTFILE_CDF) {
+          pthread_mutex_lock(&out_mutex);
+          status = put_sev_cdf(out->ncid,out->varid,driver,preproc,i_line,
+                               out->slot,out->put_static);
+          pthread_mutex_unlock(&out_mutex);
+          if (status) {E_L_R();}
+     }
+     if (out->outfrmt==SEVIRI_OUTFILE_TIF)
+          if (put_sev_tiff(out->tif,preproc,i_line)) {E_L_R();}
+     if (out->outfrmt==SEVIRI_OUTFILE_ZARR)
+          if (put_sev_zarr(out->zarr,driver,preproc,i_line)) {E_L_R();}
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++)
+          if (out->rgb[i]) if (put_sev_rgb(out->rgb[i],preproc,i_line)) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes the statistics of the bands collected during the processing (see
+ *    the stats member of struct seviri_options) into an output file created with
+ *    open_sev_out(), as attributes of the bands.
+ *    Inputs:
+ *        out:        The output file
+ *        stats:      The statistics of the bands of the whole image
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int put_sev_stats(struct sev_outfile *out,const struct seviri_stats_data *stats)
+{
+     int status = 0;
+
+     if (stats->band==NULL || stats->n_bands!=out->n_bands) {
+          fprintf(stderr,"ERROR: The band statistics were not collected\n");
+          E_L_R();
+     }
+
+     if (out->outfrmt==SEVIRI_OUTFILE_HDF) {
+          pthread_mutex_lock(&out_mutex);
+          status = put_hdf_stats(out->datasets,stats);
+          pthread_mutex_unlock(&out_mutex);
+     }
+     if (out->outfrmt==SEVIRI_OUTFILE_CDF) {
+          pthread_mutex_lock(&out_mutex);
+          status = put_cdf_stats(out->ncid,out->varid,stats);
+          pthread_mutex_unlock(&out_mutex);
+     }
+     if (out->outfrmt==SEVIRI_OUTFILE_ZARR)
+          status = put_zarr_stats(out->zarr,stats);
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Closes an output file created with open_sev_out().
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+int close_sev_out(struct sev_outfile *out)
+{
+     int i, status = 0;
+
+     pthread_mutex_lock(&out_mutex);
+     if (out->datasets) {
+          for (i=0;i<out->n_bands+7;i++)
+               if (out->datasets[i]>=0) H5Dclose(out->datasets[i]);
+          free(out->datasets);
+     }
+     if (out->outfrmt==SEVIRI_OUTFILE_HDF && out->outfile>=0)
+          if (H5Fclose(out->outfile) < 0) status = -1;
+
+     if (out->varid) {
+          if (out->ncid>=0) if(nc_close(out->ncid)) status = -1;
+          free(out->varid);
+     }
+     pthread_mutex_unlock(&out_mutex);
+
+     if (out->tif) if (close_sev_tiff(out->tif)) status = -1;
+
+     if (out->zarr) close_sev_zarr(out->zarr);
+
+     for (i=0;i<N_SEVIRI_COMPOSITES;i++)
+          if (out->rgb[i]) if (close_sev_rgb(out->rgb[i])) status = -1;
+
+     free(out);
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Writes the processed SEVIRI data (and any ancilliary data) into a TIFF,
+ *    NetCDF or HDF5 file or a Zarr store, see open_sev_tiff(), open_sev_cdf(),
+ *    open_sev_hdf() and open_sev_zarr() for the formats.
+ *    Inputs:
+ *        driver:     The float array that will contain the data
+ *        preproc:    Main structure that will contain the SEVIRI data
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+static int save_sev_out(struct driver_data driver,struct seviri_preproc_data preproc)
+{
+     struct sev_outfile *out;
+
+     if ((out = open_sev_out(driver,preproc.n_lines,preproc.n_columns,preproc.n_bands,
+                             preproc.fill_value)) == NULL) {E_L_R();}
+     if (put_sev_out(out,driver,preproc,0)) {close_sev_out(out);E_L_R();}
+     if (driver.stats==1)
+          if (put_sev_stats(out,&preproc.stats)) {close_sev_out(out);E_L_R();}
+     if (close_sev_out(out)) {E_L_R();}
+
+     return 0;
+}
+
+int save_sev_tiff(struct driver_data driver,struct seviri_preproc_data preproc)
+{
+     driver.outfrmt = SEVIRI_OUTFILE_TIF;
+     return save_sev_out(driver,preproc);
+}
+
+int save_sev_cdf(struct driver_data driver,struct seviri_preproc_data preproc)
+{
+     driver.outfrmt = SEVIRI_OUTFILE_CDF;
+     return save_sev_out(driver,preproc);
+}
+
+int save_sev_hdf(struct driver_data driver,struct seviri_preproc_data preproc)
+{
+     driver.outfrmt = SEVIRI_OUTFILE_HDF;
+     return save_sev_out(driver,preproc);
+}
+
+int save_sev_zarr(struct driver_data driver,struct seviri_preproc_data preproc)
+{
+     driver.outfrmt = SEVIRI_OUTFILE_ZARR;
+     return save_sev_out(driver,preproc);
+}
+
+/*******************************************************************************
+ *    A block of lines handed to the writer thread of run_sev_stream().
+ ******************************************************************************/
+struct stream_block {
+     struct sev_outfile          *out;
+     struct driver_data          driver;
+     struct seviri_preproc_data  preproc;
+     unsigned int                i_line;
+     int                         status;
+};
+
+/*******************************************************************************
+ *    Thread function writing a stream_block.
+ ******************************************************************************/
+static void *write_stream_block(void *arg)
+{
+     struct stream_block *b = (struct stream_block *) arg;
+
+     SU_PERF_TIMER(timer);
+
+     SU_PERF_START(&b->preproc.perf, timer);
+     b->status = put_sev_out(b->out,b->driver,b->preproc,b->i_line);
+     SU_PERF_STOP(&b->preproc.perf, timer, SEVIRI_PERF_WRITE,
+                  (ulong) b->preproc.n_bands * b->preproc.n_lines * b->preproc.n_columns, 0);
+
+     return NULL;
+}
+
+/*******************************************************************************
+ *    Initialises or frees a sev_out_turn.
+ ******************************************************************************/
+static void init_out_turn(struct sev_out_turn *t)
+{
+     t->next = 0;
+     t->n    = 0;
+     pthread_mutex_init(&t->mutex,NULL);
+     pthread_cond_init(&t->cond,NULL);
+}
+
+static void free_out_turn(struct sev_out_turn *t)
+{
+     pthread_mutex_destroy(&t->mutex);
+     pthread_cond_destroy(&t->cond);
+}
+
+/*******************************************************************************
+ *    Hands out the next turn to write the cube.
+ ******************************************************************************/
+static int take_out_turn(struct sev_out_turn *t)
+{
+     int i;
+
+     pthread_mutex_lock(&t->mutex);
+     i = t->n++;
+     pthread_mutex_unlock(&t->mutex);
+
+     return i;
+}
+
+/*******************************************************************************
+ *    Waits for the turn of a driver to write its cube, if it has one, which
+ *    lasts until end_out_turn().
+ ******************************************************************************/
+static void wait_out_turn(struct driver_data driver)
+{
+     struct sev_out_turn *t = driver.out_turn;
+
+     if (t==NULL) return;
+
+     pthread_mutex_lock(&t->mutex);
+     while (t->next!=driver.i_turn) pthread_cond_wait(&t->cond,&t->mutex);
+     pthread_mutex_unlock(&t->mutex);
+}
+
+/*******************************************************************************
+ *    Ends the turn of a driver, after waiting for it if it was not taken
+ *    because the slot failed, so that the next slot can write the cube.
+ ******************************************************************************/
+static void end_out_turn(struct driver_data driver)
+{
+     struct sev_out_turn *t = driver.out_turn;
+
+     if (t==NULL) return;
+
+     pthread_mutex_lock(&t->mutex);
+     while (t->next!=driver.i_turn) pthread_cond_wait(&t->cond,&t->mutex);
+     t->next++;
+     pthread_cond_broadcast(&t->cond);
+     pthread_mutex_unlock(&t->mutex);
+}
+
+/*******************************************************************************
+ *    Reads, processes and writes the SEVIRI data a block of driver.block
+ *    lines at a time. Each block is written by a writer thread while the next
+ *    is read and processed, so that at most two blocks are held in memory and
+ *    the output overlaps the computation. For compressed HDF5 and for Zarr
+ *    output blocks are rounded up to whole rows of chunks so that they can be
+ *    compressed in parallel. The band statistics of the blocks, if saved, are
+ *    merged into those of the image and written before the file is closed.
+ *
+ *    The blocks are read with line/column bounds, so full disk bounds can
+ *    only be streamed when the file covers the full disk.
+ *    Inputs:
+ *        driver:     Structure containing the driver info
+ *    Outputs:
+ *        perf:       The timing statistics of all the blocks
+ *        satposstr:  Information required for parallax correction
+ *        integer:    Returns 0 if successful, 1 if the data cannot be
+ *                    streamed, otherwise -1
+ ******************************************************************************/
+int run_sev_stream(struct driver_data driver,struct seviri_perf_data *perf,char satposstr[128])
+{
+     int i, status = 0, running = 0, have_block;
+     unsigned int i_line, i_column, n_lines, n_columns, i_line2, i_column2, n_lines2, n_columns2;
+     unsigned int n_block, l0;
+     struct sev_outfile *out = NULL;
+     struct driver_data blkdriver;
+     struct stream_block blocks[2];
+     struct seviri_stats_data stats = {0, NULL};
+     pthread_t writer;
+
+     /* The dimensions of the image, and for full disk bounds those of the
+        actual image which must be the same */
+     if (driver.infrmt==SEVIRI_INFILE_NAT) {
+          if (seviri_get_dimens_nat(driver.infdir,&i_line,&i_column,&n_lines,&n_columns,driver.bounds,
+                                    driver.iline,driver.fline,driver.icol,driver.fcol,0.,0.,0.,0.,NULL)) {E_L_R();}
+          if (driver.bounds==SEVIRI_BOUNDS_FULL_DISK &&
+              seviri_get_dimens_nat(driver.infdir,&i_line2,&i_column2,&n_lines2,&n_columns2,
+                                    SEVIRI_BOUNDS_ACTUAL_IMAGE,0,0,0,0,0.,0.,0.,0.,NULL)) {E_L_R();}
+     }
+     else {
+          if (seviri_get_dimens_hrit(driver.infdir,driver.timeslot,driver.satnum,&i_line,&i_column,
+                                     &n_lines,&n_columns,driver.bounds,driver.iline,driver.fline,
+                                     driver.icol,driver.fcol,0.,0.,0.,0.,driver.rss)) {E_L_R();}
+          if (driver.bounds==SEVIRI_BOUNDS_FULL_DISK &&
+              seviri_get_dimens_hrit(driver.infdir,driver.timeslot,driver.satnum,&i_line2,&i_column2,
+                                     &n_lines2,&n_columns2,SEVIRI_BOUNDS_ACTUAL_IMAGE,0,0,0,0,
+                                     0.,0.,0.,0.,driver.rss)) {E_L_R();}
+     }
+     if (driver.bounds==SEVIRI_BOUNDS_FULL_DISK && (n_lines2!=n_lines || n_columns2!=n_columns))
+          return 1;
+
+     n_block = driver.block;
+     if ((driver.outfrmt==SEVIRI_OUTFILE_HDF && driver.compression==1) ||
+         driver.outfrmt==SEVIRI_OUTFILE_ZARR) {
+          l0 = get_chunk_size(driver.chunk[0],n_lines);
+          n_block = (n_block + l0 - 1) / l0 * l0;
+     }
+
+     seviri_perf_init(perf);
+
+     blkdriver        = driver;
+     blkdriver.bounds = SEVIRI_BOUNDS_LINE_COLUMN;
+     blkdriver.icol   = i_column;
+     blkdriver.fcol   = i_column + n_columns - 1;
+
+     for (l0=0,i=0;l0<n_lines && status==0;l0+=n_block,i=!i) {
+          blkdriver.iline = i_line + l0;
+          blkdriver.fline = i_line + (l0 + n_block < n_lines ? l0 + n_block : n_lines) - 1;
+
+          if (driver.infrmt==SEVIRI_INFILE_NAT) status=run_sev_native(blkdriver,&blocks[i].preproc,satposstr);
+          else                                  status=run_sev_hrit  (blkdriver,&blocks[i].preproc,satposstr);
+          have_block = status==0;
+
+          /* Wait for the previous block to be written before writing this one */
+          if (running) {
+               pthread_join(writer,NULL);
+               running = 0;
+               if (blocks[!i].status!=0) status = -1;
+               seviri_perf_add(perf,&blocks[!i].preproc.perf);
+               if (seviri_stats_add(&stats,&blocks[!i].preproc.stats)) status = -1;
+               seviri_preproc_free(&blocks[!i].preproc);
+          }
+          if (status!=0) {
+               /* The block was read but the previous one failed to be written */
+               if (have_block) seviri_preproc_free(&blocks[i].preproc);
+               break;
+          }
+
+          /* The output is created once the fill value is known, in the turn of
+             the slot if it appends to a cube */
+          if (out==NULL) wait_out_turn(driver);
+          if (out==NULL && (out = open_sev_out(driver,n_lines,n_columns,driver.sev_bands.nbands,
+                                               blocks[i].preproc.fill_value)) == NULL) {
+               seviri_preproc_free(&blocks[i].preproc);
+               status = -1;
+               break;
+          }
+
+          blocks[i].out     = out;
+          blocks[i].driver  = driver;
+          blocks[i].i_line  = l0;
+          blocks[i].status  = 0;
+          if (pthread_create(&writer,NULL,write_stream_block,&blocks[i])==0)
+               running = 1;
+          else {
+               write_stream_block(&blocks[i]);
+               if (blocks[i].status!=0) status = -1;
+               seviri_perf_add(perf,&blocks[i].preproc.perf);
+               if (seviri_stats_add(&stats,&blocks[i].preproc.stats)) status = -1;
+               seviri_preproc_free(&blocks[i].preproc);
+          }
+     }
+
+     if (running) {
+          pthread_join(writer,NULL);
+          if (blocks[!i].status!=0) status = -1;
+          seviri_perf_add(perf,&blocks[!i].preproc.perf);
+          if (seviri_stats_add(&stats,&blocks[!i].preproc.stats)) status = -1;
+          seviri_preproc_free(&blocks[!i].preproc);
+     }
+
+     /* The statistics of the blocks are merged into those of the image */
+     if (out && status==0 && driver.stats==1 && put_sev_stats(out,&stats)) status = -1;
+     seviri_stats_free(&stats);
+
+     if (out && close_sev_out(out)) status = -1;
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Does the work of run_sev_slot().
+ ******************************************************************************/
+static int process_sev_slot(struct driver_data driver,struct seviri_perf_data *perf)
+{
+     /* This struct will contain the image data and some metadata. */
+     struct seviri_preproc_data preproc;
+
+     /* Char array to store information required for parallax correction */
+     char satposstr[128];
+
+     int status;
+
+     SU_PERF_TIMER(timer);
+
+     if (VERBOSE) if (print_driver(driver)!=0) {E_L_R();}
+
+     /* Stream the image a block of lines at a time if requested and possible */
+     if (driver.block>0) {
+          status = run_sev_stream(driver, perf, satposstr);
+          if (status<0) {E_L_R();}
+          if (status==0) return 0;
+          printf("The file does not cover the full disk, will not stream the image\n");
+     }
+
+     /* Run the appropriate processing chain, HRIT or NAT */
+     if (driver.infrmt==SEVIRI_INFILE_HRIT) if (run_sev_hrit(driver,&preproc, satposstr)!=0) {E_L_R();}
+     if (driver.infrmt==SEVIRI_INFILE_NAT) if (run_sev_native(driver,&preproc, satposstr)!=0) {E_L_R();}
+
+     /* If we're in verbose mode then print info about a sample pixel in the preprocessed data
+        By default we'll examine the central pixel in the image */
+     if (VERBOSE) if (print_preproc_out(driver, preproc, preproc.n_lines/2-1, preproc.n_columns/2-1)!=0) {seviri_preproc_free(&preproc);E_L_R();}
+
+     SU_PERF_START(&preproc.perf, timer);
+     wait_out_turn(driver);
+     status = save_sev_out(driver,preproc);
+     SU_PERF_STOP(&preproc.perf, timer, SEVIRI_PERF_WRITE,
+                  (ulong) preproc.n_bands * preproc.n_lines * preproc.n_columns, 0);
+     *perf = preproc.perf;
+
+     /* Free memory allocated by seviri_read_and_preproc(). */
+     if (seviri_preproc_free(&preproc)!=0) {E_L_R();}
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    Processes the time slot described by a driver: reads, processes and
+ *    writes it, streamed a block of lines at a time if requested. If the
+ *    driver has a turn to write its cube (see driver.out_turn) the output is
+ *    only opened, written and closed in that turn.
+ *    Inputs:
+ *        driver:     Structure containing the driver info
+ *    Outputs:
+ *        perf:       The timing statistics of the slot
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+int run_sev_slot(struct driver_data driver,struct seviri_perf_data *perf)
+{
+     int status;
+
+     status = process_sev_slot(driver,perf);
+
+     end_out_turn(driver);
+
+     if (status!=0) {E_L_R();}
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    The drivers of a batch, handed out one at a time to the threads of
+ *    run_sev_batch().
+ ******************************************************************************/
+struct sev_batch {
+     struct driver_data *drivers;
+     int                n_drivers;
+     int                next;
+     int                n_failed;
+     pthread_mutex_t    mutex;
+     /* Turns of the drivers appending to a cube, in driver order */
+     struct sev_out_turn out_turn;
+};
+
+/*******************************************************************************
+ *    Thread function processing the drivers of a batch until there are none
+ *    left.
+ ******************************************************************************/
+static void *run_batch_slots(void *arg)
+{
+     int i, status;
+     struct sev_batch *b = (struct sev_batch *) arg;
+     struct seviri_perf_data perf;
+
+     for (;;) {
+          pthread_mutex_lock(&b->mutex);
+          i = b->next++;
+          pthread_mutex_unlock(&b->mutex);
+          if (i>=b->n_drivers) break;
+
+          status = run_sev_slot(b->drivers[i],&perf);
+
+          if (status==0 && b->drivers[i].perf==1) {
+               flockfile(stdout);
+               status = seviri_perf_print_json(stdout,&perf);
+               funlockfile(stdout);
+          }
+
+          if (status!=0) {
+               fprintf(stderr,"ERROR: Failed to process driver %d, %s\n",i+1,b->drivers[i].infdir);
+               pthread_mutex_lock(&b->mutex);
+               b->n_failed++;
+               pthread_mutex_unlock(&b->mutex);
+          }
+     }
+
+     return NULL;
+}
+
+/*******************************************************************************
+ *    Locks or unlocks the navigation cache shared by the slots of a batch or
+ *    the jobs of a daemon.
+ ******************************************************************************/
+static void lock_nav_cache(void *data,int lock)
+{
+     if (lock) pthread_mutex_lock((pthread_mutex_t *) data);
+     else      pthread_mutex_unlock((pthread_mutex_t *) data);
+}
+
+/*******************************************************************************
+ *    The number of threads compressing the output of each of n_slots slots
+ *    processed at a time, so that they share out the processors, or 0 for
+ *    the default of one per processor if only one slot is processed.
+ ******************************************************************************/
+static int get_slot_threads(int n_slots)
+{
+     int n;
+
+     if (n_slots<=1) return 0;
+
+     n = sysconf(_SC_NPROCESSORS_ONLN) / n_slots;
+
+     return n>0 ? n : 1;
+}
+
+/*******************************************************************************
+ *    Processes the time slots described by a list of drivers in one process,
+ *    at most n_slots at a time. The latitude and longitude images are
+ *    computed once for each set of bounds and shared by all the slots through
+ *    the nav_cache of their drivers, and by default the threads compressing
+ *    the output are shared out between the slots. The slots appending to a
+ *    cube write it in turn, in driver order. A slot that fails is reported
+ *    and the others are still processed.
+ *    Inputs:
+ *        drivers:    The driver info of each slot
+ *        n_drivers:  Number of drivers
+ *        n_slots:    Number of slots processed at a time
+ *    Outputs:
+ *        integer:    Returns 0 if all the slots were processed, otherwise -1
+ ******************************************************************************/
+int run_sev_batch(struct driver_data *drivers,int n_drivers,int n_slots)
+{
+     int i, n_threads, n_running = 0;
+     struct sev_batch b;
+     struct seviri_nav_cache nav_cache;
+     pthread_mutex_t nav_mutex = PTHREAD_MUTEX_INITIALIZER;
+     pthread_t *threads;
+
+     if (n_slots>n_drivers) n_slots = n_drivers;
+     if (n_slots<1) n_slots = 1;
+
+     /* Share the processors out between the slots */
+     n_threads = get_slot_threads(n_slots);
+     for (i=0;i<n_drivers;i++)
+          if (drivers[i].threads==0) drivers[i].threads = n_threads;
+
+     if (n_drivers>1) {
+          seviri_nav_cache_init(&nav_cache,BATCH_NAV_CACHE_SIZE,n_slots>1 ? lock_nav_cache : NULL,&nav_mutex);
+          for (i=0;i<n_drivers;i++) drivers[i].nav_cache = &nav_cache;
+     }
+
+     b.drivers   = drivers;
+     b.n_drivers = n_drivers;
+     b.next      = 0;
+     b.n_failed  = 0;
+     pthread_mutex_init(&b.mutex,NULL);
+     init_out_turn(&b.out_turn);
+     for (i=0;i<n_drivers;i++) {
+          if (!drivers[i].append) continue;
+          drivers[i].out_turn = &b.out_turn;
+          drivers[i].i_turn   = take_out_turn(&b.out_turn);
+     }
+
+     threads = (pthread_t*) malloc(sizeof(pthread_t)*n_slots);
+     for (i=1;i<n_slots;i++)
+          if (pthread_create(&threads[n_running],NULL,run_batch_slots,&b)==0) n_running++;
+
+     run_batch_slots(&b);
+
+     for (i=0;i<n_running;i++) pthread_join(threads[i],NULL);
+     free(threads);
+
+     pthread_mutex_destroy(&b.mutex);
+     free_out_turn(&b.out_turn);
+     for (i=0;i<n_drivers;i++) drivers[i].out_turn = NULL;
+
+     if (n_drivers>1) {
+          for (i=0;i<n_drivers;i++) drivers[i].nav_cache = NULL;
+          seviri_nav_cache_free(&nav_cache);
+     }
+
+     if (b.n_failed>0) {
+          fprintf(stderr,"ERROR: %d of %d drivers failed\n",b.n_failed,n_drivers);
+          E_L_R();
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    State shared by the threads of run_sev_daemon().
+ ******************************************************************************/
+struct sev_daemon {
+     int                fd;
+     int                n_slots;
+     /* Cache of the latitude and longitude images shared by the jobs */
+     struct seviri_nav_cache *nav_cache;
+     /* Turns of the jobs appending to a cube, in the order they are received */
+     struct sev_out_turn out_turn;
+};
+
+/*******************************************************************************
+ *    Runs the job sent over a connection to run_sev_daemon(): reads the
+ *    driver until the client shuts down its side of the connection, runs it
+ *    and replies with the status and timings.
+ ******************************************************************************/
+static void run_daemon_job(struct sev_daemon *d,int fd)
+{
+     int status = -1;
+     double wall;
+     struct driver_data driver;
+     struct seviri_perf_data perf;
+     struct timespec t0, t1;
+     FILE *in, *out;
+
+     clock_gettime(CLOCK_MONOTONIC,&t0);
+
+     if ((in = fdopen(fd,"r")) == NULL) {close(fd);return;}
+     if ((out = fdopen(dup(fd),"w")) == NULL) {fclose(in);return;}
+
+     memset(&driver,0,sizeof(struct driver_data));
+     if (parse_driver_fp(in,"<job>",&driver)==0) {
+          if (driver.threads==0) driver.threads = get_slot_threads(d->n_slots);
+          driver.nav_cache = d->nav_cache;
+          if (driver.append) {
+               driver.out_turn = &d->out_turn;
+               driver.i_turn   = take_out_turn(&d->out_turn);
+          }
+
+          status = run_sev_slot(driver,&perf);
+     }
+     free_driver(&driver);
+
+     clock_gettime(CLOCK_MONOTONIC,&t1);
+     wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1.e9;
+
+     fprintf(out,"{\"status\": %d, \"wall\": %.6f",status,wall);
+     if (status==0 && driver.perf==1) {
+          fprintf(out,", \"perf\": ");
+          seviri_perf_print_json(out,&perf);
+     }
+     fprintf(out,"}\n");
+
+     fclose(out);
+     fclose(in);
+}
+
+/*******************************************************************************
+ *    Thread function accepting and running jobs until the socket is shut
+ *    down.
+ ******************************************************************************/
+static void *run_daemon_jobs(void *arg)
+{
+     int fd;
+     struct sev_daemon *d = (struct sev_daemon *) arg;
+     struct timeval timeout = {DAEMON_RECV_TIMEOUT, 0};
+
+     for (;;) {
+          if ((fd = accept(d->fd,NULL,NULL)) < 0) {
+               if (errno==EINTR || errno==ECONNABORTED) continue;
+               break;
+          }
+          /* A client that never ends its job must not hold the thread */
+          if (setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(struct timeval)) < 0) {
+               close(fd);
+               continue;
+          }
+          run_daemon_job(d,fd);
+     }
+
+     return NULL;
+}
+
+/*******************************************************************************
+ *    Runs SEVIRI_util as a resident service accepting jobs over a Unix domain
+ *    socket, until it receives SIGINT or SIGTERM, after which the running
+ *    jobs are finished and the socket is removed. A job is a driver, as in a
+ *    driver file, sent over a connection to the socket and ended by shutting
+ *    down the sending side of the connection. A job fails if nothing is
+ *    received for DAEMON_RECV_TIMEOUT seconds before it ends. The reply is one JSON object
+ *    with the status of the job (0 if successful, otherwise -1), its wall
+ *    time in seconds and, if the driver contains a perf line, its timing
+ *    statistics. At most n_slots jobs are run at a time and, as in
+ *    run_sev_batch(), they share the latitude and longitude images, which
+ *    are kept for the life of the daemon, and the processors.
+ *    Inputs:
+ *        path:       Path of the socket, which must not exist
+ *        n_slots:    Number of jobs run at a time
+ *    Outputs:
+ *        integer:    Returns 0 if successful, otherwise -1
+ ******************************************************************************/
+int run_sev_daemon(const char *path,int n_slots)
+{
+     int i, sig, n_running = 0;
+     struct sev_daemon d;
+     struct sockaddr_un addr;
+     struct seviri_nav_cache nav_cache;
+     pthread_mutex_t nav_mutex = PTHREAD_MUTEX_INITIALIZER;
+     pthread_t *threads;
+     sigset_t sigs;
+
+     if (n_slots<1) n_slots = 1;
+
+     if (strlen(path)>=sizeof(addr.sun_path)) {
+          fprintf(stderr,"ERROR: Socket path is too long: %s\n",path);
+          E_L_R();
+     }
+
+     /* The signals ending the daemon are only received by sigwait() below, and
+        clients going away must not end it */
+     sigemptyset(&sigs);
+     sigaddset(&sigs,SIGINT);
+     sigaddset(&sigs,SIGTERM);
+     pthread_sigmask(SIG_BLOCK,&sigs,NULL);
+     signal(SIGPIPE,SIG_IGN);
+
+     memset(&addr,0,sizeof(struct sockaddr_un));
+     addr.sun_family = AF_UNIX;
+     strcpy(addr.sun_path,path);
+
+     if ((d.fd = socket(AF_UNIX,SOCK_STREAM,0)) < 0) {
+          fprintf(stderr,"ERROR: socket(): %s\n",strerror(errno));
+          E_L_R();
+     }
+     if (bind(d.fd,(struct sockaddr *) &addr,sizeof(struct sockaddr_un)) < 0) {
+          fprintf(stderr,"ERROR: Unable to bind the socket %s: %s\n",path,strerror(errno));
+          close(d.fd);
+          E_L_R();
+     }
+     if (listen(d.fd,SOMAXCONN) < 0) {
+          fprintf(stderr,"ERROR: listen(): %s\n",strerror(errno));
+          close(d.fd);
+          unlink(path);
+          E_L_R();
+     }
+
+     seviri_nav_cache_init(&nav_cache,BATCH_NAV_CACHE_SIZE,lock_nav_cache,&nav_mutex);
+     d.nav_cache = &nav_cache;
+
+     d.n_slots = n_slots;
+     init_out_turn(&d.out_turn);
+
+     threads = (pthread_t*) malloc(sizeof(pthread_t)*n_slots);
+     for (i=0;i<n_slots;i++)
+          if (pthread_create(&threads[n_running],NULL,run_daemon_jobs,&d)==0) n_running++;
+
+     if (n_running>0) {
+          printf("Accepting jobs on %s\n",path);
+          fflush(stdout);
+          sigwait(&sigs,&sig);
+          printf("Received signal %d, finishing the running jobs\n",sig);
+     }
+
+     /* Wake the threads waiting in accept() */
+     shutdown(d.fd,SHUT_RDWR);
+     for (i=0;i<n_running;i++) pthread_join(threads[i],NULL);
+     free(threads);
+
+     close(d.fd);
+     unlink(path);
+
+     free_out_turn(&d.out_turn);
+
+     seviri_nav_cache_free(&nav_cache);
+
+     if (n_running==0) {
+          fprintf(stderr,"ERROR: Unable to start the threads running jobs\n");
+          E_L_R();
+     }
+
+     return 0;
+}
+
+/*******************************************************************************
+ *    The line blocks of a Native file, handed out one at a time to the
+ *    threads of run_sev_monitor().
+ ******************************************************************************/
+struct sev_monitor {
+     char                     *fname;
+     unsigned int             n_lines;
+     unsigned int             next;
+     int                      n_failed;
+     struct seviri_stats_data stats;
+     pthread_mutex_t          mutex;
+};
+
+/*******************************************************************************
+ *    Thread function collecting the count statistics of the line blocks of a
+ *    file until there are none left, then merging them into those of the
+ *    file.
+ ******************************************************************************/
+static void *run_monitor_blocks(void *arg)
+{
+     unsigned int line0, band_ids[SEVIRI_N_BANDS];
+     int i, status = 0;
+     struct sev_monitor *m = (struct sev_monitor *) arg;
+     struct seviri_stats_data stats = {0, NULL}, block;
+
+     for (i=0;i<SEVIRI_N_BANDS;i++) band_ids[i] = i+1;
+
+     for (;;) {
+          pthread_mutex_lock(&m->mutex);
+          line0 = m->next;
+          m->next += MONITOR_BLOCK_LINES;
+          pthread_mutex_unlock(&m->mutex);
+          if (line0>=m->n_lines) break;
+
+          if (seviri_count_stats_nat(m->fname,SEVIRI_N_BANDS,band_ids,line0,
+                                     line0+MONITOR_BLOCK_LINES-1,&block,NULL)!=0) {status = -1;break;}
+          status = seviri_stats_add(&stats,&block);
+          seviri_stats_free(&block);
+          if (status!=0) break;
+     }
+
+     pthread_mutex_lock(&m->mutex);
+     if (status==0) status = seviri_stats_add(&m->stats,&stats);
+     if (status!=0) m->n_failed++;
+     pthread_mutex_unlock(&m->mutex);
+
+     seviri_stats_free(&stats);
+
+     return NULL;
+}
+
+/*******************************************************************************
+ *    Prints the count statistics of a file as a line of JSON.
+ ******************************************************************************/
+static void print_monitor_json(const char *fname,const struct seviri_stats_data *stats)
+{
+     unsigned int i, j;
+     const struct seviri_band_stats *s;
+
+     printf("{\"file\": \"%s\", \"bands\": [",fname);
+     for (i=0;i<stats->n_bands;i++) {
+          s = &stats->band[i];
+          printf("%s{\"band\": %u, \"n_pixels\": %lu, \"fill_fraction\": %.9g, "
+                 "\"minimum\": %.9g, \"maximum\": %.9g, \"mean\": %.9g, "
+                 "\"stddev\": %.9g, \"count_histogram\": [",i>0 ? ", " : "",
+                 i+1,s->n_pixels,seviri_stats_fill_fraction(s),s->min,s->max,
+                 s->mean,seviri_stats_std(s));
+          for (j=0;j<SEVIRI_STATS_N_COUNTS;j++) printf("%s%lu",j>0 ? ", " : "",s->hist[j]);
+          printf("]}");
+     }
+     printf("]}\n");
+}
+
+/*******************************************************************************
+ *    Monitors the radiometry of Native files, printing for each a line of
+ *    JSON with the statistics and histogram of the raw counts of every band
+ *    (see seviri_count_stats_nat()). The images are not calibrated or even
+ *    held in memory, the line records are unpacked straight into the
+ *    statistics, and the blocks of lines of each file are shared out between
+ *    n_slots threads. A file that fails is reported and the others are still
+ *    processed.
+ *    Inputs:
+ *        fnames:     The Native files
+ *        n_files:    Number of files
+ *        n_slots:    Number of threads collecting the statistics of a file
+ *    Outputs:
+ *        integer:    Returns 0 if all the files were processed, otherwise -1
+ ******************************************************************************/
+int run_sev_monitor(char **fnames,int n_files,int n_slots)
+{
+     unsigned int i_line, i_column, n_columns;
+     int i, j, n_running, n_failed = 0;
+     struct sev_monitor m;
+     pthread_t *threads;
+
+     pthread_mutex_init(&m.mutex,NULL);
+     threads = (pthread_t*) malloc(sizeof(pthread_t)*n_slots);
+
+     for (i=0;i<n_files;i++) {
+          m.fname         = fnames[i];
+          m.next          = 0;
+          m.n_failed      = 0;
+          m.stats.n_bands = 0;
+          m.stats.band    = NULL;
+
+          if (seviri_get_dimens_nat(fnames[i],&i_line,&i_column,&m.n_lines,&n_columns,
+                                    SEVIRI_BOUNDS_ACTUAL_IMAGE,0,0,0,0,0.,0.,0.,0.,NULL)!=0) m.n_failed++;
+          else {
+               n_running = 0;
+               for (j=1;j<n_slots;j++)
+                    if (pthread_create(&threads[n_running],NULL,run_monitor_blocks,&m)==0) n_running++;
+
+               run_monitor_blocks(&m);
+
+               for (j=0;j<n_running;j++) pthread_join(threads[j],NULL);
+          }
+
+          if (m.n_failed==0 && m.stats.band) print_monitor_json(fnames[i],&m.stats);
+          else {
+               fprintf(stderr,"ERROR: Failed to monitor file %d, %s\n",i+1,fnames[i]);
+               n_failed++;
+          }
+
+          seviri_stats_free(&m.stats);
+     }
+
+     free(threads);
+     pthread_mutex_destroy(&m.mutex);
+
+     if (n_failed>0) {
+          fprintf(stderr,"ERROR: %d of %d files failed\n",n_failed,n_files);
+          E_L_R();
      }
 
-     /* Set up dataspaces for the ancilliary data and write to the file.*/
-     if(driver.ancsave[0]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"Time",H5T_NATIVE_DOUBLE,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_DOUBLE,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.time[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-     if(driver.ancsave[1]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"Latitude",H5T_NATIVE_FLOAT,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.lat[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-     if(driver.ancsave[2]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"Longitude",H5T_NATIVE_FLOAT,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.lon[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-     if(driver.ancsave[3]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"Solar Zenith Angle",H5T_NATIVE_FLOAT,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.sza[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-     if(driver.ancsave[4]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"Solar Azimuth Angle",H5T_NATIVE_DOUBLE,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.saa[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-     if(driver.ancsave[5]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"View Zenith Angle",H5T_NATIVE_FLOAT,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.vza[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-     if(driver.ancsave[6]==1) {
-          dataspace=H5Screate_simple(2,dims,dims);
-          dataset=H5Dcreate2(outfile,"View Azimuth Angle",H5T_NATIVE_FLOAT,dataspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
-          status=H5Dwrite(dataset,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,&preproc.vaa[0]);
-          status=H5Sclose(dataspace);
-          status=H5Dclose(dataset);
-          i++;
-     }
-
-     /* Now we are done, so close the file*/
-     status=H5Fclose(outfile);
      return 0;
 }
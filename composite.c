@@ -0,0 +1,197 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#include "external.h"
+#include "internal.h"
+#include "composite.h"
+
+
+/*******************************************************************************
+ * The recipe of a composite: for each of the red, green and blue channels the
+ * band IDs of the band and of the band subtracted from it (0 for none), the
+ * value of the channel mapped to 0 and to 255, which is decreasing for an
+ * inverted channel, and the gamma.  These are the EUMETSAT recipes with
+ * reflectances as fractions and brightness temperatures in K.
+ ******************************************************************************/
+struct composite_recipe {
+     const char *name;
+     uint band_ids[3][2];
+     float min[3];
+     float max[3];
+     float gamma[3];
+};
+
+
+static const struct composite_recipe recipes[] = {
+     {"natural_colour", {{ 3, 0}, { 2, 0}, { 1, 0}},
+                        {  0.0,    0.0,    0.0},
+                        {  1.0,    1.0,    1.0},
+                        {  1.0,    1.0,    1.0}},
+     {"airmass",        {{ 5, 6}, { 8, 9}, { 5, 0}},
+                        {-25.0,  -40.0,  243.0},
+                        {  0.0,    5.0,  208.0},
+                        {  1.0,    1.0,    1.0}},
+     {"dust",           {{10, 9}, { 9, 7}, { 9, 0}},
+                        { -4.0,    0.0,  261.0},
+                        {  2.0,   15.0,  289.0},
+                        {  1.0,    2.5,    1.0}}
+};
+
+
+
+/*******************************************************************************
+ * The name of a composite, for example for file names.
+ ******************************************************************************/
+const char *seviri_composite_name(enum seviri_composite type)
+{
+     return recipes[type].name;
+}
+
+
+
+/*******************************************************************************
+ * Set up a composite of the bands of the seviri_preproc_data structs produced
+ * with the given bands and units.  The composite requires bands 1, 2 and 3 in
+ * SEVIRI_UNIT_REF or SEVIRI_UNIT_BRF and bands 4 to 11 in SEVIRI_UNIT_BT:
+ *	SEVIRI_COMPOSITE_NATURAL_COLOUR	: bands 1, 2 and 3
+ *	SEVIRI_COMPOSITE_AIRMASS	: bands 5, 6, 8 and 9
+ *	SEVIRI_COMPOSITE_DUST		: bands 7, 9 and 10
+ *
+ * c		: The output seviri_composite_data struct
+ * type		: The composite
+ * n_bands	: The number of bands of the preprocessed data
+ * band_ids	: The band IDs of the preprocessed data of length n_bands
+ * band_units	: The units of the preprocessed data of length n_bands
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_composite_init(struct seviri_composite_data *c,
+                          enum seviri_composite type, uint n_bands,
+                          const uint *band_ids,
+                          const enum seviri_units *band_units)
+{
+     uint i;
+     uint j;
+     uint k;
+     uint band_id;
+
+     const struct composite_recipe *r;
+
+     if (type >= N_SEVIRI_COMPOSITES) {
+          fprintf(stderr, "ERROR: Invalid composite: %d\n", type);
+          return -1;
+     }
+
+     r = &recipes[type];
+
+     c->type = type;
+
+     for (i = 0; i < 3; ++i) {
+          for (j = 0; j < 2; ++j) {
+               c->i_bands[i][j] = -1;
+
+               if ((band_id = r->band_ids[i][j]) == 0)
+                    continue;
+
+               for (k = 0; k < n_bands; ++k) {
+                    if (band_ids[k] == band_id)
+                         break;
+               }
+
+               if (k == n_bands) {
+                    fprintf(stderr, "ERROR: The %s composite requires band %u\n",
+                            r->name, band_id);
+                    return -1;
+               }
+
+               if (band_id <= 3 ? band_units[k] != SEVIRI_UNIT_REF &&
+                                  band_units[k] != SEVIRI_UNIT_BRF :
+                                  band_units[k] != SEVIRI_UNIT_BT) {
+                    fprintf(stderr, "ERROR: The %s composite requires band %u "
+                            "in %s units\n", r->name, band_id,
+                            band_id <= 3 ? "REF or BRF" : "BT");
+                    return -1;
+               }
+
+               c->i_bands[i][j] = k;
+          }
+
+          c->offset[i] = r->min[i];
+          c->scale [i] = (SEVIRI_COMPOSITE_LUT_SIZE - 1) / (r->max[i] - r->min[i]);
+
+          for (k = 0; k < SEVIRI_COMPOSITE_LUT_SIZE; ++k)
+               c->lut[i][k] = (uchar) (255. * pow((double) k /
+                    (SEVIRI_COMPOSITE_LUT_SIZE - 1), 1. / r->gamma[i]) + .5);
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Produce a block of lines of a composite.  Each value of a channel is clamped
+ * to its range and looked up, so that there is no floating point math beyond a
+ * multiply and add per value.  The channels of a pixel where any of their bands
+ * is fill are 0.  For streamed processing, with seviri_preproc_lines() or on
+ * blocks of lines read separately, this is called on each block as soon as it
+ * is calibrated while it is still in cache.
+ *
+ * c		: The composite set up with seviri_composite_init()
+ * d		: The preprocessed data
+ * i_line	: The first line of d
+ * n_lines	: The number of lines
+ * rgb		: The output red, green and blue values of each pixel of the
+ *                lines, of length n_lines * d->n_columns * 3
+ ******************************************************************************/
+void seviri_composite_lines(const struct seviri_composite_data *c,
+                            const struct seviri_preproc_data *d,
+                            uint i_line, uint n_lines, uchar *rgb)
+{
+     uint i;
+
+     size_t j;
+     size_t k;
+     size_t n;
+
+     float x;
+     float x_max;
+
+     const float *a;
+     const float *b;
+
+     const uchar *lut;
+
+     n     = (size_t) n_lines * d->n_columns;
+     x_max = SEVIRI_COMPOSITE_LUT_SIZE - 1;
+
+     for (i = 0; i < 3; ++i) {
+          a   = d->data[c->i_bands[i][0]] + (size_t) i_line * d->n_columns;
+          b   = c->i_bands[i][1] < 0 ? NULL :
+                d->data[c->i_bands[i][1]] + (size_t) i_line * d->n_columns;
+          lut = c->lut[i];
+
+          for (k = 0, j = i; k < n; ++k, j += 3) {
+               if (a[k] == d->fill_value || (b && b[k] == d->fill_value)) {
+                    rgb[j] = 0;
+                    continue;
+               }
+
+               x = ((b ? a[k] - b[k] : a[k]) - c->offset[i]) * c->scale[i];
+
+               /* Written so that a NaN is clamped as well. */
+               if (! (x > 0.f))
+                    x = 0.f;
+               if (x > x_max)
+                    x = x_max;
+
+               rgb[j] = lut[(int) (x + .5f)];
+          }
+     }
+}
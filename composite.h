@@ -0,0 +1,65 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#ifndef COMPOSITE_H
+#define COMPOSITE_H
+
+#include "external.h"
+#include "preproc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Number of entries of the lookup table of each channel of a composite, over
+   which the range of the channel is quantized. */
+#define SEVIRI_COMPOSITE_LUT_SIZE 4096
+
+
+enum seviri_composite {
+     SEVIRI_COMPOSITE_NATURAL_COLOUR,
+     SEVIRI_COMPOSITE_AIRMASS,
+     SEVIRI_COMPOSITE_DUST,
+
+     N_SEVIRI_COMPOSITES
+};
+
+
+/*******************************************************************************
+ * A standard RGB composite of the bands of a seviri_preproc_data struct, set up
+ * with seviri_composite_init().  Each channel is a band or the difference of
+ * two bands, which is scaled from its range to an index into a lookup table of
+ * 8 bit values that applies the enhancement (the gamma) of the channel.
+ ******************************************************************************/
+struct seviri_composite_data {
+     enum seviri_composite type;
+     int i_bands[3][2];		/* indices of the band and of the band subtracted
+				   from it, or -1, of each channel */
+     float offset[3];		/* start of the range of each channel */
+     float scale[3];		/* lookup table entries per unit of each channel */
+     uchar lut[3][SEVIRI_COMPOSITE_LUT_SIZE];	/* lookup table of each channel */
+};
+
+
+const char *seviri_composite_name(enum seviri_composite type);
+int seviri_composite_init(struct seviri_composite_data *c,
+                          enum seviri_composite type, uint n_bands,
+                          const uint *band_ids,
+                          const enum seviri_units *band_units);
+void seviri_composite_lines(const struct seviri_composite_data *c,
+                            const struct seviri_preproc_data *d,
+                            uint i_line, uint n_lines, uchar *rgb);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPOSITE_H */
@@ -54,7 +54,7 @@ int main(int argc, char *argv[])
      if (seviri_read_and_preproc(filename, &preproc, n_bands, band_ids,
                                  band_units, SEVIRI_BOUNDS_LINE_COLUMN,
                                  line0, line1, column0, column1,
-                                 0., 0., 0., 0., 0, 0, satposstr, 0)) {
+                                 0., 0., 0., 0., 0, 0, satposstr, 0, NULL)) {
           fprintf(stderr, "ERROR: seviri_read_and_preproc_main()\n");
           exit(1);
      }
@@ -66,7 +66,7 @@ int main(int argc, char *argv[])
 
      printf("i_line:                       %d\n", i_line);
      printf("i_column:                     %d\n", i_column);
-     printf("Julian Day Number:            % .8e\n", preproc.time[i_pixel]);
+     printf("Julian Day Number:            % .8e\n", preproc.time_line[i_line]);
      printf("latitude:                     % .8e\n", preproc.lat [i_pixel]);
      printf("longitude:                    % .8e\n", preproc.lon [i_pixel]);
      printf("solar zenith angle:           % .8e\n", preproc.sza [i_pixel]);
@@ -60,7 +60,7 @@ program example_f90
 
      print '("i_line:                       ", I4)', i_line - 1
      print '("i_column:                     ", I4)', i_column - 1
-     print '("Julian Day Number:            ", ES15.8)', preproc%time(i_column, i_line)
+     print '("Julian Day Number:            ", ES15.8)', preproc%time_line(i_line)
      print '("latitude:                     ", ES15.8)', preproc%lat (i_column, i_line)
      print '("longitude:                    ", ES15.8)', preproc%lon (i_column, i_line)
      print '("solar zenith angle:           ", ES15.8)', preproc%sza (i_column, i_line)
@@ -11,25 +11,26 @@ seviri_preproc_dlm, $
      pixel_coords = [1899, 2199, 1700, 2299], $
      preproc
 
-print, preproc.n_lines
-print, preproc.n_columns
+; IDL arrays are column major so images are indexed [i_column, i_line].
+print, 'n_lines:                      ', preproc.n_lines
+print, 'n_columns:                    ', preproc.n_columns
 
 ; Print the values for the central pixel.
-;i_line   = util.n_lines / 2
-;i_column = util.n_columns / 2
+i_line   = preproc.n_lines   / 2
+i_column = preproc.n_columns / 2
 
-;print "i_line:                       %4d"   % i_line
-;print "i_column:                     %4d"   % i_column
-;print "Julian Day Number:            % .8e" % util.time[i_line, i_column]
-;print "latitude:                     % .8e" % util.lat [i_line, i_column]
-;print "longitude:                    % .8e" % util.lon [i_line, i_column]
-;print "solar zenith angle:           % .8e" % util.sza [i_line, i_column]
-;print "solar azimuth angle:          % .8e" % util.saa [i_line, i_column]
-;print "viewing zenith angle:         % .8e" % util.vza [i_line, i_column]
-;print "viewing azimuth angle:        % .8e" % util.vaa [i_line, i_column]
-;print "0.635 refectance:             % .8e" % util.data[0, i_line, i_column]
-;print "1.64  refectance:             % .8e" % util.data[1, i_line, i_column]
-;print "8.70  brightness temperature: % .8e" % util.data[2, i_line, i_column]
-;print "10.80 brightness temprature:  % .8e" % util.data[3, i_line, i_column]
+print, 'i_line:                       ', i_line
+print, 'i_column:                     ', i_column
+print, 'Julian Day Number:            ', preproc.time_line[i_line], format = '(A, E16.8)'
+print, 'latitude:                     ', preproc.lat [i_column, i_line]
+print, 'longitude:                    ', preproc.lon [i_column, i_line]
+print, 'solar zenith angle:           ', preproc.sza [i_column, i_line]
+print, 'solar azimuth angle:          ', preproc.saa [i_column, i_line]
+print, 'viewing zenith angle:         ', preproc.vza [i_column, i_line]
+print, 'viewing azimuth angle:        ', preproc.vaa [i_column, i_line]
+print, '0.635 refectance:             ', preproc.data[i_column, i_line, 0]
+print, '1.64  refectance:             ', preproc.data[i_column, i_line, 1]
+print, '8.70  brightness temperature: ', preproc.data[i_column, i_line, 2]
+print, '10.80 brightness temprature:  ', preproc.data[i_column, i_line, 3]
 
 end
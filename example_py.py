@@ -1,4 +1,4 @@
-#! /usr/bin/env python
+#! /usr/bin/env python3
 
 # Example program calling seviri_util to read a native SEVIRI level 1.5 image
 # file and preprocess it to obtain several fields.
@@ -16,17 +16,18 @@ try:
     util = seviri_util.seviri_preproc(sys.argv[1], [1, 3, 7, 9], ['BRF', 'BRF',
         'BT', 'BT'], 'line_column', pixel_coords = (1899, 2199, 1700, 2299),
         do_gsics = False)
-except seviri_preproc.error:
+except seviri_util.error:
     print('ERROR: seviri_preproc.init()', file=sys.stderr)
     exit()
 
-# Print the values for the central pixel.
-i_line   = util.n_lines / 2
-i_column = util.n_columns / 2
+# Print the values for the central pixel.  The arrays share memory with the
+# C library, which is released once util and all of its arrays are released.
+i_line   = util.n_lines // 2
+i_column = util.n_columns // 2
 
 print('i_line:                       %d'    % i_line)
 print('i_column:                     %d'    % i_column)
-print('Julian Day Number:            % .8e' % util.time[i_line, i_column])
+print('Julian Day Number:            % .8e' % util.time_line[i_line])
 print('latitude:                     % .8e' % util.lat[i_line, i_column])
 print('longitude:                    % .8e' % util.lon [i_line, i_column])
 print('solar zenith angle:           % .8e' % util.sza [i_line, i_column])
@@ -10,6 +10,7 @@
 #include "external.h"
 #include "hrit_anc_funcs.h"
 #include "internal.h"
+#include "read_write_hrit.h"
 
 
 /*******************************************************************************
@@ -233,125 +234,531 @@ int assemble_proname(char **pnam, const char *indir, const char *timeslot,
 
 
 
+/*******************************************************************************
+ * Open an HRIT file for reading, from the tar archive if one is given.
+ *
+ * fname:	The name of the file
+ * tar:		The archive containing the file or NULL
+ * opts:	Options of the read, with the opener of the file
+ *
+ * returns:	The stream or NULL on error, with errno set
+ ******************************************************************************/
+struct seviri_io *hrit_open(const char *fname, struct seviri_tar *tar,
+                            const struct seviri_options *opts)
+{
+     if (tar)
+          return seviri_tar_open_member(tar, fname);
+
+     return seviri_io_open(fname, "rb", opts->open, opts->open_data);
+}
+
+
+
+/*******************************************************************************
+ * Big endian (network order) unsigned integers from a byte buffer.
+ ******************************************************************************/
+static uint get_be16(const uchar *b)
+{
+     return (uint) b[0] << 8 | b[1];
+}
+
+static uint get_be32(const uchar *b)
+{
+     return (uint) b[0] << 24 | (uint) b[1] << 16 | (uint) b[2] << 8 | b[3];
+}
+
+
+
+/*******************************************************************************
+ * Read the header records of an HRIT file (Ref: PDF_CGMS_LRIT_HRIT_2_6 and
+ * PDF_TEN_05105_MSG_IMG_DATA), leaving the file positioned at the start of the
+ * data field.  The file may be positioned at the start of an HRIT file within
+ * a larger stream, such as concatenated files, in which case the next file
+ * starts h->data_length / 8 bytes after the data field.
+ *
+ * fp:		The open stream
+ * fname:	The name of the stream, for error messages
+ * h:		Output header values
+ *
+ * returns:     Zero if successful
+ ******************************************************************************/
+int read_hrit_header(struct seviri_io *fp, const char *fname, struct hrit_header *h)
+{
+     uchar *b;
+     uchar primary[16];
+     uint i;
+     uint n;
+
+     memset(h, 0, sizeof(struct hrit_header));
+
+     if (seviri_io_read(primary, sizeof(uchar), 16, fp) < 16) {
+          fprintf(stderr, "ERROR: Problem reading file: %s\n", fname);
+          return -1;
+     }
+
+     if (primary[0] != 0 || get_be16(primary + 1) != 16) {
+          fprintf(stderr, "ERROR: Invalid HRIT primary header: %s\n", fname);
+          return -1;
+     }
+
+     h->file_type     = primary[3];
+     h->header_length = get_be32(primary + 4);
+     h->data_length   = (ulong) get_be32(primary + 8) << 16 << 16 |
+                        get_be32(primary + 12);
+
+     if (h->header_length < 16) {
+          fprintf(stderr, "ERROR: Invalid HRIT header length: %s\n", fname);
+          return -1;
+     }
+
+     n = h->header_length - 16;
+
+     b = malloc(n + 1);
+
+     if (seviri_io_read(b, sizeof(uchar), n, fp) < n) {
+          fprintf(stderr, "ERROR: Problem reading file: %s\n", fname);
+          free(b);
+          return -1;
+     }
+
+     for (i = 0; i + 3 <= n; ) {
+          uchar *r = b + i;
+          uint length = get_be16(r + 1);
+
+          /* Anything after the last record is padding. */
+          if (length < 3 || i + length > n)
+               break;
+
+          switch (r[0]) {
+               /* Image structure */
+               case 1:
+                    if (length < 9)
+                         break;
+                    h->n_bits      = r[3];
+                    h->n_columns   = get_be16(r + 4);
+                    h->n_lines     = get_be16(r + 6);
+                    h->compression = r[8];
+                    break;
+               /* Image navigation */
+               case 2:
+                    if (length < 51)
+                         break;
+                    memcpy(h->projection, r + 3, 32);
+                    h->projection[32] = '\0';
+                    h->cfac = (int) get_be32(r + 35);
+                    h->lfac = (int) get_be32(r + 39);
+                    h->coff = (int) get_be32(r + 43);
+                    h->loff = (int) get_be32(r + 47);
+                    break;
+               /* Annotation */
+               case 4:
+                    memcpy(h->annotation, r + 3, MIN(length - 3, 64));
+                    h->annotation[MIN(length - 3, 64)] = '\0';
+                    break;
+               /* Segment identification (MSG specific) */
+               case 128:
+                    if (length < 13)
+                         break;
+                    h->satellite_id  = get_be16(r + 3);
+                    h->channel_id    = r[5];
+                    h->segment       = get_be16(r + 6);
+                    h->segment_start = get_be16(r + 8);
+                    h->segment_end   = get_be16(r + 10);
+                    break;
+               default:
+                    break;
+          }
+
+          i += length;
+     }
+
+     free(b);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Check that the header of a segment file is that of the expected segment and
+ * band and of an image structure that the readers handle.
+ *
+ * h:		Header values from read_hrit_header()
+ * fname:	The name of the file, for error messages
+ * segnum:	The segment number expected (0->7 / 0->23 for VIR / HRV)
+ * cnum:	The band expected
+ * ncols:	The number of columns expected
+ * nlines:	Output number of lines of the segment
+ *
+ * returns:     Zero if successful
+ ******************************************************************************/
+static int check_segment_header(const struct hrit_header *h, const char *fname,
+                                int segnum, uint cnum, uint ncols, uint *nlines)
+{
+     if (h->file_type != 0 || (h->channel_id && h->channel_id != cnum) ||
+         (h->segment && (int) h->segment != segnum + 1)) {
+          fprintf(stderr, "ERROR: HRIT file is not segment %d of band %u: %s\n",
+                  segnum + 1, cnum, fname);
+          return -1;
+     }
+
+     *nlines = h->n_lines ? h->n_lines : 464;
+
+     if ((h->n_columns && h->n_columns != ncols) || *nlines > 464 ||
+         (h->n_bits && h->n_bits != 10)) {
+          fprintf(stderr, "ERROR: Unexpected HRIT image structure (%u columns, "
+                  "%u lines, %u bits): %s\n", h->n_columns, *nlines, h->n_bits,
+                  fname);
+          return -1;
+     }
+
+     return 0;
+}
+
+
+
 /*******************************************************************************
  * Reads one HRIT segment into the image memory space
  *
- * NOTE: Only supports full disk scanning. RSS and SRSS are not supported.
- * NOTE: Does support HRV reading, but this is untested.
+ * NOTE: Only supports full disk and RSS scanning. SRSS is not supported.
+ *
+ * VIR segments are 464 lines of 3712 columns.  HRV segments are 464 lines of
+ * 5568 columns, the width of an HRV window, and each line is placed at the
+ * column of the lower or upper HRV window it was acquired in.  Uncompressed
+ * segments are read line by line, skipping lines outside the requested image
+ * area.  Compressed (wavelet, "-C_") segments are read whole and decompressed
+ * in memory with the decompress member of opts.  The library has no wavelet
+ * decoder of its own so without one they are an error.
  *
  * fname:	The name of the file to be read
- * segnum:	The segment number to be read (1->8 / 1->24 for VIR / HRV)
- * cnum:	The channel number (1 -> 11 for VIR, 12 for HRV)
+ * segnum:	The segment number to be read (0->7 / 0->23 for VIR / HRV)
+ * i_band:	Index of the band in d->image.band_ids
  * d:		Main SEVIRI data structure
- * dims:	Container for the image boundaries.
+ * rss:		Flag to set rss processing (1=yes, 0=no)
+ * tar:		Tar archive containing the file or NULL
+ * opts:	Options of the read
  *
  * returns:     Zero if successful
  ******************************************************************************/
-int read_data_oneseg(char *fname, int segnum, int cnum, struct seviri_data *d,
-                     int rss)
+int read_data_oneseg(char *fname, int segnum, int i_band, struct seviri_data *d,
+                     int rss, struct seviri_tar *tar,
+                     const struct seviri_options *opts)
 {
-     if (rss==1 && segnum<5) return 0;
-
      /* Set up the various data that is required*/
      uchar *data10;
-     const uchar shifts[] = {6, 4, 2, 0};
-     ushort temp;
-     const ushort masks[] = {0xFFC0, 0x3FF0, 0x0FFC, 0x03FF};
-     int x,out,j,jj,k,offset;
+     const uchar *p10 = NULL;
+     ushort *counts;
+     int x,first_seg,offset;
+     uint cnum,ncols,nlines,nbytes;
+
+     /* Required to align with NAT format reader.  The requested image area is
+        three times larger for HRV. */
+     long first_line;
+     long first_col;
+     long last_line;
+     long last_col;
+
+     long out_d_line;
 
-     /* Required to align with NAT format reader.  4 must be subtracted form the
-        column as we read 4 pixels simultaneously*/
-     int first_line = d->image.dimens.i_line_requested_VIR;
-     int first_col  = d->image.dimens.i_column_requested_VIR;
+     struct hrit_header h;
 
-     int last_line  = first_line + d->image.dimens.n_lines_requested_VIR-1;
-     int last_col   = first_col  + d->image.dimens.n_columns_requested_VIR-1;
+     struct seviri_io *fp;
 
-     long int out_d_col,out_d_line;
+     SU_PERF_TIMER(t);
 
-     FILE *fp;
+     cnum = d->image.band_ids[i_band];
 
-     if ((fp = fopen(fname, "rb")) == NULL) {
+     if (cnum<1 || cnum>12) return -1;
+
+     /* RSS only scans the northern segments. */
+     first_seg = cnum==12 ? 15 : 5;
+
+     if (rss==1 && segnum<first_seg) return 0;
+
+     if (cnum<12) {
+          first_line = d->image.dimens.i_line_requested_VIR;
+          first_col  = d->image.dimens.i_column_requested_VIR;
+          last_line  = first_line + d->image.dimens.n_lines_requested_VIR-1;
+          last_col   = first_col  + d->image.dimens.n_columns_requested_VIR-1;
+          ncols      = d->image.dimens.n_columns_selected_VIR;
+     }
+     else {
+          first_line = d->image.dimens.i_line_requested_HRV;
+          first_col  = d->image.dimens.i_column_requested_HRV;
+          last_line  = first_line + d->image.dimens.n_lines_requested_HRV-1;
+          last_col   = first_col  + d->image.dimens.n_columns_requested_HRV-1;
+          ncols      = IMAGE_SIZE_HRV_COLUMNS;
+     }
+
+     nbytes = ncols / 4 * 5;
+
+     SU_PERF_START(&d->perf, t);
+     if ((fp = hrit_open(fname, tar, opts)) == NULL) {
           fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
                   fname, strerror(errno));
           return -1;
      }
+     SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
-     /* Skip header section, don't bother to read */
-     fseek(fp,6198,SEEK_SET);
+     /* Read the header records rather than assume their length. */
+     SU_PERF_START(&d->perf, t);
+     if (read_hrit_header(fp, fname, &h)) {
+          fprintf(stderr, "ERROR: read_hrit_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+     SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_READ, 0, h.header_length);
 
-     if (cnum>0 && cnum<12) {
-          int ncols = d->image.dimens.n_columns_selected_VIR;
+     if (check_segment_header(&h, fname, segnum, cnum, ncols, &nlines)) {
+          seviri_io_close(fp);
+          return -1;
+     }
 
-          /* Each segment if 464 lines, so skip to correct part of image based
-             on segnum. */
-          if (rss==1)
-               offset=(segnum-5)*464;
-          else
-               offset=segnum*464;
-          ushort tmpline[ncols];
+     /* Each segment if 464 lines, so skip to correct part of image based on
+        segnum. */
+     if (rss==1)
+          offset=(segnum-first_seg)*464;
+     else
+          offset=segnum*464;
 
-          data10 = malloc(ncols / 4 * 5 * sizeof(uchar));
+     data10 = NULL;
+     counts = NULL;
 
-          /* Loop over all lines in segment */
-          for (x=offset;x<offset+464;x++) {
-               out_d_line=(x-first_line)*(last_col-first_col+1);
-               /* If we're outside the requested image boundary: move file
-                  pointed and skip. */
-               if (x<first_line || x>last_line) {
-                    fseek(fp,ncols/4*5,SEEK_CUR);
-                    continue;
+     if (h.compression == 0)
+          data10 = malloc(nbytes * sizeof(uchar));
+     else {
+          size_t n_in;
+
+          if (opts->decompress == NULL) {
+               fprintf(stderr, "ERROR: Compressed HRIT segment and no "
+                       "decompressor given in the options: %s\n", fname);
+               seviri_io_close(fp);
+               return -1;
+          }
+
+          n_in   = (h.data_length + 7) / 8;
+          data10 = malloc(n_in * sizeof(uchar));
+          counts = malloc((size_t) nlines * ncols * sizeof(ushort));
+
+          SU_PERF_START(&d->perf, t);
+          if ((p10 = seviri_io_view(fp, data10, n_in)) == NULL) {
+               fprintf(stderr, "ERROR: Problem reading file: %s\n", fname);
+               free(data10);
+               free(counts);
+               seviri_io_close(fp);
+               return -1;
+          }
+          SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_READ, 0, n_in);
+
+          SU_PERF_START(&d->perf, t);
+          if (opts->decompress(p10, n_in, counts, ncols, nlines, h.n_bits,
+                               h.compression, opts->decompress_data)) {
+               fprintf(stderr, "ERROR: Problem decompressing file: %s\n", fname);
+               free(data10);
+               free(counts);
+               seviri_io_close(fp);
+               return -1;
+          }
+          SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_UNPACK, nlines * ncols, 0);
+     }
+
+     /* Loop over all lines in segment */
+     for (x=offset;x<offset+(int)nlines;x++) {
+          long p0,p1;
+          uint i_column;
+          ushort *out;
+
+          /* If we're outside the requested image boundary: move file pointer
+             and skip. */
+          if (x<first_line || x>last_line) {
+               if (! counts) {
+                    SU_PERF_START(&d->perf, t);
+                    seviri_io_seek(fp,nbytes,SEEK_CUR);
+                    SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_SEEK, 0, 0);
                }
+               continue;
+          }
 
-               /* Otherwise read the data and store in the image memory space. */
-               out=fread(data10, sizeof(char), ncols / 4 * 5, fp);
-               out=out;
-
-               for (j = 0, jj = 0; j < ncols; ) {
-                    for (k = 0; k < 4; ++k) {
-                         temp = *((ushort *) (data10 + jj));
-                         SWAP_2(temp, temp);
-                         tmpline[j] = (temp & masks[k]) >> shifts[k];
-
-                         if (j>=first_col && j<=last_col) {
-                              out_d_col=j-first_col;
-                              d->image.data_vir[cnum-1][out_d_line+out_d_col] =
-                                   tmpline[j];
-                         }
-                         j++, jj++;
-                    }
-                    jj++;
+          /* Otherwise read the data and store in the image memory space. */
+          if (! counts) {
+               SU_PERF_START(&d->perf, t);
+               if ((p10 = seviri_io_view(fp, data10, nbytes)) == NULL) {
+                    fprintf(stderr, "ERROR: Problem reading file: %s\n", fname);
+                    free(data10);
+                    seviri_io_close(fp);
+                    return -1;
                }
+               SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_READ, 0, nbytes);
+          }
+
+          /* The columns of the line within the full disk and the range of
+             its pixels within the requested image area. */
+          if (cnum<12) {
+               i_column=0;
+               out_d_line=(x-first_line)*(last_col-first_col+1);
+          }
+          else {
+               if (seviri_hrv_window(&d->header.ImageDescription.PlannedCoverageHRV,
+                                     x + (rss==1 ? first_seg*464 : 0), &i_column))
+                    continue;
+               out_d_line=(x-first_line)*d->image.n_columns_hrv;
+          }
+
+          p0=MAX(first_col-(long)i_column,0);
+          p1=MIN(last_col -(long)i_column+1,(long)ncols);
+          if (p0>=p1)
+               continue;
+
+          out = (cnum<12 ? d->image.data_vir[i_band] : d->image.data_hrv) +
+                out_d_line+i_column+p0-first_col;
+
+          if (counts)
+               memcpy(out, counts + (size_t) (x-offset)*ncols + p0,
+                      (p1-p0)*sizeof(ushort));
+          else {
+               SU_PERF_START(&d->perf, t);
+               su_unpack_10bit(p10, p0, p1-p0, out);
+               SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_UNPACK, p1 - p0, 0);
           }
-          free(data10);
      }
 
-     /* Same as above, but for HRV */
-     if (cnum==12) {
-          /* Fudge the HRV line numbers */
-          int nlines=11136;
-          int ncols=11136;
-          int offset=nlines-(segnum*464)-464;
-          for (x=offset+464;x>offset;x--) {
-               data10 = malloc(ncols / 4 * 5 * sizeof(uchar));
-               out=fread(data10, sizeof(char), ncols / 4 * 5, fp);
-               for (j = ncols, jj = 0; j > 0;) {
-                    for (k = 0; k < 4; ++k) {
-                         temp = *((ushort *) (data10 + jj));
-                         SWAP_2(temp, temp);
-                         d->image.data_hrv[(x*ncols*2)+j] =
-                              (temp & masks[k]) >> shifts[k];
-                         j--, jj++;
-                    }
-                    jj++;
+     free(data10);
+     free(counts);
+
+     SU_PERF_START(&d->perf, t);
+     seviri_io_close(fp);
+     SU_PERF_STOP(&d->perf, t, SEVIRI_PERF_OPEN, 0, 0);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Adds the raw counts of the lines of one HRIT segment within a range of lines
+ * to the statistics of its band, without placing them in an image.  Lines are
+ * numbered as in read_data_oneseg(), from 0 at the first scanned line of the
+ * band.  Uncompressed segments are read in place line by line from the first
+ * line in the range, each unpacked into a single line buffer.  Compressed
+ * segments are decompressed whole with the decompress member of opts.
+ *
+ * fname:	The name of the file to be read
+ * segnum:	The segment number to be read (0->7 / 0->23 for VIR / HRV)
+ * cnum:	The band of the segment (1 -> 12)
+ * first_line:	First line of the range
+ * last_line:	Last line of the range
+ * rss:		Flag to set rss processing (1=yes, 0=no)
+ * tar:		Tar archive containing the file or NULL
+ * opts:	Options of the read
+ * s:		Statistics of the band the counts are added to
+ *
+ * returns:     Zero if successful
+ ******************************************************************************/
+int count_stats_oneseg(const char *fname, int segnum, uint cnum,
+                       long first_line, long last_line, int rss,
+                       struct seviri_tar *tar, const struct seviri_options *opts,
+                       struct seviri_band_stats *s)
+{
+     uchar *data10;
+     const uchar *p10;
+     ushort *counts;
+     int first_seg;
+     uint ncols,nlines,nbytes;
+     long x,x0,x1,offset;
+
+     struct hrit_header h;
+
+     struct seviri_io *fp;
+
+     if (cnum<1 || cnum>12) return -1;
+
+     first_seg = cnum==12 ? 15 : 5;
+
+     if (rss==1 && segnum<first_seg) return 0;
+
+     ncols  = cnum<12 ? IMAGE_SIZE_VIR_COLUMNS : IMAGE_SIZE_HRV_COLUMNS;
+     nbytes = ncols / 4 * 5;
+
+     if ((fp = hrit_open(fname, tar, opts)) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
+                  fname, strerror(errno));
+          return -1;
+     }
+
+     if (read_hrit_header(fp, fname, &h)) {
+          fprintf(stderr, "ERROR: read_hrit_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (check_segment_header(&h, fname, segnum, cnum, ncols, &nlines)) {
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     offset = (long) (rss==1 ? segnum-first_seg : segnum) * 464;
+
+     x0 = MAX(first_line, offset);
+     x1 = MIN(last_line,  offset + (long) nlines - 1);
+
+     if (x0 > x1) {
+          seviri_io_close(fp);
+          return 0;
+     }
+
+     if (h.compression == 0) {
+          data10 = malloc(nbytes * sizeof(uchar));
+          counts = malloc(ncols * sizeof(ushort));
+
+          seviri_io_seek(fp, (x0 - offset) * nbytes, SEEK_CUR);
+
+          for (x = x0; x <= x1; x++) {
+               if ((p10 = seviri_io_view(fp, data10, nbytes)) == NULL) {
+                    fprintf(stderr, "ERROR: Problem reading file: %s\n", fname);
+                    free(data10);
+                    free(counts);
+                    seviri_io_close(fp);
+                    return -1;
                }
+
+               su_unpack_10bit(p10, 0, ncols, counts);
+               seviri_stats_add_counts(s, counts, ncols);
           }
-          free(data10);
+     }
+     else {
+          size_t n_in;
+
+          if (opts->decompress == NULL) {
+               fprintf(stderr, "ERROR: Compressed HRIT segment and no "
+                       "decompressor given in the options: %s\n", fname);
+               seviri_io_close(fp);
+               return -1;
+          }
+
+          n_in   = (h.data_length + 7) / 8;
+          data10 = malloc(n_in * sizeof(uchar));
+          counts = malloc((size_t) nlines * ncols * sizeof(ushort));
+
+          if ((p10 = seviri_io_view(fp, data10, n_in)) == NULL ||
+              opts->decompress(p10, n_in, counts, ncols, nlines, h.n_bits,
+                               h.compression, opts->decompress_data)) {
+               fprintf(stderr, "ERROR: Problem reading or decompressing file: "
+                       "%s\n", fname);
+               free(data10);
+               free(counts);
+               seviri_io_close(fp);
+               return -1;
+          }
+
+          for (x = x0; x <= x1; x++)
+               seviri_stats_add_counts(s, counts + (size_t) (x - offset) * ncols,
+                                       ncols);
      }
 
-     fclose(fp);
+     free(data10);
+     free(counts);
 
-     if (cnum<=0 || cnum>12) return -1;
+     seviri_io_close(fp);
 
      return 0;
 }
@@ -12,12 +12,60 @@
 
 #include "external.h"
 #include "read_write.h"
+#include "stats_util.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/*******************************************************************************
+ * HRIT file types and the offset of the image description from the start of
+ * the prologue data field, after the satellite status, image acquisition and
+ * celestial events, which are of fixed length.
+ ******************************************************************************/
+#define HRIT_FILE_TYPE_IMAGE		0
+#define HRIT_FILE_TYPE_PROLOGUE		128
+#define HRIT_FILE_TYPE_EPILOGUE		129
+
+#define HRIT_PROLOGUE_IMAGE_DESCRIPTION	386892
+
+
+/*******************************************************************************
+ * Values from the header records of an HRIT file, see read_hrit_header().
+ * Values of records not present in the file are zero.
+ ******************************************************************************/
+struct hrit_header {
+     /* Primary header */
+     uint  file_type;		/* 0 for image data, 128 prologue, 129 epilogue */
+     uint  header_length;	/* total length of the header records in bytes */
+     ulong data_length;		/* length of the data field in bits */
+
+     /* Image structure */
+     uint  n_bits;		/* bits per pixel */
+     uint  n_columns;		/* number of columns */
+     uint  n_lines;		/* number of lines */
+     uint  compression;		/* 0 none, 1 lossless, 2 lossy */
+
+     /* Image navigation */
+     char  projection[33];	/* projection name */
+     int   cfac;		/* column scaling factor */
+     int   lfac;		/* line scaling factor */
+     int   coff;		/* column offset */
+     int   loff;		/* line offset */
+
+     /* Annotation */
+     char  annotation[65];	/* the file name as disseminated */
+
+     /* Segment identification */
+     uint  satellite_id;	/* GP_SC_ID of the spacecraft */
+     uint  channel_id;		/* spectral channel (1 -> 12) */
+     uint  segment;		/* segment sequence number (1 based) */
+     uint  segment_start;	/* planned first segment sequence number */
+     uint  segment_end;		/* planned last segment sequence number */
+};
+
+
 int is_hrv(int band);
 const char *chan_name(int cnum);
 char *extract_path_sat_id_timeslot(const char *filename, int *sat_id,
@@ -28,8 +76,17 @@ int assemble_epiname(char **enam, const char *indir, const char *timeslot,
                      int sat, int rss, int iodc);
 int assemble_proname(char **pnam, const char *indir, const char *timeslot,
                      int sat, int rss, int iodc);
-int read_data_oneseg(char *fname, int segnum, int cnum, struct seviri_data *d,
-                     int rss);
+struct seviri_io *hrit_open(const char *fname, struct seviri_tar *tar,
+                            const struct seviri_options *opts);
+int read_hrit_header(struct seviri_io *fp, const char *fname,
+                     struct hrit_header *h);
+int read_data_oneseg(char *fname, int segnum, int i_band, struct seviri_data *d,
+                     int rss, struct seviri_tar *tar,
+                     const struct seviri_options *opts);
+int count_stats_oneseg(const char *fname, int segnum, uint cnum,
+                       long first_line, long last_line, int rss,
+                       struct seviri_tar *tar, const struct seviri_options *opts,
+                       struct seviri_band_stats *s);
 
 
 #ifdef __cplusplus
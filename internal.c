@@ -29,16 +29,16 @@ const double band_solar_irradiance[][SEVIRI_N_BANDS] =
 {
      /* MSG-1, 321 */
      {65.2296, 73.0127, 62.3715, -999., -999., -999., -999., -999., -999.,
-      -999., 78.7599},
+      -999., -999., 78.7599},
      /* MSG-2, 322 */
      {65.2065, 73.1869, 61.9923, -999., -999., -999., -999., -999., -999.,
-      -999., 79.0113},
+      -999., -999., 79.0113},
      /* MSG-3, 323 */
      {65.5148, 73.1807, 62.0208, -999., -999., -999., -999., -999., -999.,
-      -999., 78.9416},
+      -999., -999., 78.9416},
      /* MSG-4, 324 */
      {65.2656, 73.1692, 61.9416, -999., -999., -999., -999., -999., -999.,
-      -999., 79.0035}
+      -999., -999., 79.0035}
 };
 
 /* Ref: PDF_EFFECT_RAD_TO_BRIGHTNESS-1 */
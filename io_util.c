@@ -0,0 +1,581 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "external.h"
+#include "internal.h"
+#include "io_util.h"
+
+
+/*******************************************************************************
+ * Open a named stream: with the given open function when reading and it accepts
+ * the name, or else as a file.
+ *
+ * name		: The name of the stream
+ * mode		: Mode as for fopen()
+ * func		: The open function, for example of the options of a read (see
+ *                struct seviri_options), or NULL to open a file
+ * data		: User data passed on to func
+ *
+ * returns	: The stream or NULL on error, with errno set
+ ******************************************************************************/
+struct seviri_io *seviri_io_open(const char *name, const char *mode,
+                                 seviri_io_open_func func, void *data)
+{
+     struct seviri_io *io;
+
+     if (func && mode[0] == 'r' && (io = func(name, data)))
+          return io;
+
+     return seviri_io_open_file(name, mode);
+}
+
+
+
+/*******************************************************************************
+ * Open a file as a stream.
+ *
+ * name		: The name of the file
+ * mode		: Mode as for fopen()
+ *
+ * returns	: The stream or NULL on error, with errno set
+ ******************************************************************************/
+struct seviri_io *seviri_io_open_file(const char *name, const char *mode)
+{
+     FILE *fp;
+
+     struct seviri_io *io;
+
+     if ((fp = fopen(name, mode)) == NULL)
+          return NULL;
+
+     io = calloc(1, sizeof(struct seviri_io));
+     io->fp = fp;
+
+     return io;
+}
+
+
+
+/*******************************************************************************
+ * Open a memory buffer as a read only stream.  The buffer is read in place and
+ * must remain valid until the stream is closed.
+ *
+ * buf		: The buffer
+ * size		: The size of the buffer in bytes
+ *
+ * returns	: The stream
+ ******************************************************************************/
+struct seviri_io *seviri_io_open_mem(const void *buf, size_t size)
+{
+     struct seviri_io *io;
+
+     io = calloc(1, sizeof(struct seviri_io));
+     io->mem  = (const uchar *) buf;
+     io->size = size;
+
+     return io;
+}
+
+
+
+/*******************************************************************************
+ * Open a custom stream implemented by a set of functions.
+ *
+ * funcs	: The functions, which must remain valid until the stream is
+ *                closed
+ * stream	: The stream pointer passed to the functions
+ *
+ * returns	: The stream
+ ******************************************************************************/
+struct seviri_io *seviri_io_open_funcs(const struct seviri_io_funcs *funcs,
+                                       void *stream)
+{
+     struct seviri_io *io;
+
+     io = calloc(1, sizeof(struct seviri_io));
+     io->funcs  = funcs;
+     io->stream = stream;
+
+     return io;
+}
+
+
+
+/*******************************************************************************
+ * Close a stream opened with one of the seviri_io_open*() functions.
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_io_close(struct seviri_io *io)
+{
+     int r = 0;
+
+     if (io->fp)
+          r = fclose(io->fp);
+     else if (io->funcs && io->funcs->close)
+          r = io->funcs->close(io->stream);
+
+     free(io);
+
+     return r;
+}
+
+
+
+/*******************************************************************************
+ * Like fread(), fwrite(), fseek() and ftell() on a stream.
+ ******************************************************************************/
+size_t seviri_io_read(void *ptr, size_t size, size_t nmemb, struct seviri_io *io)
+{
+     size_t n;
+
+     if (io->fp)
+          n = fread(ptr, size, nmemb, io->fp);
+     else if (io->funcs)
+          n = io->funcs->read(ptr, size, nmemb, io->stream);
+     else {
+          n = size == 0 || io->pos >= io->size ? 0 :
+              MIN(nmemb, (io->size - io->pos) / size);
+          memcpy(ptr, io->mem + io->pos, n * size);
+          io->pos += n * size;
+     }
+
+     if (n < nmemb)
+          io->eof = 1;
+
+     return n;
+}
+
+
+
+size_t seviri_io_write(const void *ptr, size_t size, size_t nmemb,
+                       struct seviri_io *io)
+{
+     if (io->fp)
+          return fwrite(ptr, size, nmemb, io->fp);
+     else if (io->funcs && io->funcs->write)
+          return io->funcs->write(ptr, size, nmemb, io->stream);
+
+     errno = EBADF;
+
+     return 0;
+}
+
+
+
+int seviri_io_seek(struct seviri_io *io, long offset, int whence)
+{
+     long pos;
+
+     io->eof = 0;
+
+     if (io->fp)
+          return fseek(io->fp, offset, whence);
+     else if (io->funcs)
+          return io->funcs->seek(io->stream, offset, whence);
+
+     switch (whence) {
+          case SEEK_SET:
+               pos = offset;
+               break;
+          case SEEK_CUR:
+               pos = (long) io->pos + offset;
+               break;
+          case SEEK_END:
+               pos = (long) io->size + offset;
+               break;
+          default:
+               errno = EINVAL;
+               return -1;
+     }
+
+     if (pos < 0) {
+          errno = EINVAL;
+          return -1;
+     }
+
+     io->pos = pos;
+
+     return 0;
+}
+
+
+
+long seviri_io_tell(struct seviri_io *io)
+{
+     if (io->fp)
+          return ftell(io->fp);
+     else if (io->funcs)
+          return io->funcs->tell(io->stream);
+
+     return io->pos;
+}
+
+
+
+/*******************************************************************************
+ * Returns non-zero if the last read was short, as for feof().
+ ******************************************************************************/
+int seviri_io_eof(const struct seviri_io *io)
+{
+     if (io->fp)
+          return feof(io->fp);
+
+     return io->eof;
+}
+
+
+
+/*******************************************************************************
+ * Set the buffer size of a file stream as with setvbuf().  Does nothing for
+ * other streams.
+ ******************************************************************************/
+int seviri_io_setvbuf(struct seviri_io *io, size_t size)
+{
+     if (io->fp)
+          return setvbuf(io->fp, NULL, _IOFBF, size);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Hint that a range of a file stream will be read soon so that the operating
+ * system may start reading it in the background, which overlaps the I/O with
+ * whatever is done before the range is actually read.  Does nothing for other
+ * streams or where there is no posix_fadvise().
+ *
+ * io		: The stream
+ * offset	: Offset of the range from the beginning of the stream
+ * n		: The number of bytes in the range
+ ******************************************************************************/
+void seviri_io_prefetch(struct seviri_io *io, long offset, size_t n)
+{
+#ifdef POSIX_FADV_WILLNEED
+     if (io->fp)
+          posix_fadvise(fileno(io->fp), offset, n, POSIX_FADV_WILLNEED);
+#endif
+}
+
+
+
+/*******************************************************************************
+ * Read n bytes, returning a pointer to them.  For a memory stream this points
+ * into the buffer itself, so no copy is made.  Otherwise the bytes are read
+ * into buf.
+ *
+ * io		: The stream
+ * buf		: Buffer of at least n bytes for streams that are not in memory
+ * n		: The number of bytes
+ *
+ * returns	: Pointer to the bytes or NULL on a short read
+ ******************************************************************************/
+const uchar *seviri_io_view(struct seviri_io *io, uchar *buf, size_t n)
+{
+     const uchar *p;
+
+     if (io->fp || io->funcs)
+          return seviri_io_read(buf, sizeof(uchar), n, io) < n ? NULL : buf;
+
+     if (io->pos > io->size || n > io->size - io->pos) {
+          io->eof = 1;
+          return NULL;
+     }
+
+     p = io->mem + io->pos;
+
+     io->pos += n;
+
+     return p;
+}
+
+
+
+/*******************************************************************************
+ * Returns non-zero if the name is that of a tar archive, ending in ".tar".
+ ******************************************************************************/
+int seviri_is_tar(const char *name)
+{
+     size_t n = strlen(name);
+
+     return n > 4 && strcmp(name + n - 4, ".tar") == 0;
+}
+
+
+
+/*******************************************************************************
+ * Parse an octal number field of a tar header.
+ ******************************************************************************/
+static long tar_octal(const uchar *p, uint n)
+{
+     uint i;
+     long x = 0;
+
+     for (i = 0; i < n && p[i] == ' '; ++i) ;
+
+     for ( ; i < n && p[i] >= '0' && p[i] <= '7'; ++i)
+          x = x * 8 + (p[i] - '0');
+
+     return x;
+}
+
+
+
+/*******************************************************************************
+ * Read n bytes at an offset of a file descriptor with pread(), which does not
+ * move a shared file position, retrying short reads.  Returns the number of
+ * bytes read, less than n at the end of the file or on error.
+ ******************************************************************************/
+static size_t pread_full(int fd, void *buf, size_t n, long offset)
+{
+     ssize_t r;
+
+     size_t m = 0;
+
+     while (m < n) {
+          r = pread(fd, (uchar *) buf + m, n - m, offset + m);
+          if (r < 0 && errno == EINTR)
+               continue;
+          if (r <= 0)
+               break;
+          m += r;
+     }
+
+     return m;
+}
+
+
+
+/*******************************************************************************
+ * Open a tar archive (ustar, GNU or POSIX pax) and index its regular file
+ * members so that they may be read in place with seviri_tar_open_member(),
+ * without extracting them.  Only the 512 byte headers are read.
+ *
+ * filename	: The name of the archive
+ *
+ * returns	: The archive index or NULL on error
+ ******************************************************************************/
+struct seviri_tar *seviri_tar_open(const char *filename)
+{
+     char name[256 + 1];
+
+     const char *p;
+
+     uchar h[512];
+
+     uint n_alloc = 0;
+
+     long offset = 0;
+     long size;
+
+     struct seviri_tar *tar;
+
+     tar = calloc(1, sizeof(struct seviri_tar));
+
+     if ((tar->fd = open(filename, O_RDONLY)) < 0) {
+          fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
+                  filename, strerror(errno));
+          free(tar);
+          return NULL;
+     }
+
+     while (pread_full(tar->fd, h, 512, offset) == 512) {
+          offset += 512;
+
+          /* The archive ends with zero blocks. */
+          if (h[0] == '\0')
+               break;
+
+          size = tar_octal(h + 124, 12);
+
+          /* Regular files only, skipping directories, links and pax and GNU
+             extended headers. */
+          if (h[156] == '0' || h[156] == '\0') {
+               if (memcmp(h + 257, "ustar", 5) == 0 && h[345] != '\0')
+                    sprintf(name, "%.155s/%.100s", h + 345, h);
+               else
+                    sprintf(name, "%.100s", h);
+
+               if (tar->n_members == n_alloc) {
+                    n_alloc = n_alloc ? 2 * n_alloc : 128;
+                    tar->members = realloc(tar->members, n_alloc *
+                                           sizeof(struct seviri_tar_member));
+               }
+
+               p = strrchr(name, '/');
+               p = p ? p + 1 : name;
+
+               tar->members[tar->n_members].name   = malloc(strlen(p) + 1);
+               strcpy(tar->members[tar->n_members].name, p);
+               tar->members[tar->n_members].offset = offset;
+               tar->members[tar->n_members].size   = size;
+               tar->n_members++;
+          }
+
+          offset += (size + 511) / 512 * 512;
+     }
+
+     return tar;
+}
+
+
+
+/*******************************************************************************
+ * A member of a tar archive open for reading: a window onto the archive with
+ * its own position.
+ ******************************************************************************/
+struct tar_window {
+     struct seviri_tar *tar;
+     long offset;
+     long size;
+     long pos;
+};
+
+
+static size_t tar_read(void *ptr, size_t size, size_t nmemb, void *stream)
+{
+     size_t n;
+
+     struct tar_window *w = (struct tar_window *) stream;
+
+     if (size == 0 || w->pos >= w->size)
+          return 0;
+
+     nmemb = MIN(nmemb, (size_t) (w->size - w->pos) / size);
+
+     n = pread_full(w->tar->fd, ptr, nmemb * size, w->offset + w->pos) / size;
+
+     w->pos += n * size;
+
+     return n;
+}
+
+
+static int tar_seek(void *stream, long offset, int whence)
+{
+     long pos;
+
+     struct tar_window *w = (struct tar_window *) stream;
+
+     switch (whence) {
+          case SEEK_SET:
+               pos = offset;
+               break;
+          case SEEK_CUR:
+               pos = w->pos + offset;
+               break;
+          case SEEK_END:
+               pos = w->size + offset;
+               break;
+          default:
+               errno = EINVAL;
+               return -1;
+     }
+
+     if (pos < 0) {
+          errno = EINVAL;
+          return -1;
+     }
+
+     w->pos = pos;
+
+     return 0;
+}
+
+
+static long tar_tell(void *stream)
+{
+     return ((struct tar_window *) stream)->pos;
+}
+
+
+static int tar_close(void *stream)
+{
+     free(stream);
+
+     return 0;
+}
+
+
+static const struct seviri_io_funcs tar_funcs = {
+     tar_read, NULL, tar_seek, tar_tell, tar_close
+};
+
+
+
+/*******************************************************************************
+ * Open a member of a tar archive as a read only stream.  Members are matched
+ * by name without any directory.  Each stream keeps its own position and reads
+ * the archive with pread(), so the streams of one archive may be open at the
+ * same time and each used from a different thread.
+ *
+ * tar		: The archive index from seviri_tar_open()
+ * name		: The name of the member, any directory is ignored
+ *
+ * returns	: The stream or NULL, with errno set to ENOENT, if the archive
+ *                does not contain the member
+ ******************************************************************************/
+struct seviri_io *seviri_tar_open_member(struct seviri_tar *tar, const char *name)
+{
+     const char *p;
+
+     uint i;
+
+     struct tar_window *w;
+
+     p = strrchr(name, '/');
+     p = p ? p + 1 : name;
+
+     for (i = 0; i < tar->n_members; ++i) {
+          if (strcmp(tar->members[i].name, p) == 0)
+               break;
+     }
+
+     if (i == tar->n_members) {
+          errno = ENOENT;
+          return NULL;
+     }
+
+     w = malloc(sizeof(struct tar_window));
+     w->tar    = tar;
+     w->offset = tar->members[i].offset;
+     w->size   = tar->members[i].size;
+     w->pos    = 0;
+
+     return seviri_io_open_funcs(&tar_funcs, w);
+}
+
+
+
+/*******************************************************************************
+ * Close a tar archive opened with seviri_tar_open().  Its members must be
+ * closed first.
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_tar_close(struct seviri_tar *tar)
+{
+     uint i;
+
+     int r;
+
+     r = close(tar->fd);
+
+     for (i = 0; i < tar->n_members; ++i)
+          free(tar->members[i].name);
+     free(tar->members);
+
+     free(tar);
+
+     return r;
+}
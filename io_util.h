@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#ifndef IO_UTIL_H
+#define IO_UTIL_H
+
+#include "external.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*******************************************************************************
+ * Functions implementing a custom input/output stream, with the semantics of
+ * fread(), fwrite(), fseek(), ftell() and fclose() on the stream pointer given
+ * to seviri_io_open_funcs().  write may be NULL for a read only stream and
+ * close may be NULL if there is nothing to release.
+ ******************************************************************************/
+struct seviri_io_funcs {
+     size_t (*read) (void *ptr, size_t size, size_t nmemb, void *stream);
+     size_t (*write)(const void *ptr, size_t size, size_t nmemb, void *stream);
+     int    (*seek) (void *stream, long offset, int whence);
+     long   (*tell) (void *stream);
+     int    (*close)(void *stream);
+};
+
+
+/*******************************************************************************
+ * An input/output stream that all the readers and writers go through: a file,
+ * a memory buffer or a custom stream.  Memory buffers are read in place.
+ ******************************************************************************/
+struct seviri_io {
+     FILE *fp;				/* file, if a file stream */
+
+     const struct seviri_io_funcs *funcs;	/* functions, if a custom stream */
+     void *stream;			/* stream pointer passed to funcs */
+
+     const uchar *mem;			/* buffer, if a memory stream */
+     size_t size;			/* size of the buffer */
+     size_t pos;			/* current position in the buffer */
+
+     int eof;				/* non-zero after a short read */
+};
+
+
+/*******************************************************************************
+ * An index of the members of a tar archive, which are read in place.  See
+ * seviri_tar_open().
+ ******************************************************************************/
+struct seviri_tar_member {
+     char *name;			/* name of the member, without any directory */
+     long offset;			/* offset of the data in the archive */
+     long size;				/* size of the data */
+};
+
+
+struct seviri_tar {
+     int fd;				/* descriptor of the archive, only read
+					   with pread() so it has no position */
+
+     uint n_members;
+     struct seviri_tar_member *members;	/* members in the order of the archive */
+};
+
+
+/*******************************************************************************
+ * Opens the named stream for reading in place of a file, or returns NULL to
+ * fall back to opening a file of that name, see seviri_io_open().
+ ******************************************************************************/
+typedef struct seviri_io *(*seviri_io_open_func)(const char *name, void *data);
+
+
+struct seviri_io *seviri_io_open(const char *name, const char *mode,
+                                 seviri_io_open_func func, void *data);
+struct seviri_io *seviri_io_open_file(const char *name, const char *mode);
+struct seviri_io *seviri_io_open_mem(const void *buf, size_t size);
+struct seviri_io *seviri_io_open_funcs(const struct seviri_io_funcs *funcs,
+                                       void *stream);
+int seviri_io_close(struct seviri_io *io);
+
+size_t seviri_io_read(void *ptr, size_t size, size_t nmemb, struct seviri_io *io);
+size_t seviri_io_write(const void *ptr, size_t size, size_t nmemb,
+                       struct seviri_io *io);
+int seviri_io_seek(struct seviri_io *io, long offset, int whence);
+long seviri_io_tell(struct seviri_io *io);
+int seviri_io_eof(const struct seviri_io *io);
+int seviri_io_setvbuf(struct seviri_io *io, size_t size);
+void seviri_io_prefetch(struct seviri_io *io, long offset, size_t n);
+
+const uchar *seviri_io_view(struct seviri_io *io, uchar *buf, size_t n);
+
+int seviri_is_tar(const char *name);
+struct seviri_tar *seviri_tar_open(const char *filename);
+struct seviri_io *seviri_tar_open_member(struct seviri_tar *tar, const char *name);
+int seviri_tar_close(struct seviri_tar *tar);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IO_UTIL_H */
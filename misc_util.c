@@ -79,6 +79,72 @@ void su_init_array_d(double *a, uint n, double x)
 
 
 
+/*******************************************************************************
+ * Unpack n 10-bit counts starting at pixel i0 of a packed line, in which each
+ * group of 4 pixels occupies 5 bytes, most significant bits first.  The main
+ * loop unpacks a whole group at a time so that there are no per pixel range
+ * checks.
+ ******************************************************************************/
+void su_unpack_10bit(const uchar *in, uint i0, uint n, ushort *out)
+{
+     uint i;
+     uint i1;
+
+     const uchar *p;
+
+     i1 = i0 + n;
+
+     for (i = i0; i < i1 && i % 4; ++i) {
+          p = in + i / 4 * 5 + i % 4;
+          *out++ = ((p[0] << 8 | p[1]) >> (6 - i % 4 * 2)) & 0x3FF;
+     }
+
+     for (p = in + i / 4 * 5; i + 4 <= i1; i += 4, p += 5) {
+          out[0] = ( p[0]         << 2 | p[1] >> 6) & 0x3FF;
+          out[1] = ((p[1] & 0x3F) << 4 | p[2] >> 4);
+          out[2] = ((p[2] & 0x0F) << 6 | p[3] >> 2);
+          out[3] = ((p[3] & 0x03) << 8 | p[4]);
+          out += 4;
+     }
+
+     for ( ; i < i1; ++i) {
+          p = in + i / 4 * 5 + i % 4;
+          *out++ = ((p[0] << 8 | p[1]) >> (6 - i % 4 * 2)) & 0x3FF;
+     }
+}
+
+
+
+/*******************************************************************************
+ * Pack n 10-bit counts into a line of n / 4 * 5 bytes, the inverse of
+ * su_unpack_10bit().  n must be a multiple of 4 and counts are masked to 10
+ * bits so that fill values are written as 1023.
+ ******************************************************************************/
+void su_pack_10bit(const ushort *in, uint n, uchar *out)
+{
+     uint i;
+
+     ushort a;
+     ushort b;
+     ushort c;
+     ushort d;
+
+     for (i = 0; i < n; i += 4, in += 4, out += 5) {
+          a = in[0] & 0x3FF;
+          b = in[1] & 0x3FF;
+          c = in[2] & 0x3FF;
+          d = in[3] & 0x3FF;
+
+          out[0] =  a >> 2;
+          out[1] = (a << 6 | b >> 4) & 0xFF;
+          out[2] = (b << 4 | c >> 6) & 0xFF;
+          out[3] = (c << 2 | d >> 8) & 0xFF;
+          out[4] =  d        & 0xFF;
+     }
+}
+
+
+
 /*******************************************************************************
  * Calculate and return the GSICS calibration offset from the values contained
  * in the Level 1.5 header file
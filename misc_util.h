@@ -22,6 +22,8 @@ void su_init_array_uc(uchar *a, uint n, uchar x);
 void su_init_array_us(ushort *a, uint n, ushort x);
 void su_init_array_f(float *a, uint n, float x);
 void su_init_array_d(double *a, uint n, double x);
+void su_unpack_10bit(const uchar *in, uint i0, uint n, ushort *out);
+void su_pack_10bit(const ushort *in, uint n, uchar *out);
 double su_get_ar_val(double ac, double bc, double g0);
 double su_get_br_val(double bc, double gs);
 void su_jul_to_cal_date(long jul, int *y, int *m, int *d);
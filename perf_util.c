@@ -0,0 +1,136 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#include "external.h"
+#include "internal.h"
+#include "perf_util.h"
+
+#ifdef SEVIRI_PERF
+#include <time.h>
+#endif
+
+
+const char *seviri_perf_stage_names[] = {"open", "seek", "read", "unpack", "nav",
+                                         "solar", "view", "calib", "write"};
+
+
+/*******************************************************************************
+ * Zero a seviri_perf_data struct.
+ ******************************************************************************/
+void seviri_perf_init(struct seviri_perf_data *d)
+{
+     memset(d, 0, sizeof(struct seviri_perf_data));
+#ifdef SEVIRI_PERF
+     d->enabled = 1;
+#endif
+}
+
+
+
+/*******************************************************************************
+ * Accumulate the statistics in d2 into d.
+ ******************************************************************************/
+void seviri_perf_add(struct seviri_perf_data *d, const struct seviri_perf_data *d2)
+{
+     int i;
+
+     d->enabled = d->enabled || d2->enabled;
+
+     for (i = 0; i < N_SEVIRI_PERF_STAGES; ++i) {
+          d->stage[i].wall   += d2->stage[i].wall;
+          d->stage[i].cpu    += d2->stage[i].cpu;
+          d->stage[i].calls  += d2->stage[i].calls;
+          d->stage[i].pixels += d2->stage[i].pixels;
+          d->stage[i].bytes  += d2->stage[i].bytes;
+     }
+}
+
+
+
+/*******************************************************************************
+ * Print the statistics as a JSON object with one member per stage.
+ *
+ * fp		: Output stream
+ * d		: The statistics to print
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_perf_print_json(FILE *fp, const struct seviri_perf_data *d)
+{
+     int i;
+
+     fprintf(fp, "{\n");
+     fprintf(fp, "  \"enabled\": %s,\n", d->enabled ? "true" : "false");
+     fprintf(fp, "  \"stages\": {\n");
+
+     for (i = 0; i < N_SEVIRI_PERF_STAGES; ++i) {
+          fprintf(fp, "    \"%s\": {\"wall\": %.6f, \"cpu\": %.6f, \"calls\": %lu, "
+                  "\"pixels\": %lu, \"bytes\": %lu}%s\n", seviri_perf_stage_names[i],
+                  d->stage[i].wall, d->stage[i].cpu, d->stage[i].calls,
+                  d->stage[i].pixels, d->stage[i].bytes,
+                  i < N_SEVIRI_PERF_STAGES - 1 ? "," : "");
+     }
+
+     fprintf(fp, "  }\n");
+     fprintf(fp, "}\n");
+
+     if (ferror(fp)) {
+          fprintf(stderr, "ERROR: Error writing performance statistics\n");
+          return -1;
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Start and stop a timer, adding the elapsed wall and CPU time, one call and
+ * the given pixels and bytes to a stage.
+ ******************************************************************************/
+void su_perf_start(struct su_perf_timer *t)
+{
+#ifdef SEVIRI_PERF
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     t->wall = ts.tv_sec + ts.tv_nsec / 1.e9;
+
+     clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+     t->cpu  = ts.tv_sec + ts.tv_nsec / 1.e9;
+#else
+     (void) t;
+#endif
+}
+
+
+
+void su_perf_stop(struct seviri_perf_data *d, const struct su_perf_timer *t,
+                  enum seviri_perf_stages stage, ulong pixels, ulong bytes)
+{
+#ifdef SEVIRI_PERF
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     d->stage[stage].wall += ts.tv_sec + ts.tv_nsec / 1.e9 - t->wall;
+
+     clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+     d->stage[stage].cpu  += ts.tv_sec + ts.tv_nsec / 1.e9 - t->cpu;
+
+     d->stage[stage].calls++;
+     d->stage[stage].pixels += pixels;
+     d->stage[stage].bytes  += bytes;
+#else
+     (void) d;
+     (void) t;
+     (void) stage;
+     (void) pixels;
+     (void) bytes;
+#endif
+}
@@ -0,0 +1,100 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#ifndef PERF_UTIL_H
+#define PERF_UTIL_H
+
+#include "external.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*******************************************************************************
+ * Stages for which time, calls, pixels and bytes are collected when the library
+ * is compiled with SEVIRI_PERF defined.  Otherwise the instrumentation compiles
+ * to nothing and the statistics remain zero.
+ ******************************************************************************/
+enum seviri_perf_stages {
+     SEVIRI_PERF_OPEN,		/* fopen() and fclose() */
+     SEVIRI_PERF_SEEK,		/* fseek() */
+     SEVIRI_PERF_READ,		/* fread() of headers and image data */
+     SEVIRI_PERF_UNPACK,	/* unpacking of 10 bit counts */
+     SEVIRI_PERF_NAV,		/* su_line_column_to_lat_lon() */
+     SEVIRI_PERF_SOLAR,		/* su_solar_params2() */
+     SEVIRI_PERF_VIEW,		/* su_vza_and_vaa() */
+     SEVIRI_PERF_CALIB,		/* conversion of counts to the requested units */
+     SEVIRI_PERF_WRITE,		/* output writers */
+
+     N_SEVIRI_PERF_STAGES
+};
+
+
+struct seviri_perf_stage_data {
+     double wall;		/* wall clock time (s) */
+     double cpu;		/* CPU time of the calling thread (s) */
+     ulong calls;		/* number of timed calls, I/O calls for the I/O stages */
+     ulong pixels;		/* number of pixels processed */
+     ulong bytes;		/* number of bytes read or written */
+};
+
+
+struct seviri_perf_data {
+     int enabled;		/* non-zero if compiled with SEVIRI_PERF */
+     struct seviri_perf_stage_data stage[N_SEVIRI_PERF_STAGES];
+};
+
+
+extern const char *seviri_perf_stage_names[];
+
+
+void seviri_perf_init(struct seviri_perf_data *d);
+void seviri_perf_add(struct seviri_perf_data *d, const struct seviri_perf_data *d2);
+int seviri_perf_print_json(FILE *fp, const struct seviri_perf_data *d);
+
+
+/*******************************************************************************
+ * Internal timer and instrumentation macros.  perf may be NULL in which case
+ * nothing is collected.
+ ******************************************************************************/
+struct su_perf_timer {
+     double wall;
+     double cpu;
+};
+
+
+void su_perf_start(struct su_perf_timer *t);
+void su_perf_stop(struct seviri_perf_data *d, const struct su_perf_timer *t,
+                  enum seviri_perf_stages stage, ulong pixels, ulong bytes);
+
+
+#define SU_PERF_TIMER(T)	struct su_perf_timer T
+
+#ifdef SEVIRI_PERF
+#define SU_PERF_START(PERF, T) do { \
+     if (PERF) su_perf_start(&T); \
+} while (0)
+#define SU_PERF_STOP(PERF, T, STAGE, PIXELS, BYTES) do { \
+     if (PERF) su_perf_stop(PERF, &T, STAGE, PIXELS, BYTES); \
+} while (0)
+#else
+#define SU_PERF_START(PERF, T) do { (void) (PERF); (void) &(T); } while (0)
+#define SU_PERF_STOP(PERF, T, STAGE, PIXELS, BYTES) do { \
+     (void) (PERF); (void) &(T); \
+} while (0)
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_UTIL_H */
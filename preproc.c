@@ -13,6 +13,7 @@
 #include "hrit_anc_funcs.h"
 #include "internal.h"
 #include "preproc.h"
+#include "read_write_bsq.h"
 #include "read_write_hrit.h"
 #include "read_write_nat.h"
 
@@ -32,9 +33,9 @@ static double TIME_CDS_SHORT_to_jtime(const struct seviri_TIME_CDS_SHORT_data *d
 /*******************************************************************************
  * This function computes the number of days since satellite launch, based upon
  * the image time and a const array storing launch dates. Needed for the NASA
- * VIS calibration routines.
+ * VIS calibration routines.  Returns non-zero for an unrecognised satellite.
  ******************************************************************************/
-static long get_time_since_launch(const struct seviri_data *d) {
+static int get_time_since_launch(const struct seviri_data *d, long *days) {
 
      short  satnum;
      double jtime_start, jtime_end, jtime;
@@ -47,6 +48,11 @@ static long get_time_since_launch(const struct seviri_data *d) {
 
      satnum = d->trailer.ImageProductionStats.SatelliteID;
 
+     if (satnum < 321 || satnum > 324) {
+          fprintf(stderr, "ERROR: Unrecognised satellite platform: %d\n", satnum);
+          return -1;
+     }
+
      jtime_start = TIME_CDS_SHORT_to_jtime(
           &d->trailer.ImageProductionStats.ActScanForwardStart);
      jtime_end   = TIME_CDS_SHORT_to_jtime(
@@ -56,7 +62,9 @@ static long get_time_since_launch(const struct seviri_data *d) {
 
      dayssince = jtime - launches[satnum-321];
 
-     return dayssince;
+     *days = dayssince;
+
+     return 0;
 }
 
 
@@ -64,8 +72,9 @@ static long get_time_since_launch(const struct seviri_data *d) {
 /*******************************************************************************
  * This function generates an array of NASA calibration values for the VIS
  * channels based upon satellite ID, band and days since satellite launch.
+ * Returns non-zero for an unrecognised satellite.
  ******************************************************************************/
-static void get_nasa_calib(short satnum, int band_id, long dayssince, double *retval) {
+static int get_nasa_calib(short satnum, int band_id, long dayssince, double *retval) {
 
      // Define arrays with g0, g1 and g2 values for each satellite
      // MSG-1 has two sets, one pre- and one post-IODC move.
@@ -173,8 +182,10 @@ static void get_nasa_calib(short satnum, int band_id, long dayssince, double *re
      }
      else {
           fprintf(stderr, "ERROR: Unrecognised satellite platform: %d\n", satnum);
-          exit(-1);
+          return -1;
      }
+
+     return 0;
 }
 
 
@@ -223,23 +234,441 @@ static void get_cal_slope_and_offset(const struct seviri_data *d, int band_id,
 
 
 
+/*******************************************************************************
+ * Convert the counts of one band to the requested unit.  The same code is used
+ * for the VIR images and, with factor = 3, for the HRV image, in which case
+ * each 3 x 3 block of pixels uses the solar zenith angle of the VIR pixel it
+ * falls in.
+ *
+ * d		: The main input SEVIRI level 1.5 seviri_data struct
+ * band_id	: The band ID (1 -> 12)
+ * unit		: The output unit
+ * i_sat	: Index of the satellite in satellite_ids
+ * day_of_year	: Day of the year for the center of the image scan
+ * counts	: Image of counts of length n_lines * n_columns
+ * sza		: Image of solar zenith angle of length
+ *                n_lines / factor * n_columns / factor
+ * factor	: Ratio of the resolution of counts to that of sza
+ * data		: Output image of length n_lines * n_columns
+ * cal_slope	: Output calibration slope or NULL
+ * perf		: Statistics to add the calibration time to
+ * stats	: Statistics of the band to add each line to once calibrated,
+ *                or NULL
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+static int calibrate_band(const struct seviri_data *d, int band_id,
+                          enum seviri_units unit, uint i_sat, double day_of_year,
+                          int do_gsics, int do_nasa, const ushort *counts,
+                          uint n_lines, uint n_columns, const float *sza,
+                          uint factor, float *data, float *cal_slope,
+                          struct seviri_perf_data *perf,
+                          struct seviri_band_stats *stats)
+{
+     uint j;
+     uint k;
+     uint kk;
+     uint m;
+
+     uint i_image;
+
+     const double c1 = 1.19104e-5;
+     const double c2 = 1.43877;
+
+     double a;
+     double b;
+     double c;
+     double e;
+
+     double slope;
+     double offset;
+
+     double R;
+
+     double nu;
+
+     double L;
+
+     long  ldays   = 0;
+     double calivals[3];
+
+     const float *sza_line;
+
+     SU_PERF_TIMER(timer);
+
+     /* The NASA calibration is only defined for the VIS channels. */
+     do_nasa = do_nasa && band_id <= 3;
+
+
+     /*-------------------------------------------------------------------------
+      * Extract the raw pixel counts only. Do not scale or transform in any way.
+      *-----------------------------------------------------------------------*/
+     if (unit == SEVIRI_UNIT_CNT) {
+          SU_PERF_START(perf, timer);
+          for (j = 0; j < n_lines; ++j) {
+               for (k = 0; k < n_columns; ++k) {
+                    i_image = j * n_columns + k;
+
+                    if (counts[i_image] != FILL_VALUE_US && counts[i_image] > 0) {
+                         L = counts[i_image];
+
+                         data[i_image] = L;
+                    }
+               }
+               if (stats)
+                    seviri_stats_add_line(stats, counts + j * n_columns,
+                                          data + j * n_columns, n_columns,
+                                          FILL_VALUE_F);
+          }
+          SU_PERF_STOP(perf, timer, SEVIRI_PERF_CALIB, n_lines * n_columns, 0);
+
+          return 0;
+     }
+
+
+     get_cal_slope_and_offset(d, band_id, do_gsics, &slope, &offset, &do_nasa);
+
+     if (do_nasa && unit != SEVIRI_UNIT_BT) {
+          if (get_time_since_launch(d, &ldays)) {
+               fprintf(stderr, "ERROR: get_time_since_launch()\n");
+               return -1;
+          }
+          if (get_nasa_calib(d->trailer.ImageProductionStats.SatelliteID,
+                             band_id-1, ldays, calivals)) {
+               fprintf(stderr, "ERROR: get_nasa_calib()\n");
+               return -1;
+          }
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Compute radiance.
+      *
+      * Ref: PDF_TEN_05105_MSG_IMG_DATA, Page 26
+      *-----------------------------------------------------------------------*/
+     if (unit == SEVIRI_UNIT_RAD) {
+          if (cal_slope)
+               *cal_slope = slope;
+
+          SU_PERF_START(perf, timer);
+          for (j = 0; j < n_lines; ++j) {
+               for (k = 0; k < n_columns; ++k) {
+                    i_image = j * n_columns + k;
+                    if (do_nasa)
+                         data[i_image] = (counts[i_image] - calivals[1]) * calivals[0];
+                    else {
+                         if (counts[i_image] != FILL_VALUE_US && counts[i_image] > 0)
+                              data[i_image] = counts[i_image] * slope + offset;
+                    }
+               }
+               if (stats)
+                    seviri_stats_add_line(stats, counts + j * n_columns,
+                                          data + j * n_columns, n_columns,
+                                          FILL_VALUE_F);
+          }
+          SU_PERF_STOP(perf, timer, SEVIRI_PERF_CALIB, n_lines * n_columns, 0);
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Compute reflectance or bidirectional reflectance factor (BRF).
+      *
+      * Ref: PDF_MSG_SEVIRI_RAD2REFL, Page 8
+      *-----------------------------------------------------------------------*/
+     else if (unit == SEVIRI_UNIT_REF || unit == SEVIRI_UNIT_BRF) {
+          if (cal_slope)
+               *cal_slope = slope;
+
+          a = su_solar_distance_factor2(day_of_year);
+
+          b = 1. / (a * band_solar_irradiance[i_sat][band_id - 1]);
+
+          SU_PERF_START(perf, timer);
+          for (j = 0; j < n_lines; ++j) {
+               sza_line = sza + j / factor * (n_columns / factor);
+
+               /* kk is the column in sza, advanced every factor columns. */
+               for (k = 0, kk = 0, m = 0; k < n_columns; ++k) {
+                    i_image = j * n_columns + k;
+
+                    if (do_nasa) {
+                         if (counts[i_image] <= calivals[1])
+                              data[i_image] = 51;
+
+                         R = (counts[i_image] - calivals[1]) * calivals[0];
+                         data[i_image] = R / (calivals[2] * a);
+
+                         if (unit == SEVIRI_UNIT_BRF)
+                              data[i_image] /= cos(sza_line[kk] * D2R);
+
+                         if (data[i_image] < -1.0)
+                              data[i_image] = FILL_VALUE_F;
+                    }
+                    else {
+                         if (counts[i_image] != FILL_VALUE_US && counts[i_image] > 0 &&
+                             sza_line[kk] >= 0. && sza_line[kk] < 90.) {
+
+                              R = counts[i_image] * slope + offset;
+                              data[i_image] = PI * b * R;
+
+                              if (unit == SEVIRI_UNIT_BRF) {
+                                   data[i_image] /= cos(sza_line[kk] * D2R);
+                              }
+                         }
+                    }
+
+                    if (++m == factor) {
+                         m = 0;
+                         kk++;
+                    }
+               }
+               if (stats)
+                    seviri_stats_add_line(stats, counts + j * n_columns,
+                                          data + j * n_columns, n_columns,
+                                          FILL_VALUE_F);
+          }
+          SU_PERF_STOP(perf, timer, SEVIRI_PERF_CALIB, n_lines * n_columns, 0);
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Compute brightness temperature.
+      *
+      * Ref: PDF_TEN_05105_MSG_IMG_DATA, Page 26
+      *-----------------------------------------------------------------------*/
+     else if (unit == SEVIRI_UNIT_BT) {
+          if (cal_slope)
+               *cal_slope = FILL_VALUE_F;
+/*
+          nu = 1.e4 / channel_center_wavelength[band_id - 1];
+*/
+          nu = bt_nu_c[i_sat][band_id - 1];
+
+          a = bt_A[i_sat][band_id - 1];
+          b = bt_B[i_sat][band_id - 1];
+
+          c = c2 * nu;
+          e = nu * nu * nu * c1;
+
+          SU_PERF_START(perf, timer);
+          for (j = 0; j < n_lines; ++j) {
+               for (k = 0; k < n_columns; ++k) {
+                    i_image = j * n_columns + k;
+
+                    if (counts[i_image] != FILL_VALUE_US && counts[i_image] > 0) {
+                         L = counts[i_image] * slope + offset;
+
+                         data[i_image] = (c / log(1. + e / L) - b) / a;
+                    }
+               }
+               if (stats)
+                    seviri_stats_add_line(stats, counts + j * n_columns,
+                                          data + j * n_columns, n_columns,
+                                          FILL_VALUE_F);
+          }
+          SU_PERF_STOP(perf, timer, SEVIRI_PERF_CALIB, n_lines * n_columns, 0);
+     }
+
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Initialize a cache of latitude and longitude images to be shared by the
+ * pre-processing of many images.  Given to seviri_preproc() in the nav_cache
+ * member of struct seviri_options, the images of an image with the same
+ * navigation and bounds as one pre-processed before are looked up in it rather
+ * than computed again.
+ *
+ * cache	: The cache
+ * max_size	: The maximum size in bytes of the images kept, beyond which
+ *                images with new bounds are computed but not kept
+ * lock		: Function locking the cache if it is used by several threads
+ *                or NULL
+ * lock_data	: User data passed on to lock
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_nav_cache_init(struct seviri_nav_cache *cache, size_t max_size,
+                          seviri_nav_lock_func lock, void *lock_data)
+{
+     cache->max_size    = max_size;
+     cache->size        = 0;
+     cache->entries     = NULL;
+     cache->lock        = lock;
+     cache->lock_data   = lock_data;
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Free the images kept by a cache initialized with seviri_nav_cache_init().
+ *
+ * cache	: The cache
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_nav_cache_free(struct seviri_nav_cache *cache)
+{
+     struct seviri_nav_entry *entry;
+
+     while (cache->entries) {
+          entry = cache->entries;
+          cache->entries = entry->next;
+          free(entry->lat);
+          free(entry);
+     }
+
+     cache->size = 0;
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Find the cached images for the given navigation and bounds, with the cache
+ * locked.  Entries are never changed once added, so they may be read once the
+ * cache is unlocked.
+ ******************************************************************************/
+static struct seviri_nav_entry *nav_cache_scan(
+     const struct seviri_nav_cache *cache, double lon0, uchar earthmod,
+     uint i_line, uint i_column, uint n_lines, uint n_columns)
+{
+     struct seviri_nav_entry *entry;
+
+     for (entry = cache->entries; entry; entry = entry->next) {
+          if (entry->lon0 == lon0 && entry->earthmod == earthmod &&
+              entry->i_line == i_line && entry->i_column == i_column &&
+              entry->n_lines == n_lines && entry->n_columns == n_columns)
+               break;
+     }
+
+     return entry;
+}
+
+static const struct seviri_nav_entry *nav_cache_find(
+     struct seviri_nav_cache *cache, double lon0, uchar earthmod,
+     uint i_line, uint i_column, uint n_lines, uint n_columns)
+{
+     struct seviri_nav_entry *entry;
+
+     if (cache->lock)
+          cache->lock(cache->lock_data, 1);
+
+     entry = nav_cache_scan(cache, lon0, earthmod, i_line, i_column, n_lines,
+                            n_columns);
+
+     if (cache->lock)
+          cache->lock(cache->lock_data, 0);
+
+     return entry;
+}
+
+
+
+/*******************************************************************************
+ * Add a copy of the given images to the cache, unless it is full or another
+ * thread has added them in the meantime.
+ ******************************************************************************/
+static void nav_cache_add(struct seviri_nav_cache *cache, double lon0,
+                          uchar earthmod, uint i_line, uint i_column,
+                          uint n_lines, uint n_columns,
+                          const float *lat, const float *lon)
+{
+     int full;
+
+     uint length;
+
+     struct seviri_nav_entry *entry;
+
+     length = n_lines * n_columns;
+
+     if (cache->lock)
+          cache->lock(cache->lock_data, 1);
+
+     full = cache->size + 2 * length * sizeof(float) > cache->max_size;
+
+     if (cache->lock)
+          cache->lock(cache->lock_data, 0);
+
+     if (full)
+          return;
+
+     if ((entry = malloc(sizeof(struct seviri_nav_entry))) == NULL)
+          return;
+
+     if ((entry->lat = malloc(2 * length * sizeof(float))) == NULL) {
+          free(entry);
+          return;
+     }
+
+     entry->lon = entry->lat + length;
+
+     memcpy(entry->lat, lat, length * sizeof(float));
+     memcpy(entry->lon, lon, length * sizeof(float));
+
+     entry->lon0      = lon0;
+     entry->earthmod  = earthmod;
+     entry->i_line    = i_line;
+     entry->i_column  = i_column;
+     entry->n_lines   = n_lines;
+     entry->n_columns = n_columns;
+
+     if (cache->lock)
+          cache->lock(cache->lock_data, 1);
+
+     if (cache->size + 2 * length * sizeof(float) <= cache->max_size &&
+         ! nav_cache_scan(cache, lon0, earthmod, i_line, i_column, n_lines,
+                          n_columns)) {
+          entry->next    = cache->entries;
+          cache->entries = entry;
+          cache->size   += 2 * length * sizeof(float);
+          entry = NULL;
+     }
+
+     if (cache->lock)
+          cache->lock(cache->lock_data, 0);
+
+     if (entry) {
+          free(entry->lat);
+          free(entry);
+     }
+}
+
+
+
 /*******************************************************************************
  * Main pre-processing function which includes the computation of Julian Day,
  * latitude, longitude, solar zenith and azimuth angles, viewing zenith and
  * and azimuth angles, and either radiance, reflectance, or brightness
  * temperature for each requested channel.
  *
+ * Time only depends on the line so it is stored once per line in time_line and
+ * the image of time is only expanded on request with seviri_preproc_time(). If
+ * do_not_alloc is set and time is not NULL the image of time is filled here.
+ *
  * d		: The main input SEVIRI level 1.5 seviri_data struct
  * d2		: The struct containing the preprocessed output
  * band_units	: Array of band_unit types of length n_bands
  * do_not_alloc	: Flag indicating not to allocate space for the output data.
  *                Useful for avoiding unnecessary memory allocations and use.
+ *                lat_hrv, lon_hrv and data_hrv must then also be set, either
+ *                to arrays of length 9 * n_lines * n_columns or to NULL to
+ *                skip the full resolution HRV image.
+ * opts		: Options of the pre-processing (see read_write.h) or NULL for
+ *                the defaults
  *
  * returns	: Non-zero on error
  ******************************************************************************/
 int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
                    const enum seviri_units *band_units, int rss, int do_gsics,
-                   int do_nasa, char satposstr[128], int do_not_alloc)
+                   int do_nasa, char satposstr[128], int do_not_alloc,
+                   const struct seviri_options *opts)
 {
      uint i;
      uint ii;
@@ -247,6 +676,7 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
      uint k;
 
      uint length;
+     uint length_hrv;
 
      uint i_sat;
 
@@ -256,14 +686,6 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
      int month;
      int day;
 
-     const double c1 = 1.19104e-5;
-     const double c2 = 1.43877;
-
-     double a;
-     double b;
-     double c;
-     double e;
-
      double jtime;
      double jtime2;
 
@@ -285,20 +707,9 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
      double theta0;
      double phi0;
 
-     double slope;
-     double offset;
-
      double day_of_year;
 
-     double R;
-
-     double nu;
-
-     double L;
-
      int nav_off = 0;
-     long  ldays   = 0;
-     double calivals[3];
 
      int ORBITCOEF_SIZE = 8;
      double dx=0, dy=0, dz=0;
@@ -306,6 +717,12 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
      double savex=0, savey=0, savez=0;
      double t2;
 
+     const struct seviri_nav_entry *nav_entry;
+
+     SU_PERF_TIMER(timer);
+
+     opts = seviri_options_get(opts);
+
      if (rss)
           nav_off = 464 * 5;
 
@@ -355,18 +772,40 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
      d2->n_columns  = d->image.n_columns;
      d2->fill_value = FILL_VALUE_F;
 
+     /* The full resolution HRV image is only produced if the HRV band is one
+        of the bands and was read at full resolution. */
+     d2->n_lines_hrv   = 0;
+     d2->n_columns_hrv = 0;
+     for (i = 0; i < d->image.n_bands; ++i) {
+          if (d->image.band_ids[i] == 12 && d->image.data_hrv) {
+               d2->n_lines_hrv   = d->image.n_lines_hrv;
+               d2->n_columns_hrv = d->image.n_columns_hrv;
+          }
+     }
+
+     if (do_not_alloc && (! d2->lat_hrv || ! d2->lon_hrv || ! d2->data_hrv)) {
+          d2->n_lines_hrv   = 0;
+          d2->n_columns_hrv = 0;
+     }
+
+     d2->perf       = d->perf;
+
 
      /*-------------------------------------------------------------------------
       * Allocate and initialize memory.
       *-----------------------------------------------------------------------*/
      length = d->image.n_lines * d->image.n_columns;
 
+     length_hrv = d2->n_lines_hrv * d2->n_columns_hrv;
+
+     d2->memory_alloc_t = 0;
+
      if (do_not_alloc)
           d2->memory_alloc_d = 0;
      else {
           d2->memory_alloc_d = 1;
 
-          d2->time  = malloc(length * sizeof(double));
+          d2->time  = NULL;
           d2->lat   = malloc(length * sizeof(float));
           d2->lon   = malloc(length * sizeof(float));
           d2->sza   = malloc(length * sizeof(float));
@@ -376,16 +815,36 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
           d2->cal_slope   = malloc(d->image.n_bands * sizeof(float));
 
           d2->data2 = malloc(d->image.n_bands * length * sizeof(float *));
+
+          d2->lat_hrv  = NULL;
+          d2->lon_hrv  = NULL;
+          d2->data_hrv = NULL;
+          if (length_hrv > 0) {
+               d2->lat_hrv  = malloc(length_hrv * sizeof(float));
+               d2->lon_hrv  = malloc(length_hrv * sizeof(float));
+               d2->data_hrv = malloc(length_hrv * sizeof(float));
+          }
      }
 
 
+     d2->time_line = malloc(d->image.n_lines * sizeof(double));
+
+     d2->stats.n_bands = 0;
+     d2->stats.band    = NULL;
+     if (opts->stats) {
+          d2->stats.n_bands = d->image.n_bands;
+          d2->stats.band    = malloc(d->image.n_bands *
+                                     sizeof(struct seviri_band_stats));
+          for (i = 0; i < d->image.n_bands; ++i)
+               seviri_stats_init(&d2->stats.band[i]);
+     }
+
      d2->data = malloc(d->image.n_bands * sizeof(float **));
 
      for (i = 0; i < d->image.n_bands; ++i)
           d2->data[i] = &d2->data2[i * length];
 
 
-     su_init_array_d(d2->time, length, d2->fill_value);
      su_init_array_f(d2->lat,  length, d2->fill_value);
      su_init_array_f(d2->lon,  length, d2->fill_value);
      su_init_array_f(d2->sza,  length, d2->fill_value);
@@ -395,6 +854,12 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
 
      su_init_array_f(d2->data2, d->image.n_bands * length, d2->fill_value);
 
+     if (length_hrv > 0) {
+          su_init_array_f(d2->lat_hrv,  length_hrv, d2->fill_value);
+          su_init_array_f(d2->lon_hrv,  length_hrv, d2->fill_value);
+          su_init_array_f(d2->data_hrv, length_hrv, d2->fill_value);
+     }
+
 
      /*-------------------------------------------------------------------------
       * Compute the day of the year for the center of the image scan.
@@ -463,24 +928,58 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
       *-----------------------------------------------------------------------*/
      lon0 = d->header.ImageDescription.LongitudeOfSSP;
      earthmod = d->header.GeometricProcessing.TypeOfEarthModel;
-     
+
+     /* The latitude and longitude only depend on the navigation and the bounds
+        so they are taken from the cache, if one is given, when possible. */
+     nav_entry = NULL;
+     if (opts->nav_cache)
+          nav_entry = nav_cache_find(opts->nav_cache, lon0, earthmod,
+                                     d->image.i_line + nav_off, d->image.i_column,
+                                     d->image.n_lines, d->image.n_columns);
+
+     if (nav_entry) {
+          SU_PERF_START(&d2->perf, timer);
+          memcpy(d2->lat, nav_entry->lat, length * sizeof(float));
+          memcpy(d2->lon, nav_entry->lon, length * sizeof(float));
+          SU_PERF_STOP(&d2->perf, timer, SEVIRI_PERF_NAV, length, 0);
+     }
+     else {
+          for (i = 0; i < d->image.n_lines; ++i) {
+               ii = d->image.i_line + i;
+
+               SU_PERF_START(&d2->perf, timer);
+               for (j = 0; j < d->image.n_columns; ++j) {
+                    i_image = i * d->image.n_columns + j;
+
+                    su_line_column_to_lat_lon(ii + 1 + nav_off, d->image.i_column + j + 1,
+                                              &d2->lat[i_image], &d2->lon[i_image],
+                                              lon0, &nav_scaling_factors_vir, earthmod);
+               }
+               SU_PERF_STOP(&d2->perf, timer, SEVIRI_PERF_NAV, d->image.n_columns, 0);
+          }
+
+          if (opts->nav_cache && length > 0)
+               nav_cache_add(opts->nav_cache, lon0, earthmod, d->image.i_line + nav_off,
+                             d->image.i_column, d->image.n_lines,
+                             d->image.n_columns, d2->lat, d2->lon);
+     }
+
      for (i = 0; i < d->image.n_lines; ++i) {
           ii = d->image.i_line + i;
 
           jtime2 = jtime_start + (double) ii / (double) (IMAGE_SIZE_VIR_LINES - 1) *
                    (jtime_end - jtime_start);
 
+          d2->time_line[i] = jtime2;
+
+          /* The solar and viewing geometry are computed in separate passes
+             over the line so that each can be timed. */
+          SU_PERF_START(&d2->perf, timer);
           for (j = 0; j < d->image.n_columns; ++j) {
                i_image = i * d->image.n_columns + j;
 
-               su_line_column_to_lat_lon(ii + 1 + nav_off, d->image.i_column + j + 1,
-                                         &d2->lat[i_image], &d2->lon[i_image],
-                                         lon0, &nav_scaling_factors_vir, earthmod);
-
                if (d2->lat[i_image] != FILL_VALUE_F &&
                    d2->lon[i_image] != FILL_VALUE_F) {
-                    d2->time[i_image] = jtime2;
-
                     su_solar_params2(jtime2, d2->lat[i_image] * D2R,
                                      d2->lon[i_image] * D2R, &mu0, &theta0,
                                      &phi0, NULL);
@@ -490,7 +989,16 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
                     d2->saa[i_image] = d2->saa[i_image] + 180.;
                     if (d2->saa[i_image] > 360.)
                          d2->saa[i_image] = d2->saa[i_image] - 360.;
+               }
+          }
+          SU_PERF_STOP(&d2->perf, timer, SEVIRI_PERF_SOLAR, d->image.n_columns, 0);
+
+          SU_PERF_START(&d2->perf, timer);
+          for (j = 0; j < d->image.n_columns; ++j) {
+               i_image = i * d->image.n_columns + j;
 
+               if (d2->lat[i_image] != FILL_VALUE_F &&
+                   d2->lon[i_image] != FILL_VALUE_F) {
                     su_vza_and_vaa(d2->lat[i_image], d2->lon[i_image], 0.,
                                    X, Y, Z, &d2->vza[i_image], &d2->vaa[i_image]);
 
@@ -499,9 +1007,30 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
                          d2->vaa[i_image] = d2->vaa[i_image] - 360.;
                }
           }
+          SU_PERF_STOP(&d2->perf, timer, SEVIRI_PERF_VIEW, d->image.n_columns, 0);
      }
 
 
+     /* The HRV latitude and longitude on the HRV reference grid. */
+     for (i = 0; i < d2->n_lines_hrv; ++i) {
+          ii = 3 * (d->image.i_line + nav_off) + i;
+
+          SU_PERF_START(&d2->perf, timer);
+          for (j = 0; j < d2->n_columns_hrv; ++j) {
+               i_image = i * d2->n_columns_hrv + j;
+
+               su_line_column_to_lat_lon(ii + 1, 3 * d->image.i_column + j + 1,
+                                         &d2->lat_hrv[i_image], &d2->lon_hrv[i_image],
+                                         lon0, &nav_scaling_factors_hrv, earthmod);
+          }
+          SU_PERF_STOP(&d2->perf, timer, SEVIRI_PERF_NAV, d2->n_columns_hrv, 0);
+     }
+
+
+     if (d2->time)
+          seviri_preproc_expand_time(d2, d2->time);
+
+
      /*-------------------------------------------------------------------------
       * Compute the satellite position string.
       *-----------------------------------------------------------------------*/
@@ -531,157 +1060,100 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
 
 
      /*-------------------------------------------------------------------------
-      * Extract the raw pixel counts only. Do not scale or transform in any way.
+      * Convert the counts of each band to the requested units, including the
+      * full resolution HRV image.
       *-----------------------------------------------------------------------*/
      for (i = 0; i < d->image.n_bands; ++i) {
-          if (band_units[i] == SEVIRI_UNIT_CNT) {
-
-               for (j = 0; j < d->image.n_lines; ++j) {
-                    for (k = 0; k < d->image.n_columns; ++k) {
-                         i_image = j * d->image.n_columns + k;
-
-                         if (d->image.data_vir[i][i_image] != FILL_VALUE_US &&
-                             d->image.data_vir[i][i_image] > 0) {
-                              L = d->image.data_vir[i][i_image];
-
-                              d2->data[i][i_image] = L;
-                         }
-                    }
-               }
+          if (calibrate_band(d, d->image.band_ids[i], band_units[i], i_sat,
+                             day_of_year, do_gsics, do_nasa, d->image.data_vir[i],
+                             d->image.n_lines, d->image.n_columns, d2->sza, 1,
+                             d2->data[i], &d2->cal_slope[i], &d2->perf,
+                             d2->stats.band ? &d2->stats.band[i] : NULL)) {
+               fprintf(stderr, "ERROR: calibrate_band()\n");
+               return -1;
           }
-     }
-
-
-     /*-------------------------------------------------------------------------
-      * Compute radiance for the bands requested.
-      *
-      * Ref: PDF_TEN_05105_MSG_IMG_DATA, Page 26
-      *-----------------------------------------------------------------------*/
-     for (i = 0; i < d->image.n_bands; ++i) {
-          if (band_units[i] == SEVIRI_UNIT_RAD) {
-               get_cal_slope_and_offset(d, d->image.band_ids[i], do_gsics,
-                                        &slope, &offset, &do_nasa);
-               d2->cal_slope[i] = slope;
-
-               if (do_nasa) {
-                    ldays = get_time_since_launch(d);
-                    get_nasa_calib(d->trailer.ImageProductionStats.SatelliteID,
-                                   d->image.band_ids[i]-1, ldays, calivals);
-               }
 
-               for (j = 0; j < d->image.n_lines; ++j) {
-                    for (k = 0; k < d->image.n_columns; ++k) {
-                         i_image = j * d->image.n_columns + k;
-                         if (do_nasa)
-                              d2->data[i][i_image] = (d->image.data_vir[i][i_image] -
-                                                      calivals[1]) * calivals[0];
-                         else {
-                              if (d->image.data_vir[i][i_image] != FILL_VALUE_US &&
-                                  d->image.data_vir[i][i_image] > 0)
-                                   d2->data[i][i_image] =
-                                        d->image.data_vir[i][i_image] * slope + offset;
-                         }
-                    }
+          if (d->image.band_ids[i] == 12 && d2->n_lines_hrv > 0) {
+               if (calibrate_band(d, 12, band_units[i], i_sat, day_of_year,
+                                  do_gsics, do_nasa, d->image.data_hrv,
+                                  d2->n_lines_hrv, d2->n_columns_hrv, d2->sza, 3,
+                                  d2->data_hrv, NULL, &d2->perf, NULL)) {
+                    fprintf(stderr, "ERROR: calibrate_band()\n");
+                    return -1;
                }
           }
      }
 
 
-     /*-------------------------------------------------------------------------
-      * Compute reflectance or bidirectional reflectance factor (BRF) for the
-      * bands requested.
-      *
-      * Ref: PDF_MSG_SEVIRI_RAD2REFL, Page 8
-      *-----------------------------------------------------------------------*/
-     a = su_solar_distance_factor2(day_of_year);
-
-     for (i = 0; i < d->image.n_bands; ++i) {
-          if (band_units[i] == SEVIRI_UNIT_REF || band_units[i] == SEVIRI_UNIT_BRF) {
-               get_cal_slope_and_offset(d, d->image.band_ids[i], do_gsics,&slope,
-                                        &offset, &do_nasa);
-               d2->cal_slope[i] = slope;
-
-               b = 1. / (a * band_solar_irradiance[i_sat][d->image.band_ids[i] - 1]);
-
-               if (do_nasa) {
-                    ldays = get_time_since_launch(d);
-                    get_nasa_calib(d->trailer.ImageProductionStats.SatelliteID,
-                                   d->image.band_ids[i]-1, ldays, calivals);
-               }
+     return 0;
+}
 
-               for (j = 0; j < d->image.n_lines; ++j) {
-                    for (k = 0; k < d->image.n_columns; ++k) {
-                         i_image = j * d->image.n_columns + k;
 
-                         if (do_nasa) {
-                              if (d->image.data_vir[i][i_image] <= calivals[1])
-                                   d2->data[i][i_image] = 51;
 
-                              R = (d->image.data_vir[i][i_image] - calivals[1]) *
-                                  calivals[0];
-                              d2->data[i][i_image] = R / (calivals[2] * a);
+/*******************************************************************************
+ * Pre-process a block of lines of the image only, for example those completed
+ * so far by an incremental HRIT ingest (see seviri_hrit_ingest_init()).  The
+ * output is as from seviri_preproc() for an image of the given lines.
+ *
+ * d		: The main input SEVIRI level 1.5 seviri_data struct
+ * d2		: The struct containing the preprocessed output for the lines
+ * band_units	: Described in the seviri_preproc() header
+ * rss		:      ''
+ * do_gsics	:      ''
+ * do_nasa	:      ''
+ * satposstr	:      ''
+ * i_line	: First line of the block within the image
+ * n_lines	: Number of lines in the block
+ * opts		: Described in the seviri_preproc() header
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_preproc_lines(const struct seviri_data *d, struct seviri_preproc_data *d2,
+                         const enum seviri_units *band_units, int rss, int do_gsics,
+                         int do_nasa, char satposstr[128], uint i_line, uint n_lines,
+                         const struct seviri_options *opts)
+{
+     uint i;
 
-                              if (band_units[i] == SEVIRI_UNIT_BRF)
-                                   d2->data[i][i_image] /= cos(d2->sza[i_image] * D2R);
+     int status;
 
-                              if (d2->data[i][i_image] < -1.0)
-                                   d2->data[i][i_image] = FILL_VALUE_F;
-                         }
-                         else {
-                              if (d->image.data_vir[i][i_image] != FILL_VALUE_US &&
-                                  d->image.data_vir[i][i_image] > 0 &&
-                                    d2->sza[i_image] >= 0. && d2->sza[i_image] < 90.) {
+     ushort *data_vir[SEVIRI_N_BANDS];
 
-                                   R = d->image.data_vir[i][i_image] * slope + offset;
-                                   d2->data[i][i_image] = PI * b * R;
+     struct seviri_data *d3;
 
-                                   if (band_units[i] == SEVIRI_UNIT_BRF) {
-                                        d2->data[i][i_image] /= cos(d2->sza[i_image] * D2R);
-                                   }
-                              }
-                         }
-                    }
-               }
-          }
+     if (n_lines == 0 || i_line + n_lines > d->image.n_lines) {
+          fprintf(stderr, "ERROR: Lines %u to %u are not within the image\n",
+                  i_line, i_line + n_lines - 1);
+          return -1;
      }
 
+     /* A shallow copy of the input with the image restricted to the lines. */
+     d3 = malloc(sizeof(struct seviri_data));
 
-     /*-------------------------------------------------------------------------
-      * Compute brightness temperature for the bands requested.
-      *
-      * Ref: PDF_TEN_05105_MSG_IMG_DATA, Page 26
-      *-----------------------------------------------------------------------*/
-     for (i = 0; i < d->image.n_bands; ++i) {
-          if (band_units[i] == SEVIRI_UNIT_BT) {
-               get_cal_slope_and_offset(d, d->image.band_ids[i], do_gsics,
-                                        &slope, &offset, &do_nasa);
-               d2->cal_slope[i] = FILL_VALUE_F;
-/*
-               nu = 1.e4 / channel_center_wavelength[d->image.band_ids[i] - 1];
-*/
-               nu = bt_nu_c[i_sat][d->image.band_ids[i] - 1];
+     *d3 = *d;
 
-               a = bt_A[i_sat][d->image.band_ids[i] - 1];
-               b = bt_B[i_sat][d->image.band_ids[i] - 1];
+     for (i = 0; i < d->image.n_bands; ++i)
+          data_vir[i] = d->image.data_vir[i] + i_line * d->image.n_columns;
 
-               c = c2 * nu;
-               e = nu * nu * nu * c1;
+     d3->image.i_line  += i_line;
+     d3->image.n_lines  = n_lines;
+     d3->image.data_vir = data_vir;
 
-               for (j = 0; j < d->image.n_lines; ++j) {
-                    for (k = 0; k < d->image.n_columns; ++k) {
-                         i_image = j * d->image.n_columns + k;
+     if (d->image.data_hrv) {
+          d3->image.n_lines_hrv = 3 * n_lines;
+          d3->image.data_hrv    = d->image.data_hrv +
+                                  3 * i_line * d->image.n_columns_hrv;
+     }
 
-                         if (d->image.data_vir[i][i_image] != FILL_VALUE_US &&
-                             d->image.data_vir[i][i_image] > 0) {
-                              L = d->image.data_vir[i][i_image] * slope + offset;
+     status = seviri_preproc(d3, d2, band_units, rss, do_gsics, do_nasa,
+                             satposstr, 0, opts);
 
-                              d2->data[i][i_image] = (c / log(1. + e / L) - b) / a;
-                         }
-                    }
-               }
-          }
-     }
+     free(d3);
 
+     if (status) {
+          fprintf(stderr, "ERROR: seviri_preproc()\n");
+          return -1;
+     }
 
      return 0;
 }
@@ -711,6 +1183,8 @@ int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
  *                parallax correction.
  * do_not_alloc	: Flag indicating not to allocate space for the output data.
  *                Useful for avoiding unnecessary memory allocations and use.
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
  *
  * returns	: Non-zero on error
  ******************************************************************************/
@@ -722,20 +1196,63 @@ int seviri_read_and_preproc_nat(const char *filename,
                                 uint line0, uint line1, uint column0, uint column1,
                                 double lat0, double lat1, double lon0, double lon1,
                                 int do_gsics, int do_nasa, char satposstr[128],
-                                int do_not_alloc)
+                                int do_not_alloc, const struct seviri_options *opts)
 {
      struct seviri_data seviri;
      int rss=0;
 
      if (seviri_read_nat(filename, &seviri, n_bands, band_ids, bounds,
-                     line0, line1, column0, column1, lat0, lat1, lon0, lon1)) {
+                     line0, line1, column0, column1, lat0, lat1, lon0, lon1,
+                     opts)) {
           fprintf(stderr, "ERROR: seviri_read_nat()\n");
           return -1;
      }
 
      if (seviri_preproc(&seviri, preproc, band_units, rss, do_gsics, do_nasa, 
-                        satposstr, do_not_alloc)) {
+                        satposstr, do_not_alloc, opts)) {
+          fprintf(stderr, "ERROR: seviri_preproc()\n");
+          return -1;
+     }
+
+     seviri_free(&seviri);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Convenience function that calls both seviri_read_bsq() and seviri_preproc().
+ *
+ * filename	: Band sequential SEVIRI level 1.5 filename
+ * The rest	: Described in the seviri_read_and_preproc_nat() header
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_read_and_preproc_bsq(const char *filename,
+                                struct seviri_preproc_data *preproc,
+                                uint n_bands, const uint *band_ids,
+                                const enum seviri_units *band_units,
+                                enum seviri_bounds bounds,
+                                uint line0, uint line1, uint column0, uint column1,
+                                double lat0, double lat1, double lon0, double lon1,
+                                int do_gsics, int do_nasa, char satposstr[128],
+                                int do_not_alloc, const struct seviri_options *opts)
+{
+     struct seviri_data seviri;
+     int rss=0;
+
+     if (seviri_read_bsq(filename, &seviri, n_bands, band_ids, bounds,
+                     line0, line1, column0, column1, lat0, lat1, lon0, lon1,
+                     opts)) {
+          fprintf(stderr, "ERROR: seviri_read_bsq()\n");
+          return -1;
+     }
+
+     if (seviri_preproc(&seviri, preproc, band_units, rss, do_gsics, do_nasa,
+                        satposstr, do_not_alloc, opts)) {
           fprintf(stderr, "ERROR: seviri_preproc()\n");
+          seviri_free(&seviri);
           return -1;
      }
 
@@ -771,6 +1288,8 @@ int seviri_read_and_preproc_nat(const char *filename,
  *                parallax correction.
  * do_not_alloc	: Flag indicating not to allocate space for the output data.
  *                Useful for avoiding unnecessary memory allocations and use.
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
  *
  * returns	: Non-zero on error
  ******************************************************************************/
@@ -783,7 +1302,8 @@ int seviri_read_and_preproc_hrit(const char *indir, const char *timeslot,
                                  uint line0, uint line1, uint column0, uint column1,
                                  double lat0, double lat1, double lon0, double lon1,
                                  int rss, int iodc, int do_gsics, int do_nasa, 
-                                 char satposstr[128], int do_not_alloc)
+                                 char satposstr[128], int do_not_alloc,
+                                 const struct seviri_options *opts)
 {
      int i, proc_hrv = 0;
 
@@ -791,13 +1311,13 @@ int seviri_read_and_preproc_hrit(const char *indir, const char *timeslot,
 
      if (seviri_read_hrit(indir, timeslot, satnum, &seviri, n_bands, band_ids,
           bounds, line0, line1, column0, column1, lat0, lat1, lon0, lon1, rss,
-          iodc)) {
+          iodc, opts)) {
           fprintf(stderr, "ERROR: seviri_read()\n");
           return -1;
      }
 
      if (seviri_preproc(&seviri, preproc, band_units, rss, do_gsics, do_nasa,
-                        satposstr, do_not_alloc)) {
+                        satposstr, do_not_alloc, opts)) {
          fprintf(stderr, "ERROR: seviri_preproc()\n");
           return -1;
      }
@@ -821,10 +1341,11 @@ int seviri_read_and_preproc_hrit(const char *indir, const char *timeslot,
 
 
 /*******************************************************************************
- * Helper function that examines if input file is HRIT or NAT and calls the
- * appropriate processing functions.
+ * Helper function that examines if input file is HRIT, NAT or BSQ and calls
+ * the appropriate processing functions.
  *
- * filename	: Native SEVIRI level 1.5 filename
+ * filename	: Native (.nat) or band sequential (.bsq) SEVIRI level 1.5
+ *                filename or the name of a HRIT segment file
  * preproc	: The struct containing the preprocessed output
  * n_bands	: Described in the seviri_read_nat() header (read_write_nat.c)
  * band_ids	:      ''
@@ -840,6 +1361,8 @@ int seviri_read_and_preproc_hrit(const char *indir, const char *timeslot,
  * lon1		:      ''
  * do_not_alloc	: Flag indicating not to allocate space for the output data.
  *                Useful for avoiding unnecessary memory allocations and use.
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
  *
  * returns	: Non-zero on error
  ******************************************************************************/
@@ -850,7 +1373,8 @@ int seviri_read_and_preproc(const char *filename,
                             enum seviri_bounds bounds,
                             uint line0, uint line1, uint column0, uint column1,
                             double lat0, double lat1, double lon0, double lon1,
-                            int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc)
+                            int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc,
+                            const struct seviri_options *opts)
 {
      char *indir;
      int satnum;
@@ -861,11 +1385,19 @@ int seviri_read_and_preproc(const char *filename,
      if (strstr(filename, ".nat") != NULL) {
           if (seviri_read_and_preproc_nat(filename, preproc, n_bands, band_ids,
                band_units, bounds, line0, line1, column0, column1, lat0, lat1,
-               lon0, lon1, do_gsics, do_nasa, satposstr, do_not_alloc)) {
+               lon0, lon1, do_gsics, do_nasa, satposstr, do_not_alloc, opts)) {
                fprintf(stderr, "ERROR: seviri_read_and_preproc_nat()\n");
                return -1;
           }
      }
+     else if (strstr(filename, ".bsq") != NULL) {
+          if (seviri_read_and_preproc_bsq(filename, preproc, n_bands, band_ids,
+               band_units, bounds, line0, line1, column0, column1, lat0, lat1,
+               lon0, lon1, do_gsics, do_nasa, satposstr, do_not_alloc, opts)) {
+               fprintf(stderr, "ERROR: seviri_read_and_preproc_bsq()\n");
+               return -1;
+          }
+     }
      else {
           if ((indir = extract_path_sat_id_timeslot(filename, &satnum, timeslot,
                &rss, &iodc)) == NULL) {
@@ -876,7 +1408,7 @@ int seviri_read_and_preproc(const char *filename,
           if (seviri_read_and_preproc_hrit(indir, timeslot, satnum, preproc,
                n_bands, band_ids, band_units, bounds, line0, line1, column0,
                column1, lat0, lat1, lon0, lon1, rss, iodc, do_gsics, do_nasa,
-               satposstr, do_not_alloc)) {
+               satposstr, do_not_alloc, opts)) {
                fprintf(stderr, "ERROR: seviri_read_and_preproc_hrit()\n");
                return -1;
           }
@@ -889,6 +1421,66 @@ int seviri_read_and_preproc(const char *filename,
 
 
 
+/*******************************************************************************
+ * Expand the per line time into an image of Julian Day Number.  Pixels off the
+ * Earth disk, those with a latitude equal to the fill value, are set to the
+ * fill value.
+ *
+ * d		: The struct containing the preprocessed data
+ * time		: Output image of length n_lines * n_columns
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_preproc_expand_time(const struct seviri_preproc_data *d, double *time)
+{
+     uint i;
+     uint j;
+     uint i_image;
+
+     for (i = 0; i < d->n_lines; ++i) {
+          for (j = 0; j < d->n_columns; ++j) {
+               i_image = i * d->n_columns + j;
+
+               if (d->lat[i_image] != d->fill_value)
+                    time[i_image] = d->time_line[i];
+               else
+                    time[i_image] = d->fill_value;
+          }
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Return the image of Julian Day Number, allocating and expanding it from the
+ * per line time on the first call.  The memory is freed by
+ * seviri_preproc_free().
+ *
+ * d		: The struct containing the preprocessed data
+ *
+ * returns	: The image of time or NULL on error
+ ******************************************************************************/
+double *seviri_preproc_time(struct seviri_preproc_data *d)
+{
+     if (d->time)
+          return d->time;
+
+     if ((d->time = malloc(d->n_lines * d->n_columns * sizeof(double))) == NULL) {
+          fprintf(stderr, "ERROR: malloc()\n");
+          return NULL;
+     }
+
+     d->memory_alloc_t = 1;
+
+     seviri_preproc_expand_time(d, d->time);
+
+     return d->time;
+}
+
+
+
 /*******************************************************************************
  * Free memory allocated by seviri_preproc() for the pre-processing output in a
  * struct seviri_preproc_data type.
@@ -899,8 +1491,10 @@ int seviri_read_and_preproc(const char *filename,
  ******************************************************************************/
 int seviri_preproc_free(struct seviri_preproc_data *d)
 {
-     if (d->memory_alloc_d) {
+     if (d->memory_alloc_t)
           free(d->time);
+
+     if (d->memory_alloc_d) {
           free(d->lat);
           free(d->lon);
           free(d->sza);
@@ -909,11 +1503,22 @@ int seviri_preproc_free(struct seviri_preproc_data *d)
           free(d->vaa);
      }
 
+     free(d->time_line);
      free(d->data);
 
-     if (d->memory_alloc_d)
+     seviri_stats_free(&d->stats);
+
+     if (d->memory_alloc_d) {
           free(d->data2);
 
+          if (d->lat_hrv)
+               free(d->lat_hrv);
+          if (d->lon_hrv)
+               free(d->lon_hrv);
+          if (d->data_hrv)
+               free(d->data_hrv);
+     }
+
      return 0;
 }
 
@@ -923,7 +1528,8 @@ int seviri_preproc_free(struct seviri_preproc_data *d)
  * Convenience function that returns the number of lines and columns in the
  * image to be read with the given choice of offset and dimension parameters.
  *
- * filename	: Native SEVIRI level 1.5 filename
+ * filename	: Native (.nat) or band sequential (.bsq) SEVIRI level 1.5
+ *                filename or the name of a HRIT segment file
  * i_line	: Output line offset to the beginning of the actual image
  *                within the full disk
  * i_column	: Output column offset to the beginning of the actual image
@@ -941,13 +1547,16 @@ int seviri_preproc_free(struct seviri_preproc_data *d)
  * lon1		:      ''
  * aux		: Seviri_auxillary_io_data struct containing information related
  *                to the read operation
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
  *
  * returns	: Non-zero on error
  ******************************************************************************/
 int seviri_get_dimens(const char *filename, uint *i_line, uint *i_column,
                       uint *n_lines, uint *n_columns, enum seviri_bounds bounds,
                       uint line0, uint line1, uint column0, uint column1,
-                      double lat0, double lat1, double lon0, double lon1)
+                      double lat0, double lat1, double lon0, double lon1,
+                      const struct seviri_options *opts)
 {
      char *indir;
      int satnum;
@@ -958,11 +1567,19 @@ int seviri_get_dimens(const char *filename, uint *i_line, uint *i_column,
      if (strstr(filename, ".nat") != NULL) {
           if (seviri_get_dimens_nat(filename, i_line, i_column, n_lines,
                n_columns, bounds, line0, line1, column0, column1, lat0, lat1,
-               lon0, lon1)) {
+               lon0, lon1, opts)) {
                fprintf(stderr, "ERROR: seviri_get_dimens_nat()\n");
                return -1;
           }
      }
+     else if (strstr(filename, ".bsq") != NULL) {
+          if (seviri_get_dimens_bsq(filename, i_line, i_column, n_lines,
+               n_columns, bounds, line0, line1, column0, column1, lat0, lat1,
+               lon0, lon1, opts)) {
+               fprintf(stderr, "ERROR: seviri_get_dimens_bsq()\n");
+               return -1;
+          }
+     }
      else {
           if ((indir = extract_path_sat_id_timeslot(filename, &satnum, timeslot,
                &rss, &iodc)) == NULL) {
@@ -13,6 +13,7 @@
 
 #include "external.h"
 #include "read_write.h"
+#include "stats_util.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,12 +25,14 @@ extern "C" {
 
 struct seviri_preproc_data {
      int memory_alloc_d;	/* non-zero if memory has been allocated */
+     int memory_alloc_t;	/* non-zero if time has been allocated by seviri_preproc_time() */
      uint n_bands;		/* number of bands read in */
      uint n_lines;		/* number of lines read in */
      uint n_columns;		/* number of columns read in */
      float fill_value;		/* fill value of the image data */
+     double *time_line;		/* array of Julian Day Number of length n_lines */
 				/* the following image arrays are n_lines * n_columns */
-     double *time;		/* image of Julian Day Number */
+     double *time;		/* image of Julian Day Number, NULL until seviri_preproc_time() */
      float *lat;		/* image of latitude */
      float *lon;		/* image of longitude */
      float *sza;		/* image of solar zenith angle (degrees: 0.0 -- 180.0) */
@@ -39,12 +42,56 @@ struct seviri_preproc_data {
      float **data;		/* array of pointers to images of length n_bands */
      float  *data2;		/* array of image data of length n_bands * n_lines * n_columns */
      float *cal_slope;  /* array of pointers to cal_slopes of length n_bands */
+     uint n_lines_hrv;		/* number of HRV lines (3 * n_lines) or 0 if HRV was not read */
+     uint n_columns_hrv;	/* number of HRV columns (3 * n_columns) or 0 if HRV was not read */
+				/* the following HRV image arrays are n_lines_hrv * n_columns_hrv */
+     float *lat_hrv;		/* image of HRV latitude */
+     float *lon_hrv;		/* image of HRV longitude */
+     float *data_hrv;		/* image of the HRV band in the same units as its VIR resolution image */
+     struct seviri_perf_data perf;	/* read and preprocessing statistics (see perf_util.h) */
+     struct seviri_stats_data stats;	/* band statistics, if collected (see the stats member of struct seviri_options) */
+};
+
+
+/* A cache of the latitude and longitude images computed by seviri_preproc().
+   These only depend on the navigation and the bounds of the image so they are
+   the same for every time slot of a satellite, see seviri_nav_cache_init(). */
+
+struct seviri_nav_entry {
+     double lon0;		/* longitude of the sub satellite point */
+     uchar earthmod;		/* type of earth model */
+     uint i_line;		/* navigation line offset of the image */
+     uint i_column;		/* column offset of the image */
+     uint n_lines;		/* number of lines of the image */
+     uint n_columns;		/* number of columns of the image */
+     float *lat;		/* image of latitude */
+     float *lon;		/* image of longitude */
+     struct seviri_nav_entry *next;
+};
+
+
+/* Locks (lock non-zero) or unlocks the cache, if it is used by several
+   threads. */
+typedef void (*seviri_nav_lock_func)(void *data, int lock);
+
+
+struct seviri_nav_cache {
+     size_t max_size;		/* maximum size in bytes of the images kept */
+     size_t size;		/* size in bytes of the images kept */
+     struct seviri_nav_entry *entries;
+     seviri_nav_lock_func lock;	/* NULL if only used by one thread */
+     void *lock_data;		/* user data passed on to lock */
 };
 
 
 int seviri_preproc(const struct seviri_data *d, struct seviri_preproc_data *d2,
                    const enum seviri_units *band_units, int rss, int do_gsics,
-                   int do_nasa, char satposstr[128], int do_not_alloc);
+                   int do_nasa, char satposstr[128], int do_not_alloc,
+                   const struct seviri_options *opts);
+int seviri_preproc_lines(const struct seviri_data *d, struct seviri_preproc_data *d2,
+                         const enum seviri_units *band_units, int rss, int do_gsics,
+                         int do_nasa, char satposstr[128], uint i_line, uint n_lines,
+                         const struct seviri_options *opts);
 int seviri_read_and_preproc_nat(const char *filename,
                                 struct seviri_preproc_data *preproc,
                                 uint n_bands, const uint *band_ids,
@@ -52,7 +99,17 @@ int seviri_read_and_preproc_nat(const char *filename,
                                 enum seviri_bounds bounds,
                                 uint line0, uint line1, uint column0, uint column1,
                                 double lat0, double lat1, double lon0, double lon1,
-                                int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc);
+                                int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc,
+                                const struct seviri_options *opts);
+int seviri_read_and_preproc_bsq(const char *filename,
+                                struct seviri_preproc_data *preproc,
+                                uint n_bands, const uint *band_ids,
+                                const enum seviri_units *band_units,
+                                enum seviri_bounds bounds,
+                                uint line0, uint line1, uint column0, uint column1,
+                                double lat0, double lat1, double lon0, double lon1,
+                                int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc,
+                                const struct seviri_options *opts);
 int seviri_read_and_preproc_hrit(const char *indir, const char *timeslot,
                                  const int satnum,
                                  struct seviri_preproc_data *preproc,
@@ -62,7 +119,7 @@ int seviri_read_and_preproc_hrit(const char *indir, const char *timeslot,
                                  uint line0, uint line1, uint column0, uint column1,
                                  double lat0, double lat1, double lon0, double lon1,
                                  int rss, int iodc, int do_gsics, int do_nasa, char satposstr[128],
-                                 int do_not_alloc);
+                                 int do_not_alloc, const struct seviri_options *opts);
 int seviri_read_and_preproc(const char *filename,
                             struct seviri_preproc_data *preproc,
                             uint n_bands, const uint *band_ids,
@@ -70,12 +127,19 @@ int seviri_read_and_preproc(const char *filename,
                             enum seviri_bounds bounds,
                             uint line0, uint line1, uint column0, uint column1,
                             double lat0, double lat1, double lon0, double lon1,
-                            int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc);
+                            int do_gsics, int do_nasa, char satposstr[128], int do_not_alloc,
+                            const struct seviri_options *opts);
+int seviri_preproc_expand_time(const struct seviri_preproc_data *d, double *time);
+double *seviri_preproc_time(struct seviri_preproc_data *d);
 int seviri_preproc_free(struct seviri_preproc_data *d);
+int seviri_nav_cache_init(struct seviri_nav_cache *cache, size_t max_size,
+                          seviri_nav_lock_func lock, void *lock_data);
+int seviri_nav_cache_free(struct seviri_nav_cache *cache);
 int seviri_get_dimens(const char *filename, uint *i_line, uint *i_column,
                       uint *n_lines, uint *n_columns, enum seviri_bounds bounds,
                       uint line0, uint line1, uint column0, uint column1,
-                      double lat0, double lat1, double lon0, double lon1);
+                      double lat0, double lat1, double lon0, double lon1,
+                      const struct seviri_options *opts);
 
 
 #ifdef __cplusplus
@@ -23,6 +23,8 @@ int seviri_auxillary_alloc(struct seviri_auxillary_io_data *d)
      d->temp_2 = malloc(n * sizeof(ushort));
      d->temp_8 = malloc(n * sizeof(ulong));
 
+     d->perf   = NULL;
+
      return 0;
 }
 
@@ -42,7 +44,8 @@ int seviri_auxillary_free(struct seviri_auxillary_io_data *d)
 /*******************************************************************************
  * Like fread() that also swaps bytes after reading as needed.
  ******************************************************************************/
-static int fread_swap(void *ptr, size_t size, size_t nmemb, FILE *stream,
+static int fread_swap(void *ptr, size_t size, size_t nmemb,
+                      struct seviri_io *stream,
                       struct seviri_auxillary_io_data *aux)
 {
      size_t i;
@@ -52,9 +55,13 @@ static int fread_swap(void *ptr, size_t size, size_t nmemb, FILE *stream,
      uint   *ptr_4;
      ulong  *ptr_8;
 
-     n = fread(ptr, size, nmemb, stream);
+     SU_PERF_TIMER(t);
+
+     SU_PERF_START(aux->perf, t);
+     n = seviri_io_read(ptr, size, nmemb, stream);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_READ, 0, n * size);
      if (n < nmemb) {
-          if (feof(stream))
+          if (seviri_io_eof(stream))
                fprintf(stderr, "ERROR: End of file reached\n");
           else
                fprintf(stderr, "ERROR: Error reading file: %s\n",
@@ -96,7 +103,8 @@ static int fread_swap(void *ptr, size_t size, size_t nmemb, FILE *stream,
 /*******************************************************************************
  * Like fwrite() that also swaps bytes before writing as needed.
  ******************************************************************************/
-static int fwrite_swap(const void *ptr, size_t size, size_t nmemb, FILE *stream,
+static int fwrite_swap(const void *ptr, size_t size, size_t nmemb,
+                       struct seviri_io *stream,
                        struct seviri_auxillary_io_data *aux)
 {
      size_t i;
@@ -108,6 +116,8 @@ static int fwrite_swap(const void *ptr, size_t size, size_t nmemb, FILE *stream,
 
      const void *ptr_temp;
 
+     SU_PERF_TIMER(t);
+
      if (! aux->swap_bytes)
           ptr_temp = ptr;
      else {
@@ -139,9 +149,11 @@ static int fwrite_swap(const void *ptr, size_t size, size_t nmemb, FILE *stream,
           }
      }
 
-     n = fwrite(ptr_temp, size, nmemb, stream);
+     SU_PERF_START(aux->perf, t);
+     n = seviri_io_write(ptr_temp, size, nmemb, stream);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_WRITE, 0, n * size);
      if (n < nmemb) {
-          if (feof(stream))
+          if (seviri_io_eof(stream))
                fprintf(stderr, "ERROR: End of file reached\n");
           else
                fprintf(stderr, "ERROR: Error writing file: %s\n", strerror(errno));
@@ -157,8 +169,8 @@ static int fwrite_swap(const void *ptr, size_t size, size_t nmemb, FILE *stream,
 /*******************************************************************************
  * High level function to handle the choice of operation.
  ******************************************************************************/
-int fxxxx_swap(void *ptr, size_t size, size_t nmemb, FILE *stream, struct
-               seviri_auxillary_io_data *aux)
+int fxxxx_swap(void *ptr, size_t size, size_t nmemb, struct seviri_io *stream,
+               struct seviri_auxillary_io_data *aux)
 {
      if (aux->operation == 0)
           return fread_swap(ptr, size, nmemb, stream, aux);
@@ -171,7 +183,7 @@ int fxxxx_swap(void *ptr, size_t size, size_t nmemb, FILE *stream, struct
 /*******************************************************************************
  *
  ******************************************************************************/
-int seviri_l15_ph_data_read(FILE *fp,
+int seviri_l15_ph_data_read(struct seviri_io *fp,
                             struct seviri_marf_l15_ph_data_data *d,
                             struct seviri_auxillary_io_data *aux)
 {
@@ -186,7 +198,7 @@ int seviri_l15_ph_data_read(FILE *fp,
 /*******************************************************************************
  *
  ******************************************************************************/
-int seviri_l15_ph_data_id_read(FILE *fp,
+int seviri_l15_ph_data_id_read(struct seviri_io *fp,
                                struct seviri_marf_l15_ph_data_id_data *d,
                                struct seviri_auxillary_io_data *aux)
 {
@@ -203,7 +215,7 @@ int seviri_l15_ph_data_id_read(FILE *fp,
  *
  ******************************************************************************/
 static int seviri_marf_l15_main_product_header_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_marf_l15_main_product_header_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -247,7 +259,7 @@ static int seviri_marf_l15_main_product_header_read(
  *
  ******************************************************************************/
 static int seviri_marf_l15_secondary_product_header_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_marf_l15_secondary_product_header_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -278,7 +290,8 @@ static int seviri_marf_l15_secondary_product_header_read(
 /*******************************************************************************
  *
  ******************************************************************************/
-int seviri_marf_header_read(FILE *fp, struct seviri_marf_header_data *d,
+int seviri_marf_header_read(struct seviri_io *fp,
+                            struct seviri_marf_header_data *d,
                             struct seviri_auxillary_io_data *aux)
 {
      if (seviri_marf_l15_main_product_header_read(fp, &d->main, aux)) {
@@ -299,7 +312,7 @@ int seviri_marf_header_read(FILE *fp, struct seviri_marf_header_data *d,
 /*******************************************************************************
  *
  ******************************************************************************/
-int seviri_TIME_CDS_read(FILE *fp,
+int seviri_TIME_CDS_read(struct seviri_io *fp,
                          struct seviri_TIME_CDS_data *d,
                          struct seviri_auxillary_io_data *aux)
 {
@@ -312,7 +325,7 @@ int seviri_TIME_CDS_read(FILE *fp,
 
 
 
-int seviri_TIME_CDS_SHORT_read(FILE *fp,
+int seviri_TIME_CDS_SHORT_read(struct seviri_io *fp,
                                struct seviri_TIME_CDS_SHORT_data *d,
                                struct seviri_auxillary_io_data *aux)
 {
@@ -324,7 +337,7 @@ int seviri_TIME_CDS_SHORT_read(FILE *fp,
 
 
 
-int seviri_TIME_CDS_EXPANDED_read(FILE *fp,
+int seviri_TIME_CDS_EXPANDED_read(struct seviri_io *fp,
                                   struct seviri_TIME_CDS_EXPANDED_data *d,
                                   struct seviri_auxillary_io_data *aux)
 {
@@ -342,7 +355,7 @@ int seviri_TIME_CDS_EXPANDED_read(FILE *fp,
  *
  ******************************************************************************/
 static int seviri_15HEADER_SatelliteStatus_ORBITCOEF_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_SatelliteStatus_ORBITCOEF_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -361,7 +374,7 @@ static int seviri_15HEADER_SatelliteStatus_ORBITCOEF_read(
 
 
 int seviri_15HEADER_SatelliteStatus_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_SatelliteStatus_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -397,7 +410,7 @@ int seviri_15HEADER_SatelliteStatus_read(
  *
  *----------------------------------------------------------------------------*/
 int seviri_15HEADER_ImageAcquisition_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageAcquisition_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -465,7 +478,7 @@ int seviri_15HEADER_ImageAcquisition_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15HEADER_CelestialEvents_TIME_GENERALIZED_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_CelestialEvents_TIME_GENERALIZED_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -477,7 +490,7 @@ static int seviri_15HEADER_CelestialEvents_TIME_GENERALIZED_read(
 
 
 static int seviri_15HEADER_CelestialEvents_EARTHMOONSUNCOEF_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_CelestialEvents_EARTHMOONSUNCOEF_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -492,7 +505,7 @@ static int seviri_15HEADER_CelestialEvents_EARTHMOONSUNCOEF_read(
 
 
 static int seviri_15HEADER_CelestialEvents_STARCOEF_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_CelestialEvents_STARCOEF_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -508,7 +521,7 @@ static int seviri_15HEADER_CelestialEvents_STARCOEF_read(
 
 
 int seviri_15HEADER_CelestialEvents_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_CelestialEvents_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -550,7 +563,7 @@ int seviri_15HEADER_CelestialEvents_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15HEADER_ImageDescription_ReferenceGridVIS_IR_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageDescription_ReferenceGridVIS_IR_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -566,7 +579,7 @@ static int seviri_15HEADER_ImageDescription_ReferenceGridVIS_IR_read(
 
 
 static int seviri_15HEADER_ImageDescription_ReferenceGridHRV_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageDescription_ReferenceGridHRV_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -582,7 +595,7 @@ static int seviri_15HEADER_ImageDescription_ReferenceGridHRV_read(
 
 
 static int seviri_15HEADER_ImageDescription_PlannedCoverageVIS_IR_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageDescription_PlannedCoverageVIS_IR_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -597,7 +610,7 @@ static int seviri_15HEADER_ImageDescription_PlannedCoverageVIS_IR_read(
 
 
 static int seviri_15HEADER_ImageDescription_PlannedCoverageHRV_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -616,7 +629,7 @@ static int seviri_15HEADER_ImageDescription_PlannedCoverageHRV_read(
 
 
 int seviri_15HEADER_ImageDescription_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageDescription_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -645,7 +658,7 @@ int seviri_15HEADER_ImageDescription_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15HEADER_RadiometricProcessing_Level1_5ImageCalibration_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_RadiometricProcessing_Level1_5ImageCalibration_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -661,7 +674,7 @@ static int seviri_15HEADER_RadiometricProcessing_Level1_5ImageCalibration_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15HEADER_RadiometricProcessing_MPEFCalFeedback_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_RadiometricProcessing_MPEFCalFeedback_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -683,7 +696,7 @@ static int seviri_15HEADER_RadiometricProcessing_MPEFCalFeedback_read(
 
 
 int seviri_15HEADER_RadiometricProcessing_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_RadiometricProcessing_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -715,7 +728,7 @@ int seviri_15HEADER_RadiometricProcessing_read(
  *
  *----------------------------------------------------------------------------*/
 int seviri_15HEADER_GeometricProcessing_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_GeometricProcessing_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -739,7 +752,7 @@ int seviri_15HEADER_GeometricProcessing_read(
  *
  *----------------------------------------------------------------------------*/
 int seviri_15HEADER_IMPFConfiguration_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_IMPFConfiguration_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -754,7 +767,7 @@ int seviri_15HEADER_IMPFConfiguration_read(
  *
  *----------------------------------------------------------------------------*/
 int seviri_15HEADER_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -777,7 +790,7 @@ int seviri_15HEADER_read(
  *
  ******************************************************************************/
 static int seviri_15TRAILER_ImageProductionStats_L15ImageValidity_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_ImageProductionStats_L15ImageValidity_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -794,7 +807,7 @@ static int seviri_15TRAILER_ImageProductionStats_L15ImageValidity_read(
 
 
 static int seviri_15TRAILER_ImageProductionStats_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_ImageProductionStats_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -852,7 +865,7 @@ static int seviri_15TRAILER_ImageProductionStats_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15TRAILER_NavigationExtractionResults_HORIZONOBSERVATION_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_NavigationExtractionResults_HORIZONOBSERVATION_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -872,7 +885,7 @@ static int seviri_15TRAILER_NavigationExtractionResults_HORIZONOBSERVATION_read(
 
 
 static int seviri_15TRAILER_NavigationExtractionResults_STAROBSERVATION_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_NavigationExtractionResults_STAROBSERVATION_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -892,7 +905,7 @@ static int seviri_15TRAILER_NavigationExtractionResults_STAROBSERVATION_read(
 
 
 static int seviri_15TRAILER_NavigationExtractionResults_LANDMARKOBSERVATION_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_NavigationExtractionResults_LANDMARKOBSERVATION_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -914,7 +927,7 @@ static int seviri_15TRAILER_NavigationExtractionResults_LANDMARKOBSERVATION_read
 
 
 static int seviri_15TRAILER_NavigationExtractionResults_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_NavigationExtractionResults_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -939,7 +952,7 @@ static int seviri_15TRAILER_NavigationExtractionResults_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15TRAILER_RadiometricQuality_L10RadQuality_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_RadiometricQuality_L10RadQuality_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -993,7 +1006,7 @@ static int seviri_15TRAILER_RadiometricQuality_L10RadQuality_read(
 
 
 static int seviri_15TRAILER_RadiometricQuality_L15RadQuality_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_RadiometricQuality_L15RadQuality_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1032,7 +1045,7 @@ static int seviri_15TRAILER_RadiometricQuality_L15RadQuality_read(
 
 
 static int seviri_15TRAILER_RadiometricQuality_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_RadiometricQuality_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1054,7 +1067,7 @@ static int seviri_15TRAILER_RadiometricQuality_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15TRAILER_GeometricQuality_Accuracy_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_GeometricQuality_Accuracy_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1078,7 +1091,7 @@ static int seviri_15TRAILER_GeometricQuality_Accuracy_read(
 
 
 static int seviri_15TRAILER_GeometricQuality_MisregistrationResiduals_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_GeometricQuality_MisregistrationResiduals_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1100,7 +1113,7 @@ static int seviri_15TRAILER_GeometricQuality_MisregistrationResiduals_read(
 
 
 static int seviri_15TRAILER_GeometricQuality_GeometricQualityStatus_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_GeometricQuality_GeometricQualityStatus_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1117,7 +1130,7 @@ static int seviri_15TRAILER_GeometricQuality_GeometricQualityStatus_read(
 
 
 static int seviri_15TRAILER_GeometricQuality_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_GeometricQuality_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1151,7 +1164,7 @@ static int seviri_15TRAILER_GeometricQuality_read(
  *
  *----------------------------------------------------------------------------*/
 static int seviri_15TRAILER_TimelinessAndCompleteness_Completeness_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_TimelinessAndCompleteness_Completeness_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1167,7 +1180,7 @@ static int seviri_15TRAILER_TimelinessAndCompleteness_Completeness_read(
 
 
 static int seviri_15TRAILER_TimelinessAndCompleteness_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_TimelinessAndCompleteness_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1190,7 +1203,7 @@ static int seviri_15TRAILER_TimelinessAndCompleteness_read(
  *
  *----------------------------------------------------------------------------*/
 int seviri_15TRAILER_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1218,7 +1231,7 @@ int seviri_15TRAILER_read(
  *
  ******************************************************************************/
 int seviri_packet_header_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_packet_header_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1256,7 +1269,7 @@ int seviri_packet_header_read(
  *
  ******************************************************************************/
 int seviri_LineSideInfo_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_LineSideInfo_data *d,
           struct seviri_auxillary_io_data *aux)
 {
@@ -1542,12 +1555,255 @@ int seviri_get_dimension_data(
      sscanf(marf_header->secondary.NumberColumnsHRV.Value,   "%u",
             &d->n_columns_selected_HRV);
 
+     d->i_line_requested_HRV    = 3 * d->i_line_requested_VIR;
+     d->i_column_requested_HRV  = 3 * d->i_column_requested_VIR;
+
+     d->n_lines_requested_HRV   = 3 * d->n_lines_requested_VIR;
+     d->n_columns_requested_HRV = 3 * d->n_columns_requested_VIR;
+
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Find the HRV window, lower or upper, that a line of the HRV reference grid
+ * was acquired in.
+ *
+ * d		: The planned HRV coverage from the level 1.5 header
+ * i_line	: Line within the HRV reference grid (from zero)
+ * i_column	: Output column within the HRV reference grid (from zero) of the
+ *                first pixel of the line
+ *
+ * returns	: Non-zero if the line is in neither window
+ ******************************************************************************/
+int seviri_hrv_window(
+          const struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data *d,
+          uint i_line, uint *i_column)
+{
+     int line;
+
+     line = i_line + 1;
+
+     if (line >= d->LowerSouthLinePlanned && line <= d->LowerNorthLinePlanned &&
+         d->LowerEastColumnPlanned > 0) {
+          *i_column = d->LowerEastColumnPlanned - 1;
+          return 0;
+     }
+
+     if (line >= d->UpperSouthLinePlanned && line <= d->UpperNorthLinePlanned &&
+         d->UpperEastColumnPlanned > 0) {
+          *i_column = d->UpperEastColumnPlanned - 1;
+          return 0;
+     }
+
+     return -1;
+}
+
+
+
+/*******************************************************************************
+ * Allocate the HRV image for the requested area, filled with fill_value.
+ *
+ * d		: The seviri_image_data struct with dimens already set
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_hrv_alloc(struct seviri_image_data *d)
+{
+     uint length;
+
+     d->n_lines_hrv   = d->dimens.n_lines_requested_HRV;
+     d->n_columns_hrv = d->dimens.n_columns_requested_HRV;
+
+     length = d->n_lines_hrv * d->n_columns_hrv;
+
+     if ((d->data_hrv = malloc(length * sizeof(ushort))) == NULL) {
+          fprintf(stderr, "ERROR: malloc()\n");
+          return -1;
+     }
+
+     su_init_array_us(d->data_hrv, length, d->fill_value);
 
      return 0;
 }
 
 
 
+/*******************************************************************************
+ * Fill lines of the VIR resolution image of the HRV band with the mean of the
+ * valid counts of each 3 x 3 block of HRV pixels.  Blocks with no valid counts
+ * are set to fill_value.
+ *
+ * d		: The seviri_image_data struct with data_hrv read
+ * i_band	: Index of the HRV band in data_vir
+ * i_line	: First VIR line to fill
+ * n_lines	: Number of VIR lines to fill
+ ******************************************************************************/
+void seviri_hrv_bin(struct seviri_image_data *d, uint i_band, uint i_line,
+                    uint n_lines)
+{
+     uint i;
+     uint j;
+     uint k;
+     uint n;
+
+     uint sum;
+
+     ushort x;
+
+     const ushort *hrv;
+
+     ushort *vir;
+
+     for (i = i_line; i < i_line + n_lines; ++i) {
+          hrv = d->data_hrv + 3 * i * d->n_columns_hrv;
+          vir = d->data_vir[i_band] + i * d->n_columns;
+
+          for (j = 0; j < d->n_columns; ++j, hrv += 3) {
+               sum = 0;
+               n   = 0;
+               for (k = 0; k < 9; ++k) {
+                    x = hrv[k / 3 * d->n_columns_hrv + k % 3];
+                    if (x != d->fill_value && x > 0) {
+                         sum += x;
+                         n++;
+                    }
+               }
+
+               vir[j] = n ? (sum + n / 2) / n : d->fill_value;
+          }
+     }
+}
+
+
+
+/*******************************************************************************
+ * Unpack the three HRV line records of a line group into their place in the
+ * HRV image, at the column of the lower or upper HRV window each line was
+ * acquired in, and bin them into the VIR resolution image of the HRV band.
+ *
+ * d		: The seviri_image_data struct with data_hrv allocated
+ * coverage	: The planned HRV coverage from the level 1.5 header
+ * i_band	: Index of the HRV band in data_vir
+ * i_line	: VIR line of the line group within the output image
+ * data10	: The three HRV line records, including their packet headers and
+ *                line side info, one after the other
+ ******************************************************************************/
+void seviri_hrv_unpack(struct seviri_image_data *d,
+          const struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+          *coverage, uint i_band, uint i_line, const uchar *data10)
+{
+     uint k;
+
+     uint i_image;
+
+     uint i_line_hrv;
+     uint i_column_hrv;
+
+     uint n_bytes_HRV_line;
+     uint n_columns_HRV_line;
+
+     long p0;
+     long p1;
+
+     const struct seviri_dimension_data *dimens;
+
+     dimens = &d->dimens;
+
+     n_bytes_HRV_line   = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE +
+                          dimens->n_columns_selected_HRV / 4 * 5 / 2;
+     n_columns_HRV_line = dimens->n_columns_selected_HRV / 2;
+
+     for (k = 0; k < 3; ++k) {
+          i_line_hrv = 3 * (dimens->i_line_requested_VIR + i_line) + k;
+
+          if (seviri_hrv_window(coverage, i_line_hrv, &i_column_hrv))
+               continue;
+
+          /* Pixels of the record within the requested columns. */
+          p0 = (long) dimens->i_column_requested_HRV - i_column_hrv;
+          p1 = p0 + dimens->n_columns_requested_HRV;
+
+          p0 = MAX(p0, 0);
+          p1 = MIN(p1, n_columns_HRV_line);
+
+          if (p0 >= p1)
+               continue;
+
+          i_image = (3 * i_line + k) * d->n_columns_hrv +
+                    i_column_hrv + p0 - dimens->i_column_requested_HRV;
+
+          su_unpack_10bit(data10 + k * n_bytes_HRV_line +
+                          PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE,
+                          p0, p1 - p0, d->data_hrv + i_image);
+     }
+
+     seviri_hrv_bin(d, i_band, i_line, 1);
+}
+
+
+
+/*******************************************************************************
+ * Pack one HRV line record from the HRV image.  Pixels outside the requested
+ * area or equal to fill_value are written as zero.
+ *
+ * d		: The seviri_image_data struct with data_hrv
+ * coverage	: The planned HRV coverage from the level 1.5 header
+ * i_line	: VIR line of the line group within the output image
+ * k		: HRV line within the line group, 0 to 2
+ * line_hrv	: Work array of n_columns_selected_HRV / 2 elements
+ * data10	: Output packed record data, without the packet header and line
+ *                side info
+ ******************************************************************************/
+void seviri_hrv_pack(const struct seviri_image_data *d,
+          const struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+          *coverage, uint i_line, uint k, ushort *line_hrv, uchar *data10)
+{
+     uint j;
+
+     uint i_image;
+
+     uint i_line_hrv;
+     uint i_column_hrv;
+
+     uint n_columns_HRV_line;
+
+     long p0;
+     long p1;
+
+     const struct seviri_dimension_data *dimens;
+
+     dimens = &d->dimens;
+
+     n_columns_HRV_line = dimens->n_columns_selected_HRV / 2;
+
+     su_init_array_us(line_hrv, n_columns_HRV_line, 0);
+
+     i_line_hrv = 3 * (dimens->i_line_requested_VIR + i_line) + k;
+
+     if (! seviri_hrv_window(coverage, i_line_hrv, &i_column_hrv)) {
+          p0 = (long) dimens->i_column_requested_HRV - i_column_hrv;
+          p1 = p0 + dimens->n_columns_requested_HRV;
+
+          p0 = MAX(p0, 0);
+          p1 = MIN(p1, n_columns_HRV_line);
+
+          i_image = (3 * i_line + k) * d->n_columns_hrv +
+                    i_column_hrv - dimens->i_column_requested_HRV;
+
+          for (j = p0; j < p1; ++j) {
+               if (d->data_hrv[i_image + j] != d->fill_value)
+                    line_hrv[j] = d->data_hrv[i_image + j];
+          }
+     }
+
+     su_pack_10bit(line_hrv, n_columns_HRV_line, data10);
+}
+
+
+
 /*******************************************************************************
  * Free memory allocated by seviri_image_read() to hold seviri_image_data struct
  * fields.
@@ -1575,16 +1831,28 @@ static int seviri_image_free(struct seviri_image_data *d)
      for (i = 0; i < d->n_bands; ++i)
           free(d->data_vir[i]);
      free(d->data_vir);
-/*
-     for (i = 0; i < d->n_bands; ++i)
-          free(d->data_hrv[i]);
-     free(d->data_hrv);
-*/
+
+     if (d->data_hrv)
+          free(d->data_hrv);
+
      return 0;
 }
 
 
 
+/*******************************************************************************
+ * The options to use for a call given the options passed to it, which may be
+ * NULL for the defaults.
+ ******************************************************************************/
+const struct seviri_options *seviri_options_get(const struct seviri_options *opts)
+{
+     static const struct seviri_options defaults;
+
+     return opts ? opts : &defaults;
+}
+
+
+
 /*******************************************************************************
  * Free memory allocated by seviri_read_hrit() or seviri_read_hrit() to hold
  * seviri_data struct fields.
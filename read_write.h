@@ -12,6 +12,8 @@
 #define READ_WRITE_H
 
 #include "external.h"
+#include "io_util.h"
+#include "perf_util.h"
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -27,8 +29,8 @@ extern "C" {
 */
 #define PACKET_HEADER_SIZE	38
 #define LINE_SIDE_INFO_SIZE	27
-/*
 #define _15HEADER_SIZE		445248
+/*
 #define _15TRAILER_SIZE		380325
 */
 
@@ -921,6 +923,8 @@ struct seviri_auxillary_io_data {
      ushort *temp_2;
      uint   *temp_4;
      ulong  *temp_8;
+
+     struct seviri_perf_data *perf;	/* statistics to collect into or NULL */
 };
 
 
@@ -956,6 +960,14 @@ struct seviri_dimension_data {
 
      uint n_lines_selected_HRV;
      uint n_columns_selected_HRV;
+
+     /* The HRV image covers the requested VIR area at three times the
+        resolution. */
+     uint i_line_requested_HRV;
+     uint i_column_requested_HRV;
+
+     uint n_lines_requested_HRV;
+     uint n_columns_requested_HRV;
 };
 
 
@@ -981,7 +993,10 @@ struct seviri_image_data {
 			/* array of pointers to line side info's of length n_bands * n_lines */
 
      ushort **data_vir;	/* array of visible and infrared image arrays of length n_bands */
-     ushort  *data_hrv;
+			/* for the HRV band this is the mean of each 3 x 3 HRV pixels */
+     uint n_lines_hrv;	/* number of lines in the HRV sub-image (3 * n_lines) */
+     uint n_columns_hrv;/* number of columns in the HRV sub-image (3 * n_columns) */
+     ushort  *data_hrv;	/* HRV image array or NULL if the HRV band was not read */
 
      struct seviri_dimension_data dimens;
 };
@@ -1001,80 +1016,146 @@ struct seviri_data {
 
      struct seviri_packet_header_data packet_header2;
      struct seviri_15TRAILER_data trailer;
+
+     struct seviri_perf_data perf;	/* statistics of the read, see perf_util.h */
 };
 
 
+/*******************************************************************************
+ * Decompresses the data field of a compressed HRIT image segment, held in
+ * memory in n_in bytes, into n_lines x n_columns counts of n_bits bits each.
+ * compression is 1 for lossless and 2 for lossy.  Returns zero if successful.
+ * The library does not yet include a wavelet decoder (see TODO) so one must be
+ * supplied by the user, for example a wrapper around EUMETSAT's public
+ * decompression library.
+ ******************************************************************************/
+typedef int (*seviri_hrit_decompress_func)(const uchar *in, size_t n_in,
+     ushort *out, uint n_columns, uint n_lines, uint n_bits, uint compression,
+     void *data);
+
+
+/*******************************************************************************
+ * Runs a function on a thread of the user's, so that the library itself need
+ * not depend on a thread library.  The start function runs func(arg) on a new
+ * thread and sets *thread to a handle of it, returning zero if successful, and
+ * the join function waits for that thread to finish.
+ ******************************************************************************/
+typedef void (*seviri_thread_func)(void *arg);
+typedef int (*seviri_thread_start_func)(void **thread, seviri_thread_func func,
+     void *arg, void *data);
+typedef int (*seviri_thread_join_func)(void *thread, void *data);
+
+
+/*******************************************************************************
+ * Options of a read or pre-processing call.  They are given to each call rather
+ * than set for the library so that calls on different threads may use their
+ * own.  A NULL pointer or a zeroed struct gives the defaults and options that
+ * do not apply to a function are ignored.
+ ******************************************************************************/
+struct seviri_options {
+     seviri_io_open_func open;	/* opens the streams that would otherwise be
+				   opened as files by name, for example members
+				   of an archive or buffers in memory, or NULL */
+     void *open_data;		/* user data passed on to open */
+     seviri_hrit_decompress_func decompress;	/* decompresses compressed HRIT
+					   segments, or NULL to fail on them */
+     void *decompress_data;	/* user data passed on to decompress */
+     uint read_ahead;		/* line groups of Native image data read at a
+				   time, about 75kB each for a full disk, or 0
+				   for the default of 32 */
+     uint read_depth;		/* chunks of read_ahead line groups of Native
+				   image data held at a time, read on a reader
+				   thread ahead of the one unpacked, or 0 or 1
+				   to read them on the calling thread */
+     seviri_thread_start_func thread_start;	/* starts the reader thread */
+     seviri_thread_join_func thread_join;	/* waits for the reader thread */
+     void *thread_data;		/* user data passed on to thread_start and
+				   thread_join */
+     struct seviri_nav_cache *nav_cache;	/* cache of the latitude and
+					   longitude images shared by
+					   pre-processing calls (see preproc.h)
+					   or NULL */
+     int stats;			/* non-zero for seviri_preproc() to collect the
+				   statistics of each band (see stats_util.h) in
+				   the stats member of its output as it
+				   calibrates each line */
+};
+
+
+
+const struct seviri_options *seviri_options_get(const struct seviri_options *opts);
 
 int seviri_auxillary_alloc(struct seviri_auxillary_io_data *d);
 int seviri_auxillary_free(struct seviri_auxillary_io_data *d);
 
-int fxxxx_swap(void *ptr, size_t size, size_t nmemb, FILE *stream, struct
-               seviri_auxillary_io_data *aux);
+int fxxxx_swap(void *ptr, size_t size, size_t nmemb, struct seviri_io *stream,
+               struct seviri_auxillary_io_data *aux);
 
-int seviri_l15_ph_data_read(FILE *fp,
+int seviri_l15_ph_data_read(struct seviri_io *fp,
                             struct seviri_marf_l15_ph_data_data *d,
                             struct seviri_auxillary_io_data *aux);
-int seviri_l15_ph_data_id_read(FILE *fp,
+int seviri_l15_ph_data_id_read(struct seviri_io *fp,
                                struct seviri_marf_l15_ph_data_id_data *d,
                                struct seviri_auxillary_io_data *aux);
 
-int seviri_marf_header_read(FILE *fp, struct seviri_marf_header_data *d,
+int seviri_marf_header_read(struct seviri_io *fp,
+                            struct seviri_marf_header_data *d,
                             struct seviri_auxillary_io_data *aux);
 
-int seviri_TIME_CDS_read(FILE *fp,
+int seviri_TIME_CDS_read(struct seviri_io *fp,
                          struct seviri_TIME_CDS_data *d,
                          struct seviri_auxillary_io_data *aux);
-int seviri_TIME_CDS_SHORT_read(FILE *fp,
+int seviri_TIME_CDS_SHORT_read(struct seviri_io *fp,
                                struct seviri_TIME_CDS_SHORT_data *d,
                                struct seviri_auxillary_io_data *aux);
-int seviri_TIME_CDS_EXPANDED_read(FILE *fp,
+int seviri_TIME_CDS_EXPANDED_read(struct seviri_io *fp,
                                   struct seviri_TIME_CDS_EXPANDED_data *d,
                                   struct seviri_auxillary_io_data *aux);
 
 int seviri_15HEADER_SatelliteStatus_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_SatelliteStatus_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_ImageAcquisition_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageAcquisition_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_CelestialEvents_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_CelestialEvents_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_ImageDescription_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_ImageDescription_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_RadiometricProcessing_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_RadiometricProcessing_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_GeometricProcessing_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_GeometricProcessing_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_IMPFConfiguration_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_IMPFConfiguration_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_15HEADER_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15HEADER_data *d,
           struct seviri_auxillary_io_data *aux);
 
 int seviri_15TRAILER_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_15TRAILER_data *d,
           struct seviri_auxillary_io_data *aux);
 
 int seviri_packet_header_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_packet_header_data *d,
           struct seviri_auxillary_io_data *aux);
 int seviri_LineSideInfo_read(
-          FILE *fp,
+          struct seviri_io *fp,
           struct seviri_LineSideInfo_data *d,
           struct seviri_auxillary_io_data *aux);
 
@@ -1085,6 +1166,19 @@ int seviri_get_dimension_data(
           uint line0, uint line1, uint column0, uint column1,
           double lat0, double lat1, double lon0, double lon1, int rss);
 
+int seviri_hrv_window(
+          const struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data *d,
+          uint i_line, uint *i_column);
+int seviri_hrv_alloc(struct seviri_image_data *d);
+void seviri_hrv_bin(struct seviri_image_data *d, uint i_band, uint i_line,
+                    uint n_lines);
+void seviri_hrv_unpack(struct seviri_image_data *d,
+          const struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+          *coverage, uint i_band, uint i_line, const uchar *data10);
+void seviri_hrv_pack(const struct seviri_image_data *d,
+          const struct seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+          *coverage, uint i_line, uint k, ushort *line_hrv, uchar *data10);
+
 int seviri_free(struct seviri_data *d);
 
 
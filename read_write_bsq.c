@@ -0,0 +1,787 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ *******************************************************************************
+ *
+ *    Band sequential (BSQ) SEVIRI level 1.5 files have the same U-MARF header,
+ *    level 1.5 header and trailer as Native files but the line records of each
+ *    band are contiguous rather than interleaved by line group.  The records
+ *    of the VIS/IR bands come first, in the order of SelectedBandIDs, each
+ *    band being n_lines_selected_VIR records, followed by the HRV records, if
+ *    HRV was selected, three per VIS/IR line.  The records themselves, packet
+ *    header, line side info and packed 10-bit data, are as in Native files.
+ *
+ *    A band can therefore be read with one sequential pass over only its own
+ *    records, in a few large reads, which is much less I/O than the strided
+ *    access required for a Native file when few bands are requested.  Each
+ *    call opens its own stream so bands may also be read on separate threads
+ *    by the caller, one seviri_read_bsq() per band.
+ *
+ ******************************************************************************/
+
+#include "external.h"
+#include "internal.h"
+#include "read_write.h"
+#include "read_write_bsq.h"
+#include "read_write_nat.h"
+
+
+/* Size of each read of the contiguous records of a band, rounded down to
+   whole records.  A memory stream is viewed in place whatever the size. */
+#define BSQ_CHUNK_SIZE	(1 << 22)
+
+/* Size of the stdio buffer used by the writer. */
+#define BSQ_BUFFER_SIZE	(1 << 20)
+
+
+/*******************************************************************************
+ * Read the chunk of records of a band starting at record i, of at most n_chunk
+ * of the n_records to be read, and hint that the next chunk will be read.
+ *
+ * fp		: The stream of the file
+ * chunk	: Buffer of n_chunk * n_bytes_record bytes to read into
+ * band_offset	: Offset in the file of the first record to be read
+ * i		: Index of the first record of the chunk
+ * n_records	: Number of records to be read
+ * n_chunk	: Number of records per chunk
+ * n_bytes_record: Size of a record
+ * aux		: Seviri_auxillary_io_data struct of the read
+ *
+ * returns	: A memory stream of the chunk or NULL on error
+ ******************************************************************************/
+static struct seviri_io *bsq_read_chunk(struct seviri_io *fp, uchar *chunk,
+                                        long band_offset, uint i,
+                                        uint n_records, uint n_chunk,
+                                        uint n_bytes_record,
+                                        struct seviri_auxillary_io_data *aux)
+{
+     const uchar *p;
+
+     long offset;
+
+     size_t length;
+
+     SU_PERF_TIMER(t);
+
+     offset = band_offset + (long) i * n_bytes_record;
+     length = (size_t) MIN(n_chunk, n_records - i) * n_bytes_record;
+
+     SU_PERF_START(aux->perf, t);
+     seviri_io_seek(fp, offset, SEEK_SET);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_SEEK, 0, 0);
+
+     SU_PERF_START(aux->perf, t);
+     if ((p = seviri_io_view(fp, chunk, length)) == NULL) {
+          fprintf(stderr, "ERROR: seviri_io_view()\n");
+          return NULL;
+     }
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_READ, 0, length);
+
+     if (i + n_chunk < n_records)
+          seviri_io_prefetch(fp, offset + length, (size_t) MIN(n_chunk,
+                             n_records - i - n_chunk) * n_bytes_record);
+
+     return seviri_io_open_mem(p, length);
+}
+
+
+
+/*******************************************************************************
+ * Read the band sequential line records - the actual image data.
+ *
+ * The records of each requested band that are to be read are contiguous and
+ * are read in chunks of BSQ_CHUNK_SIZE, each one read while the next is
+ * prefetched, so that a band is one sequential pass over its own records.
+ *
+ * fp		: Pointer to the image data file set to the beginning of the
+ *              : line records.
+ * image	: The output seviri_image_data struct with the image data
+ * marf_header	: The seviri_marf_header_data struct for the current image data
+ *                file.
+ * coverage	: The planned HRV coverage from the level 1.5 header
+ * n_bands	: Described in the seviri_read_nat() header (read_write_nat.c)
+ * band_ids	: 	''
+ * bounds	: 	''
+ * line0	: 	''
+ * line1	: 	''
+ * column0	: 	''
+ * column1	: 	''
+ * lat0		: 	''
+ * lat1		: 	''
+ * lon0		: 	''
+ * lon1		: 	''
+ * aux		: Seviri_auxillary_io_data struct containing information related
+ *                to the read operation
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+static int seviri_image_read(struct seviri_io *fp,
+                             struct seviri_image_data *image,
+                             const struct seviri_marf_header_data *marf_header,
+                             const struct
+                             seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+                             *coverage,
+                             uint n_bands, const uint *band_ids,
+                             enum seviri_bounds bounds,
+                             uint line0, uint line1, uint column0, uint column1,
+                             double lat0, double lat1, double lon0, double lon1,
+                             struct seviri_auxillary_io_data *aux)
+{
+     uchar *chunk;
+     const uchar *p10;
+
+     uint i;
+     uint ii;
+     uint iii;
+     uint j0;
+     uint j1;
+     uint k;
+
+     uint length;
+
+     uint i_band;
+     int  i_band_hrv;
+
+     uint i_image;
+
+     uint n_chunk_VIR;
+     uint n_chunk_HRV;
+
+     uint n_bands_VIR;
+     uint n_bands_HRV;
+
+     uint n_bytes_VIR_data;
+     uint n_bytes_VIR_line;
+     uint n_bytes_HRV_line;
+
+     uint j_offset;
+     uint i_column0;
+     uint i_column1;
+
+     long n_bytes_VIR_band;
+     long n_bytes_HRV_band;
+
+     long file_start;
+     long file_offset;
+
+     struct seviri_io *io;
+
+     struct seviri_dimension_data *dimens;
+
+     int i_bands_infile[12];
+
+     SU_PERF_TIMER(t);
+
+
+     /*-------------------------------------------------------------------------
+      * Check if the requested band IDs are valid.
+      *-----------------------------------------------------------------------*/
+     image->n_bands = n_bands;
+
+     i_band_hrv = -1;
+
+     for (i = 0; i < n_bands; ++i) {
+          if (band_ids[i] < 1 || band_ids[i] > SEVIRI_N_BANDS) {
+               fprintf(stderr, "ERROR: Invalid SEVIRI band Id at band list "
+                               "element %d: %d\n", i, band_ids[i]);
+               return -1;
+          }
+          image->band_ids[i] = band_ids[i];
+
+          if (band_ids[i] == 12)
+               i_band_hrv = i;
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Count the number VIR and HRV bands in the file.
+      *-----------------------------------------------------------------------*/
+     n_bands_VIR = 0;
+     for (i = 0; i < 11; ++i) {
+          if (marf_header->secondary.SelectedBandIDs.Value[i] == 'X') {
+               n_bands_VIR++;
+          }
+     }
+
+     n_bands_HRV = 0;
+     if (marf_header->secondary.SelectedBandIDs.Value[11] == 'X')
+          n_bands_HRV = 1;
+
+
+     /*-------------------------------------------------------------------------
+      * The position of each requested VIR band among the bands in the file.
+      *-----------------------------------------------------------------------*/
+     for (i = 0; i < n_bands; ++i) {
+          if (marf_header->secondary.SelectedBandIDs.Value[band_ids[i] - 1] == 'X') {
+               iii = -1;
+               for (ii = 0; ii < band_ids[i]; ++ii) {
+                    if (marf_header->secondary.SelectedBandIDs.Value[ii] == 'X')
+                         iii++;
+               }
+               i_bands_infile[i] = iii;
+          }
+          else
+              i_bands_infile[i] = -1;
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Allocate and fill in the seviri_dimension_data struct.
+      *-----------------------------------------------------------------------*/
+     dimens = (struct seviri_dimension_data *) &image->dimens;
+
+     if (seviri_get_dimension_data(dimens, marf_header, bounds, line0, line1,
+                                   column0, column1, lat0, lat1, lon0, lon1, 0)) {
+          fprintf(stderr, "ERROR: seviri_get_dimension_data()\n");
+          return -1;
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Quantities useful for moving around in the file.
+      *-----------------------------------------------------------------------*/
+     n_bytes_VIR_data = dimens->n_columns_selected_VIR / 4 * 5;
+     n_bytes_VIR_line = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE +
+                        n_bytes_VIR_data;
+     n_bytes_HRV_line = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE +
+                        dimens->n_columns_selected_HRV / 4 * 5 / 2;
+
+     n_bytes_VIR_band = (long) dimens->n_lines_selected_VIR * n_bytes_VIR_line;
+     n_bytes_HRV_band = (long) dimens->n_lines_selected_VIR * 3 * n_bytes_HRV_line;
+
+
+     /*-------------------------------------------------------------------------
+      * Image offsets and dimensions and the fill_value for the caller.
+      *-----------------------------------------------------------------------*/
+     image->i_line     = dimens->i_line_requested_VIR;
+     image->i_column   = dimens->i_column_requested_VIR;
+
+     image->n_lines    = dimens->n_lines_requested_VIR;
+     image->n_columns  = dimens->n_columns_requested_VIR;
+
+     image->fill_value = FILL_VALUE_US;
+
+
+     /*-------------------------------------------------------------------------
+      * Allocate memory to hold structure fields.
+      *-----------------------------------------------------------------------*/
+     image->packet_header = malloc(image->n_bands *
+                                   sizeof(struct seviri_packet_header_data *));
+     for (i = 0; i < image->n_bands; ++i)
+          image->packet_header[i] = malloc(dimens->n_lines_requested_VIR *
+                                           sizeof(struct seviri_packet_header_data));
+
+     image->LineSideInfo = malloc(image->n_bands *
+                                  sizeof(struct seviri_LineSideInfo_data *));
+     for (i = 0; i < image->n_bands; ++i)
+          image->LineSideInfo[i]  = malloc(dimens->n_lines_requested_VIR *
+                                           sizeof(struct seviri_LineSideInfo_data ));
+
+     length = dimens->n_lines_requested_VIR * dimens->n_columns_requested_VIR;
+
+     image->data_vir = malloc(image->n_bands * sizeof(ushort *));
+     for (i = 0; i < image->n_bands; ++i) {
+          image->data_vir[i] = malloc(length * sizeof(ushort));
+          su_init_array_us(image->data_vir[i], length, image->fill_value);
+     }
+
+     image->n_lines_hrv   = 0;
+     image->n_columns_hrv = 0;
+     image->data_hrv      = NULL;
+
+     if (i_band_hrv >= 0 && seviri_hrv_alloc(image)) {
+          fprintf(stderr, "ERROR: seviri_hrv_alloc()\n");
+          return -1;
+     }
+
+     if (i_band_hrv >= 0 && n_bands_HRV == 0)
+          i_band_hrv = -1;
+
+
+     /*-------------------------------------------------------------------------
+      * Read the VIR bands, one sequential pass per band.
+      *-----------------------------------------------------------------------*/
+     n_chunk_VIR = MAX(BSQ_CHUNK_SIZE / n_bytes_VIR_line, 1);
+     n_chunk_HRV = MAX(BSQ_CHUNK_SIZE / (3 * n_bytes_HRV_line), 1);
+
+     chunk = malloc(MAX((size_t) n_chunk_VIR * n_bytes_VIR_line,
+                        (size_t) n_chunk_HRV * 3 * n_bytes_HRV_line) *
+                    sizeof(uchar));
+
+     file_start = seviri_io_tell(fp);
+
+     /* The range of the VIR pixels read, which are aligned on 4 pixel/5 byte
+        boundaries, that are within the requested image area. */
+     j_offset  = dimens->i0_column_selected_VIR + dimens->i_column_to_read_VIR;
+     i_column0 = dimens->i_column_requested_VIR;
+     i_column1 = dimens->i_column_requested_VIR + dimens->n_columns_requested_VIR - 1;
+
+     j0 = i_column0 > j_offset ? i_column0 - j_offset : 0;
+     j1 = MIN(i_column1 - j_offset, dimens->n_columns_to_read_VIR - 1);
+
+     io = NULL;
+
+     for (i_band = 0; i_band < image->n_bands; ++i_band) {
+          if (i_bands_infile[i_band] < 0 || image->band_ids[i_band] == 12)
+               continue;
+
+          file_offset = file_start + i_bands_infile[i_band] * n_bytes_VIR_band +
+                        (long) dimens->i_line_to_read_VIR * n_bytes_VIR_line;
+
+          for (i = 0; i < dimens->n_lines_to_read_VIR; ++i) {
+               ii = dimens->i_line_in_output_VIR + i;
+
+               if (i % n_chunk_VIR == 0) {
+                    if (io)
+                         seviri_io_close(io);
+
+                    if ((io = bsq_read_chunk(fp, chunk, file_offset, i,
+                                             dimens->n_lines_to_read_VIR,
+                                             n_chunk_VIR, n_bytes_VIR_line,
+                                             aux)) == NULL) {
+                         fprintf(stderr, "ERROR: bsq_read_chunk()\n");
+                         free(chunk);
+                         return -1;
+                    }
+               }
+
+               if (seviri_packet_header_read(io, &image->packet_header[i_band][i], aux) ||
+                   seviri_LineSideInfo_read (io, &image->LineSideInfo [i_band][i], aux) ||
+                   (p10 = seviri_io_view(io, NULL, n_bytes_VIR_data)) == NULL) {
+                    fprintf(stderr, "ERROR: Problem reading a line record of "
+                            "band %u\n", image->band_ids[i_band]);
+                    seviri_io_close(io);
+                    free(chunk);
+                    return -1;
+               }
+
+               SU_PERF_START(aux->perf, t);
+               i_image = ii * dimens->n_columns_requested_VIR + dimens->i_column_in_output_VIR;
+
+               su_unpack_10bit(p10, dimens->i_column_to_read_VIR + j0, j1 - j0 + 1,
+                               image->data_vir[i_band] + i_image);
+               SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_UNPACK, j1 - j0 + 1, 0);
+          }
+
+          if (io) {
+               seviri_io_close(io);
+               io = NULL;
+          }
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Read the HRV band, three records per line group.
+      *-----------------------------------------------------------------------*/
+     if (i_band_hrv >= 0) {
+          file_offset = file_start + n_bands_VIR * n_bytes_VIR_band +
+                        (long) dimens->i_line_to_read_VIR * 3 * n_bytes_HRV_line;
+
+          for (i = 0; i < dimens->n_lines_to_read_VIR; ++i) {
+               ii = dimens->i_line_in_output_VIR + i;
+
+               if (i % n_chunk_HRV == 0) {
+                    if (io)
+                         seviri_io_close(io);
+
+                    if ((io = bsq_read_chunk(fp, chunk, file_offset, i,
+                                             dimens->n_lines_to_read_VIR,
+                                             n_chunk_HRV, 3 * n_bytes_HRV_line,
+                                             aux)) == NULL) {
+                         fprintf(stderr, "ERROR: bsq_read_chunk()\n");
+                         free(chunk);
+                         return -1;
+                    }
+               }
+
+               /* The rest of the three HRV records in place. */
+               k = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE;
+
+               if (seviri_packet_header_read(io, &image->packet_header[i_band_hrv][i], aux) ||
+                   seviri_LineSideInfo_read (io, &image->LineSideInfo [i_band_hrv][i], aux) ||
+                   (p10 = seviri_io_view(io, NULL, 3 * n_bytes_HRV_line - k)) == NULL) {
+                    fprintf(stderr, "ERROR: Problem reading a line record of "
+                            "band 12\n");
+                    seviri_io_close(io);
+                    free(chunk);
+                    return -1;
+               }
+
+               SU_PERF_START(aux->perf, t);
+               seviri_hrv_unpack(image, coverage, i_band_hrv, ii, p10 - k);
+               SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_UNPACK,
+                            3 * image->n_columns_hrv, 0);
+          }
+
+          if (io)
+               seviri_io_close(io);
+     }
+
+
+     file_offset = file_start + n_bands_VIR * n_bytes_VIR_band +
+                                n_bands_HRV * n_bytes_HRV_band;
+
+     SU_PERF_START(aux->perf, t);
+     seviri_io_seek(fp, file_offset, SEEK_SET);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_SEEK, 0, 0);
+
+
+     free(chunk);
+
+
+     return 0;
+}
+
+
+/*******************************************************************************
+ * Write the band sequential line records - the actual image data.
+ *
+ * fp		: File pointer to where the line records are to be written.
+ * image	: The input seviri_image_data struct
+ * coverage	: The planned HRV coverage from the level 1.5 header
+ * aux		: Seviri_auxillary_io_data struct containing information related
+ *                to the read operation
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+static int seviri_image_write(struct seviri_io *fp,
+                              const struct seviri_image_data *image,
+                              const struct
+                              seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+                              *coverage,
+                              struct seviri_auxillary_io_data *aux)
+{
+     uchar *data10;
+
+     ushort *line_hrv = NULL;
+
+     uint i;
+     uint ii;
+     uint k;
+
+     uint i_band;
+     int  i_band_hrv;
+
+     uint i_image;
+
+     uint n_columns_HRV_line;
+
+     const struct seviri_dimension_data *dimens;
+
+
+     /*-------------------------------------------------------------------------
+      * For convenience.
+      *-----------------------------------------------------------------------*/
+     dimens = (struct seviri_dimension_data *) &image->dimens;
+
+     i_band_hrv = -1;
+     for (i_band = 0; i_band < image->n_bands; ++i_band) {
+          if (image->band_ids[i_band] == 12 && image->data_hrv)
+               i_band_hrv = i_band;
+     }
+
+     n_columns_HRV_line = dimens->n_columns_selected_HRV / 2;
+
+
+     /*-------------------------------------------------------------------------
+      * Write the VIR bands one after the other.
+      *-----------------------------------------------------------------------*/
+     data10 = malloc(MAX(dimens->n_columns_selected_VIR,
+                         n_columns_HRV_line) / 4 * 5 * sizeof(uchar));
+
+     for (i_band = 0; i_band < image->n_bands; ++i_band) {
+          if (image->band_ids[i_band] == 12)
+               continue;
+
+          for (i = 0; i < dimens->n_lines_to_read_VIR; ++i) {
+               ii = dimens->i_line_in_output_VIR + i;
+
+               if (seviri_packet_header_read(fp, &image->packet_header[i_band][i], aux)) {
+                    fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+                    return -1;
+               }
+
+               if (seviri_LineSideInfo_read(fp, &image->LineSideInfo  [i_band][i], aux)) {
+                    fprintf(stderr, "ERROR: seviri_LineSideInfo_read()\n");
+                    return -1;
+               }
+
+               i_image = ii * dimens->n_columns_requested_VIR + dimens->i_column_in_output_VIR;
+
+               su_pack_10bit(image->data_vir[i_band] + i_image,
+                             dimens->n_columns_to_read_VIR, data10);
+
+               if (seviri_io_write(data10, sizeof(char),
+                                   dimens->n_columns_to_read_VIR / 4 * 5, fp) <
+                          dimens->n_columns_to_read_VIR / 4 * 5) E_L_R();
+          }
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * Then the HRV band.
+      *-----------------------------------------------------------------------*/
+     if (i_band_hrv >= 0) {
+          line_hrv = malloc(n_columns_HRV_line * sizeof(ushort));
+
+          for (i = 0; i < dimens->n_lines_to_read_VIR; ++i) {
+               ii = dimens->i_line_in_output_VIR + i;
+
+               for (k = 0; k < 3; ++k) {
+                    if (seviri_packet_header_read(fp, &image->packet_header[i_band_hrv][i], aux)) {
+                         fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+                         return -1;
+                    }
+
+                    if (seviri_LineSideInfo_read(fp, &image->LineSideInfo  [i_band_hrv][i], aux)) {
+                         fprintf(stderr, "ERROR: seviri_LineSideInfo_read()\n");
+                         return -1;
+                    }
+
+                    seviri_hrv_pack(image, coverage, ii, k, line_hrv, data10);
+
+                    if (seviri_io_write(data10, sizeof(char),
+                                   n_columns_HRV_line / 4 * 5, fp) <
+                               n_columns_HRV_line / 4 * 5) E_L_R();
+               }
+          }
+
+          free(line_hrv);
+     }
+
+
+     free(data10);
+
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Convenience function that returns the number of lines and columns in the
+ * image to be read with the given choice of offset and dimension parameters.
+ * As the headers are the same as those of Native files this is the same as
+ * seviri_get_dimens_nat().
+ *
+ * filename	: BSQ SEVIRI level 1.5 filename
+ * i_line	: Output line offset to the beginning of the actual image
+ *                within the full disk
+ * i_column	: Output column offset to the beginning of the actual image
+ *                within the full disk
+ * n_lines	: Output number of lines of the actual image
+ * n_columns	: Output number of columns of the actual image
+ * bounds	: Described in the seviri_read_nat() header (read_write_nat.c)
+ * line0	: 	''
+ * line1	: 	''
+ * column0	: 	''
+ * column1	: 	''
+ * lat0		: 	''
+ * lat1		: 	''
+ * lon0		: 	''
+ * lon1		: 	''
+ * opts		: 	''
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_get_dimens_bsq(const char *filename, uint *i_line, uint *i_column,
+                          uint *n_lines, uint *n_columns, enum seviri_bounds bounds,
+                          uint line0, uint line1, uint column0, uint column1,
+                          double lat0, double lat1, double lon0, double lon1,
+                          const struct seviri_options *opts)
+{
+     return seviri_get_dimens_nat(filename, i_line, i_column, n_lines,
+                                  n_columns, bounds, line0, line1, column0,
+                                  column1, lat0, lat1, lon0, lon1, opts);
+}
+
+
+
+/*******************************************************************************
+ * The main read function.
+ *
+ * filename	: BSQ SEVIRI level 1.5 filename
+ * d		: The output seviri_data struct with the U-MARF header, level
+ *                1.5 header and trailer, and the image data.
+ * n_bands	: Described in the seviri_read_nat() header (read_write_nat.c)
+ * band_ids	: 	''
+ * bounds	: 	''
+ * line0	: 	''
+ * line1	: 	''
+ * column0	: 	''
+ * column1	: 	''
+ * lat0		: 	''
+ * lat1		: 	''
+ * lon0		: 	''
+ * lon1		: 	''
+ * opts		: 	''
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_read_bsq(const char *filename, struct seviri_data *d,
+                    uint n_bands, const uint *band_ids,
+                    enum seviri_bounds bounds,
+                    uint line0, uint line1, uint column0, uint column1,
+                    double lat0, double lat1, double lon0, double lon1,
+                    const struct seviri_options *opts)
+{
+     struct seviri_io *fp;
+
+     struct seviri_auxillary_io_data aux;
+
+     SU_PERF_TIMER(t);
+
+     aux.operation  = 0;
+     aux.swap_bytes = su_is_little_endian();
+
+     seviri_auxillary_alloc(&aux);
+
+     seviri_perf_init(&d->perf);
+     aux.perf = &d->perf;
+
+     opts = seviri_options_get(opts);
+
+     SU_PERF_START(aux.perf, t);
+     if ((fp = seviri_io_open(filename, "r", opts->open, opts->open_data)) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
+                  filename, strerror(errno));
+          seviri_auxillary_free(&aux);
+          return -1;
+     }
+     SU_PERF_STOP(aux.perf, t, SEVIRI_PERF_OPEN, 0, 0);
+
+     if (seviri_marf_header_read(fp, &d->marf_header, &aux)) {
+          fprintf(stderr, "ERROR: seviri_marf_header_read(), filename = %s\n",
+                  filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_packet_header_read(fp, &d->packet_header1, &aux)) {
+          fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+          return -1;
+     }
+
+     if (seviri_15HEADER_read(fp, &d->header, &aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_read(), filename = %s\n",
+                  filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_image_read(fp, &d->image, &d->marf_header,
+                           &d->header.ImageDescription.PlannedCoverageHRV,
+                           n_bands, band_ids,
+                           bounds, line0, line1, column0, column1, lat0, lat1,
+                           lon0, lon1, &aux)) {
+          fprintf(stderr, "ERROR: seviri_image_read(), filename = %s\n",
+                 filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_packet_header_read(fp, &d->packet_header2, &aux)) {
+          fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+          return -1;
+     }
+
+     if (seviri_15TRAILER_read(fp, &d->trailer, &aux)) {
+          fprintf(stderr, "ERROR: seviri_15TRAILER_read(), filename = %s\n",
+                  filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     SU_PERF_START(aux.perf, t);
+     seviri_io_close(fp);
+     SU_PERF_STOP(aux.perf, t, SEVIRI_PERF_OPEN, 0, 0);
+
+     seviri_auxillary_free(&aux);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * The main write function.
+ *
+ * filename	: BSQ SEVIRI level 1.5 filename
+ * d		: The input seviri_data struct with the U-MARF header, level 1.5
+ *                header and trailer, and the image data.
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_write_bsq(const char *filename, const struct seviri_data *d)
+{
+     struct seviri_io *fp;
+
+     struct seviri_auxillary_io_data aux;
+
+     aux.operation  = 1;
+     aux.swap_bytes = su_is_little_endian();
+
+     seviri_auxillary_alloc(&aux);
+
+     if ((fp = seviri_io_open(filename, "w", NULL, NULL)) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for writing: %s ... %s\n",
+                  filename, strerror(errno));
+          return -1;
+     }
+
+     seviri_io_setvbuf(fp, BSQ_BUFFER_SIZE);
+
+     if (seviri_marf_header_read(fp, (struct seviri_marf_header_data *)
+                                 &d->marf_header, &aux)) {
+          fprintf(stderr, "ERROR: seviri_marf_header_read(), filename = %s\n",
+                  filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_packet_header_read(fp, (struct seviri_packet_header_data *)
+                                   &d->packet_header1, &aux)) {
+          fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+          return -1;
+     }
+
+     if (seviri_15HEADER_read(fp, (struct seviri_15HEADER_data *)
+                              &d->header, &aux)) {
+          fprintf(stderr, "ERROR: seviri_15HEADER_read(), filename = %s\n",
+                  filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_image_write(fp, &d->image,
+                            &d->header.ImageDescription.PlannedCoverageHRV, &aux)) {
+          fprintf(stderr, "ERROR: seviri_image_write(), filename = %s\n",
+                 filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     if (seviri_packet_header_read(fp, (struct seviri_packet_header_data *)
+                                   &d->packet_header2, &aux)) {
+          fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+          return -1;
+     }
+
+     if (seviri_15TRAILER_read(fp, (struct seviri_15TRAILER_data *)
+                               &d->trailer, &aux)) {
+          fprintf(stderr, "ERROR: seviri_15TRAILER_read(), filename = %s\n",
+                  filename);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     seviri_io_close(fp);
+
+     seviri_auxillary_free(&aux);
+
+     return 0;
+}
@@ -20,38 +20,49 @@
  *
  * fname:	Name of the EPI file to be read (including full directory)
  * d:		Main SEVIRI data structure
+ * tar:		Tar archive containing the file or NULL
+ * opts:	Options of the read
  * aux:		Auxiliary data structure
  *
  * returns:	Zero if successful, nonzero if error
  ******************************************************************************/
 static int read_hrit_epilogue(const char *fname, struct seviri_data *d,
+                              struct seviri_tar *tar,
+                              const struct seviri_options *opts,
                               struct seviri_auxillary_io_data *aux)
 {
-     FILE *fp;
-     int out;
-     const unsigned int probeSize = 4;
-     long hdrlen = 10;
-     unsigned char probeBuf[probeSize];
+     struct seviri_io *fp;
+
+     struct hrit_header h;
+
+     SU_PERF_TIMER(t);
 
      /* Open epilogue */
-     if ((fp = fopen(fname, "rb")) == NULL) {
+     SU_PERF_START(aux->perf, t);
+     if ((fp = hrit_open(fname, tar, opts)) == NULL) {
           fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
                   fname, strerror(errno));
           return -1;
      }
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
-     fseek(fp,0,SEEK_SET);
-/*
-     if (seviri_15HEADER_SatelliteStatus_read(fp, &d->header.SatelliteStatus, aux)) E_L_R();
-*/
-     /* Read first part of prologue and check contents to see if correct filetype. */
-     out = fread((char *) probeBuf, probeSize,1,fp);
-     out = out;
+     /* Read the header records, leaving the file at the start of the data. */
+     if (read_hrit_header(fp, fname, &h)) {
+          fprintf(stderr, "ERROR: read_hrit_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
 
-     if (probeBuf[0] == 0 && probeBuf[1] == 0 && probeBuf[2] == 16) {
-          if (fxxxx_swap(&hdrlen, 4, 1,  fp, aux) < 0) {E_L_R();}
+     if (h.file_type != HRIT_FILE_TYPE_EPILOGUE) {
+          fprintf(stderr, "ERROR: Not an HRIT epilogue: %s\n", fname);
+          seviri_io_close(fp);
+          return -1;
      }
-     fseek(fp,hdrlen+1,SEEK_SET);
+
+     /* Skip the level 1.5 trailer version. */
+     SU_PERF_START(aux->perf, t);
+     seviri_io_seek(fp, 1, SEEK_CUR);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_SEEK, 0, 0);
      if (fxxxx_swap(&d->trailer.ImageProductionStats.SatelliteID,          sizeof(short), 1,  fp, aux) < 0) {E_L_R();}
 
      if (fxxxx_swap(&d->trailer.ImageProductionStats.NominalImageScanning, sizeof(uchar), 1,  fp, aux) < 0) {E_L_R();}
@@ -59,7 +70,9 @@ static int read_hrit_epilogue(const char *fname, struct seviri_data *d,
      if (seviri_TIME_CDS_SHORT_read(fp, &d->trailer.ImageProductionStats.ActScanForwardStart,     aux))     {E_L_R();}
      if (seviri_TIME_CDS_SHORT_read(fp, &d->trailer.ImageProductionStats.ActScanForwardEnd,       aux))     {E_L_R();}
 
-     fclose(fp);
+     SU_PERF_START(aux->perf, t);
+     seviri_io_close(fp);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
      return 0;
 }
@@ -72,42 +85,56 @@ static int read_hrit_epilogue(const char *fname, struct seviri_data *d,
  *
  * fname:	Name of the PRO file to be read (including full directory)
  * d:		Main SEVIRI data structure
+ * tar:		Tar archive containing the file or NULL
+ * opts:	Options of the read
  * aux:		Auxiliary data structure
  *
  * returns:	Zero if successful, nonzero if error
  ******************************************************************************/
 static int read_hrit_prologue(const char *fname, struct seviri_data *d,
+                              struct seviri_tar *tar,
+                              const struct seviri_options *opts,
                               struct seviri_auxillary_io_data *aux)
 {
-     FILE *fp;
-     int out;
-     const unsigned int probeSize = 4;
-     long hdrlen = 10;
-     unsigned char probeBuf[probeSize];
+     struct seviri_io *fp;
+
+     struct hrit_header h;
+
+     SU_PERF_TIMER(t);
 
      /* Open prologue*/
-     if ((fp = fopen(fname, "rb")) == NULL) {
+     SU_PERF_START(aux->perf, t);
+     if ((fp = hrit_open(fname, tar, opts)) == NULL) {
           fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
                   fname, strerror(errno));
           return -1;
      }
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
-     fseek(fp,0,SEEK_SET);
-
-     /* Read first part of prologue and check contents to see if correct filetype*/
-     out = fread((char *)probeBuf, probeSize,1,fp);
-     out = out;
+     /* Read the header records, leaving the file at the start of the data. */
+     if (read_hrit_header(fp, fname, &h)) {
+          fprintf(stderr, "ERROR: read_hrit_header()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
 
-     if (probeBuf[0] == 0 && probeBuf[1] == 0 && probeBuf[2] == 16)
-          if (fxxxx_swap(&hdrlen, 4, 1, fp, aux) < 0) {E_L_R();}
-     fseek(fp, hdrlen, SEEK_SET);
+     if (h.file_type != HRIT_FILE_TYPE_PROLOGUE) {
+          fprintf(stderr, "ERROR: Not an HRIT prologue: %s\n", fname);
+          seviri_io_close(fp);
+          return -1;
+     }
 
      seviri_15HEADER_SatelliteStatus_read(fp,&d->header.SatelliteStatus, aux);
 
-     /* Seek to the beginning of the useful part of the prologue (only care
-        about image desc and radiometric calibration. This seek value should be
-        constant, has not changed in 11 years of MSG data. */
-     fseek(fp, 386982, SEEK_SET);
+     /* The image acquisition data follows, with the planned scan times that
+        stand in for those of the epilogue during an incremental ingest. */
+     if (seviri_15HEADER_ImageAcquisition_read(fp, &d->header.ImageAcquisition, aux)) {E_L_R();}
+
+     /* Skip the celestial events, which are of fixed length, to the image
+        description, the first of the remaining records used. */
+     SU_PERF_START(aux->perf, t);
+     seviri_io_seek(fp, h.header_length + HRIT_PROLOGUE_IMAGE_DESCRIPTION, SEEK_SET);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_SEEK, 0, 0);
 
      /* Read the image description data */
      if (seviri_15HEADER_ImageDescription_read     (fp, &d->header.ImageDescription,      aux)) {E_L_R();}
@@ -116,14 +143,16 @@ static int read_hrit_prologue(const char *fname, struct seviri_data *d,
      /* Read geometric processing data */
      if (seviri_15HEADER_GeometricProcessing_read(fp, &d->header.GeometricProcessing, aux)) {E_L_R();}
 
-     fclose(fp);
+     SU_PERF_START(aux->perf, t);
+     seviri_io_close(fp);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
      return 0;
 }
 
 /*******************************************************************************
- * Allocate the space in memory to be used for the SEVIRI image. Space is
- * allocated for the HRV data is required, although it is unsupported.
+ * Allocate the space in memory to be used for the SEVIRI image, including the
+ * HRV image if the HRV band is requested.  d->image.dimens must be set.
  *
  * nbands:	Number of bands to be read (NOT number of bands in file)
  * band_ids:	Array of band ids (channel numbers)
@@ -133,34 +162,34 @@ static int read_hrit_prologue(const char *fname, struct seviri_data *d,
  ******************************************************************************/
 static int alloc_imagearr(uint nbands, const uint *band_ids, struct seviri_data *d)
 {
-     int i,proc_hrv = 0,virb;
-     long length_vir,length_hrv;
-     virb = nbands;
+     uint i;
+     int proc_hrv = 0;
+     long length_vir;
+
+     if (nbands==0) return -1;
 
      for (i = 0; i < nbands; ++i) {
           d->image.band_ids[i]=band_ids[i];
-          if (band_ids[i]==12) {
-               virb -= 1;
+          if (band_ids[i]==12)
                proc_hrv = 1;
-          }
      }
 
      d->image.n_bands    = nbands;
      d->image.fill_value = FILL_VALUE_US;
 
-     length_vir = d->header.ImageDescription.ReferenceGridVIS_IR.NumberOfLines *
-          d->header.ImageDescription.ReferenceGridVIS_IR.NumberOfColumns;
-     length_hrv = d->header.ImageDescription.ReferenceGridHRV.NumberOfLines    *
-          d->header.ImageDescription.ReferenceGridHRV.NumberOfColumns;
-
-     if (virb<=0) return -1;
+     length_vir = d->image.n_lines * d->image.n_columns;
 
-     d->image.data_vir = malloc(virb * sizeof(ushort *));
-     for (i = 0; i < virb; ++i) {
-          d->image.data_vir[i] = malloc(length_vir * sizeof(float));
+     d->image.data_vir = malloc(nbands * sizeof(ushort *));
+     for (i = 0; i < nbands; ++i) {
+          d->image.data_vir[i] = malloc(length_vir * sizeof(ushort));
           su_init_array_us(d->image.data_vir[i], length_vir, d->image.fill_value);
      }
-     if (proc_hrv==1) d->image.data_hrv = malloc(length_hrv * sizeof(float));
+
+     d->image.n_lines_hrv   = 0;
+     d->image.n_columns_hrv = 0;
+     d->image.data_hrv      = NULL;
+
+     if (proc_hrv==1 && seviri_hrv_alloc(&d->image)) {E_L_R();}
 
      return 0;
 }
@@ -233,60 +262,219 @@ int seviri_get_dimens_hrit(const char *indir, const char *timeslot, int sat,
 
 
 /*******************************************************************************
- * Main function for reading the HRIT data
- * Assembles the filenames, reads ancillary data, reads bands, tidies up.
+ * The number of segments of the given band, unsigned so that it compares with
+ * the segment indices below.
+ ******************************************************************************/
+static uint n_band_segments(uint band_id)
+{
+     return (uint) is_hrv((int) band_id);
+}
+
+
+
+/*******************************************************************************
+ * The first segment (from zero) that is scanned for the given band: RSS only
+ * scans the northern 3 VIR or 9 HRV segments.
+ ******************************************************************************/
+static uint first_segment(uint band_id, int rss)
+{
+     if (rss!=1) return 0;
+
+     return band_id==12 ? 15 : 5;
+}
+
+
+
+/*******************************************************************************
+ * Non-zero if the 464 lines of the given segment, placed as by
+ * read_data_oneseg(), intersect the requested lines of the image.  Segments
+ * that do not are neither opened nor read.
+ ******************************************************************************/
+static int segment_in_image(const struct seviri_image_data *image,
+                            uint band_id, uint segnum, int rss)
+{
+     long x0,first_line,last_line;
+
+     x0 = (long) (segnum - first_segment(band_id, rss)) * 464;
+
+     if (band_id==12) {
+          first_line = image->dimens.i_line_requested_HRV;
+          last_line  = first_line + (long) image->dimens.n_lines_requested_HRV - 1;
+     }
+     else {
+          first_line = image->dimens.i_line_requested_VIR;
+          last_line  = first_line + (long) image->dimens.n_lines_requested_VIR - 1;
+     }
+
+     return x0 <= last_line && x0 + 464 > first_line;
+}
+
+
+
+/*******************************************************************************
+ * Read one segment of an incremental ingest.  If this completes a block of 464
+ * VIR lines for all the requested bands the output lines of the block that are
+ * within the requested image are returned in i_line and n_lines, and the HRV
+ * band, if requested, is binned for those lines.  Otherwise n_lines is zero.
  *
- * indir:	Directory containing the HRIT data
- * timeslot:	Timeslot to be read. Format: YYYYMMDDHHMM
- * sat:		Satellite number - can be 1, 2, 3 or 4
- * d:		Main SEVIRI data structure
- * nbands:	Number of bands to be read (NOT number of bands in file)
- * band_ids:	Array of band ids (channel numbers)
- * bounds:	Boundaries of the data to be read
- * line0:	First line to read
- * line1:	Last line to read
- * column0:	First column to read
- * column1:	Last column to read
- * lat0:	Initial latitude
- * lat1:	Final latitude
- * lon0:	Initial longitude
- * lon1:	Final longitude
- * rss:		Flag to set rss processing (1=yes, 0=no)
- * iodc:	Flag to set IODC processing (1=yes, 0=no)
+ * s:		Ingest state from seviri_hrit_ingest_init()
+ * i_band:	Index of the band in d->image.band_ids
+ * segnum:	The segment number to be read (0->7 / 0->23 for VIR / HRV)
+ * i_line:	Output first line completed within the output image
+ * n_lines:	Output number of lines completed
  *
  * returns:	Zero if successful, nonzero if error
  ******************************************************************************/
-int seviri_read_hrit(const char *indir, const char *timeslot, int sat,
-     struct seviri_data *d, uint n_bands, const uint *band_ids,
-     enum seviri_bounds bounds, uint line0, uint line1, uint column0,
-     uint column1, double lat0, double lat1, double lon0, double lon1, int rss,
-     int iodc)
+static int ingest_segment(struct seviri_hrit_ingest_data *s, uint i_band,
+                          uint segnum, uint *i_line, uint *n_lines)
+{
+     uint i,j,k;
+     long x0,x1;
+
+     struct seviri_image_data *image = &s->d->image;
+
+     *n_lines = 0;
+
+     if (s->have_segment[i_band][segnum])
+          return 0;
+
+     if (read_data_oneseg(s->bnames[i_band][segnum], segnum, i_band, s->d, s->rss,
+                          s->tar, &s->opts)) {
+          fprintf(stderr, "ERROR: read_data_oneseg()\n");
+          return -1;
+     }
+
+     s->have_segment[i_band][segnum] = 1;
+     s->n_segments_read++;
+
+     /* The VIR segment, or block, this segment is part of.  Each covers the
+        lines of three HRV segments. */
+     k = image->band_ids[i_band]==12 ? segnum / 3 : segnum;
+
+     for (i = 0; i < image->n_bands; i++) {
+          if (image->band_ids[i]==12) {
+               for (j = 3 * k; j < 3 * k + 3; j++) {
+                    if (! s->have_segment[i][j])
+                         return 0;
+               }
+          }
+          else if (! s->have_segment[i][k])
+               return 0;
+     }
+
+     s->have_block[k] = 1;
+
+     /* The lines of the block within the output image. */
+     x0 = (long) (k - first_segment(1, s->rss)) * 464 -
+          image->dimens.i_line_requested_VIR;
+     x1 = x0 + 464;
+
+     x0 = MAX(x0, 0);
+     x1 = MIN(x1, (long) image->n_lines);
+
+     if (x0 >= x1)
+          return 0;
+
+     for (i = 0; i < image->n_bands; i++) {
+          if (image->band_ids[i]==12)
+               seviri_hrv_bin(image, i, x0, x1 - x0);
+     }
+
+     *i_line  = x0;
+     *n_lines = x1 - x0;
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Start an incremental ingest of a HRIT timeslot, for use while the segments
+ * are still arriving.  Only the prologue is required at this point.  It is
+ * read and the image is allocated, filled with fill_value, after which the
+ * segments are read as they become available with seviri_hrit_ingest_segment()
+ * or seviri_hrit_ingest_poll(), in any order, and the ingest is completed with
+ * seviri_hrit_ingest_finish(), which requires the epilogue.  On error, or to
+ * abandon the ingest, call seviri_hrit_ingest_free() and seviri_free().
+ *
+ * Until the epilogue is read the scan start and end times in d->trailer are
+ * the planned ones from the prologue so that the image may be pre-processed,
+ * for example with seviri_preproc_lines(), as each block of lines completes.
+ *
+ * s:		Output ingest state
+ * d:		Main SEVIRI data structure, as for seviri_read_hrit()
+ * The rest:	Described in the seviri_read_hrit() header
+ *
+ * returns:	Zero if successful, nonzero if error
+ ******************************************************************************/
+int seviri_hrit_ingest_init(struct seviri_hrit_ingest_data *s,
+     const char *indir, const char *timeslot, int sat, struct seviri_data *d,
+     uint n_bands, const uint *band_ids, enum seviri_bounds bounds, uint line0,
+     uint line1, uint column0, uint column1, double lat0, double lat1,
+     double lon0, double lon1, int rss, int iodc,
+     const struct seviri_options *opts)
 {
      long int out,i,j;
      char *proname;
-     char *epiname;
-     char ***bnames;
+     const char *namedir;
 
      struct seviri_auxillary_io_data aux;
 
      struct seviri_dimension_data *dimens;
 
+     memset(s, 0, sizeof(struct seviri_hrit_ingest_data));
+
+     s->rss  = rss;
+     s->opts = *seviri_options_get(opts);
+     s->d    = d;
+
+     if (n_bands==0 || n_bands>SEVIRI_N_BANDS) {
+          fprintf(stderr, "ERROR: Invalid number of bands: %u\n", n_bands);
+          return -1;
+     }
+
+     for (i = 0; i < n_bands; i++) {
+          if (band_ids[i]<1 || band_ids[i]>SEVIRI_N_BANDS) {
+               fprintf(stderr, "ERROR: Invalid SEVIRI band Id at band list "
+                               "element %ld: %d\n", i, band_ids[i]);
+               return -1;
+          }
+     }
+
+     /* The members of a tar archive are named without a directory. */
+     namedir = seviri_is_tar(indir) ? "" : indir;
+
      /* Get the names of the prologue, epilogue and data files. */
-     /* NOTE: Only supports full disk scanning. RSS unavailable! */
-     out = assemble_proname(&proname, indir, timeslot, sat, rss, iodc);
+     out = assemble_proname(&proname, namedir, timeslot, sat, rss, iodc);
      if (out != 0) {
           fprintf(stderr, "ERROR: assemble_proname()\n");
           return -1;
      }
-     out = assemble_epiname(&epiname,indir,timeslot, sat, rss, iodc);
+     out = assemble_epiname(&s->epiname,namedir,timeslot, sat, rss, iodc);
      if (out != 0) {
           fprintf(stderr, "ERROR: assemble_epiname()\n");
+          free(proname);
           return -1;
      }
-     out = assemble_fnames(&bnames, indir, timeslot, n_bands, band_ids,sat, rss,
-                           iodc);
+     out = assemble_fnames(&s->bnames, namedir, timeslot, n_bands, band_ids,sat,
+                           rss, iodc);
      if (out != 0) {
           fprintf(stderr, "ERROR: assemble_fnames()\n");
+          free(proname);
+          free(s->epiname);
+          return -1;
+     }
+
+     /* seviri_hrit_ingest_free() needs the band list. */
+     d->image.n_bands = n_bands;
+     for (i = 0; i < n_bands; ++i)
+          d->image.band_ids[i] = band_ids[i];
+
+     /* Index the archive once, the files are then read from it in place. */
+     if (namedir != indir && (s->tar = seviri_tar_open(indir)) == NULL) {
+          fprintf(stderr, "ERROR: seviri_tar_open()\n");
+          free(proname);
+          seviri_hrit_ingest_free(s);
           return -1;
      }
 
@@ -295,18 +483,34 @@ int seviri_read_hrit(const char *indir, const char *timeslot, int sat,
      aux.operation  = 0;
      aux.swap_bytes = su_is_little_endian();
 
-     /* Read the epilogue file */
-     if (read_hrit_epilogue(epiname,d,&aux)) {
-          fprintf(stderr, "ERROR: read_hrit_epilogue()\n");
-          return -1;
-     }
+     seviri_perf_init(&d->perf);
+     aux.perf = &d->perf;
 
      /* Read the prologue file */
-     if (read_hrit_prologue(proname,d,&aux)) {
-          fprintf(stderr, "ERROR: read_hrit_epilogue()\n");
+     if (read_hrit_prologue(proname,d,s->tar,&s->opts,&aux)) {
+          fprintf(stderr, "ERROR: read_hrit_prologue()\n");
+          seviri_auxillary_free(&aux);
+          free(proname);
+          seviri_hrit_ingest_free(s);
           return -1;
      }
 
+     seviri_auxillary_free(&aux);
+     free(proname);
+
+     /* The epilogue is the last file of a timeslot to arrive so until it is
+        read use the satellite and the planned scan times from the prologue. */
+     d->trailer.ImageProductionStats.SatelliteID =
+          d->header.SatelliteStatus.SatelliteId;
+     d->trailer.ImageProductionStats.ActScanForwardStart.day  =
+          d->header.ImageAcquisition.TrueRepeatCycleStart.day;
+     d->trailer.ImageProductionStats.ActScanForwardStart.msec =
+          d->header.ImageAcquisition.TrueRepeatCycleStart.msec;
+     d->trailer.ImageProductionStats.ActScanForwardEnd.day    =
+          d->header.ImageAcquisition.PlannedForwardScanEnd.day;
+     d->trailer.ImageProductionStats.ActScanForwardEnd.msec   =
+          d->header.ImageAcquisition.PlannedForwardScanEnd.msec;
+
      /* Put image info in the correct place. This is done for consistency with
         the .nat reader. HRIT files contain different data, so need to move
         things around. */
@@ -340,6 +544,7 @@ int seviri_read_hrit(const char *indir, const char *timeslot, int sat,
      if (seviri_get_dimension_data(dimens, &d->marf_header, bounds, line0, line1,
                                    column0, column1, lat0, lat1, lon0, lon1, rss)) {
           fprintf(stderr, "ERROR: seviri_get_dimension_data()\n");
+          seviri_hrit_ingest_free(s);
           return -1;
      }
 
@@ -355,31 +560,428 @@ int seviri_read_hrit(const char *indir, const char *timeslot, int sat,
      d->image.packet_header = NULL;
      d->image.LineSideInfo  = NULL;
 
-     out = alloc_imagearr(n_bands, band_ids,d);
+     if (alloc_imagearr(n_bands, band_ids,d)) {
+          fprintf(stderr, "ERROR: alloc_imagearr()\n");
+          seviri_hrit_ingest_free(s);
+          return -1;
+     }
 
-     /* Loop over each band and each segment. Note: VIR only, no HRV */
+     /* The number of segments to expect, for reporting progress.  Segments
+        outside of the requested lines are never needed so they are marked as
+        read up front, which also keeps the streaming of blocks of lines from
+        opening every segment of the image for each block. */
      for (i = 0; i < n_bands; i++) {
-          for (j = 0; j < 8; j++) {
-               if (rss == 1 && j < 5)
+          for (j = first_segment(band_ids[i], rss);
+               j < n_band_segments(band_ids[i]); j++) {
+               if (segment_in_image(&d->image, band_ids[i], j, rss))
+                    s->n_segments++;
+               else
+                    s->have_segment[i][j] = 1;
+          }
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Read one segment, given by its band and segment number, of an incremental
+ * ingest as soon as its file is available.  Segments of bands that were not
+ * requested, segments that RSS does not scan, segments outside of the requested
+ * lines and segments that were already read are ignored, so this may be called
+ * for every file received.
+ *
+ * s:		Ingest state from seviri_hrit_ingest_init()
+ * band_id:	Band (channel number) of the segment, 1 -> 12
+ * segment:	Segment number as in the file name, 1 -> 8 (1 -> 24 for HRV)
+ * i_line:	Output first line of the output image that was completed by
+ *              this segment, that is, for which all requested bands are now
+ *              read
+ * n_lines:	Output number of lines completed, zero if none
+ *
+ * returns:	Zero if successful, nonzero if error
+ ******************************************************************************/
+int seviri_hrit_ingest_segment(struct seviri_hrit_ingest_data *s, uint band_id,
+     uint segment, uint *i_line, uint *n_lines)
+{
+     uint i;
+
+     *n_lines = 0;
+
+     if (band_id<1 || band_id>SEVIRI_N_BANDS ||
+         segment<1 || segment>n_band_segments(band_id)) {
+          fprintf(stderr, "ERROR: Invalid HRIT band and segment: %u, %u\n",
+                  band_id, segment);
+          return -1;
+     }
+
+     if (segment-1 < first_segment(band_id, s->rss))
+          return 0;
+
+     for (i = 0; i < s->d->image.n_bands; i++) {
+          if (s->d->image.band_ids[i]==band_id)
+               break;
+     }
+
+     if (i == s->d->image.n_bands)
+          return 0;
+
+     return ingest_segment(s, i, segment-1, i_line, n_lines);
+}
+
+
+
+/*******************************************************************************
+ * Read the next segment of an incremental ingest whose file has appeared in the
+ * input directory, if any, for callers that poll the directory rather than
+ * being told of each file.  Segment files must be moved into place once
+ * complete, as the EUMETCast client does, as a partial file is an error.
+ *
+ * s:		Ingest state from seviri_hrit_ingest_init()
+ * i_line:	Described in the seviri_hrit_ingest_segment() header
+ * n_lines:	     ''
+ *
+ * returns:	One if a segment was read, zero if no new segment is available
+ *              and negative on error
+ ******************************************************************************/
+int seviri_hrit_ingest_poll(struct seviri_hrit_ingest_data *s, uint *i_line,
+     uint *n_lines)
+{
+     uint i,j;
+
+     struct seviri_io *fp;
+
+     *n_lines = 0;
+
+     for (i = 0; i < s->d->image.n_bands; i++) {
+          for (j = first_segment(s->d->image.band_ids[i], s->rss);
+               j < n_band_segments(s->d->image.band_ids[i]); j++) {
+               if (s->have_segment[i][j])
+                    continue;
+
+               if ((fp = hrit_open(s->bnames[i][j], s->tar, &s->opts)) == NULL)
                     continue;
-               if (read_data_oneseg(bnames[i][j], j, i+1, d, rss)) {
-                    fprintf(stderr, "ERROR: read_data_oneseg()\n");
+               seviri_io_close(fp);
+
+               if (ingest_segment(s, i, j, i_line, n_lines)) {
+                    fprintf(stderr, "ERROR: ingest_segment()\n");
                     return -1;
                }
+
+               return 1;
           }
      }
 
-     /* Tidy up */
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Complete an incremental ingest: read the epilogue, which replaces the planned
+ * scan times with the actual ones, and bin the HRV band for any blocks of lines
+ * that were not completed.  The ingest state is freed whether or not this
+ * succeeds.  The seviri_data struct is then as from seviri_read_hrit(), except
+ * that the lines of segments not read are fill_value.
+ *
+ * s:		Ingest state from seviri_hrit_ingest_init()
+ *
+ * returns:	Zero if successful, nonzero if error
+ ******************************************************************************/
+int seviri_hrit_ingest_finish(struct seviri_hrit_ingest_data *s)
+{
+     uint i,k;
+     long x0,x1;
+
+     struct seviri_auxillary_io_data aux;
+
+     struct seviri_image_data *image = &s->d->image;
+
+     seviri_auxillary_alloc(&aux);
+     aux.operation  = 0;
+     aux.swap_bytes = su_is_little_endian();
+     aux.perf       = &s->d->perf;
+
+     /* Read the epilogue file */
+     if (read_hrit_epilogue(s->epiname,s->d,s->tar,&s->opts,&aux)) {
+          fprintf(stderr, "ERROR: read_hrit_epilogue()\n");
+          seviri_auxillary_free(&aux);
+          seviri_hrit_ingest_free(s);
+          return -1;
+     }
+
      seviri_auxillary_free(&aux);
-     free(proname);
-     free(epiname);
+
+     /* The HRV band at VIR resolution for the blocks not yet binned. */
+     for (k = first_segment(1, s->rss); k < 8; k++) {
+          if (s->have_block[k])
+               continue;
+
+          x0 = (long) (k - first_segment(1, s->rss)) * 464 -
+               image->dimens.i_line_requested_VIR;
+          x1 = x0 + 464;
+
+          x0 = MAX(x0, 0);
+          x1 = MIN(x1, (long) image->n_lines);
+
+          if (x0 >= x1)
+               continue;
+
+          for (i = 0; i < image->n_bands; i++) {
+               if (image->band_ids[i]==12)
+                    seviri_hrv_bin(image, i, x0, x1 - x0);
+          }
+     }
+
+     seviri_hrit_ingest_free(s);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Free the memory held by an incremental ingest.  The image itself is freed
+ * with seviri_free().
+ *
+ * s:		Ingest state from seviri_hrit_ingest_init()
+ *
+ * returns:	Zero if successful, nonzero if error
+ ******************************************************************************/
+int seviri_hrit_ingest_free(struct seviri_hrit_ingest_data *s)
+{
+     uint i,j;
+
+     if (s->tar) {
+          seviri_tar_close(s->tar);
+          s->tar = NULL;
+     }
+
+     if (s->epiname) {
+          free(s->epiname);
+          s->epiname = NULL;
+     }
+
+     if (s->bnames) {
+          for (i = 0; i < s->d->image.n_bands; i++) {
+               for (j = 0; j < n_band_segments(s->d->image.band_ids[i]); j++) {
+                    free(s->bnames[i][j]);
+               }
+               free(s->bnames[i]);
+          }
+          free(s->bnames);
+          s->bnames = NULL;
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Main function for reading the HRIT data
+ * Reads the timeslot in one go with the incremental ingest functions above, so
+ * the segment files of the requested lines, the prologue and the epilogue must
+ * be present.  The segment files of other lines are not opened.
+ *
+ * indir:	Directory containing the HRIT data or a tar archive of the
+ *              timeslot, with a name ending in ".tar", which is read in place
+ * timeslot:	Timeslot to be read. Format: YYYYMMDDHHMM
+ * sat:		Satellite number - can be 1, 2, 3 or 4
+ * d:		Main SEVIRI data structure
+ * nbands:	Number of bands to be read (NOT number of bands in file)
+ * band_ids:	Array of band ids (channel numbers)
+ * bounds:	Boundaries of the data to be read
+ * line0:	First line to read
+ * line1:	Last line to read
+ * column0:	First column to read
+ * column1:	Last column to read
+ * lat0:	Initial latitude
+ * lat1:	Final latitude
+ * lon0:	Initial longitude
+ * lon1:	Final longitude
+ * rss:		Flag to set rss processing (1=yes, 0=no)
+ * iodc:	Flag to set IODC processing (1=yes, 0=no)
+ * opts:	Options of the read (see read_write.h) or NULL for the defaults
+ *
+ * returns:	Zero if successful, nonzero if error
+ ******************************************************************************/
+int seviri_read_hrit(const char *indir, const char *timeslot, int sat,
+     struct seviri_data *d, uint n_bands, const uint *band_ids,
+     enum seviri_bounds bounds, uint line0, uint line1, uint column0,
+     uint column1, double lat0, double lat1, double lon0, double lon1, int rss,
+     int iodc, const struct seviri_options *opts)
+{
+     uint i,j,k;
+     uint i_line,n_lines;
+
+     struct seviri_hrit_ingest_data s;
+
+     if (seviri_hrit_ingest_init(&s, indir, timeslot, sat, d, n_bands, band_ids,
+                                 bounds, line0, line1, column0, column1, lat0,
+                                 lat1, lon0, lon1, rss, iodc, opts)) {
+          fprintf(stderr, "ERROR: seviri_hrit_ingest_init()\n");
+          return -1;
+     }
+
+     /* Read the segments of an archive in the order they are stored so that
+        the reads are sequential. */
+     for (k = 0; s.tar && k < s.tar->n_members; k++) {
+          for (i = 0; i < n_bands; i++) {
+               for (j = first_segment(band_ids[i], rss);
+                    j < n_band_segments(band_ids[i]); j++) {
+                    if (strcmp(s.tar->members[k].name, s.bnames[i][j]) == 0 &&
+                        ingest_segment(&s, i, j, &i_line, &n_lines)) {
+                         fprintf(stderr, "ERROR: ingest_segment()\n");
+                         seviri_hrit_ingest_free(&s);
+                         return -1;
+                    }
+               }
+          }
+     }
+
+     /* Loop over each band and each segment. RSS only has the northern 3 VIR
+        or 9 HRV segments. */
      for (i = 0; i < n_bands; i++) {
-          for (j = 0; j < 8 ; j++) {
-               free(bnames[i][j]);
+          for (j = first_segment(band_ids[i], rss);
+               j < n_band_segments(band_ids[i]); j++) {
+               if (ingest_segment(&s, i, j, &i_line, &n_lines)) {
+                    fprintf(stderr, "ERROR: ingest_segment()\n");
+                    seviri_hrit_ingest_free(&s);
+                    return -1;
+               }
+          }
+     }
+
+     if (seviri_hrit_ingest_finish(&s)) {
+          fprintf(stderr, "ERROR: seviri_hrit_ingest_finish()\n");
+          return -1;
+     }
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * Collect the statistics of the raw counts of each band, including the
+ * histogram of counts, over a range of lines of an HRIT timeslot without
+ * reading the prologue or epilogue or allocating the image, the HRIT
+ * counterpart of seviri_count_stats_nat().  Only the segment files of the
+ * requested lines are opened and, for uncompressed segments, only those lines
+ * are read.  All the columns of a segment are included and the statistics of
+ * the HRV band are of its three lines per VIR line at full resolution.
+ *
+ * Each call opens its own files so that a timeslot may be split into blocks
+ * of lines that are collected in parallel by the caller and merged with
+ * seviri_stats_add().
+ *
+ * indir:	Directory containing the HRIT data or a tar archive of the
+ *              timeslot, as for seviri_read_hrit()
+ * timeslot:	Timeslot to be read. Format: YYYYMMDDHHMM
+ * sat:		Satellite number - can be 1, 2, 3 or 4
+ * n_bands:	The desired number of bands
+ * band_ids:	Array of band Ids of length n_bands
+ * line0:	First VIR line, from 0 at the first scanned line
+ * line1:	Last VIR line, clipped to the last scanned line
+ * rss:		Flag to set rss processing (1=yes, 0=no)
+ * iodc:	Flag to set IODC processing (1=yes, 0=no)
+ * stats:	Output statistics of each band in the order of band_ids, to be
+ *              freed with seviri_stats_free()
+ * opts:	Options of the read (see read_write.h) or NULL for the defaults
+ *
+ * returns:	Zero if successful, nonzero if error
+ ******************************************************************************/
+int seviri_count_stats_hrit(const char *indir, const char *timeslot, int sat,
+     uint n_bands, const uint *band_ids, uint line0, uint line1, int rss,
+     int iodc, struct seviri_stats_data *stats,
+     const struct seviri_options *opts)
+{
+     uint i,j;
+     int status;
+     long x0,first_line,last_line;
+     char ***bnames;
+     const char *namedir;
+
+     struct seviri_tar *tar;
+
+     stats->n_bands = 0;
+     stats->band    = NULL;
+
+     if (n_bands==0 || n_bands>SEVIRI_N_BANDS) {
+          fprintf(stderr, "ERROR: Invalid number of bands: %u\n", n_bands);
+          return -1;
+     }
+
+     for (i = 0; i < n_bands; i++) {
+          if (band_ids[i]<1 || band_ids[i]>SEVIRI_N_BANDS) {
+               fprintf(stderr, "ERROR: Invalid SEVIRI band Id at band list "
+                               "element %u: %d\n", i, band_ids[i]);
+               return -1;
+          }
+     }
+
+     opts = seviri_options_get(opts);
+
+     /* The members of a tar archive are named without a directory. */
+     namedir = seviri_is_tar(indir) ? "" : indir;
+
+     if (assemble_fnames(&bnames, namedir, timeslot, n_bands, band_ids, sat,
+                         rss, iodc)) {
+          fprintf(stderr, "ERROR: assemble_fnames()\n");
+          return -1;
+     }
+
+     status = 0;
+
+     tar = NULL;
+     if (namedir != indir && (tar = seviri_tar_open(indir)) == NULL) {
+          fprintf(stderr, "ERROR: seviri_tar_open()\n");
+          status = -1;
+     }
+
+     stats->n_bands = n_bands;
+     stats->band    = malloc(n_bands * sizeof(struct seviri_band_stats));
+     for (i = 0; i < n_bands; i++)
+          seviri_stats_init(&stats->band[i]);
+
+     if (line1 >= (8 - first_segment(1, rss)) * 464)
+          line1 = (8 - first_segment(1, rss)) * 464 - 1;
+
+     /* Only the segments with lines in the range are opened. */
+     for (i = 0; status == 0 && line0 <= line1 && i < n_bands; i++) {
+          first_line = band_ids[i]==12 ? 3 * (long) line0     : line0;
+          last_line  = band_ids[i]==12 ? 3 * (long) line1 + 2 : line1;
+
+          for (j = first_segment(band_ids[i], rss);
+               j < n_band_segments(band_ids[i]); j++) {
+               x0 = (long) (j - first_segment(band_ids[i], rss)) * 464;
+               if (x0 > last_line || x0 + 464 <= first_line)
+                    continue;
+
+               if (count_stats_oneseg(bnames[i][j], j, band_ids[i], first_line,
+                                      last_line, rss, tar, opts,
+                                      &stats->band[i])) {
+                    fprintf(stderr, "ERROR: count_stats_oneseg()\n");
+                    status = -1;
+                    break;
+               }
           }
+     }
+
+     if (tar)
+          seviri_tar_close(tar);
+
+     for (i = 0; i < n_bands; i++) {
+          for (j = 0; j < n_band_segments(band_ids[i]); j++)
+               free(bnames[i][j]);
           free(bnames[i]);
      }
      free(bnames);
 
-     return 0;
+     if (status != 0)
+          seviri_stats_free(stats);
+
+     return status;
 }
@@ -12,12 +12,38 @@
 
 #include "external.h"
 #include "read_write.h"
+#include "stats_util.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/*******************************************************************************
+ * State of an incremental HRIT ingest, see seviri_hrit_ingest_init().  Only
+ * n_segments_read and n_segments, for reporting progress, are meant to be read
+ * by the caller.
+ ******************************************************************************/
+struct seviri_hrit_ingest_data {
+     int rss;			/* non-zero for rapid scan (RSS) data */
+
+     struct seviri_options opts;	/* options of the ingest */
+
+     struct seviri_tar *tar;	/* archive the files are read from or NULL */
+
+     char *epiname;		/* name of the epilogue file */
+     char ***bnames;		/* names of the segment files [band][segment] */
+
+     uchar have_segment[SEVIRI_N_BANDS][24];	/* non-zero if read [band][segment] */
+     uchar have_block[8];	/* non-zero if all the bands of a VIR segment are read */
+
+     uint n_segments_read;	/* number of image segments read so far */
+     uint n_segments;		/* number of image segments expected */
+
+     struct seviri_data *d;	/* the image being filled in */
+};
+
+
 int seviri_get_dimens_hrit(const char *indir, const char *timeslot, int sat,
      uint *i_line, uint *i_column, uint *n_lines, uint *n_columns,
      enum seviri_bounds bounds, uint line0, uint line1, uint column0,
@@ -26,7 +52,23 @@ int seviri_read_hrit(const char *indir, const char *timeslot, int sat,
      struct seviri_data *d, uint n_bands, const uint *band_ids,
      enum seviri_bounds bounds, uint line0, uint line1, uint column0,
      uint column1, double lat0, double lat1, double lon0, double lon1, int rss,
-     int iodc);
+     int iodc, const struct seviri_options *opts);
+int seviri_hrit_ingest_init(struct seviri_hrit_ingest_data *s,
+     const char *indir, const char *timeslot, int sat, struct seviri_data *d,
+     uint n_bands, const uint *band_ids, enum seviri_bounds bounds, uint line0,
+     uint line1, uint column0, uint column1, double lat0, double lat1,
+     double lon0, double lon1, int rss, int iodc,
+     const struct seviri_options *opts);
+int seviri_hrit_ingest_segment(struct seviri_hrit_ingest_data *s, uint band_id,
+     uint segment, uint *i_line, uint *n_lines);
+int seviri_hrit_ingest_poll(struct seviri_hrit_ingest_data *s, uint *i_line,
+     uint *n_lines);
+int seviri_hrit_ingest_finish(struct seviri_hrit_ingest_data *s);
+int seviri_hrit_ingest_free(struct seviri_hrit_ingest_data *s);
+int seviri_count_stats_hrit(const char *indir, const char *timeslot, int sat,
+     uint n_bands, const uint *band_ids, uint line0, uint line1, int rss,
+     int iodc, struct seviri_stats_data *stats,
+     const struct seviri_options *opts);
 
 
 #ifdef __cplusplus
@@ -14,14 +14,123 @@
 #include "read_write_nat.h"
 
 
+/* Default number of line groups read at a time, see struct seviri_options. */
+#define NAT_READ_AHEAD 32
+
+/* Largest gap between the records read from consecutive line groups that is
+   read through rather than seeked over. */
+#define NAT_COALESCE_GAP 32768
+
+
+/*******************************************************************************
+ * The number of line groups of Native image data read with each read, from the
+ * read_ahead member of the options or the default.
+ ******************************************************************************/
+static uint nat_read_ahead(const struct seviri_options *opts)
+{
+     return opts->read_ahead == 0 ? NAT_READ_AHEAD : opts->read_ahead;
+}
+
+
+
+/*******************************************************************************
+ * The chunks of line groups of Native image data read by seviri_image_read(),
+ * held in a ring of depth buffers, chunk c in buffer c % depth.
+ ******************************************************************************/
+struct nat_reader {
+     struct seviri_io *fp;
+     long file_start;		/* offset of the first line group read */
+     uint n_bytes_line_group;
+     uint span0;		/* span of the records read in a line group */
+     uint span1;
+     uint n_chunk;		/* line groups per chunk */
+     uint n_lines;		/* line groups read */
+     uint depth;		/* number of buffers */
+     uchar **buf;
+     const uchar **p;		/* data of each buffer, which may be a view */
+     uint *length;		/* length of the data of each buffer */
+     uint c0;			/* chunks to be read by nat_reader_read() */
+     uint c1;
+     int status;		/* non-zero if a read failed */
+     struct seviri_perf_data *perf;
+};
+
+
+
+/*******************************************************************************
+ * The range of a chunk of line groups in the file.
+ ******************************************************************************/
+static void nat_reader_range(const struct nat_reader *r, uint c, long *offset,
+                             uint *length)
+{
+     *offset = r->file_start + (long) c * r->n_chunk * r->n_bytes_line_group +
+               r->span0;
+     *length = (MIN(r->n_chunk, r->n_lines - c * r->n_chunk) - 1) *
+               r->n_bytes_line_group + r->span1 - r->span0;
+}
+
+
+
+/*******************************************************************************
+ * Read the chunks c0 to c1 - 1 into their buffers, on the calling thread or as
+ * the function of the reader thread.
+ ******************************************************************************/
+static void nat_reader_read(void *arg)
+{
+     struct nat_reader *r = (struct nat_reader *) arg;
+
+     uint c;
+     uint k;
+
+     long offset;
+
+     SU_PERF_TIMER(t);
+
+     for (c = r->c0; c < r->c1 && r->status == 0; ++c) {
+          k = c % r->depth;
+
+          nat_reader_range(r, c, &offset, &r->length[k]);
+
+          SU_PERF_START(r->perf, t);
+          seviri_io_seek(r->fp, offset, SEEK_SET);
+          SU_PERF_STOP(r->perf, t, SEVIRI_PERF_SEEK, 0, 0);
+
+          SU_PERF_START(r->perf, t);
+          if ((r->p[k] = seviri_io_view(r->fp, r->buf[k], r->length[k])) == NULL) {
+               fprintf(stderr, "ERROR: seviri_io_view()\n");
+               r->status = -1;
+          }
+          SU_PERF_STOP(r->perf, t, SEVIRI_PERF_READ, 0, r->length[k]);
+     }
+}
+
+
+
 /*******************************************************************************
  * Read a VIS/IR line record structure - the actual image data.
  *
+ * Only the span of each line group from the first to the last requested record
+ * is read.  When the gap between the spans of consecutive line groups is small
+ * the line groups are read in chunks of the read ahead of the options, each
+ * with a single read, otherwise the span of each line group is read on its own.
+ * Before the current chunk is unpacked the range of the next one is passed to
+ * seviri_io_prefetch(), a hint that lets the operating system start reading it.
+ * If the options give a read_depth of more than one and the functions to start
+ * and join a thread the chunks are instead read by a reader thread into a ring
+ * of read_depth buffers, up to read_depth - 1 chunks ahead of the one being
+ * unpacked, so that the reads and the unpacking overlap.  Only one read runs
+ * at a time, so fp is only used by one thread at a time.
+ * Within a chunk the VIR records of each line group are unpacked one band at a
+ * time.  Each of the three HRV lines that follow them is unpacked into its
+ * place in the HRV image, at the column of the lower or upper HRV window it was
+ * acquired in.
+ *
  * fp		: Pointer to the image data file set to the beginning of the
  *              : line record structure.
  * image	: The output seviri_image_data struct with the image data
  * marf_header	: The seviri_marf_header_data struct for the current image data
  *                file.
+ * coverage	: The planned HRV coverage from the level 1.5 header
  * n_bands	: Described in the seviri_read_nat() header
  * band_ids	: 	''
  * bounds	: 	''
@@ -35,36 +144,41 @@
  * lon1		: 	''
  * aux		: Seviri_auxillary_io_data struct containing information related
  *                to the read operation
+ * opts		: Options of the read, not NULL
  *
  * returns	: Non-zero on error
  ******************************************************************************/
-static int seviri_image_read(FILE *fp, struct seviri_image_data *image,
+static int seviri_image_read(struct seviri_io *fp,
+                             struct seviri_image_data *image,
                              const struct seviri_marf_header_data *marf_header,
+                             const struct
+                             seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+                             *coverage,
                              uint n_bands, const uint *band_ids,
                              enum seviri_bounds bounds,
                              uint line0, uint line1, uint column0, uint column1,
                              double lat0, double lat1, double lon0, double lon1,
-                             struct seviri_auxillary_io_data *aux)
+                             struct seviri_auxillary_io_data *aux,
+                             const struct seviri_options *opts)
 {
-     uchar *data10 = '\0';
-
-     const uchar shifts[] = {6, 4, 2, 0};
+     const uchar *p10;
 
-     ushort temp=0;
-
-     const ushort masks[] = {0xFFC0, 0x3FF0, 0x0FFC, 0x03FF};
+     int status = 0;
+     int threaded;
+     int running = 0;
 
+     uint c;
      uint i;
      uint ii;
      uint iii;
-     uint j;
-     uint jj;
-     uint jjj;
+     uint j0;
+     uint j1;
      uint k;
 
      uint length;
 
      uint i_band;
+     int  i_band_hrv;
 
      uint i_image;
 
@@ -76,29 +190,40 @@ static int seviri_image_read(FILE *fp, struct seviri_image_data *image,
 
      uint n_bytes_line_group;
 
+     uint n_chunk;
+     uint n_chunks;
+
+     uint span0;
+     uint span1;
+
      uint j_offset;
      uint i_column0;
      uint i_column1;
 
-     uint i_alignment0;
-     uint i_alignment1;
-     uint n_loop0;
-     uint n_loop1;
-
      long file_start;
-     long file_offset;
+     long file_offset = 0;
      long file_offset2;
 
+     void *thread = NULL;
+
+     struct nat_reader r;
+
+     struct seviri_io *io = NULL;
+
      struct seviri_dimension_data *dimens;
 
      int i_bands_infile[12];
 
+     SU_PERF_TIMER(t);
+
 
      /*-------------------------------------------------------------------------
       * Check if the requested band IDs are valid.
       *-----------------------------------------------------------------------*/
      image->n_bands = n_bands;
 
+     i_band_hrv = -1;
+
      for (i = 0; i < n_bands; ++i) {
           if (band_ids[i] < 1 || band_ids[i] > SEVIRI_N_BANDS) {
                fprintf(stderr, "ERROR: Invalid SEVIRI band Id at band list "
@@ -106,15 +231,9 @@ static int seviri_image_read(FILE *fp, struct seviri_image_data *image,
                return -1;
           }
           image->band_ids[i] = band_ids[i];
-     }
 
-     /* Check that the caller is not expecting HRV data. */
-     for (i = 0; i < n_bands; ++i) {
-          if (band_ids[i] == 12) {
-               fprintf(stderr, "ERROR: Reading of the HRV channel is not yet "
-                               "fully supported\n");
-               return -1;
-          }
+          if (band_ids[i] == 12)
+               i_band_hrv = i;
      }
 
 
@@ -206,136 +325,235 @@ static int seviri_image_read(FILE *fp, struct seviri_image_data *image,
 
      image->data_vir = malloc(image->n_bands * sizeof(ushort *));
      for (i = 0; i < image->n_bands; ++i) {
-          image->data_vir[i] = malloc(length * sizeof(float));
+          image->data_vir[i] = malloc(length * sizeof(ushort));
           su_init_array_us(image->data_vir[i], length, image->fill_value);
      }
 
+     image->n_lines_hrv   = 0;
+     image->n_columns_hrv = 0;
+     image->data_hrv      = NULL;
+
+     if (i_band_hrv >= 0 && seviri_hrv_alloc(image)) {
+          fprintf(stderr, "ERROR: seviri_hrv_alloc()\n");
+          return -1;
+     }
+
+     if (i_band_hrv >= 0 && n_bands_HRV == 0)
+          i_band_hrv = -1;
+
 
      /*-------------------------------------------------------------------------
       * Read the image data.
       *-----------------------------------------------------------------------*/
-     data10 = malloc(dimens->n_columns_selected_VIR / 4 * 5 * sizeof(uchar));
+     /* The span of the requested records within a line group. */
+     span0 = n_bytes_line_group;
+     span1 = 0;
+
+     for (i_band = 0; i_band < image->n_bands; ++i_band) {
+          if (i_bands_infile[i_band] < 0 || image->band_ids[i_band] == 12)
+               continue;
 
-     file_start  = ftell(fp);
+          k = i_bands_infile[i_band] * n_bytes_VIR_line +
+              dimens->i_column_to_read_VIR / 4 * 5;
 
-     file_offset = file_start + dimens->i_line_to_read_VIR * n_bytes_line_group;
+          span0 = MIN(span0, k);
+          span1 = MAX(span1, k + PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE +
+                             dimens->n_columns_to_read_VIR / 4 * 5);
+     }
 
+     if (i_band_hrv >= 0) {
+          span0 = MIN(span0, n_bands_VIR * n_bytes_VIR_line);
+          span1 = n_bands_VIR * n_bytes_VIR_line + 3 * n_bytes_HRV_line;
+     }
 
-     /* Considerable effort is gone into dealing with starting columns and
-        ending columns that are not aligned on 4 pixel/5 byte boundaries. Below
-        are quantities used for this effort. */
+     span0 = MIN(span0, span1);
 
-     /* Quantities for approach 1 which simply checks every pixel to see if they
-        are in the requested image area.  Simple but has an if statement within
-        the inner loop. */
+     /* Chunks of whole line groups when the gaps are small enough to read
+        through or else the span of each line group on its own. */
+     if (n_bytes_line_group - (span1 - span0) <= NAT_COALESCE_GAP)
+          n_chunk = MAX(MIN(nat_read_ahead(opts), dimens->n_lines_to_read_VIR), 1);
+     else
+          n_chunk = 1;
+
+     n_chunks = (dimens->n_lines_to_read_VIR + n_chunk - 1) / n_chunk;
+
+     /* A reader thread if the options supply one and more than one chunk is
+        to be held. */
+     threaded = opts->thread_start && opts->thread_join &&
+                opts->read_depth > 1 && n_chunks > 1;
+
+     file_start           = seviri_io_tell(fp);
+
+     r.fp                 = fp;
+     r.file_start         = file_start +
+                            (long) dimens->i_line_to_read_VIR * n_bytes_line_group;
+     r.n_bytes_line_group = n_bytes_line_group;
+     r.span0              = span0;
+     r.span1              = span1;
+     r.n_chunk            = n_chunk;
+     r.n_lines            = dimens->n_lines_to_read_VIR;
+     r.depth              = threaded ? MIN(opts->read_depth, n_chunks) : 1;
+     r.c0                 = 0;
+     r.c1                 = 0;
+     r.status             = 0;
+     r.perf               = aux->perf;
+
+     r.buf    = malloc(r.depth * sizeof(uchar *));
+     r.p      = malloc(r.depth * sizeof(uchar *));
+     r.length = malloc(r.depth * sizeof(uint));
+     for (k = 0; k < r.depth; ++k)
+          r.buf[k] = malloc(((n_chunk - 1) * n_bytes_line_group + span1 - span0) *
+                            sizeof(uchar));
+
+     /* The range of the VIR pixels read, which are aligned on 4 pixel/5 byte
+        boundaries, that are within the requested image area. */
      j_offset  = dimens->i0_column_selected_VIR + dimens->i_column_to_read_VIR;
      i_column0 = dimens->i_column_requested_VIR;
      i_column1 = dimens->i_column_requested_VIR + dimens->n_columns_requested_VIR - 1;
 
-     /* Quantities for approach 2 which only loops over the pixels required.
-        more complicated but more efficient. */
-     if (dimens->i_column_requested_VIR > dimens->i0_column_selected_VIR)
-          i_alignment0 = (dimens->i_column_requested_VIR -
-                                 dimens->i0_column_selected_VIR) % 4;
-     else
-          i_alignment0 = 0;
+     j0 = i_column0 > j_offset ? i_column0 - j_offset : 0;
+     j1 = MIN(i_column1 - j_offset, dimens->n_columns_to_read_VIR - 1);
 
-     if (dimens->i_column_requested_VIR + dimens->n_columns_requested_VIR - 1 <
-         dimens->i1_column_selected_VIR)
-          i_alignment1 = (dimens->i_column_requested_VIR +
-                                 dimens->n_columns_requested_VIR - 1 -
-                                 dimens->i0_column_selected_VIR) % 4;
-     else
-          i_alignment1 = (dimens->n_columns_selected_VIR - 1) % 4;
+     for (c = 0; c < n_chunks && status == 0; ++c) {
+          /* Wait for the chunk to be read, or read it if it was not read
+             ahead. */
+          if (running) {
+               opts->thread_join(thread, opts->thread_data);
+               running = 0;
+          }
 
-     n_loop0 = dimens->n_columns_to_read_VIR -
-                    k - (i_alignment1 == 3 ? 0 : 4);
+          if (c == r.c1) {
+               r.c0 = c;
+               r.c1 = c + 1;
+               nat_reader_read(&r);
+          }
 
-     n_loop1 = i_alignment1 < 3 ? i_alignment1 + 1 : 0;
+          if (r.status) {
+               status = -1;
+               break;
+          }
 
+          /* Read the chunks after it into the free buffers on the reader
+             thread, or let the next one be read in the background by the
+             operating system, while this one is unpacked. */
+          if (threaded) {
+               r.c0 = r.c1;
+               r.c1 = MIN(c + r.depth, n_chunks);
+               if (r.c0 < r.c1) {
+                    if (opts->thread_start(&thread, nat_reader_read, &r,
+                                           opts->thread_data) == 0)
+                         running = 1;
+                    else
+                         r.c1 = r.c0;
+               }
+          }
+          else if (c + 1 < n_chunks) {
+               nat_reader_range(&r, c + 1, &file_offset, &length);
+               seviri_io_prefetch(fp, file_offset, length);
+          }
 
-     for (i = 0; i < dimens->n_lines_to_read_VIR; ++i) {
-          ii = dimens->i_line_in_output_VIR + i;
+          k  = c % r.depth;
+          io = seviri_io_open_mem(r.p[k], r.length[k]);
 
-          for (i_band = 0; i_band < image->n_bands; ++i_band) {
-               if (i_bands_infile[i_band] < 0)
-                    continue;
+          /* Offsets in the chunk are relative to the first span. */
+          file_offset = -(long) span0;
 
-               file_offset2 = file_offset + i_bands_infile[i_band] *
-                    n_bytes_VIR_line + dimens->i_column_to_read_VIR / 4 * 5;
+          for (i = c * n_chunk; i < MIN((c + 1) * n_chunk, dimens->n_lines_to_read_VIR) &&
+               status == 0; ++i) {
+               ii = dimens->i_line_in_output_VIR + i;
 
-               fseek(fp, file_offset2, SEEK_SET);
+               for (i_band = 0; i_band < image->n_bands; ++i_band) {
+                    if (i_bands_infile[i_band] < 0 || image->band_ids[i_band] == 12)
+                         continue;
 
-               if (seviri_packet_header_read(fp, &image->packet_header[i_band][i], aux)) {
-                    fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
-                    return -1;
-               }
+                    file_offset2 = file_offset + i_bands_infile[i_band] *
+                         n_bytes_VIR_line + dimens->i_column_to_read_VIR / 4 * 5;
 
-               if (seviri_LineSideInfo_read(fp, &image->LineSideInfo  [i_band][i], aux)) {
-                    fprintf(stderr, "ERROR: seviri_LineSideInfo_read()\n");
-                    return -1;
-               }
+                    seviri_io_seek(io, file_offset2, SEEK_SET);
 
-               if (fread(data10, sizeof(char), dimens->n_columns_to_read_VIR / 4 * 5, fp) <
-                         dimens->n_columns_to_read_VIR / 4 * 5) E_L_R();
+                    if (seviri_packet_header_read(io, &image->packet_header[i_band][i], aux)) {
+                         fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+                         status = -1;
+                         break;
+                    }
 
-               i_image = ii * dimens->n_columns_requested_VIR + dimens->i_column_in_output_VIR;
-if (1) {
-               for (j = 0, jj = 0, jjj = 0; j < dimens->n_columns_to_read_VIR; ) {
-                    for (k = 0; k < 4; ++k) {
-                         if (j_offset + j >= i_column0 && j_offset + j <= i_column1) {
-                              temp = *((ushort *) (data10 + jj));
-
-                              SWAP_2(temp, temp);
-
-                              image->data_vir[i_band][i_image + jjj] = (temp & masks[k]) >> shifts[k];
-                              jjj++;
-                         }
-                         j++, jj++;
+                    if (seviri_LineSideInfo_read(io, &image->LineSideInfo  [i_band][i], aux)) {
+                         fprintf(stderr, "ERROR: seviri_LineSideInfo_read()\n");
+                         status = -1;
+                         break;
                     }
 
-                    jj++;
-               }
-}
-else {
-               jj = k = i_alignment0;
+                    if ((p10 = seviri_io_view(io, NULL,
+                              dimens->n_columns_to_read_VIR / 4 * 5)) == NULL) {
+                         fprintf(stderr, "ERROR: seviri_io_view()\n");
+                         status = -1;
+                         break;
+                    }
+
+                    SU_PERF_START(aux->perf, t);
+                    i_image = ii * dimens->n_columns_requested_VIR + dimens->i_column_in_output_VIR;
 
-               for (j = 0, jjj = 0; j < n_loop0; ) {
-                    for ( ; k < 4; ++k) {
-                         temp = *((ushort *) (data10 + jj));
+                    su_unpack_10bit(p10, j0, j1 - j0 + 1, image->data_vir[i_band] + i_image);
+                    SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_UNPACK, j1 - j0 + 1, 0);
+               }
 
-                         SWAP_2(temp, temp);
+               if (status == 0 && i_band_hrv >= 0) {
+                    file_offset2 = file_offset + n_bands_VIR * n_bytes_VIR_line;
 
-                         image->data_vir[i_band][i_image + jjj] = (temp & masks[k]) >> shifts[k];
+                    seviri_io_seek(io, file_offset2, SEEK_SET);
 
-                         j++, jj++; jjj++;
+                    if (seviri_packet_header_read(io, &image->packet_header[i_band_hrv][i], aux)) {
+                         fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+                         status = -1;
+                         break;
                     }
 
-                    jj++; k = 0;
-               }
-
-               for (k = 0; k < n_loop1; ++k) {
-                    temp = *((ushort *) (data10 + jj));
+                    if (seviri_LineSideInfo_read(io, &image->LineSideInfo  [i_band_hrv][i], aux)) {
+                         fprintf(stderr, "ERROR: seviri_LineSideInfo_read()\n");
+                         status = -1;
+                         break;
+                    }
 
-                    SWAP_2(temp, temp);
+                    /* The rest of the three HRV records in place. */
+                    k = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE;
 
-                    image->data_vir[i_band][i_image + jjj] = (temp & masks[k]) >> shifts[k];
+                    if ((p10 = seviri_io_view(io, NULL, 3 * n_bytes_HRV_line - k)) == NULL) {
+                         fprintf(stderr, "ERROR: seviri_io_view()\n");
+                         status = -1;
+                         break;
+                    }
 
-                    jj++; jjj++;
+                    SU_PERF_START(aux->perf, t);
+                    seviri_hrv_unpack(image, coverage, i_band_hrv, ii, p10 - k);
+                    SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_UNPACK,
+                                 3 * image->n_columns_hrv, 0);
                }
-}
+
+               file_offset += n_bytes_line_group;
           }
 
-          file_offset += n_bytes_line_group;
+          seviri_io_close(io);
      }
 
+     /* The reader thread may still be reading ahead after an error. */
+     if (running)
+          opts->thread_join(thread, opts->thread_data);
 
-     file_offset = file_start + dimens->n_lines_selected_VIR * n_bytes_line_group;
+     for (k = 0; k < r.depth; ++k)
+          free(r.buf[k]);
+     free(r.buf);
+     free(r.p);
+     free(r.length);
 
-     fseek(fp, file_offset, SEEK_SET);
+     if (status)
+          return -1;
 
 
-     free(data10);
+     file_offset = file_start + dimens->n_lines_selected_VIR * n_bytes_line_group;
+
+     SU_PERF_START(aux->perf, t);
+     seviri_io_seek(fp, file_offset, SEEK_SET);
+     SU_PERF_STOP(aux->perf, t, SEVIRI_PERF_SEEK, 0, 0);
 
 
      return 0;
@@ -349,31 +567,35 @@ else {
  * fp		: File pointer to where the line record structure is to be
  *                written.
  * image	: The input seviri_image_data struct
+ * coverage	: The planned HRV coverage from the level 1.5 header
  * aux		: Seviri_auxillary_io_data struct containing information related
  *                to the read operation
  *
  * returns	: Non-zero on error
  *
  ******************************************************************************/
-static int seviri_image_write(FILE *fp, const struct seviri_image_data *image,
+static int seviri_image_write(struct seviri_io *fp,
+                              const struct seviri_image_data *image,
+                              const struct
+                              seviri_15HEADER_ImageDescription_PlannedCoverageHRV_data
+                              *coverage,
                               struct seviri_auxillary_io_data *aux)
 {
      uchar *data10;
 
-     const uchar shifts[] = {6, 4, 2, 0};
-
-     ushort temp;
+     ushort *line_hrv = NULL;
 
      uint i;
      uint ii;
-     uint j;
-     uint jj;
      uint k;
 
      uint i_band;
+     int  i_band_hrv;
 
      uint i_image;
 
+     uint n_columns_HRV_line;
+
      const struct seviri_dimension_data *dimens;
 
 
@@ -382,16 +604,30 @@ static int seviri_image_write(FILE *fp, const struct seviri_image_data *image,
       *-----------------------------------------------------------------------*/
      dimens = (struct seviri_dimension_data *) &image->dimens;
 
+     i_band_hrv = -1;
+     for (i_band = 0; i_band < image->n_bands; ++i_band) {
+          if (image->band_ids[i_band] == 12 && image->data_hrv)
+               i_band_hrv = i_band;
+     }
+
+     n_columns_HRV_line = dimens->n_columns_selected_HRV / 2;
+
 
      /*-------------------------------------------------------------------------
       * Write the image data.
       *-----------------------------------------------------------------------*/
-     data10 = malloc(dimens->n_columns_selected_VIR / 4 * 5 * sizeof(uchar));
+     data10 = malloc(MAX(dimens->n_columns_selected_VIR,
+                         n_columns_HRV_line) / 4 * 5 * sizeof(uchar));
+
+     if (i_band_hrv >= 0)
+          line_hrv = malloc(n_columns_HRV_line * sizeof(ushort));
 
      for (i = 0; i < dimens->n_lines_to_read_VIR; ++i) {
           ii = dimens->i_line_in_output_VIR + i;
 
           for (i_band = 0; i_band < image->n_bands; ++i_band) {
+               if (image->band_ids[i_band] == 12)
+                    continue;
 
                if (seviri_packet_header_read(fp, &image->packet_header[i_band][i], aux)) {
                     fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
@@ -403,32 +639,44 @@ static int seviri_image_write(FILE *fp, const struct seviri_image_data *image,
                     return -1;
                }
 
-               su_init_array_uc(data10, dimens->n_columns_to_read_VIR / 4 * 5, 0);
-
                i_image = ii * dimens->n_columns_requested_VIR + dimens->i_column_in_output_VIR;
 
-               for (j = 0, jj = 0; j < dimens->n_columns_to_read_VIR; ) {
-                    for (k = 0; k < 4; ++k) {
-                         temp = image->data_vir[i_band][i_image + j] << shifts[k];
+               su_pack_10bit(image->data_vir[i_band] + i_image,
+                             dimens->n_columns_to_read_VIR, data10);
 
-                         SWAP_2(temp, temp);
+               if (seviri_io_write(data10, sizeof(char),
+                                   dimens->n_columns_to_read_VIR / 4 * 5, fp) <
+                          dimens->n_columns_to_read_VIR / 4 * 5) E_L_R();
+          }
 
-                         *((ushort *) (data10 + jj)) = *((ushort *) (data10 + jj)) | temp;
+          if (i_band_hrv < 0)
+               continue;
 
-                         j++, jj++;
-                    }
+          for (k = 0; k < 3; ++k) {
+               if (seviri_packet_header_read(fp, &image->packet_header[i_band_hrv][i], aux)) {
+                    fprintf(stderr, "ERROR: seviri_packet_header_read()\n");
+                    return -1;
+               }
 
-                    jj++;
+               if (seviri_LineSideInfo_read(fp, &image->LineSideInfo  [i_band_hrv][i], aux)) {
+                    fprintf(stderr, "ERROR: seviri_LineSideInfo_read()\n");
+                    return -1;
                }
 
-               if (fwrite(data10, sizeof(char), dimens->n_columns_to_read_VIR / 4 * 5, fp) <
-                          dimens->n_columns_to_read_VIR / 4 * 5) E_L_R();
+               seviri_hrv_pack(image, coverage, ii, k, line_hrv, data10);
+
+               if (seviri_io_write(data10, sizeof(char),
+                                   n_columns_HRV_line / 4 * 5, fp) <
+                          n_columns_HRV_line / 4 * 5) E_L_R();
           }
      }
 
 
      free(data10);
 
+     if (line_hrv)
+          free(line_hrv);
+
 
      return 0;
 }
@@ -458,11 +706,10 @@ static int seviri_image_free(struct seviri_image_data *d)
      for (i = 0; i < d->n_bands; ++i)
           free(d->data_vir[i]);
      free(d->data_vir);
-/*
-     for (i = 0; i < d->n_bands; ++i)
-          free(d->data_hrv[i]);
-     free(d->data_hrv);
-*/
+
+     if (d->data_hrv)
+          free(d->data_hrv);
+
      return 0;
 }
 
@@ -490,15 +737,18 @@ static int seviri_image_free(struct seviri_image_data *d)
  * lon1		: 	''
  * aux		: Seviri_auxillary_io_data struct containing information related
  *                to the read operation
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
  *
  * returns	: Non-zero on error
  ******************************************************************************/
 int seviri_get_dimens_nat(const char *filename, uint *i_line, uint *i_column,
                           uint *n_lines, uint *n_columns, enum seviri_bounds bounds,
                           uint line0, uint line1, uint column0, uint column1,
-                          double lat0, double lat1, double lon0, double lon1)
+                          double lat0, double lat1, double lon0, double lon1,
+                          const struct seviri_options *opts)
 {
-     FILE *fp;
+     struct seviri_io *fp;
 
      struct seviri_auxillary_io_data aux;
 
@@ -511,7 +761,9 @@ int seviri_get_dimens_nat(const char *filename, uint *i_line, uint *i_column,
 
      seviri_auxillary_alloc(&aux);
 
-     if ((fp = fopen(filename, "r")) == NULL) {
+     opts = seviri_options_get(opts);
+
+     if ((fp = seviri_io_open(filename, "r", opts->open, opts->open_data)) == NULL) {
           fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
                   filename, strerror(errno));
           return -1;
@@ -520,18 +772,18 @@ int seviri_get_dimens_nat(const char *filename, uint *i_line, uint *i_column,
      if (seviri_marf_header_read(fp, &marf_header, &aux)) {
           fprintf(stderr, "ERROR: seviri_marf_header_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
      if (seviri_get_dimension_data(&dimens, &marf_header, bounds, line0, line1,
                                    column0, column1, lat0, lat1, lon0, lon1, 0)) {
           fprintf(stderr, "ERROR: seviri_get_dimension_data()\n");
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
-     fclose(fp);
+     seviri_io_close(fp);
 
      seviri_auxillary_free(&aux);
 
@@ -545,6 +797,271 @@ int seviri_get_dimens_nat(const char *filename, uint *i_line, uint *i_column,
 
 
 
+/*******************************************************************************
+ * Collect the statistics of the raw counts of each band, including the
+ * histogram of counts, over a range of line groups without reading the headers
+ * or allocating the image, for radiometric monitoring at close to the speed of
+ * the disk.  The line records of the requested bands are read in chunks of the
+ * read ahead of the options, as in seviri_image_read(), and each record is
+ * unpacked into a single line buffer and added with seviri_stats_add_counts().
+ * All the columns of the file are included and the statistics of the HRV band
+ * are of its three line records per line group at full resolution.  Bands not
+ * in the file have empty statistics.  seviri_count_stats_hrit() is the HRIT
+ * counterpart.
+ *
+ * Each call opens its own stream so that an image may be split into blocks of
+ * lines, with the number of line groups from seviri_get_dimens_nat() with
+ * SEVIRI_BOUNDS_ACTUAL_IMAGE, that are collected in parallel by the caller and
+ * merged with seviri_stats_add().
+ *
+ * filename	: Native SEVIRI level 1.5 filename
+ * n_bands	: The desired number of bands
+ * band_ids	: Array of band Ids of length n_bands
+ * line0	: First line group, from 0 at the start of the image in the file
+ * line1	: Last line group, clipped to the last in the file
+ * stats	: Output statistics of each band in the order of band_ids, to be
+ *                freed with seviri_stats_free()
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_count_stats_nat(const char *filename, uint n_bands,
+                           const uint *band_ids, uint line0, uint line1,
+                           struct seviri_stats_data *stats,
+                           const struct seviri_options *opts)
+{
+     uchar *chunk;
+     const uchar *p10;
+
+     ushort *counts;
+
+     uint i;
+     uint ii;
+     uint k;
+
+     uint n_bands_VIR;
+     uint n_bands_HRV;
+
+     uint n_bytes_VIR_line;
+     uint n_bytes_HRV_line;
+     uint n_bytes_line_group;
+
+     uint n_columns_HRV_line;
+
+     uint n_lines;
+     uint n_chunk;
+
+     uint span0;
+     uint span1;
+
+     long file_start;
+     long file_offset;
+
+     size_t length;
+
+     int i_bands_infile[SEVIRI_N_BANDS];
+
+     struct seviri_io *fp;
+
+     struct seviri_auxillary_io_data aux;
+
+     struct seviri_dimension_data dimens;
+
+     struct seviri_marf_header_data marf_header;
+
+     stats->n_bands = 0;
+     stats->band    = NULL;
+
+     for (i = 0; i < n_bands; ++i) {
+          if (band_ids[i] < 1 || band_ids[i] > SEVIRI_N_BANDS) {
+               fprintf(stderr, "ERROR: Invalid SEVIRI band Id at band list "
+                               "element %d: %d\n", i, band_ids[i]);
+               return -1;
+          }
+     }
+
+     aux.operation  = 0;
+     aux.swap_bytes = su_is_little_endian();
+     aux.perf       = NULL;
+
+     seviri_auxillary_alloc(&aux);
+
+     opts = seviri_options_get(opts);
+
+     if ((fp = seviri_io_open(filename, "r", opts->open, opts->open_data)) == NULL) {
+          fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
+                  filename, strerror(errno));
+          seviri_auxillary_free(&aux);
+          return -1;
+     }
+
+     if (seviri_marf_header_read(fp, &marf_header, &aux)) {
+          fprintf(stderr, "ERROR: seviri_marf_header_read(), filename = %s\n",
+                  filename);
+          seviri_auxillary_free(&aux);
+          seviri_io_close(fp);
+          return -1;
+     }
+
+     seviri_auxillary_free(&aux);
+
+     if (seviri_get_dimension_data(&dimens, &marf_header,
+                                   SEVIRI_BOUNDS_ACTUAL_IMAGE, 0, 0, 0, 0,
+                                   0., 0., 0., 0., 0)) {
+          fprintf(stderr, "ERROR: seviri_get_dimension_data()\n");
+          seviri_io_close(fp);
+          return -1;
+     }
+
+
+     /*-------------------------------------------------------------------------
+      * The bands in the file and the layout of a line group, as in
+      * seviri_image_read().
+      *-----------------------------------------------------------------------*/
+     n_bands_VIR = 0;
+     for (i = 0; i < 11; ++i) {
+          if (marf_header.secondary.SelectedBandIDs.Value[i] == 'X')
+               n_bands_VIR++;
+     }
+
+     n_bands_HRV = marf_header.secondary.SelectedBandIDs.Value[11] == 'X';
+
+     for (i = 0; i < n_bands; ++i) {
+          i_bands_infile[i] = -1;
+          if (marf_header.secondary.SelectedBandIDs.Value[band_ids[i] - 1] == 'X') {
+               for (ii = 0; ii < band_ids[i]; ++ii) {
+                    if (marf_header.secondary.SelectedBandIDs.Value[ii] == 'X')
+                         i_bands_infile[i]++;
+               }
+          }
+     }
+
+     n_bytes_VIR_line   = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE +
+                          dimens.n_columns_selected_VIR / 4 * 5;
+     n_bytes_HRV_line   = PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE +
+                          dimens.n_columns_selected_HRV / 4 * 5 / 2;
+     n_bytes_line_group = n_bands_VIR * n_bytes_VIR_line +
+                          n_bands_HRV * 3 * n_bytes_HRV_line;
+
+     n_columns_HRV_line = dimens.n_columns_selected_HRV / 2;
+
+     span0 = n_bytes_line_group;
+     span1 = 0;
+     for (i = 0; i < n_bands; ++i) {
+          if (i_bands_infile[i] < 0)
+               continue;
+
+          if (band_ids[i] == 12)
+               k = n_bands_VIR * n_bytes_VIR_line;
+          else
+               k = i_bands_infile[i] * n_bytes_VIR_line;
+
+          span0 = MIN(span0, k);
+          span1 = MAX(span1, k + (band_ids[i] == 12 ? 3 * n_bytes_HRV_line :
+                                                       n_bytes_VIR_line));
+     }
+     span0 = MIN(span0, span1);
+
+
+     /*-------------------------------------------------------------------------
+      * Read and add the line records of the line groups.
+      *-----------------------------------------------------------------------*/
+     stats->n_bands = n_bands;
+     stats->band    = malloc(n_bands * sizeof(struct seviri_band_stats));
+     for (i = 0; i < n_bands; ++i)
+          seviri_stats_init(&stats->band[i]);
+
+     if (line1 >= dimens.n_lines_selected_VIR)
+          line1 = dimens.n_lines_selected_VIR - 1;
+
+     if (line0 > line1 || span0 == span1) {
+          seviri_io_close(fp);
+          return 0;
+     }
+
+     n_lines = line1 - line0 + 1;
+
+     if (n_bytes_line_group - (span1 - span0) <= NAT_COALESCE_GAP)
+          n_chunk = MIN(nat_read_ahead(opts), n_lines);
+     else
+          n_chunk = 1;
+
+     chunk  = malloc(((n_chunk - 1) * n_bytes_line_group + span1 - span0) *
+                     sizeof(uchar));
+     counts = malloc(MAX(dimens.n_columns_selected_VIR, n_columns_HRV_line) *
+                     sizeof(ushort));
+
+     /* The line records follow the U-MARF header, which has just been read,
+        and the packet header and level 1.5 header before them. */
+     file_start = seviri_io_tell(fp) + PACKET_HEADER_SIZE + _15HEADER_SIZE;
+
+     p10 = NULL;
+
+     for (i = 0; i < n_lines; ++i) {
+          if (i % n_chunk == 0) {
+               file_offset = file_start + (long) (line0 + i) * n_bytes_line_group +
+                             span0;
+
+               length = (MIN(n_chunk, n_lines - i) - 1) * n_bytes_line_group +
+                        span1 - span0;
+
+               seviri_io_seek(fp, file_offset, SEEK_SET);
+
+               if ((p10 = seviri_io_view(fp, chunk, length)) == NULL) {
+                    fprintf(stderr, "ERROR: seviri_io_view(), filename = %s\n",
+                            filename);
+                    free(chunk);
+                    free(counts);
+                    seviri_io_close(fp);
+                    return -1;
+               }
+
+               if (i + n_chunk < n_lines)
+                    seviri_io_prefetch(fp, file_offset + n_chunk *
+                         n_bytes_line_group, (MIN(n_chunk, n_lines - i -
+                         n_chunk) - 1) * n_bytes_line_group + span1 - span0);
+
+               /* Offsets in the chunk are relative to the first span. */
+               p10 -= span0;
+          }
+
+          for (ii = 0; ii < n_bands; ++ii) {
+               if (i_bands_infile[ii] < 0)
+                    continue;
+
+               if (band_ids[ii] == 12) {
+                    for (k = 0; k < 3; ++k) {
+                         su_unpack_10bit(p10 + n_bands_VIR * n_bytes_VIR_line +
+                                         k * n_bytes_HRV_line +
+                                         PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE,
+                                         0, n_columns_HRV_line, counts);
+                         seviri_stats_add_counts(&stats->band[ii], counts,
+                                                 n_columns_HRV_line);
+                    }
+               }
+               else {
+                    su_unpack_10bit(p10 + i_bands_infile[ii] * n_bytes_VIR_line +
+                                    PACKET_HEADER_SIZE + LINE_SIDE_INFO_SIZE,
+                                    0, dimens.n_columns_selected_VIR, counts);
+                    seviri_stats_add_counts(&stats->band[ii], counts,
+                                            dimens.n_columns_selected_VIR);
+               }
+          }
+
+          p10 += n_bytes_line_group;
+     }
+
+     free(chunk);
+     free(counts);
+
+     seviri_io_close(fp);
+
+     return 0;
+}
+
+
+
 /*******************************************************************************
  * The main read function.
  *
@@ -580,33 +1097,46 @@ int seviri_get_dimens_nat(const char *filename, uint *i_line, uint *i_column,
  * lon0		: Starting longitude of the desired sub-image
  * lon1		: Ending longitude of the desired sub-image
  *
+ * opts		: Options of the read (see read_write.h) or NULL for the
+ *                defaults
+ *
  * returns	: Non-zero on error
  ******************************************************************************/
 int seviri_read_nat(const char *filename, struct seviri_data *d,
                     uint n_bands, const uint *band_ids,
                     enum seviri_bounds bounds,
                     uint line0, uint line1, uint column0, uint column1,
-                    double lat0, double lat1, double lon0, double lon1)
+                    double lat0, double lat1, double lon0, double lon1,
+                    const struct seviri_options *opts)
 {
-     FILE *fp;
+     struct seviri_io *fp;
 
      struct seviri_auxillary_io_data aux;
 
+     SU_PERF_TIMER(t);
+
      aux.operation  = 0;
      aux.swap_bytes = su_is_little_endian();
 
      seviri_auxillary_alloc(&aux);
 
-     if ((fp = fopen(filename, "r")) == NULL) {
+     seviri_perf_init(&d->perf);
+     aux.perf = &d->perf;
+
+     opts = seviri_options_get(opts);
+
+     SU_PERF_START(aux.perf, t);
+     if ((fp = seviri_io_open(filename, "r", opts->open, opts->open_data)) == NULL) {
           fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
                   filename, strerror(errno));
           return -1;
      }
+     SU_PERF_STOP(aux.perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
      if (seviri_marf_header_read(fp, &d->marf_header, &aux)) {
           fprintf(stderr, "ERROR: seviri_marf_header_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
@@ -618,16 +1148,18 @@ int seviri_read_nat(const char *filename, struct seviri_data *d,
      if (seviri_15HEADER_read(fp, &d->header, &aux)) {
           fprintf(stderr, "ERROR: seviri_15HEADER_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
-     if (seviri_image_read(fp, &d->image, &d->marf_header, n_bands, band_ids,
+     if (seviri_image_read(fp, &d->image, &d->marf_header,
+                           &d->header.ImageDescription.PlannedCoverageHRV,
+                           n_bands, band_ids,
                            bounds, line0, line1, column0, column1, lat0, lat1,
-                           lon0, lon1, &aux)) {
+                           lon0, lon1, &aux, opts)) {
           fprintf(stderr, "ERROR: seviri_image_read(), filename = %s\n",
                  filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
@@ -639,11 +1171,13 @@ int seviri_read_nat(const char *filename, struct seviri_data *d,
      if (seviri_15TRAILER_read(fp, &d->trailer, &aux)) {
           fprintf(stderr, "ERROR: seviri_15TRAILER_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
-     fclose(fp);
+     SU_PERF_START(aux.perf, t);
+     seviri_io_close(fp);
+     SU_PERF_STOP(aux.perf, t, SEVIRI_PERF_OPEN, 0, 0);
 
      seviri_auxillary_free(&aux);
 
@@ -663,7 +1197,7 @@ int seviri_read_nat(const char *filename, struct seviri_data *d,
  ******************************************************************************/
 int seviri_write_nat(const char *filename, const struct seviri_data *d)
 {
-     FILE *fp;
+     struct seviri_io *fp;
 
      struct seviri_auxillary_io_data aux;
 
@@ -672,7 +1206,7 @@ int seviri_write_nat(const char *filename, const struct seviri_data *d)
 
      seviri_auxillary_alloc(&aux);
 
-     if ((fp = fopen(filename, "w")) == NULL) {
+     if ((fp = seviri_io_open(filename, "w", NULL, NULL)) == NULL) {
           fprintf(stderr, "ERROR: Problem opening file for reading: %s ... %s\n",
                   filename, strerror(errno));
           return -1;
@@ -682,7 +1216,7 @@ int seviri_write_nat(const char *filename, const struct seviri_data *d)
                                  &d->marf_header, &aux)) {
           fprintf(stderr, "ERROR: seviri_marf_header_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
@@ -696,14 +1230,15 @@ int seviri_write_nat(const char *filename, const struct seviri_data *d)
                               &d->header, &aux)) {
           fprintf(stderr, "ERROR: seviri_15HEADER_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
-     if (seviri_image_write(fp, &d->image, &aux)) {
+     if (seviri_image_write(fp, &d->image,
+                            &d->header.ImageDescription.PlannedCoverageHRV, &aux)) {
           fprintf(stderr, "ERROR: seviri_image_write(), filename = %s\n",
                  filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
@@ -717,11 +1252,11 @@ int seviri_write_nat(const char *filename, const struct seviri_data *d)
                                &d->trailer, &aux)) {
           fprintf(stderr, "ERROR: seviri_15TRAILER_read(), filename = %s\n",
                   filename);
-          fclose(fp);
+          seviri_io_close(fp);
           return -1;
      }
 
-     fclose(fp);
+     seviri_io_close(fp);
 
      seviri_auxillary_free(&aux);
 
@@ -12,6 +12,7 @@
 
 #include "external.h"
 #include "read_write.h"
+#include "stats_util.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,11 +22,17 @@ extern "C" {
 int seviri_get_dimens_nat(const char *filename, uint *i_line, uint *i_column,
                           uint *n_lines, uint *n_columns, enum seviri_bounds bounds,
                           uint line0, uint line1, uint column0, uint column1,
-                          double lat0, double lat1, double lon0, double lon1);
+                          double lat0, double lat1, double lon0, double lon1,
+                          const struct seviri_options *opts);
 int seviri_read_nat(const char *filename, struct seviri_data *d,
                     uint n_bands, const uint *band_ids, enum seviri_bounds bounds,
                     uint line0, uint line1, uint column0, uint column1,
-                    double lat0, double lat1, double lon0, double lon1);
+                    double lat0, double lat1, double lon0, double lon1,
+                    const struct seviri_options *opts);
+int seviri_count_stats_nat(const char *filename, uint n_bands,
+                           const uint *band_ids, uint line0, uint line1,
+                           struct seviri_stats_data *stats,
+                           const struct seviri_options *opts);
 int seviri_write_nat(const char *filename, const struct seviri_data *d);
 
 
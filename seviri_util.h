@@ -18,8 +18,11 @@ extern "C" {
 #define SEVIRI_UTIL_VERSION "0.01"
 
 
+#include "composite.h"
 #include "external.h"
+#include "io_util.h"
 #include "preproc.h"
+#include "read_write_bsq.h"
 #include "read_write_hrit.h"
 #include "read_write_nat.h"
 
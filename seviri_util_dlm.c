@@ -26,14 +26,14 @@
     /* FOR IDL < 5.3 */
     /* Define the procedures */
     static IDL_SYSFUN_DEF seviri_util_procedures[] = {
-        {(IDL_FUN_RET) seviri_preproc_dlm, "SEVIRI_PREPROC_DLM", 4, 7,
+        {(IDL_FUN_RET) seviri_preproc_dlm, "SEVIRI_PREPROC_DLM", 5, 5,
          IDL_SYSFUN_DEF_F_KEYWORDS},
     };
 #else
     /* FOR IDL >= 5.3 */
     /* Define the procedures */
     static IDL_SYSFUN_DEF2 seviri_util_procedures[] = {
-        {(IDL_FUN_RET) seviri_preproc_dlm, "SEVIRI_PREPROC_DLM", 4, 7,
+        {(IDL_FUN_RET) seviri_preproc_dlm, "SEVIRI_PREPROC_DLM", 5, 5,
          IDL_SYSFUN_DEF_F_KEYWORDS, 0},
     };
 #endif
@@ -82,8 +82,6 @@ void seviri_util_exit_handler(void)
 
 static int bounds_string_to_enum(const char *s, enum seviri_bounds *bounds) {
 
-     char temp[128];
-
      if (strcmp(s, "full_disk") == 0)
           *bounds = SEVIRI_BOUNDS_FULL_DISK;
      else if (strcmp(s, "actual_image") == 0)
@@ -92,12 +90,8 @@ static int bounds_string_to_enum(const char *s, enum seviri_bounds *bounds) {
           *bounds = SEVIRI_BOUNDS_LINE_COLUMN;
      else if (strcmp(s, "lat_lon") == 0)
           *bounds = SEVIRI_BOUNDS_LAT_LON;
-     else {
-          snprintf(temp, 128, "ERROR: invalid bounds type: %s", s);
-          fprintf(stderr, "%s\n", temp);
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP, temp);
+     else
           return -1;
-     }
 
      return 0;
 };
@@ -105,31 +99,76 @@ static int bounds_string_to_enum(const char *s, enum seviri_bounds *bounds) {
 
 static int unit_string_to_enum(const char *s, enum seviri_units *unit) {
 
-     char temp[128];
-
      if (strcmp(s, "Radiance") == 0)
           *unit = SEVIRI_UNIT_RAD;
      else if (strcmp(s, "BRF") == 0)
           *unit = SEVIRI_UNIT_BRF;
      else if (strcmp(s, "BT") == 0)
           *unit = SEVIRI_UNIT_BT;
-     else {
-          snprintf(temp, 128, "ERROR: invalid unit type: %s", s);
-          fprintf(stderr, "%s\n", temp);
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP, temp);
+     else
           return -1;
-     }
 
      return 0;
 };
 
 
-/* Wrapped Fortran routines below this point */
+/* Keyword results are filled by IDL_KWProcessByOffset() into a struct on the
+   stack of each call so that no state is shared between calls. */
+typedef struct {
+     IDL_KW_RESULT_FIRST_FIELD;
+     IDL_LONG do_gsics;
+     IDL_LONG do_nasa;
+     int lat_lon_coords_there;
+     IDL_MEMINT lat_lon_coords_n;
+     float lat_lon_coords[4];
+     int pixel_coords_there;
+     IDL_MEMINT pixel_coords_n;
+     IDL_LONG pixel_coords[4];
+} KW_RESULT;
+
+
+/* Read only descriptions of the keywords in alphabetical order, holding
+   offsets into KW_RESULT. */
+static IDL_KW_ARR_DESC_R lat_lon_coords_desc = {
+     IDL_KW_OFFSETOF(lat_lon_coords), 4, 4, IDL_KW_OFFSETOF(lat_lon_coords_n)
+};
+
+static IDL_KW_ARR_DESC_R pixel_coords_desc   = {
+     IDL_KW_OFFSETOF(pixel_coords),   4, 4, IDL_KW_OFFSETOF(pixel_coords_n)
+};
+
+static IDL_KW_PAR kw_pars[] = {
+     {"DO_GSICS",       IDL_TYP_LONG,  1, IDL_KW_ZERO,  0,
+      IDL_KW_OFFSETOF(do_gsics)},
+     {"DO_NASA",        IDL_TYP_LONG,  1, IDL_KW_ZERO,  0,
+      IDL_KW_OFFSETOF(do_nasa)},
+     {"LAT_LON_COORDS", IDL_TYP_FLOAT, 1, IDL_KW_ARRAY,
+      IDL_KW_OFFSETOF(lat_lon_coords_there), IDL_CHARA(lat_lon_coords_desc)},
+     {"PIXEL_COORDS",   IDL_TYP_LONG,  1, IDL_KW_ARRAY,
+      IDL_KW_OFFSETOF(pixel_coords_there),   IDL_CHARA(pixel_coords_desc)},
+     {NULL}
+};
+
+
+/* Free the keyword temporaries before IDL_Message() longjmps out of the call. */
+#define DLM_ERROR(MSG) do { \
+     IDL_KW_FREE; \
+     IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP, MSG); \
+} while (0)
+
+
+/* Wrapped C routines below this point */
 
 void IDL_CDECL seviri_preproc_dlm(int argc, IDL_VPTR argv[], char *argk)
 {
      char *filename;
 
+     char *sdata;
+
+     char satposstr[128];
+
+     char temp[128];
+
      int i;
 
      uint n_bands;
@@ -140,155 +179,145 @@ void IDL_CDECL seviri_preproc_dlm(int argc, IDL_VPTR argv[], char *argk)
 
      enum seviri_bounds bounds;
 
-     uint pixel_coords[4];
+     uint pixel_coords[4]      = {0, 0, 0, 0};
+
+     double lat_lon_coords[4]  = {0., 0., 0., 0.};
+
+     IDL_MEMINT length;
 
-     double lat_lon_coords[4];
+     IDL_MEMINT dims_data_1[2];
+     IDL_MEMINT dims_data_2[3];
+     IDL_MEMINT dims_data_3[4];
+
+     IDL_VPTR plain_args[5];
+
+     IDL_VPTR v;
+
+     KW_RESULT kw;
+
+     void *s;
+
+     struct seviri_preproc_data preproc;
 
 
      /*-------------------------------------------------------------------------
       *
       *-----------------------------------------------------------------------*/
-     IDL_VPTR out_argv[1];
-
-     static int pixel_coords_flag;
-     static int pixel_coords_data[4];
-     static IDL_KW_ARR_DESC pixel_coords_desc   = {(char *) pixel_coords_data,
-                                                   4, 4, 0};
-
-     static int lat_lon_coords_flag;
-     static float lat_lon_coords_data[4];
-     static IDL_KW_ARR_DESC lat_lon_coords_desc = {(char *) lat_lon_coords_data,
-                                                   4, 4, 0};
-
-     static int do_gsics_flag;
-     static int do_gsics;
-
-     static IDL_KW_PAR kw_pars[] = {
-          IDL_KW_FAST_SCAN,
-          {"PIXEL_COORDS",   IDL_TYP_LONG,  1, IDL_KW_ARRAY, &pixel_coords_flag,
-           IDL_CHARA(pixel_coords_desc)},
-          {"LAT_LON_COORDS", IDL_TYP_FLOAT, 1, IDL_KW_ARRAY, &lat_lon_coords_flag,
-           IDL_CHARA(lat_lon_coords_desc)},
-          {"DO_GSICS",       IDL_TYP_LONG,  1, IDL_KW_ZERO,  &do_gsics_flag,
-           IDL_CHARA(do_gsics)},
-          {NULL}
-     };
-
-     IDL_KWCleanup(IDL_KW_MARK);
-
-     IDL_KWGetParams(argc, argv, argk, kw_pars, out_argv, 1);
+     IDL_KWProcessByOffset(argc, argv, argk, kw_pars, plain_args, 1, &kw);
 
 
      /*-------------------------------------------------------------------------
       *
       *-----------------------------------------------------------------------*/
-     IDL_ENSURE_STRING(argv[0])
-     filename = IDL_VarGetString(argv[0]);
+     if (plain_args[0]->type != IDL_TYP_STRING)
+          DLM_ERROR("ERROR: filename must be a string");
+     filename = IDL_VarGetString(plain_args[0]);
 
-     IDL_ENSURE_ARRAY (argv[1]);
-     n_bands = argv[1]->value.arr->n_elts;
+     if (! (plain_args[1]->flags & IDL_V_ARR))
+          DLM_ERROR("ERROR: band Ids must be an array");
+     n_bands = plain_args[1]->value.arr->n_elts;
      if (n_bands > SEVIRI_N_BANDS)
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-               "ERROR: to many band Ids given, max = SEVIRI_N_BANDS");
-     if (argv[1]->type != IDL_TYP_INT)
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-               "ERROR: band Ids must be an array of ints");
+          DLM_ERROR("ERROR: to many band Ids given, max = SEVIRI_N_BANDS");
+     if (plain_args[1]->type != IDL_TYP_INT)
+          DLM_ERROR("ERROR: band Ids must be an array of ints");
      for (i = 0; i < n_bands; ++i)
-          band_ids[i] = ((short *) argv[1]->value.arr->data)[i];
-
-     IDL_ENSURE_ARRAY (argv[2]);
-     if (n_bands != argv[2]->value.arr->n_elts)
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-               "ERROR: number of band ids and number of units do not match");
-     if (argv[2]->type != IDL_TYP_STRING)
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-               "ERROR: band units must be an array of strings");
-     for (i = 0; i < n_bands; ++i)
-          unit_string_to_enum(((IDL_STRING *) argv[2]->value.arr->data)[i].s,
-                              &band_units[i]);
+          band_ids[i] = ((short *) plain_args[1]->value.arr->data)[i];
+
+     if (! (plain_args[2]->flags & IDL_V_ARR))
+          DLM_ERROR("ERROR: band units must be an array");
+     if (n_bands != plain_args[2]->value.arr->n_elts)
+          DLM_ERROR("ERROR: number of band ids and number of units do not match");
+     if (plain_args[2]->type != IDL_TYP_STRING)
+          DLM_ERROR("ERROR: band units must be an array of strings");
+     for (i = 0; i < n_bands; ++i) {
+          if (unit_string_to_enum(IDL_STRING_STR(&((IDL_STRING *)
+                                  plain_args[2]->value.arr->data)[i]),
+                                  &band_units[i])) {
+               snprintf(temp, 128, "ERROR: invalid unit type: %s",
+                        IDL_STRING_STR(&((IDL_STRING *)
+                                       plain_args[2]->value.arr->data)[i]));
+               DLM_ERROR(temp);
+          }
+     }
 
-     IDL_ENSURE_STRING(argv[3])
-     bounds_string_to_enum(IDL_VarGetString(argv[3]), &bounds);
+     if (plain_args[3]->type != IDL_TYP_STRING)
+          DLM_ERROR("ERROR: bounds must be a string");
+     if (bounds_string_to_enum(IDL_VarGetString(plain_args[3]), &bounds)) {
+          snprintf(temp, 128, "ERROR: invalid bounds type: %s",
+                   IDL_VarGetString(plain_args[3]));
+          DLM_ERROR(temp);
+     }
 
+     IDL_EXCLUDE_EXPR(plain_args[4]);
 
-     if (pixel_coords_flag && lat_lon_coords_flag)
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-               "ERROR: cannot use both the \"pixel_coords\" and "
-               "\"lat_lon_coords\" keywords");
+
+     if (kw.pixel_coords_there && kw.lat_lon_coords_there)
+          DLM_ERROR("ERROR: cannot use both the \"pixel_coords\" and "
+                    "\"lat_lon_coords\" keywords");
 
      if (bounds == SEVIRI_BOUNDS_FULL_DISK ||
          bounds == SEVIRI_BOUNDS_ACTUAL_IMAGE) {
-          if (pixel_coords_flag || lat_lon_coords_flag)
-               IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-                    "ERROR: cannot use the \"pixel_coords\" or "
-                    "\"lat_lon_coords\" keywords with \"full_disk\" or "
-                    "\"actual_image\" bounds");
+          if (kw.pixel_coords_there || kw.lat_lon_coords_there)
+               DLM_ERROR("ERROR: cannot use the \"pixel_coords\" or "
+                         "\"lat_lon_coords\" keywords with \"full_disk\" or "
+                         "\"actual_image\" bounds");
      }
      else if (bounds == SEVIRI_BOUNDS_LINE_COLUMN) {
-          if (! pixel_coords_flag)
-               IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-                    "ERROR: must use the \"pixel_coords\" keyword with "
-                    "\"line_column\" bounds");
+          if (! kw.pixel_coords_there)
+               DLM_ERROR("ERROR: must use the \"pixel_coords\" keyword with "
+                         "\"line_column\" bounds");
           for (i = 0; i < 4; ++i)
-               pixel_coords[i] = pixel_coords_data[i];
+               pixel_coords[i] = kw.pixel_coords[i];
      }
      else if (bounds == SEVIRI_BOUNDS_LAT_LON) {
-          if (! lat_lon_coords_flag)
-               IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-                    "ERROR: must use the \"lat_lon_coords\" keyword with "
-                    "\"lat_lon\" bounds");
+          if (! kw.lat_lon_coords_there)
+               DLM_ERROR("ERROR: must use the \"lat_lon_coords\" keyword with "
+                         "\"lat_lon\" bounds");
           for (i = 0; i < 4; ++i)
-               lat_lon_coords[i] = lat_lon_coords_data[i];
+               lat_lon_coords[i] = kw.lat_lon_coords[i];
      }
 
 
      /*-------------------------------------------------------------------------
-      *
+      * Zeroed so that seviri_preproc_free() may be called on it whether or not
+      * seviri_read_and_preproc() got as far as allocating its members.
       *-----------------------------------------------------------------------*/
-     struct seviri_preproc_data preproc;
+     memset(&preproc, 0, sizeof(struct seviri_preproc_data));
 
      if (seviri_read_and_preproc(filename, &preproc, n_bands, band_ids,
           band_units, bounds, pixel_coords[0], pixel_coords[1], pixel_coords[2],
           pixel_coords[3], lat_lon_coords[0], lat_lon_coords[1], lat_lon_coords[2],
-          lat_lon_coords[3], do_gsics, 0))
-          IDL_Message(IDL_M_NAMED_GENERIC, IDL_MSG_LONGJMP,
-               "ERROR: seviri_read_and_preproc()");
+          lat_lon_coords[3], kw.do_gsics, kw.do_nasa, satposstr, 0, NULL)) {
+          seviri_preproc_free(&preproc);
+          DLM_ERROR("ERROR: seviri_read_and_preproc()");
+     }
 
 
      /*-------------------------------------------------------------------------
-      *
+      * Build an anonymous structure sized for this call.  IDL arrays are
+      * column major so images are dimensioned [n_columns, n_lines].
       *-----------------------------------------------------------------------*/
-     void *s;
+     length = (IDL_MEMINT) preproc.n_lines * preproc.n_columns;
 
-     static IDL_MEMINT one = 1;
+     dims_data_1[0] = 1;
+     dims_data_1[1] = preproc.n_lines;
 
-     static IDL_MEMINT filename_length;
-     filename_length = 1024;
-/*
-     filename_length = strlen(filename) + 1;
-*/
-     static IDL_MEMINT dims_filename[2];
-     dims_filename[0] = 1;
-     dims_filename[1] = filename_length;
-
-     static IDL_MEMINT dims_data_2[2];
-     dims_data_2[0] = preproc.n_lines;
+     dims_data_2[0] = 2;
      dims_data_2[1] = preproc.n_columns;
-
-     static IDL_MEMINT dims_data_3[3];
-     dims_data_3[0] = preproc.n_bands;
-     dims_data_3[1] = preproc.n_lines;
-     dims_data_3[2] = preproc.n_columns;
-
-     static IDL_STRUCT_TAG_DEF s_tags[] = {
-          {"FILENAME",   dims_filename, (void *) IDL_TYP_STRING},
-          {"I_LINE",     NULL,          (void *) IDL_TYP_INT},
-          {"I_COLUMN",   NULL,          (void *) IDL_TYP_INT},
-          {"N_LINES",    NULL,          (void *) IDL_TYP_INT},
-          {"N_COLUMNS",  NULL,          (void *) IDL_TYP_INT},
-          {"FILL_VALUE", NULL,          (void *) IDL_TYP_DOUBLE},
-          {"TIME",       dims_data_2,   (void *) IDL_TYP_FLOAT},
-/*
+     dims_data_2[2] = preproc.n_lines;
+
+     dims_data_3[0] = 3;
+     dims_data_3[1] = preproc.n_columns;
+     dims_data_3[2] = preproc.n_lines;
+     dims_data_3[3] = preproc.n_bands;
+
+     IDL_STRUCT_TAG_DEF s_tags[] = {
+          {"FILENAME",   NULL,          (void *) IDL_TYP_STRING},
+          {"N_BANDS",    NULL,          (void *) IDL_TYP_LONG},
+          {"N_LINES",    NULL,          (void *) IDL_TYP_LONG},
+          {"N_COLUMNS",  NULL,          (void *) IDL_TYP_LONG},
+          {"FILL_VALUE", NULL,          (void *) IDL_TYP_FLOAT},
+          {"TIME_LINE",  dims_data_1,   (void *) IDL_TYP_DOUBLE},
           {"LAT",        dims_data_2,   (void *) IDL_TYP_FLOAT},
           {"LON",        dims_data_2,   (void *) IDL_TYP_FLOAT},
           {"SZA",        dims_data_2,   (void *) IDL_TYP_FLOAT},
@@ -296,51 +325,43 @@ void IDL_CDECL seviri_preproc_dlm(int argc, IDL_VPTR argv[], char *argk)
           {"VZA",        dims_data_2,   (void *) IDL_TYP_FLOAT},
           {"VAA",        dims_data_2,   (void *) IDL_TYP_FLOAT},
           {"DATA",       dims_data_3,   (void *) IDL_TYP_FLOAT},
-*/
           {NULL}
      };
 
-     s = IDL_MakeStruct("seviri_preproc_data", s_tags);
-
-     typedef struct data_struct {
-          IDL_STRING filename[1024];
-          IDL_INT i_line;
-          IDL_INT i_column;
-          IDL_INT n_lines;
-          IDL_INT n_columns;
-          float fill_value;
-          IDL_VPTR *time;
-/*
-          float *lat;
-          float *lon;
-          float *sza;
-          float *saa;
-          float *vza;
-          float *vaa;
-          float *data;
-*/
-     } DATA_STRUCT;
+     s = IDL_MakeStruct(NULL, s_tags);
 
-     IDL_VPTR v;
+     sdata = IDL_MakeTempStructVector(s, 1, &v, IDL_TRUE);
+
+#define TAG(NAME) (sdata + IDL_StructTagInfoByName(s, NAME, IDL_MSG_LONGJMP, NULL))
+
+     IDL_StrStore((IDL_STRING *) TAG("FILENAME"), filename);
 
-     static DATA_STRUCT s_data;
+     *((IDL_LONG *) TAG("N_BANDS"))    = preproc.n_bands;
+     *((IDL_LONG *) TAG("N_LINES"))    = preproc.n_lines;
+     *((IDL_LONG *) TAG("N_COLUMNS"))  = preproc.n_columns;
+     *((float    *) TAG("FILL_VALUE")) = preproc.fill_value;
 
-     s_data.n_lines   = 2;
-     s_data.n_columns = 4;
+     memcpy(TAG("TIME_LINE"), preproc.time_line, preproc.n_lines * sizeof(double));
+     memcpy(TAG("LAT"),  preproc.lat,   length * sizeof(float));
+     memcpy(TAG("LON"),  preproc.lon,   length * sizeof(float));
+     memcpy(TAG("SZA"),  preproc.sza,   length * sizeof(float));
+     memcpy(TAG("SAA"),  preproc.saa,   length * sizeof(float));
+     memcpy(TAG("VZA"),  preproc.vza,   length * sizeof(float));
+     memcpy(TAG("VAA"),  preproc.vaa,   length * sizeof(float));
+     memcpy(TAG("DATA"), preproc.data2, preproc.n_bands * length * sizeof(float));
 
-     s_data.time = malloc(preproc.n_bands * preproc.n_lines * preproc.n_columns *
-                          sizeof(float));
+#undef TAG
 
-     v = IDL_ImportArray(1, &one, IDL_TYP_STRUCT, (UCHAR *) &s_data, 0, s);
+     seviri_preproc_free(&preproc);
 
-     IDL_VarCopy(v, argv[4]);
+     IDL_VarCopy(v, plain_args[4]);
 
 
      /*-------------------------------------------------------------------------
       * Cleanup any temporaries due to the keyword and deallocate the remain
       * temporary arrays.
       *-----------------------------------------------------------------------*/
-     IDL_KWCleanup(IDL_KW_CLEAN);
+     IDL_KW_FREE;
 
 
      return;
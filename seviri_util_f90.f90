@@ -29,6 +29,7 @@ module seviri_util
               seviri_read_and_preproc_nat_f90, &
               seviri_read_and_preproc_hrit_f90, &
               seviri_read_and_preproc_f90, &
+              seviri_preproc_time_f90, &
               seviri_preproc_free_f90
 
 
@@ -44,12 +45,32 @@ module seviri_util
     integer, parameter, public :: SEVIRI_UNIT_BT             = 4
 
 
+    type, bind(c) :: seviri_perf_stage_t
+        real(c_double)  :: wall
+        real(c_double)  :: cpu
+        integer(c_long) :: calls
+        integer(c_long) :: pixels
+        integer(c_long) :: bytes
+    end type seviri_perf_stage_t
+
+    type, bind(c) :: seviri_perf_t
+        integer(c_int)            :: enabled
+        type(seviri_perf_stage_t) :: stage(9)
+    end type seviri_perf_t
+
+    type, bind(c) :: seviri_stats_t
+        integer(c_int) :: n_bands
+        type(c_ptr)    :: band
+    end type seviri_stats_t
+
     type, bind(c) :: seviri_preproc_t
         integer(c_int) :: memory_alloc_d
+        integer(c_int) :: memory_alloc_t
         integer(c_int) :: n_bands
         integer(c_int) :: n_lines
         integer(c_int) :: n_columns
         real(c_float)  :: fill_value
+        type(c_ptr)    :: time_line
         type(c_ptr)    :: time
         type(c_ptr)    :: lat
         type(c_ptr)    :: lon
@@ -60,6 +81,13 @@ module seviri_util
         type(c_ptr)    :: data
         type(c_ptr)    :: data2
         type(c_ptr)    :: cal_slope
+        integer(c_int) :: n_lines_hrv
+        integer(c_int) :: n_columns_hrv
+        type(c_ptr)    :: lat_hrv
+        type(c_ptr)    :: lon_hrv
+        type(c_ptr)    :: data_hrv
+        type(seviri_perf_t) :: perf
+        type(seviri_stats_t) :: stats
     end type seviri_preproc_t
 
     type :: seviri_preproc_t_f90
@@ -68,6 +96,7 @@ module seviri_util
         integer          :: n_lines
         integer          :: n_columns
         real(4)          :: fill_value
+        real(8), pointer :: time_line(:)
         real(8), pointer :: time(:, :)
         real(4), pointer :: lat(:, :)
         real(4), pointer :: lon(:, :)
@@ -85,7 +114,7 @@ module seviri_util
     interface
         integer(c_int) function seviri_get_dimens_nat(filename, &
             i_line, i_column, n_lines, n_columns, bounds, line0, line1, &
-            column0, column1, lat0, lat1, lon0, lon1) &
+            column0, column1, lat0, lat1, lon0, lon1, opts) &
             bind(C, name = 'seviri_get_dimens_nat')
 
             use iso_c_binding
@@ -99,6 +128,7 @@ module seviri_util
             integer(c_int),    intent(in), value :: line0, line1, &
                                                  column0, column1
             real(c_double),    intent(in), value :: lat0, lat1, lon0, lon1
+            type(c_ptr),       intent(in), value :: opts
         end function seviri_get_dimens_nat
     end interface
 
@@ -127,7 +157,7 @@ module seviri_util
     interface
         integer(c_int) function seviri_get_dimens(filename, &
             i_line, i_column, n_lines, n_columns, bounds, line0, line1, &
-            column0, column1, lat0, lat1, lon0, lon1) &
+            column0, column1, lat0, lat1, lon0, lon1, opts) &
             bind(C, name = 'seviri_get_dimens')
 
             use iso_c_binding
@@ -141,14 +171,15 @@ module seviri_util
             integer(c_int),    intent(in), value :: line0, line1, &
                                                     column0, column1
             real(c_double),    intent(in), value :: lat0, lat1, lon0, lon1
+            type(c_ptr),       intent(in), value :: opts
         end function seviri_get_dimens
     end interface
 
     interface
         integer(c_int) function seviri_read_and_preproc_nat(filename, preproc, &
             n_bands, band_ids, band_units, bounds, line0, line1, column0, column1, &
-            lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc) bind(C, &
-            name = 'seviri_read_and_preproc_nat')
+            lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc, &
+            opts) bind(C, name = 'seviri_read_and_preproc_nat')
 
             use iso_c_binding
 
@@ -169,14 +200,15 @@ module seviri_util
             integer(c_int),         intent(in), value :: do_nasa
             character(c_char),      intent(inout)     :: satposstr(128)
             integer(c_int),         intent(in), value :: do_not_alloc
+            type(c_ptr),            intent(in), value :: opts
         end function seviri_read_and_preproc_nat
     end interface
 
     interface
         integer(c_int) function seviri_read_and_preproc_hrit(filename, timeslot, &
             satnum, preproc, n_bands, band_ids, band_units, bounds, line0, line1, &
-            column0, column1, lat0, lat1, lon0, lon1, rss, do_calib, do_nasa, satposstr, &
-            do_not_alloc) bind(C, name = 'seviri_read_and_preproc_hrit')
+            column0, column1, lat0, lat1, lon0, lon1, rss, iodc, do_calib, do_nasa, &
+            satposstr, do_not_alloc, opts) bind(C, name = 'seviri_read_and_preproc_hrit')
 
             use iso_c_binding
 
@@ -196,18 +228,20 @@ module seviri_util
                                                          column0, column1
             real(c_double),         intent(in), value :: lat0, lat1, lon0, lon1
             integer(c_int),         intent(in), value :: rss
+            integer(c_int),         intent(in), value :: iodc
             integer(c_int),         intent(in), value :: do_calib
             integer(c_int),         intent(in), value :: do_nasa
             character(c_char),      intent(inout)     :: satposstr(128)
             integer(c_int),         intent(in), value :: do_not_alloc
+            type(c_ptr),            intent(in), value :: opts
         end function seviri_read_and_preproc_hrit
     end interface
 
     interface
         integer(c_int) function seviri_read_and_preproc(filename, preproc, &
             n_bands, band_ids, band_units, bounds, line0, line1, column0, column1, &
-            lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc) bind(C, &
-            name = 'seviri_read_and_preproc')
+            lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc, &
+            opts) bind(C, name = 'seviri_read_and_preproc')
 
             use iso_c_binding
 
@@ -228,9 +262,24 @@ module seviri_util
             integer(c_int),         intent(in), value :: do_nasa
             character(c_char),      intent(inout)     :: satposstr(128)
             integer(c_int),         intent(in), value :: do_not_alloc
+            type(c_ptr),            intent(in), value :: opts
         end function seviri_read_and_preproc
     end interface
 
+    interface
+        type(c_ptr) function seviri_preproc_time(preproc) &
+            bind(C, name = 'seviri_preproc_time')
+
+            use iso_c_binding
+
+            import seviri_preproc_t
+
+            implicit none
+
+            type(seviri_preproc_t), intent(inout) :: preproc
+        end function seviri_preproc_time
+    end interface
+
     interface
         integer(c_int) function seviri_preproc_free(preproc) &
             bind(C, name = 'seviri_preproc_free')
@@ -263,7 +312,7 @@ integer function seviri_get_dimens_nat_f90(filename, i_line, i_column, &
 
     status = seviri_get_dimens_nat(trim(filename)//C_NULL_CHAR, &
         i_line, i_column, n_lines, n_columns, bounds, line0, line1, &
-        column0, column1, lat0, lat1, lon0, lon1)
+        column0, column1, lat0, lat1, lon0, lon1, c_null_ptr)
     if (status .ne. 0) then
         write(6, *) 'ERROR: seviri_get_dimens_nat()'
         return
@@ -316,7 +365,7 @@ integer function seviri_get_dimens_f90(filename, i_line, i_column, &
 
     status = seviri_get_dimens(trim(filename)//C_NULL_CHAR, &
         i_line, i_column, n_lines, n_columns, bounds, line0, line1, &
-        column0, column1, lat0, lat1, lon0, lon1)
+        column0, column1, lat0, lat1, lon0, lon1, c_null_ptr)
     if (status .ne. 0) then
         write(6, *) 'ERROR: seviri_get_dimens()'
         return
@@ -375,11 +424,15 @@ integer function seviri_read_and_preproc_nat_f90(filename, preproc_f90, n_bands,
         preproc%vaa   = c_loc(preproc_f90%vaa (1, 1))
         preproc%data2 = c_loc(preproc_f90%data(1, 1, 1))
         preproc%cal_slope = c_loc(preproc_f90%cal_slope(1))
+        preproc%lat_hrv  = c_null_ptr
+        preproc%lon_hrv  = c_null_ptr
+        preproc%data_hrv = c_null_ptr
     end if
 
     status = seviri_read_and_preproc_nat(trim(filename)//C_NULL_CHAR, preproc, &
         n_bands, band_ids, band_units, bounds, line0, line1, column0, column1, &
-        lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc)
+        lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc, &
+        c_null_ptr)
     if (status .ne. 0) then
         write(6, *) 'ERROR: seviri_read_and_preproc_nat()'
         return
@@ -394,11 +447,15 @@ integer function seviri_read_and_preproc_nat_f90(filename, preproc_f90, n_bands,
     preproc_f90%n_columns  = preproc%n_columns
     preproc_f90%fill_value = preproc%fill_value
 
+    shape0 = [preproc%n_lines]
+
+    call c_f_pointer(preproc%time_line, preproc_f90%time_line, shape0)
+
     shape0 = [preproc%n_bands]
     shape1 = [preproc_f90%n_columns, preproc_f90%n_lines]
 
     if (.not. do_not_alloc_f90) then
-        call c_f_pointer(preproc%time,  preproc_f90%time, shape1)
+        nullify(preproc_f90%time)
         call c_f_pointer(preproc%lat,   preproc_f90%lat,  shape1)
         call c_f_pointer(preproc%lon,   preproc_f90%lon,  shape1)
         call c_f_pointer(preproc%sza,   preproc_f90%sza,  shape1)
@@ -476,12 +533,16 @@ integer function seviri_read_and_preproc_hrit_f90(filename, timeslot, satnum, &
         preproc%vaa   = c_loc(preproc_f90%vaa (1, 1))
         preproc%data2 = c_loc(preproc_f90%data(1, 1, 1))
         preproc%cal_slope = c_loc(preproc_f90%cal_slope(1))
+        preproc%lat_hrv  = c_null_ptr
+        preproc%lon_hrv  = c_null_ptr
+        preproc%data_hrv = c_null_ptr
     end if
 
     status = seviri_read_and_preproc_hrit(trim(filename)//C_NULL_CHAR, &
         trim(timeslot)//C_NULL_CHAR, satnum, preproc, n_bands, band_ids, &
         band_units, bounds, line0, line1, column0, column1, lat0, lat1, &
-        lon0, lon1, rss, do_calib, do_nasa, satposstr, do_not_alloc)
+        lon0, lon1, rss, 0, do_calib, do_nasa, satposstr, do_not_alloc, &
+        c_null_ptr)
     if (status .ne. 0) then
         write(6, *) 'ERROR: seviri_read_and_preproc_hrit()'
         return
@@ -496,11 +557,15 @@ integer function seviri_read_and_preproc_hrit_f90(filename, timeslot, satnum, &
     preproc_f90%n_columns  = preproc%n_columns
     preproc_f90%fill_value = preproc%fill_value
 
+    shape0 = [preproc%n_lines]
+
+    call c_f_pointer(preproc%time_line, preproc_f90%time_line, shape0)
+
     shape0 = [preproc%n_bands]
     shape1 = [preproc_f90%n_columns, preproc_f90%n_lines]
 
     if (.not. do_not_alloc_f90) then
-        call c_f_pointer(preproc%time,  preproc_f90%time, shape1)
+        nullify(preproc_f90%time)
         call c_f_pointer(preproc%lat,   preproc_f90%lat,  shape1)
         call c_f_pointer(preproc%lon,   preproc_f90%lon,  shape1)
         call c_f_pointer(preproc%sza,   preproc_f90%sza,  shape1)
@@ -573,7 +638,8 @@ integer function seviri_read_and_preproc_f90(filename, preproc_f90, n_bands, &
 
     status = seviri_read_and_preproc(trim(filename)//C_NULL_CHAR, preproc, &
         n_bands, band_ids, band_units, bounds, line0, line1, column0, column1, &
-        lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc)
+        lat0, lat1, lon0, lon1, do_calib, do_nasa, satposstr, do_not_alloc, &
+        c_null_ptr)
     if (status .ne. 0) then
         write(6, *) 'ERROR: seviri_read_and_preproc()'
         return
@@ -588,11 +654,15 @@ integer function seviri_read_and_preproc_f90(filename, preproc_f90, n_bands, &
     preproc_f90%n_columns  = preproc%n_columns
     preproc_f90%fill_value = preproc%fill_value
 
+    shape0 = [preproc%n_lines]
+
+    call c_f_pointer(preproc%time_line, preproc_f90%time_line, shape0)
+
     shape0 = [preproc%n_bands]
     shape1 = [preproc_f90%n_columns, preproc_f90%n_lines]
 
     if (.not. do_not_alloc_f90) then
-        call c_f_pointer(preproc%time,  preproc_f90%time, shape1)
+        nullify(preproc_f90%time)
         call c_f_pointer(preproc%lat,   preproc_f90%lat,  shape1)
         call c_f_pointer(preproc%lon,   preproc_f90%lon,  shape1)
         call c_f_pointer(preproc%sza,   preproc_f90%sza,  shape1)
@@ -612,6 +682,33 @@ integer function seviri_read_and_preproc_f90(filename, preproc_f90, n_bands, &
 end function seviri_read_and_preproc_f90
 
 
+! Associates preproc_f90%time with the image of time, which the C code expands
+! from the per line time on the first call.
+integer function seviri_preproc_time_f90(preproc_f90) result(status)
+
+    implicit none
+
+    type(seviri_preproc_t_f90), intent(inout) :: preproc_f90
+
+    type(c_ptr) :: time
+    integer     :: shape1(2)
+
+    status = 0
+
+    time = seviri_preproc_time(preproc_f90%preproc)
+    if (.not. c_associated(time)) then
+        write(6, *) 'ERROR: seviri_preproc_time()'
+        status = -1
+        return
+    end if
+
+    shape1 = [preproc_f90%n_columns, preproc_f90%n_lines]
+
+    call c_f_pointer(time, preproc_f90%time, shape1)
+
+end function seviri_preproc_time_f90
+
+
 integer function seviri_preproc_free_f90(preproc_f90) result(status)
 
     implicit none
@@ -7,8 +7,9 @@
  *
  ******************************************************************************/
 
-#include <python2.7/Python.h>
-#include <python2.7/structmember.h>
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/arrayobject.h>
 
@@ -17,22 +18,39 @@
 #include "seviri_util.h"
 
 
+/* Name of the capsule that owns the C pre-processing data. */
+#define PREPROC_CAPSULE_NAME "seviri_util.seviri_preproc_data"
+
+
+/* Products exposed as NumPy arrays, in the order of the getset table. */
+enum seviri_preproc_arrays {
+     PY_ARRAY_TIME_LINE,
+     PY_ARRAY_TIME,
+     PY_ARRAY_LAT,
+     PY_ARRAY_LON,
+     PY_ARRAY_SZA,
+     PY_ARRAY_SAA,
+     PY_ARRAY_VZA,
+     PY_ARRAY_VAA,
+     PY_ARRAY_DATA,
+
+     N_PY_ARRAYS
+};
+
+
+/* The NumPy arrays alias the memory of the C pre-processing data, which is
+   owned by a capsule set as the base object of each array.  The memory is
+   released when the last of the seviri_preproc object and its arrays is
+   released. */
 struct seviri_preproc_data_py {
      PyObject_HEAD
-     char *filename;
      uint n_bands;
      uint n_lines;
      uint n_columns;
      double fill_value;
-     PyObject *time;
-     PyObject *lat;
-     PyObject *lon;
-     PyObject *sza;
-     PyObject *saa;
-     PyObject *vza;
-     PyObject *vaa;
-     PyObject *data;
-     struct seviri_preproc_data d;
+     PyObject *capsule;
+     struct seviri_preproc_data *d;
+     PyObject *arrays[N_PY_ARRAYS];
 };
 
 
@@ -53,7 +71,6 @@ static int bounds_string_to_enum(const char *s, enum seviri_bounds *bounds) {
           *bounds = SEVIRI_BOUNDS_LAT_LON;
      else {
           snprintf(temp, 128, "ERROR: invalid bounds type: %s", s);
-          fprintf(stderr, "%s\n", temp);
           PyErr_SetString(SEVIRI_PREPROC_Error, temp);
           return -1;
      }
@@ -62,7 +79,7 @@ static int bounds_string_to_enum(const char *s, enum seviri_bounds *bounds) {
 };
 
 
-static int unit_string_to_enum(const char *s, enum seviri_bounds *unit) {
+static int unit_string_to_enum(const char *s, enum seviri_units *unit) {
 
      char temp[128];
 
@@ -74,7 +91,6 @@ static int unit_string_to_enum(const char *s, enum seviri_bounds *unit) {
           *unit = SEVIRI_UNIT_BT;
      else {
           snprintf(temp, 128, "ERROR: invalid unit type: %s", s);
-          fprintf(stderr, "%s\n", temp);
           PyErr_SetString(SEVIRI_PREPROC_Error, temp);
           return -1;
      }
@@ -84,10 +100,62 @@ static int unit_string_to_enum(const char *s, enum seviri_bounds *unit) {
 
 
 
+static void preproc_capsule_free(PyObject *capsule) {
+
+     struct seviri_preproc_data *d;
+
+     d = PyCapsule_GetPointer(capsule, PREPROC_CAPSULE_NAME);
+
+     seviri_preproc_free(d);
+
+     free(d);
+}
+
+
+
+/* Create an array aliasing C memory that keeps the capsule alive. */
+static PyObject *new_array(struct seviri_preproc_data_py *self, int nd,
+                           npy_intp *dims, int type, void *data) {
+
+     PyObject *array;
+
+     array = PyArray_SimpleNewFromData(nd, dims, type, data);
+     if (array == NULL)
+          return NULL;
+
+     Py_INCREF(self->capsule);
+     if (PyArray_SetBaseObject((PyArrayObject *) array, self->capsule) < 0) {
+          Py_DECREF(array);
+          return NULL;
+     }
+
+     return array;
+}
+
+
+
+static void seviri_preproc_clear(struct seviri_preproc_data_py *self) {
+
+     int i;
+
+     for (i = 0; i < N_PY_ARRAYS; ++i)
+          Py_CLEAR(self->arrays[i]);
+
+     Py_CLEAR(self->capsule);
+
+     self->d = NULL;
+}
+
+
+
 static PyObject *seviri_preproc_new(PyTypeObject *type,
-                                        PyObject *args, PyObject *keywords) {
+                                    PyObject *args, PyObject *keywords) {
      struct seviri_preproc_data_py *self;
 
+     /* The arguments are those of __init__(). */
+     (void) args;
+     (void) keywords;
+
      self = (struct seviri_preproc_data_py *) type->tp_alloc(type, 0);
      if (self == NULL) {
           PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: error allocating memory "
@@ -103,79 +171,85 @@ static PyObject *seviri_preproc_new(PyTypeObject *type,
 static int seviri_preproc_init(struct seviri_preproc_data_py *self,
                                PyObject *args, PyObject *keywords) {
 
-     char *s;
+     const char *s;
+
+     const char *filename;
 
-     char *bounds_string;
+     const char *bounds_string;
+
+     char satposstr[128];
 
       /* Return value initialized to -1 (failure) */
      int r = -1;
 
+     int status;
+
      int do_gsics = 0;
+     int do_nasa  = 0;
 
      uint i;
 
-     uint i_line;
-     uint i_column;
-     uint n_lines;
-     uint n_columns;
-
      enum seviri_bounds bounds;
 
-     uint line0;
-     uint line1;
-     uint column0;
-     uint column1;
+     uint line0   = 0;
+     uint line1   = 0;
+     uint column0 = 0;
+     uint column1 = 0;
 
      uint n_bands;
 
      uint *band_ids_array   = NULL;
-     uint *band_units_array = NULL;
+     enum seviri_units *band_units_array = NULL;
+
+     double lat0 = 0.;
+     double lat1 = 0.;
+     double lon0 = 0.;
+     double lon1 = 0.;
 
-     double lat0;
-     double lat1;
-     double lon0;
-     double lon1;
+     struct seviri_preproc_data *d = NULL;
 
-     /* Objects initialized to NULL for Py_XDECREF */
-     PyListObject *band_ids_list   = NULL;
-     PyListObject *band_units_list = NULL;
+     /* Borrowed references */
+     PyObject *band_ids_list   = NULL;
+     PyObject *band_units_list = NULL;
+     PyObject *pixel_coords    = NULL;
+     PyObject *lat_lon_coords  = NULL;
 
      static char *kw[] = {"filename", "band_ids", "units", "bounds", "pixel_coords",
-                          "lat_lon_coords", "do_gsics", NULL};
+                          "lat_lon_coords", "do_gsics", "do_nasa", NULL};
 
-     if (! PyArg_ParseTupleAndKeywords(args, keywords, "sOOs|(IIII)(dddd)i", kw,
-          &self->filename, &band_ids_list, &band_units_list, &bounds_string,
-          &line0, &line1, &column0, &column1, &lat0, &lat1, &lon0, &lon1, &do_gsics))
+     if (! PyArg_ParseTupleAndKeywords(args, keywords, "sO!O!s|OOpp", kw,
+          &filename, &PyList_Type, &band_ids_list, &PyList_Type, &band_units_list,
+          &bounds_string, &pixel_coords, &lat_lon_coords, &do_gsics, &do_nasa))
           goto error;
 
-     n_bands = PyList_Size((PyObject *) band_ids_list);
+     n_bands = PyList_Size(band_ids_list);
 
-     band_ids_array = malloc(n_bands * sizeof(uint));
-     for (i = 0; i < n_bands; ++i)
-          band_ids_array[i] =
-               PyLong_AsLong(PyList_GetItem((PyObject *) band_ids_list, i));
-
-     if (n_bands != PyList_Size((PyObject *) band_units_list)) {
+     if (n_bands != PyList_Size(band_units_list)) {
           PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: number of band ids and "
                           "number of units do not match");
           goto error;
      }
-     band_units_array = malloc(n_bands * sizeof(uint));
+
+     band_ids_array = malloc(n_bands * sizeof(uint));
      for (i = 0; i < n_bands; ++i) {
-          s = PyString_AsString(PyList_GetItem((PyObject *) band_units_list, i));
-          if (unit_string_to_enum(s, &band_units_array[i])) {
-               fprintf(stderr, "ERROR: unit_string_to_enum()\n");
+          band_ids_array[i] = PyLong_AsLong(PyList_GetItem(band_ids_list, i));
+          if (PyErr_Occurred())
                goto error;
-          }
      }
 
-     if (bounds_string_to_enum(bounds_string, &bounds)) {
-          fprintf(stderr, "ERROR: bounds_string_to_enum()\n");
-          goto error;
+     band_units_array = malloc(n_bands * sizeof(enum seviri_units));
+     for (i = 0; i < n_bands; ++i) {
+          s = PyUnicode_AsUTF8(PyList_GetItem(band_units_list, i));
+          if (s == NULL)
+               goto error;
+          if (unit_string_to_enum(s, &band_units_array[i]))
+               goto error;
      }
 
-     if (PyDict_Contains(keywords, PyString_FromString("pixel_coords")) &&
-         PyDict_Contains(keywords, PyString_FromString("lat_lon_coords"))) {
+     if (bounds_string_to_enum(bounds_string, &bounds))
+          goto error;
+
+     if (pixel_coords && lat_lon_coords) {
           PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: cannot use both the "
                "\"pixel_coords\" and \"lat_lon_coords\" keywords");
           goto error;
@@ -183,8 +257,7 @@ static int seviri_preproc_init(struct seviri_preproc_data_py *self,
 
      if (bounds == SEVIRI_BOUNDS_FULL_DISK ||
          bounds == SEVIRI_BOUNDS_ACTUAL_IMAGE) {
-          if (PyDict_Contains(keywords, PyString_FromString("pixel_coords")) ||
-              PyDict_Contains(keywords, PyString_FromString("lat_lon_coords"))) {
+          if (pixel_coords || lat_lon_coords) {
                PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: cannot use the "
                     "\"pixel_coords\" or \"lat_lon_coords\" keywords with "
                     "\"full_disk\" or \"actual_image\" bounds");
@@ -192,50 +265,64 @@ static int seviri_preproc_init(struct seviri_preproc_data_py *self,
           }
      }
      else if (bounds == SEVIRI_BOUNDS_LINE_COLUMN) {
-          if (! PyDict_Contains(keywords, PyString_FromString("pixel_coords"))) {
+          if (! pixel_coords) {
                PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: must use the "
                     "\"pixel_coords\" keyword with \"line_column\" bounds");
                goto error;
           }
+          if (! PyArg_ParseTuple(pixel_coords, "IIII;pixel_coords must be a "
+               "tuple of four ints", &line0, &line1, &column0, &column1))
+               goto error;
      }
      else if (bounds == SEVIRI_BOUNDS_LAT_LON) {
-          if (! PyDict_Contains(keywords, PyString_FromString("lat_lon_coords"))) {
+          if (! lat_lon_coords) {
                PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: must use the "
                     "\"lat_lon_coords\" keyword with \"lat_lon\" bounds");
                goto error;
           }
+          if (! PyArg_ParseTuple(lat_lon_coords, "dddd;lat_lon_coords must be a "
+               "tuple of four floats", &lat0, &lat1, &lon0, &lon1))
+               goto error;
      }
 
-     if (seviri_read_and_preproc(self->filename, &self->d, n_bands, band_ids_array,
-          band_units_array, bounds, line0, line1, column0, column1, lat0, lat1,
-          lon0, lon1, do_gsics, 0)) {
-          PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: seviri_read_and_preproc()");
+     /* Zeroed so that seviri_preproc_free() may be called on it whether or not
+        seviri_read_and_preproc() got as far as allocating its members. */
+     d = calloc(1, sizeof(struct seviri_preproc_data));
+     if (d == NULL) {
+          PyErr_NoMemory();
           goto error;
      }
 
-     self->n_bands    = self->d.n_bands;
-     self->n_lines    = self->d.n_lines;
-     self->n_columns  = self->d.n_columns;
-     self->fill_value = self->d.fill_value;
+     /* The read and pre-processing only touch C memory so other Python threads
+        may run meanwhile. */
+     Py_BEGIN_ALLOW_THREADS
+     status = seviri_read_and_preproc(filename, d, n_bands, band_ids_array,
+          band_units_array, bounds, line0, line1, column0, column1, lat0, lat1,
+          lon0, lon1, do_gsics, do_nasa, satposstr, 0, NULL);
+     Py_END_ALLOW_THREADS
 
-     npy_intp dims[3];
+     if (status) {
+          PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: seviri_read_and_preproc()");
+          seviri_preproc_free(d);
+          goto error;
+     }
 
-     dims[0] = self->n_lines;
-     dims[1] = self->n_columns;
+     /* Release the results of any previous call to __init__(). */
+     seviri_preproc_clear(self);
 
-     self->time = PyArray_SimpleNewFromData(2, dims, NPY_DOUBLE, self->d.time);
-     self->lat  = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT,  self->d.lat);
-     self->lon  = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT,  self->d.lon);
-     self->sza  = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT,  self->d.sza);
-     self->saa  = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT,  self->d.saa);
-     self->vza  = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT,  self->d.vza);
-     self->vaa  = PyArray_SimpleNewFromData(2, dims, NPY_FLOAT,  self->d.vaa);
+     self->capsule = PyCapsule_New(d, PREPROC_CAPSULE_NAME, preproc_capsule_free);
+     if (self->capsule == NULL) {
+          seviri_preproc_free(d);
+          goto error;
+     }
 
-     dims[0] = n_bands;
-     dims[1] = self->n_lines;
-     dims[2] = self->n_columns;
+     self->d = d;
+     d = NULL;
 
-     self->data = PyArray_SimpleNewFromData(3, dims, NPY_FLOAT,  self->d.data2);
+     self->n_bands    = self->d->n_bands;
+     self->n_lines    = self->d->n_lines;
+     self->n_columns  = self->d->n_columns;
+     self->fill_value = self->d->fill_value;
 
      r = 0; /* Success */
 
@@ -243,10 +330,7 @@ error:
      /* Cleanup code, shared by success and failure path */
      free(band_ids_array);
      free(band_units_array);
-
-     /* Decrement reference counts with Py_XDECREF() to ignore NULL references. */
-     Py_XDECREF(band_ids_list);
-     Py_XDECREF(band_units_list);
+     free(d);
 
      return r;
 }
@@ -254,19 +338,107 @@ error:
 
 static void seviri_preproc_dealloc(struct seviri_preproc_data_py *self) {
 
-     int r;
+     seviri_preproc_clear(self);
+
+     Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+
+
+/* Arrays are created on first access and cached. The image of time is only
+   expanded from time_line at that point. */
+static PyObject *seviri_preproc_get_array(struct seviri_preproc_data_py *self,
+                                          void *closure) {
 
-     r = seviri_preproc_free(&self->d);
-     if (r) {
-          PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: seviri_free()");
-          return;
+     int i = (int) (intptr_t) closure;
+
+     npy_intp dims[3];
+
+     struct seviri_preproc_data *d = self->d;
+
+     if (d == NULL) {
+          PyErr_SetString(SEVIRI_PREPROC_Error, "ERROR: seviri_preproc object "
+                          "has not been initialized");
+          return NULL;
      }
 
-     self->ob_type->tp_free((PyObject *) self);
+     if (self->arrays[i] == NULL) {
+          dims[0] = d->n_lines;
+          dims[1] = d->n_columns;
+
+          switch (i) {
+               case PY_ARRAY_TIME_LINE:
+                    self->arrays[i] = new_array(self, 1, dims, NPY_DOUBLE, d->time_line);
+                    break;
+               case PY_ARRAY_TIME:
+                    if (seviri_preproc_time(d) == NULL) {
+                         PyErr_SetString(SEVIRI_PREPROC_Error,
+                                         "ERROR: seviri_preproc_time()");
+                         return NULL;
+                    }
+                    self->arrays[i] = new_array(self, 2, dims, NPY_DOUBLE, d->time);
+                    break;
+               case PY_ARRAY_LAT:
+                    self->arrays[i] = new_array(self, 2, dims, NPY_FLOAT,  d->lat);
+                    break;
+               case PY_ARRAY_LON:
+                    self->arrays[i] = new_array(self, 2, dims, NPY_FLOAT,  d->lon);
+                    break;
+               case PY_ARRAY_SZA:
+                    self->arrays[i] = new_array(self, 2, dims, NPY_FLOAT,  d->sza);
+                    break;
+               case PY_ARRAY_SAA:
+                    self->arrays[i] = new_array(self, 2, dims, NPY_FLOAT,  d->saa);
+                    break;
+               case PY_ARRAY_VZA:
+                    self->arrays[i] = new_array(self, 2, dims, NPY_FLOAT,  d->vza);
+                    break;
+               case PY_ARRAY_VAA:
+                    self->arrays[i] = new_array(self, 2, dims, NPY_FLOAT,  d->vaa);
+                    break;
+               case PY_ARRAY_DATA:
+                    dims[0] = d->n_bands;
+                    dims[1] = d->n_lines;
+                    dims[2] = d->n_columns;
+                    self->arrays[i] = new_array(self, 3, dims, NPY_FLOAT,  d->data2);
+                    break;
+          }
+
+          if (self->arrays[i] == NULL)
+               return NULL;
+     }
+
+     Py_INCREF(self->arrays[i]);
+
+     return self->arrays[i];
 }
 
 
 
+static PyGetSetDef seviri_preproc_getset[] = {
+     {"time_line", (getter) seviri_preproc_get_array, NULL, "time_line",
+      (void *) PY_ARRAY_TIME_LINE},
+     {"time", (getter) seviri_preproc_get_array, NULL, "time",
+      (void *) PY_ARRAY_TIME},
+     {"lat",  (getter) seviri_preproc_get_array, NULL, "lat",
+      (void *) PY_ARRAY_LAT},
+     {"lon",  (getter) seviri_preproc_get_array, NULL, "lon",
+      (void *) PY_ARRAY_LON},
+     {"sza",  (getter) seviri_preproc_get_array, NULL, "sza",
+      (void *) PY_ARRAY_SZA},
+     {"saa",  (getter) seviri_preproc_get_array, NULL, "saa",
+      (void *) PY_ARRAY_SAA},
+     {"vza",  (getter) seviri_preproc_get_array, NULL, "vza",
+      (void *) PY_ARRAY_VZA},
+     {"vaa",  (getter) seviri_preproc_get_array, NULL, "vaa",
+      (void *) PY_ARRAY_VAA},
+     {"data", (getter) seviri_preproc_get_array, NULL, "data",
+      (void *) PY_ARRAY_DATA},
+     {NULL}
+};
+
+
+
 static PyMethodDef seviri_preproc_methods[] = {
      {NULL}
 };
@@ -275,102 +447,67 @@ static PyMethodDef seviri_preproc_methods[] = {
 
 static PyMemberDef seviri_preproc_members[] = {
      {"n_bands",   T_UINT, offsetof(struct seviri_preproc_data_py, n_bands),
-      0, "n_bands"},
+      READONLY, "n_bands"},
      {"n_lines",   T_UINT, offsetof(struct seviri_preproc_data_py, n_lines),
-      0, "n_lines"},
+      READONLY, "n_lines"},
      {"n_columns", T_UINT, offsetof(struct seviri_preproc_data_py, n_columns),
-      0, "n_columns"},
+      READONLY, "n_columns"},
      {"fill_value", T_DOUBLE, offsetof(struct seviri_preproc_data_py, fill_value),
-      0, "fill_value"},
-     {"time", T_OBJECT, offsetof(struct seviri_preproc_data_py, time),
-      0, "time"},
-     {"lat", T_OBJECT, offsetof(struct seviri_preproc_data_py, lat),
-      0, "lat"},
-     {"lon", T_OBJECT, offsetof(struct seviri_preproc_data_py, lon),
-      0, "lon"},
-     {"sza", T_OBJECT, offsetof(struct seviri_preproc_data_py, sza),
-      0, "sza"},
-     {"saa", T_OBJECT, offsetof(struct seviri_preproc_data_py, saa),
-      0, "saa"},
-     {"vza", T_OBJECT, offsetof(struct seviri_preproc_data_py, vza),
-      0, "vza"},
-     {"vaa", T_OBJECT, offsetof(struct seviri_preproc_data_py, vaa),
-      0, "vaa"},
-     {"data", T_OBJECT, offsetof(struct seviri_preproc_data_py, data),
-      0, "data"},
+      READONLY, "fill_value"},
      {NULL}
 };
 
 
 static PyTypeObject seviri_type = {
-     PyObject_HEAD_INIT(NULL)
-     0,
-     "seviri_util.seviri_preproc",
-     sizeof(struct seviri_preproc_data_py),
-     0,
-     (destructor) seviri_preproc_dealloc,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-     "SEVIRI_PREPROC object",
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     seviri_preproc_methods,
-     seviri_preproc_members,
-     0,
-     0,
-     0,
-     0,
-     0,
-     0,
-     (initproc) seviri_preproc_init,
-     0,
-     (newfunc) seviri_preproc_new,
+     PyVarObject_HEAD_INIT(NULL, 0)
+     .tp_name      = "seviri_util.seviri_preproc",
+     .tp_basicsize = sizeof(struct seviri_preproc_data_py),
+     .tp_dealloc   = (destructor) seviri_preproc_dealloc,
+     .tp_flags     = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+     .tp_doc       = "SEVIRI_PREPROC object",
+     .tp_methods   = seviri_preproc_methods,
+     .tp_members   = seviri_preproc_members,
+     .tp_getset    = seviri_preproc_getset,
+     .tp_init      = (initproc) seviri_preproc_init,
+     .tp_new       = (newfunc) seviri_preproc_new,
 };
 
 
-static PyMethodDef module_methods[] = {
-     {NULL}
+static PyModuleDef seviri_util_module = {
+     PyModuleDef_HEAD_INIT,
+     .m_name = "seviri_util",
+     .m_doc  = "Module for accessing seviri_util",
+     .m_size = -1,
 };
 
 
-#ifndef PyMODINIT_FUNC
-#define PyMODINIT_FUNC void
-#endif
-
-
-PyMODINIT_FUNC initseviri_util(void) {
+PyMODINIT_FUNC PyInit_seviri_util(void) {
      PyObject *module;
 
+     import_array();
+
      if (PyType_Ready(&seviri_type) < 0)
-          return;
+          return NULL;
 
-     module = Py_InitModule3("seviri_util", module_methods,
-                             "Module for accessing seviri_util");
+     module = PyModule_Create(&seviri_util_module);
      if (module == NULL)
-          return;
-
-     import_array();
+          return NULL;
 
      Py_INCREF(&seviri_type);
-     PyModule_AddObject(module, "seviri_preproc", (PyObject *) &seviri_type);
-     SEVIRI_PREPROC_Error = PyErr_NewException("seviri_preproc.error", NULL, NULL);
-     Py_INCREF(SEVIRI_PREPROC_Error);
-     PyModule_AddObject(module, "error", SEVIRI_PREPROC_Error);
+     if (PyModule_AddObject(module, "seviri_preproc", (PyObject *) &seviri_type) < 0) {
+          Py_DECREF(&seviri_type);
+          Py_DECREF(module);
+          return NULL;
+     }
+
+     SEVIRI_PREPROC_Error = PyErr_NewException("seviri_util.error", NULL, NULL);
+     Py_XINCREF(SEVIRI_PREPROC_Error);
+     if (PyModule_AddObject(module, "error", SEVIRI_PREPROC_Error) < 0) {
+          Py_XDECREF(SEVIRI_PREPROC_Error);
+          Py_CLEAR(SEVIRI_PREPROC_Error);
+          Py_DECREF(module);
+          return NULL;
+     }
+
+     return module;
 }
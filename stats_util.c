@@ -0,0 +1,281 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#include "external.h"
+#include "internal.h"
+#include "stats_util.h"
+
+
+/*******************************************************************************
+ * Zero the statistics of a band.
+ ******************************************************************************/
+void seviri_stats_init(struct seviri_band_stats *s)
+{
+     memset(s, 0, sizeof(struct seviri_band_stats));
+}
+
+
+
+/*******************************************************************************
+ * Merge the counts, extremes and moments of s2 into s (Chan et al., 1979).
+ ******************************************************************************/
+static void merge_moments(struct seviri_band_stats *s,
+                          const struct seviri_band_stats *s2)
+{
+     double n;
+     double n2;
+     double delta;
+
+     n  = (double) (s ->n_pixels - s ->n_fill);
+     n2 = (double) (s2->n_pixels - s2->n_fill);
+
+     if (n2 > 0.) {
+          if (n == 0.) {
+               s->min  = s2->min;
+               s->max  = s2->max;
+               s->mean = s2->mean;
+               s->m2   = s2->m2;
+          }
+          else {
+               if (s2->min < s->min)
+                    s->min = s2->min;
+               if (s2->max > s->max)
+                    s->max = s2->max;
+
+               delta = s2->mean - s->mean;
+
+               s->mean += delta * n2 / (n + n2);
+               s->m2   += s2->m2 + delta * delta * n * n2 / (n + n2);
+          }
+     }
+
+     s->n_pixels += s2->n_pixels;
+     s->n_fill   += s2->n_fill;
+}
+
+
+
+/*******************************************************************************
+ * Add a line of a band to its statistics.  The line is passed over twice, the
+ * second time for the squared differences from the mean of the line while it
+ * is still in cache, and its moments are then merged into s.
+ *
+ * s		: The statistics of the band
+ * counts	: The counts of the line, or NULL for no histogram
+ * data		: The calibrated line
+ * n		: The number of pixels of the line
+ * fill_value	: The fill value of data
+ ******************************************************************************/
+void seviri_stats_add_line(struct seviri_band_stats *s, const ushort *counts,
+                           const float *data, uint n, float fill_value)
+{
+     uint i;
+
+     struct seviri_band_stats s2;
+
+     s2.n_pixels = n;
+     s2.n_fill   = 0;
+     s2.min      = 0.;
+     s2.max      = 0.;
+     s2.mean     = 0.;
+     s2.m2       = 0.;
+
+     for (i = 0; i < n; ++i) {
+          if (data[i] == fill_value) {
+               s2.n_fill++;
+               continue;
+          }
+
+          /* The first pixel not equal to the fill value is at i == n_fill. */
+          if (s2.n_fill == i || data[i] < s2.min)
+               s2.min = data[i];
+          if (s2.n_fill == i || data[i] > s2.max)
+               s2.max = data[i];
+
+          s2.mean += data[i];
+     }
+
+     if (s2.n_fill < n) {
+          s2.mean /= n - s2.n_fill;
+
+          for (i = 0; i < n; ++i) {
+               if (data[i] != fill_value)
+                    s2.m2 += (data[i] - s2.mean) * (data[i] - s2.mean);
+          }
+     }
+
+     merge_moments(s, &s2);
+
+     if (counts) {
+          for (i = 0; i < n; ++i) {
+               if (counts[i] < SEVIRI_STATS_N_COUNTS)
+                    s->hist[counts[i]]++;
+          }
+     }
+}
+
+
+
+/*******************************************************************************
+ * Add a line of raw counts of a band to its statistics, for monitoring without
+ * calibration.  Counts of zero, which are space, and FILL_VALUE_US are fill,
+ * as with SEVIRI_UNIT_CNT, and as there zeros are still histogrammed.  The
+ * moments are accumulated exactly as integers in a single pass over the
+ * line, together with the histogram, and then merged into s.
+ *
+ * s		: The statistics of the band
+ * counts	: The counts of the line
+ * n		: The number of pixels of the line
+ ******************************************************************************/
+void seviri_stats_add_counts(struct seviri_band_stats *s, const ushort *counts,
+                             uint n)
+{
+     uint i;
+
+     ulong sum;
+     ulong sum2;
+
+     struct seviri_band_stats s2;
+
+     s2.n_pixels = n;
+     s2.n_fill   = 0;
+     s2.min      = 0.;
+     s2.max      = 0.;
+     s2.mean     = 0.;
+     s2.m2       = 0.;
+
+     sum  = 0;
+     sum2 = 0;
+
+     for (i = 0; i < n; ++i) {
+          if (counts[i] == 0 || counts[i] == FILL_VALUE_US) {
+               if (counts[i] == 0)
+                    s->hist[0]++;
+               s2.n_fill++;
+               continue;
+          }
+
+          if (s2.n_fill == i || counts[i] < s2.min)
+               s2.min = counts[i];
+          if (s2.n_fill == i || counts[i] > s2.max)
+               s2.max = counts[i];
+
+          sum  += counts[i];
+          sum2 += (ulong) counts[i] * counts[i];
+
+          if (counts[i] < SEVIRI_STATS_N_COUNTS)
+               s->hist[counts[i]]++;
+     }
+
+     if (s2.n_fill < n) {
+          s2.mean = (double) sum / (n - s2.n_fill);
+          s2.m2   = (double) sum2 - s2.mean * sum;
+     }
+
+     merge_moments(s, &s2);
+}
+
+
+
+/*******************************************************************************
+ * Merge the statistics of a band in s2, for example those of another block of
+ * lines, into s.
+ ******************************************************************************/
+void seviri_stats_merge(struct seviri_band_stats *s,
+                        const struct seviri_band_stats *s2)
+{
+     uint i;
+
+     merge_moments(s, s2);
+
+     for (i = 0; i < SEVIRI_STATS_N_COUNTS; ++i)
+          s->hist[i] += s2->hist[i];
+}
+
+
+
+/*******************************************************************************
+ * Merge the statistics of each band in d2 into d, allocating them in d if it
+ * has none.  d and d2 must be of the same bands.
+ *
+ * d		: The statistics merged into
+ * d2		: The statistics to merge
+ *
+ * returns	: Non-zero on error
+ ******************************************************************************/
+int seviri_stats_add(struct seviri_stats_data *d,
+                     const struct seviri_stats_data *d2)
+{
+     uint i;
+
+     if (! d2->band)
+          return 0;
+
+     if (! d->band) {
+          if ((d->band = malloc(d2->n_bands * sizeof(struct seviri_band_stats))) == NULL) {
+               fprintf(stderr, "ERROR: malloc()\n");
+               return -1;
+          }
+          d->n_bands = d2->n_bands;
+          for (i = 0; i < d->n_bands; ++i)
+               seviri_stats_init(&d->band[i]);
+     }
+
+     if (d->n_bands != d2->n_bands) {
+          fprintf(stderr, "ERROR: Statistics of different numbers of bands\n");
+          return -1;
+     }
+
+     for (i = 0; i < d->n_bands; ++i)
+          seviri_stats_merge(&d->band[i], &d2->band[i]);
+
+     return 0;
+}
+
+
+
+/*******************************************************************************
+ * The (population) standard deviation of the pixels not equal to the fill
+ * value, or 0 if there are none.
+ ******************************************************************************/
+double seviri_stats_std(const struct seviri_band_stats *s)
+{
+     if (s->n_pixels == s->n_fill)
+          return 0.;
+
+     return sqrt(s->m2 / (s->n_pixels - s->n_fill));
+}
+
+
+
+/*******************************************************************************
+ * The fraction of the pixels equal to the fill value, or 0 if there are none.
+ ******************************************************************************/
+double seviri_stats_fill_fraction(const struct seviri_band_stats *s)
+{
+     if (s->n_pixels == 0)
+          return 0.;
+
+     return (double) s->n_fill / s->n_pixels;
+}
+
+
+
+/*******************************************************************************
+ * Free the statistics of struct seviri_stats_data.
+ ******************************************************************************/
+int seviri_stats_free(struct seviri_stats_data *d)
+{
+     free(d->band);
+
+     d->n_bands = 0;
+     d->band    = NULL;
+
+     return 0;
+}
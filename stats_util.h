@@ -0,0 +1,68 @@
+/*******************************************************************************
+ *
+ *    Copyright (C) 2014-2018 Greg McGarragh <mcgarragh@atm.ox.ac.uk>
+ *
+ *    This source code is licensed under the GNU General Public License (GPL),
+ *    Version 3.  See the file COPYING for more details.
+ *
+ ******************************************************************************/
+
+#ifndef STATS_UTIL_H
+#define STATS_UTIL_H
+
+#include "external.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Number of bins of the histogram of counts, one per 10 bit count. */
+#define SEVIRI_STATS_N_COUNTS 1024
+
+
+/*******************************************************************************
+ * Statistics of a band, collected during calibration when enabled with the
+ * stats member of struct seviri_options.  The minimum, maximum, mean and m2
+ * are of the pixels not equal to the fill value, with m2 the sum of squared
+ * differences from the mean, so that statistics of separate lines, blocks or
+ * images can be merged exactly with seviri_stats_merge().  The histogram is of
+ * all the counts of the band, including zero counts, which are space and so
+ * fill, as only FILL_VALUE_US is outside of its range.
+ ******************************************************************************/
+struct seviri_band_stats {
+     ulong n_pixels;		/* number of pixels */
+     ulong n_fill;		/* number of pixels equal to the fill value */
+     double min;		/* minimum */
+     double max;		/* maximum */
+     double mean;		/* mean */
+     double m2;			/* sum of squared differences from the mean */
+     ulong hist[SEVIRI_STATS_N_COUNTS];	/* histogram of the counts */
+};
+
+
+struct seviri_stats_data {
+     uint n_bands;		/* number of bands, 0 if not collected */
+     struct seviri_band_stats *band;	/* array of length n_bands or NULL */
+};
+
+
+void seviri_stats_init(struct seviri_band_stats *s);
+void seviri_stats_add_line(struct seviri_band_stats *s, const ushort *counts,
+                           const float *data, uint n, float fill_value);
+void seviri_stats_add_counts(struct seviri_band_stats *s, const ushort *counts,
+                             uint n);
+void seviri_stats_merge(struct seviri_band_stats *s,
+                        const struct seviri_band_stats *s2);
+int seviri_stats_add(struct seviri_stats_data *d,
+                     const struct seviri_stats_data *d2);
+double seviri_stats_std(const struct seviri_band_stats *s);
+double seviri_stats_fill_fraction(const struct seviri_band_stats *s);
+int seviri_stats_free(struct seviri_stats_data *d);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_UTIL_H */